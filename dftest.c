@@ -22,6 +22,7 @@
 #include <ws_exit_codes.h>
 
 #include <epan/epan.h>
+#include <epan/epan_dissect.h>
 #include <epan/timestamp.h>
 #include <epan/prefs.h>
 #include <epan/dfilter/dfilter.h>
@@ -55,6 +56,10 @@ static long opt_optimize = 1;
 static int opt_show_types;
 static int opt_dump_refs;
 static int opt_dump_macros;
+static char *opt_benchmark;
+
+/* How many times the filter is applied to each packet when benchmarking. */
+#define BENCHMARK_PASSES 100
 
 static int64_t elapsed_expand;
 static int64_t elapsed_compile;
@@ -117,6 +122,9 @@ print_usage(int status)
      * development the --refs option to dftest is useless because it will just
      * print empty reference vectors. */
     fprintf(fp, "      --refs          dump some runtime data structures\n");
+    fprintf(fp, "      --benchmark=<capture file>\n");
+    fprintf(fp, "                      measure the time to apply the filter to\n");
+    fprintf(fp, "                      each packet in the capture file\n");
     fprintf(fp, "  -h, --help          display this help and exit\n");
     fprintf(fp, "  -v, --version       print version\n");
     fprintf(fp, "\n");
@@ -235,6 +243,108 @@ compile_filter(const char *text, dfilter_t **dfp)
     return ok;
 }
 
+static const nstime_t *
+dftest_get_frame_ts(struct packet_provider_data *prov _U_, uint32_t frame_num _U_)
+{
+    static nstime_t empty;
+
+    return &empty;
+}
+
+/*
+ * Dissect each packet of a capture file and time applying the filter to
+ * the dissected tree, excluding the dissection itself.
+ */
+static bool
+benchmark_filter(dfilter_t *df, const char *filename)
+{
+    static const struct packet_provider_funcs funcs = {
+        dftest_get_frame_ts,
+        NULL,
+        NULL,
+        NULL
+    };
+    wtap        *wth;
+    epan_t      *session;
+    epan_dissect_t *edt;
+    wtap_rec     rec;
+    Buffer       buf;
+    frame_data   fdata, ref_frame, prev_dis_frame;
+    const frame_data *ref = NULL, *prev_dis = NULL;
+    nstime_t     elapsed_time = NSTIME_INIT_ZERO;
+    uint32_t     cum_bytes = 0;
+    uint32_t     framenum = 0, matched = 0;
+    int64_t      data_offset, start, elapsed = 0;
+    int          err;
+    char        *err_info;
+    bool         passed = false;
+
+    wth = wtap_open_offline(filename, WTAP_TYPE_AUTO, &err, &err_info, false);
+    if (wth == NULL) {
+        cfile_open_failure_message(filename, err, err_info);
+        return false;
+    }
+
+    session = epan_new(NULL, &funcs);
+    edt = epan_dissect_new(session, true, false);
+    wtap_rec_init(&rec);
+    ws_buffer_init(&buf, 1514);
+
+    while (wtap_read(wth, &rec, &buf, &err, &err_info, &data_offset)) {
+        if (rec.rec_type != REC_TYPE_PACKET) {
+            wtap_rec_reset(&rec);
+            continue;
+        }
+        framenum++;
+        frame_data_init(&fdata, framenum, &rec, data_offset, cum_bytes);
+        frame_data_set_before_dissect(&fdata, &elapsed_time, &ref, prev_dis);
+        if (ref == &fdata) {
+            ref_frame = fdata;
+            ref = &ref_frame;
+        }
+
+        epan_dissect_prime_with_dfilter(edt, df);
+        epan_dissect_run(edt, wtap_file_type_subtype(wth), &rec,
+                tvb_new_real_data(ws_buffer_start_ptr(&buf),
+                    rec.rec_header.packet_header.caplen,
+                    rec.rec_header.packet_header.caplen),
+                &fdata, NULL);
+
+        start = g_get_monotonic_time();
+        for (int i = 0; i < BENCHMARK_PASSES; i++) {
+            passed = dfilter_apply_edt(df, edt);
+        }
+        elapsed += g_get_monotonic_time() - start;
+        if (passed)
+            matched++;
+
+        frame_data_set_after_dissect(&fdata, &cum_bytes);
+        prev_dis_frame = fdata;
+        prev_dis = &prev_dis_frame;
+        epan_dissect_reset(edt);
+        frame_data_destroy(&fdata);
+        wtap_rec_reset(&rec);
+    }
+    if (err != 0) {
+        cfile_read_failure_message(filename, err, err_info);
+    }
+
+    printf("\nBenchmark:\n %"PRIu32" packets, %"PRIu32" matched\n",
+            framenum, matched);
+    if (framenum > 0) {
+        printf(" %.1f ns per packet (%d passes, %"PRId64" µs)\n",
+                elapsed * 1000.0 / ((double)framenum * BENCHMARK_PASSES),
+                BENCHMARK_PASSES, elapsed);
+    }
+
+    epan_dissect_free(edt);
+    epan_free(session);
+    wtap_rec_cleanup(&rec);
+    ws_buffer_free(&buf);
+    wtap_close(wth);
+    return err == 0;
+}
+
 static int
 optarg_to_digit(const char *arg)
 {
@@ -297,6 +407,7 @@ main(int argc, char **argv)
         { "optimize", ws_required_argument, 0, 1000 },
         { "types",    ws_no_argument,   0, 2000 },
         { "refs",     ws_no_argument,   0, 3000 },
+        { "benchmark", ws_required_argument, 0, 4000 },
         { NULL,       0,                0,  0   }
     };
     int opt;
@@ -355,6 +466,9 @@ main(int argc, char **argv)
             case 3000:
                 opt_dump_refs = 1;
                 break;
+            case 4000:
+                opt_benchmark = ws_optarg;
+                break;
             case 'v':
                 show_version();
                 exit(EXIT_SUCCESS);
@@ -516,6 +630,13 @@ main(int argc, char **argv)
     if (opt_timer)
         print_elapsed();
 
+    if (opt_benchmark) {
+        if (!benchmark_filter(df, opt_benchmark)) {
+            exit_status = WS_EXIT_OPEN_ERROR;
+            goto out;
+        }
+    }
+
     exit_status = 0;
 
 out:
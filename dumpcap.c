@@ -121,11 +121,24 @@ FILE *debug_log;   /* for logging debug messages to  */
 #include <stdarg.h> /* va_copy */
 #endif
 
-static GAsyncQueue *pcap_queue;
-static int64_t pcap_queue_bytes;
-static int64_t pcap_queue_packets;
+/*
+ * When using a separate thread per interface, each capture thread puts
+ * the packets it reads into its capture_src's queue, and the main thread
+ * takes them out and writes them.  The limits apply to all the queues
+ * together; the counts are updated atomically by the capture threads and
+ * the main thread, and the main thread sleeps on pcap_queue_cond when
+ * there's nothing queued.  The counts are pointer-sized, which is the
+ * widest GLib can update atomically, so that a byte limit near INT_MAX
+ * plus the records that go over it can't overflow them.  (Where pointers
+ * are 32 bits, queues that large couldn't be allocated anyway.)
+ */
+static gssize pcap_queue_bytes;
+static gssize pcap_queue_packets;
 static int64_t pcap_queue_byte_limit;
 static int64_t pcap_queue_packet_limit;
+static GMutex pcap_queue_mtx;
+static GCond pcap_queue_cond;
+static int pcap_queue_writer_waiting;
 
 static bool capture_child; /* false: standalone call, true: this is an Wireshark capture child */
 static const char *report_capture_filename; /* capture child file name */
@@ -267,6 +280,7 @@ typedef struct _pcapng_pipe_info {
 } pcapng_pipe_info_t;
 
 struct _loop_data; /* forward declaration so we can use it in the cap_pipe_dispatch function pointer */
+typedef struct _pcap_queue pcap_queue_t;
 
 /*
  * A source of packets from which we're capturing.
@@ -283,6 +297,7 @@ typedef struct _capture_src {
     unsigned                     interface_id;
     unsigned                     idb_id;                 /**< If from_pcapng is false, the output IDB interface ID. Otherwise the mapping in src_iface_to_global is used. */
     GThread                     *tid;
+    pcap_queue_t                *queue;                  /**< Packets read by the thread, waiting to be written */
     int                          snaplen;
     int                          linktype;
     bool                         ts_nsec;                /**< true if we're using nanosecond precision. */
@@ -345,9 +360,8 @@ typedef struct _loop_data {
     GArray   *saved_idbs;          /**< Array of saved_idb_t, written when we have a new section or output file. */
     GRWLock   saved_shb_idb_lock;  /**< Saved IDB RW mutex */
     /* output file(s) */
-    FILE     *pdh;
+    pcapio_stream *pdh;
     int       save_file_fd;
-    char     *io_buffer;           /**< Our IO buffer if we increase the size from the standard size */
     uint64_t  bytes_written;       /**< Bytes written for the current file. */
     /* autostop conditions */
     int       packets_written;     /**< Packets written for the current file. */
@@ -358,15 +372,46 @@ typedef struct _loop_data {
     int      interval_s;
 } loop_data;
 
+/*
+ * A packet or pcapng block in a queue; its data follows the element, at
+ * PCAP_QUEUE_DATA_OFFSET, and the next element follows that, 8-byte
+ * aligned.
+ */
 typedef struct _pcap_queue_element {
-    capture_src        *pcap_src;
+    capture_src        *pcap_src;               /**< NULL if the rest of the queue's buffer is unused */
     union {
         struct pcap_pkthdr  phdr;
         pcapng_block_header_t  bh;
     } u;
-    uint8_t             *pd;
+    int                 rec_len;                /**< Length of the element, its data and padding */
 } pcap_queue_element;
 
+#define PCAP_QUEUE_ALIGN(len)   (((len) + 7) & ~(size_t)7)
+#define PCAP_QUEUE_DATA_OFFSET  PCAP_QUEUE_ALIGN(sizeof (pcap_queue_element))
+
+/*
+ * A single-producer, single-consumer ring buffer of pcap_queue_elements,
+ * allocated when the capture starts.  Only the capture thread changes
+ * head, and only the main thread changes tail, so neither needs a lock;
+ * head == tail means the queue is empty, so it's never allowed to fill
+ * up completely.  An element that doesn't fit between head and the end
+ * of the buffer is put at the start of it, and a pcap_queue_element with
+ * a NULL pcap_src is left at head, if there's room for one, to tell the
+ * main thread to go back to the start.
+ */
+struct _pcap_queue {
+    uint8_t            *buf;
+    int                 size;
+    int                 head;                   /**< Where the next element will be put */
+    int                 tail;                   /**< Where the next element will be taken from */
+};
+
+/* The most packets we write from the queues before checking the capture conditions */
+#define PCAP_QUEUE_WRITE_BATCH  256
+
+/* The size of a queue if we've only been given a packet limit */
+#define PCAP_QUEUE_DEFAULT_SIZE (64 * 1024 * 1024)
+
 /*
  * This needs to be static, so that the SIGINT handler can clear the "go"
  * flag and for saved_shb_idb_lock.
@@ -421,6 +466,8 @@ static GPtrArray *capture_comments;
 static bool quiet;
 static bool really_quiet;
 static bool use_threads;
+static ws_parallel_compression_t write_compression_type;
+static unsigned write_compress_threads;  /* 0 if we're not compressing as we write */
 static uint64_t start_time;
 
 static void capture_loop_write_packet_cb(uint8_t *pcap_src_p, const struct pcap_pkthdr *phdr,
@@ -531,6 +578,10 @@ print_usage(FILE *output)
     fprintf(output, "  --capture-comment <comment>\n");
     fprintf(output, "                           add a capture comment to the output file\n");
     fprintf(output, "                           (only for pcapng)\n");
+    fprintf(output, "  --compress <type>        write the output file(s) compressed with <type>:\n");
+    fprintf(output, "                           gzip, lz4 or zstd\n");
+    fprintf(output, "  --compress-threads <threads>\n");
+    fprintf(output, "                           number of threads to compress on (def: 1)\n");
     fprintf(output, "  --temp-dir <directory>   write temporary files to this directory\n");
     fprintf(output, "                           (default: %s)\n", g_get_tmp_dir());
     fprintf(output, "\n");
@@ -3517,26 +3568,11 @@ capture_loop_init_output(capture_options *capture_opts, loop_data *ld, char *err
     /* Set up to write to the capture file. */
     if (capture_opts->multi_files_on) {
         ld->pdh = ringbuf_init_libpcap_fdopen(&err);
+    } else if (write_compress_threads != 0) {
+        ld->pdh = pcapio_fdopen_compressed(ld->save_file_fd, write_compression_type,
+                                           write_compress_threads, &err);
     } else {
-        ld->pdh = ws_fdopen(ld->save_file_fd, "wb");
-        if (ld->pdh == NULL) {
-            err = errno;
-        } else {
-            size_t buffsize = IO_BUF_SIZE;
-#ifdef HAVE_STRUCT_STAT_ST_BLKSIZE
-            ws_statb64 statb;
-
-            if (ws_fstat64(ld->save_file_fd, &statb) == 0) {
-                if (statb.st_blksize > IO_BUF_SIZE) {
-                    buffsize = statb.st_blksize;
-                }
-            }
-#endif
-            /* Increase the size of the IO buffer */
-            ld->io_buffer = (char *)g_malloc(buffsize);
-            setvbuf(ld->pdh, ld->io_buffer, _IOFBF, buffsize);
-            ws_debug("capture_loop_init_output: buffsize %zu", buffsize);
-        }
+        ld->pdh = pcapio_fdopen(ld->save_file_fd, &err);
     }
     if (ld->pdh) {
         bool successful;
@@ -3554,10 +3590,8 @@ capture_loop_init_output(capture_options *capture_opts, loop_data *ld, char *err
                                                 pcap_src->ts_nsec, &ld->bytes_written, &err);
         }
         if (!successful) {
-            fclose(ld->pdh);
+            pcapio_close(ld->pdh, NULL);
             ld->pdh = NULL;
-            g_free(ld->io_buffer);
-            ld->io_buffer = NULL;
         }
     }
 
@@ -3588,7 +3622,6 @@ capture_loop_close_output(capture_options *capture_opts, loop_data *ld, int *err
     unsigned int i;
     capture_src *pcap_src;
     uint64_t     end_time = create_timestamp();
-    bool success;
 
     ws_debug("capture_loop_close_output");
 
@@ -3621,17 +3654,7 @@ capture_loop_close_output(capture_options *capture_opts, loop_data *ld, int *err
                 }
             }
         }
-        if (fclose(ld->pdh) == EOF) {
-            if (err_close != NULL) {
-                *err_close = errno;
-            }
-            success = false;
-        } else {
-            success = true;
-        }
-        g_free(ld->io_buffer);
-        ld->io_buffer = NULL;
-        return success;
+        return pcapio_close(ld->pdh, err_close);
     }
 }
 
@@ -3720,15 +3743,16 @@ capture_loop_dispatch(loop_data *ld,
                  * "select()" says we can read from it without blocking; go for
                  * it.
                  *
-                 * We don't have pcap_breakloop(), so we only process one packet
-                 * per pcap_dispatch() call, to allow a signal to stop the
-                 * processing immediately, rather than processing all packets
-                 * in a batch before quitting.
+                 * Process all the packets in the buffer, rather than one
+                 * per pcap_dispatch() call; a signal stops the processing
+                 * in the middle of a batch, as capture_loop_stop() calls
+                 * pcap_breakloop(), and the callbacks ignore packets once
+                 * the "go" flag is cleared.
                  */
                 if (use_threads) {
-                    inpkts = pcap_dispatch(pcap_src->pcap_h, 1, capture_loop_queue_packet_cb, (uint8_t *)pcap_src);
+                    inpkts = pcap_dispatch(pcap_src->pcap_h, -1, capture_loop_queue_packet_cb, (uint8_t *)pcap_src);
                 } else {
-                    inpkts = pcap_dispatch(pcap_src->pcap_h, 1, capture_loop_write_packet_cb, (uint8_t *)pcap_src);
+                    inpkts = pcap_dispatch(pcap_src->pcap_h, -1, capture_loop_write_packet_cb, (uint8_t *)pcap_src);
                 }
                 if (inpkts < 0) {
                     if (inpkts == -1) {
@@ -3760,9 +3784,11 @@ capture_loop_dispatch(loop_data *ld,
              * stop capturing; instead, we check for an indication on a pipe
              * after processing packets.  We therefore process only one packet
              * at a time, so that we can check the pipe after every packet.
+             * The main thread checks the pipe when using a separate thread
+             * per interface, so the capture threads can process a batch.
              */
             if (use_threads) {
-                inpkts = pcap_dispatch(pcap_src->pcap_h, 1, capture_loop_queue_packet_cb, (uint8_t *)pcap_src);
+                inpkts = pcap_dispatch(pcap_src->pcap_h, -1, capture_loop_queue_packet_cb, (uint8_t *)pcap_src);
             } else {
                 inpkts = pcap_dispatch(pcap_src->pcap_h, 1, capture_loop_write_packet_cb, (uint8_t *)pcap_src);
             }
@@ -3903,6 +3929,8 @@ capture_loop_open_output(capture_options *capture_opts, int *save_file_fd,
                                              (capture_opts->has_ring_num_files) ? capture_opts->ring_num_files : 0,
                                              capture_opts->group_read_access,
                                              capture_opts->compress_type,
+                                             write_compression_type,
+                                             write_compress_threads,
                                              capture_opts->has_nametimenum);
 
                 /* capfile_name is unused as the ringbuffer provides its own filename. */
@@ -3998,8 +4026,14 @@ capture_loop_open_output(capture_options *capture_opts, int *save_file_fd,
         } else {
             suffix = ".pcap";
         }
+        if (write_compress_threads != 0) {
+            suffix = g_strconcat(suffix, ".", ws_parallel_writer_extension(write_compression_type), NULL);
+        } else {
+            suffix = g_strdup(suffix);
+        }
         *save_file_fd = create_tempfile(capture_opts->temp_dir, &capfile_name, prefix, suffix, &err_tempfile);
         g_free(prefix);
+        g_free(suffix);
         is_tempfile = true;
     }
 
@@ -4079,11 +4113,10 @@ do_file_switch_or_stop(capture_options *capture_opts)
             }
 
             if (!successful) {
-                fclose(global_ld.pdh);
+                /* The ring buffer still has the file, and closes it
+                   in ringbuf_libpcap_dump_close() */
                 global_ld.pdh = NULL;
                 global_ld.go = false;
-                g_free(global_ld.io_buffer);
-                global_ld.io_buffer = NULL;
                 return false;
             }
             if (global_ld.file_duration_timer) {
@@ -4092,7 +4125,7 @@ do_file_switch_or_stop(capture_options *capture_opts)
             if (global_ld.next_interval_time) {
                 global_ld.next_interval_time = get_next_time_interval(global_ld.interval_s);
             }
-            fflush(global_ld.pdh);
+            pcapio_flush(global_ld.pdh);
             if (global_ld.inpkts_to_sync_pipe) {
                 if (!quiet)
                     report_packet_count(global_ld.inpkts_to_sync_pipe);
@@ -4131,46 +4164,244 @@ pcap_read_handler(void* arg)
     return (NULL);
 }
 
-/* Try to pop an item off the packet queue and if it exists, write it */
+/*
+ * The size of the queue for a source whose packets or blocks are at most
+ * max_len bytes long: enough for the queue limits' worth of them, with
+ * their elements and padding, plus one more that goes over the byte limit
+ * and one that's wasted at the end of the buffer when the queue wraps.
+ */
+static int
+pcap_queue_size(unsigned max_len)
+{
+    uint64_t max_rec_len = PCAP_QUEUE_DATA_OFFSET + PCAP_QUEUE_ALIGN(max_len);
+    uint64_t size;
+
+    if (pcap_queue_byte_limit > 0 && pcap_queue_packet_limit > 0) {
+        size = pcap_queue_byte_limit + pcap_queue_packet_limit * (PCAP_QUEUE_DATA_OFFSET + 7);
+    } else if (pcap_queue_byte_limit > 0) {
+        /* Any number of packets; allow for packets as short as their elements */
+        size = pcap_queue_byte_limit * 2;
+    } else {
+        size = MIN(pcap_queue_packet_limit * max_rec_len, PCAP_QUEUE_DEFAULT_SIZE);
+    }
+    size += 2 * max_rec_len;
+    return (int)PCAP_QUEUE_ALIGN(MIN(size, G_MAXINT - 7));
+}
+
+static pcap_queue_t *
+pcap_queue_new(int size)
+{
+    pcap_queue_t *queue = g_new(pcap_queue_t, 1);
+
+    queue->buf = (uint8_t *)g_malloc(size);
+    queue->size = size;
+    queue->head = 0;
+    queue->tail = 0;
+    return queue;
+}
+
+static void
+pcap_queue_free(pcap_queue_t *queue)
+{
+    if (queue) {
+        g_free(queue->buf);
+        g_free(queue);
+    }
+}
+
+/*
+ * Called by the capture thread to copy a packet or block into the queue.
+ * Returns false, and queues nothing, if there isn't room for it.
+ */
 static bool
-capture_loop_dequeue_packet(void) {
-    pcap_queue_element *queue_element;
+pcap_queue_push(pcap_queue_t *queue, const pcap_queue_element *element,
+                const uint8_t *pd, unsigned len)
+{
+    int                 head = queue->head;
+    int                 tail = g_atomic_int_get(&queue->tail);
+    uint64_t            rec_len = PCAP_QUEUE_DATA_OFFSET + PCAP_QUEUE_ALIGN((uint64_t)len);
+    int                 pos;
+    pcap_queue_element *queued;
 
-    g_async_queue_lock(pcap_queue);
-    queue_element = (pcap_queue_element *)g_async_queue_timeout_pop_unlocked(pcap_queue, WRITER_THREAD_TIMEOUT);
-    if (queue_element) {
-        if (queue_element->pcap_src->from_pcapng) {
-            pcap_queue_bytes -= queue_element->u.bh.block_total_length;
+    if (rec_len >= (uint64_t)queue->size) {
+        return false;
+    }
+    if (head >= tail) {
+        /* The free space is from head to the end, then up to tail. */
+        if (head + (int)rec_len < queue->size ||
+            (head + (int)rec_len == queue->size && tail > 0)) {
+            pos = head;
+        } else if ((int)rec_len < tail) {
+            pos = 0;
         } else {
-            pcap_queue_bytes -= queue_element->u.phdr.caplen;
+            return false;
+        }
+    } else {
+        /* The free space is from head up to tail. */
+        if (head + (int)rec_len < tail) {
+            pos = head;
+        } else {
+            return false;
         }
-        pcap_queue_packets -= 1;
     }
-    g_async_queue_unlock(pcap_queue);
-    if (queue_element) {
-        if (queue_element->pcap_src->from_pcapng) {
-            ws_info("Dequeued a block of type 0x%08x of length %d captured on interface %d.",
-                  queue_element->u.bh.block_type, queue_element->u.bh.block_total_length,
-                  queue_element->pcap_src->interface_id);
 
-            capture_loop_write_pcapng_cb(queue_element->pcap_src,
-                                        &queue_element->u.bh,
-                                        queue_element->pd);
-        } else {
-            ws_info("Dequeued a packet of length %d captured on interface %d.",
-                queue_element->u.phdr.caplen, queue_element->pcap_src->interface_id);
+    if (pos != head && queue->size - head >= (int)PCAP_QUEUE_DATA_OFFSET) {
+        ((pcap_queue_element *)(void *)(queue->buf + head))->pcap_src = NULL;
+    }
+    queued = (pcap_queue_element *)(void *)(queue->buf + pos);
+    *queued = *element;
+    queued->rec_len = (int)rec_len;
+    memcpy(queue->buf + pos + PCAP_QUEUE_DATA_OFFSET, pd, len);
+
+    head = pos + (int)rec_len;
+    if (head == queue->size) {
+        head = 0;
+    }
+    /* Publish the element; g_atomic_int_set() is a full memory barrier. */
+    g_atomic_int_set(&queue->head, head);
+    return true;
+}
 
-            capture_loop_write_packet_cb((uint8_t *) queue_element->pcap_src,
-                                        &queue_element->u.phdr,
-                                        queue_element->pd);
+/*
+ * Called by the main thread to get the oldest element in the queue, which
+ * stays there, with its data, until pcap_queue_pop() is called.
+ */
+static pcap_queue_element *
+pcap_queue_peek(pcap_queue_t *queue)
+{
+    int                 head = g_atomic_int_get(&queue->head);
+    int                 tail = queue->tail;
+    pcap_queue_element *element;
+
+    if (tail == head) {
+        return NULL;
+    }
+    if (queue->size - tail < (int)PCAP_QUEUE_DATA_OFFSET ||
+        ((pcap_queue_element *)(void *)(queue->buf + tail))->pcap_src == NULL) {
+        /* The capture thread went back to the start of the buffer. */
+        tail = 0;
+        g_atomic_int_set(&queue->tail, tail);
+        if (tail == head) {
+            return NULL;
+        }
+    }
+    element = (pcap_queue_element *)(void *)(queue->buf + tail);
+    return element;
+}
+
+static void
+pcap_queue_pop(pcap_queue_t *queue, const pcap_queue_element *element)
+{
+    int tail = queue->tail + element->rec_len;
+
+    if (tail == queue->size) {
+        tail = 0;
+    }
+    g_atomic_int_set(&queue->tail, tail);
+}
+
+/* Wake up the main thread if it's waiting for packets to be queued */
+static void
+pcap_queue_wake_writer(void)
+{
+    if (g_atomic_int_get(&pcap_queue_writer_waiting)) {
+        g_mutex_lock(&pcap_queue_mtx);
+        g_cond_signal(&pcap_queue_cond);
+        g_mutex_unlock(&pcap_queue_mtx);
+    }
+}
+
+/*
+ * Write up to max queued packets and blocks, taking one from each source's
+ * queue in turn, so that a busy interface doesn't hold up the others.
+ * Returns the number written.
+ */
+static int
+capture_loop_write_queued_packets(int max)
+{
+    int                 written = 0;
+    bool                queued = true;
+    capture_src        *pcap_src;
+    pcap_queue_element *queue_element;
+    uint8_t            *pd;
+    unsigned            i;
+
+    while (queued && written < max) {
+        queued = false;
+        for (i = 0; i < global_ld.pcaps->len && written < max; i++) {
+            pcap_src = g_array_index(global_ld.pcaps, capture_src *, i);
+            queue_element = pcap_queue_peek(pcap_src->queue);
+            if (queue_element == NULL) {
+                continue;
+            }
+            queued = true;
+            pd = (uint8_t *)queue_element + PCAP_QUEUE_DATA_OFFSET;
+            if (pcap_src->from_pcapng) {
+                ws_info("Dequeued a block of type 0x%08x of length %d captured on interface %d.",
+                      queue_element->u.bh.block_type, queue_element->u.bh.block_total_length,
+                      pcap_src->interface_id);
+
+                capture_loop_write_pcapng_cb(pcap_src, &queue_element->u.bh, pd);
+                g_atomic_pointer_add(&pcap_queue_bytes, -(gssize)queue_element->u.bh.block_total_length);
+            } else {
+                ws_info("Dequeued a packet of length %d captured on interface %d.",
+                    queue_element->u.phdr.caplen, pcap_src->interface_id);
+
+                capture_loop_write_packet_cb((uint8_t *) pcap_src, &queue_element->u.phdr, pd);
+                g_atomic_pointer_add(&pcap_queue_bytes, -(gssize)queue_element->u.phdr.caplen);
+            }
+            g_atomic_pointer_add(&pcap_queue_packets, -1);
+            pcap_queue_pop(pcap_src->queue, queue_element);
+            written++;
+        }
+    }
+    return written;
+}
+
+static bool
+capture_loop_packets_queued(void)
+{
+    capture_src *pcap_src;
+    unsigned     i;
+
+    for (i = 0; i < global_ld.pcaps->len; i++) {
+        pcap_src = g_array_index(global_ld.pcaps, capture_src *, i);
+        if (g_atomic_int_get(&pcap_src->queue->head) != pcap_src->queue->tail) {
+            return true;
         }
-        g_free(queue_element->pd);
-        g_free(queue_element);
-        return true;
     }
     return false;
 }
 
+/*
+ * Write a batch of queued packets; if there aren't any, wait up to
+ * WRITER_THREAD_TIMEOUT for some.  Returns the number written.
+ */
+static int
+capture_loop_dequeue_packets(void)
+{
+    int     written;
+    int64_t end_time;
+
+    written = capture_loop_write_queued_packets(PCAP_QUEUE_WRITE_BATCH);
+    if (written == 0) {
+        end_time = g_get_monotonic_time() + WRITER_THREAD_TIMEOUT;
+        g_mutex_lock(&pcap_queue_mtx);
+        /* Set the flag before looking, so a capture thread that queues a
+           packet after we've looked will signal us. */
+        g_atomic_int_set(&pcap_queue_writer_waiting, 1);
+        while (!capture_loop_packets_queued()) {
+            if (!g_cond_wait_until(&pcap_queue_cond, &pcap_queue_mtx, end_time)) {
+                break;
+            }
+        }
+        g_atomic_int_set(&pcap_queue_writer_waiting, 0);
+        g_mutex_unlock(&pcap_queue_mtx);
+        written = capture_loop_write_queued_packets(PCAP_QUEUE_WRITE_BATCH);
+    }
+    return written;
+}
+
 /*
  * Note: this code will never be run on any OS other than Windows.
  *
@@ -4237,7 +4468,6 @@ capture_loop_start(capture_options *capture_opts, bool *stats_known, struct pcap
     global_ld.err                 = 0;  /* no error seen yet */
     global_ld.pdh                 = NULL;
     global_ld.save_file_fd        = -1;
-    global_ld.io_buffer           = NULL;
     global_ld.file_count          = 0;
     global_ld.file_duration_timer = NULL;
     global_ld.next_interval_time  = 0;
@@ -4311,7 +4541,7 @@ capture_loop_start(capture_options *capture_opts, bool *stats_known, struct pcap
            message to our parent so that they'll open the capture file and
            update its windows to indicate that we have a live capture in
            progress. */
-        fflush(global_ld.pdh);
+        pcapio_flush(global_ld.pdh);
         report_new_capture_file(capture_opts->save_file);
     }
 
@@ -4348,11 +4578,11 @@ capture_loop_start(capture_options *capture_opts, bool *stats_known, struct pcap
     /* WOW, everything is prepared! */
     /* please fasten your seat belts, we will enter now the actual capture loop */
     if (use_threads) {
-        pcap_queue = g_async_queue_new();
         pcap_queue_bytes = 0;
         pcap_queue_packets = 0;
         for (i = 0; i < global_ld.pcaps->len; i++) {
             pcap_src = g_array_index(global_ld.pcaps, capture_src *, i);
+            pcap_src->queue = pcap_queue_new(pcap_queue_size(MAX(pcap_src->cap_pipe_max_pkt_size, WTAP_MAX_PACKET_SIZE_STANDARD)));
             /* XXX - Add an interface name here? */
             pcap_src->tid = g_thread_new("Capture read", pcap_read_handler, pcap_src);
         }
@@ -4360,13 +4590,7 @@ capture_loop_start(capture_options *capture_opts, bool *stats_known, struct pcap
     while (global_ld.go) {
         /* dispatch incoming packets */
         if (use_threads) {
-            bool dequeued = capture_loop_dequeue_packet();
-
-            if (dequeued) {
-                inpkts = 1;
-            } else {
-                inpkts = 0;
-            }
+            inpkts = capture_loop_dequeue_packets();
         } else {
             pcap_src = g_array_index(global_ld.pcaps, capture_src *, 0);
             inpkts = capture_loop_dispatch(&global_ld, errmsg,
@@ -4404,7 +4628,7 @@ capture_loop_start(capture_options *capture_opts, bool *stats_known, struct pcap
 
         if (inpkts > 0) {
             if (capture_opts->output_to_pipe) {
-                fflush(global_ld.pdh);
+                pcapio_flush(global_ld.pdh);
             }
         } /* inpkts */
 
@@ -4434,7 +4658,7 @@ capture_loop_start(capture_options *capture_opts, bool *stats_known, struct pcap
             /* Let the parent process know. */
             if (global_ld.inpkts_to_sync_pipe) {
                 /* do sync here */
-                fflush(global_ld.pdh);
+                pcapio_flush(global_ld.pdh);
 
                 /* Send our parent a message saying we've written out
                    "global_ld.inpkts_to_sync_pipe" packets to the capture file. */
@@ -4476,15 +4700,16 @@ capture_loop_start(capture_options *capture_opts, bool *stats_known, struct pcap
             g_thread_join(pcap_src->tid);
             ws_info("Thread of interface %u terminated.", pcap_src->interface_id);
         }
-        while (1) {
-            bool dequeued = capture_loop_dequeue_packet();
-            if (!dequeued) {
-                break;
-            }
+        while (capture_loop_write_queued_packets(PCAP_QUEUE_WRITE_BATCH) > 0) {
             if (capture_opts->output_to_pipe) {
-                fflush(global_ld.pdh);
+                pcapio_flush(global_ld.pdh);
             }
         }
+        for (i = 0; i < global_ld.pcaps->len; i++) {
+            pcap_src = g_array_index(global_ld.pcaps, capture_src *, i);
+            pcap_queue_free(pcap_src->queue);
+            pcap_src->queue = NULL;
+        }
     }
 
 
@@ -4804,13 +5029,13 @@ capture_loop_wrote_one_packet(capture_src *pcap_src) {
 
     /* check -c NUM */
     if (global_capture_opts.has_autostop_packets && global_ld.packets_captured >= global_capture_opts.autostop_packets) {
-        fflush(global_ld.pdh);
+        pcapio_flush(global_ld.pdh);
         global_ld.go = false;
         return;
     }
     /* check -a packets:NUM (treat like -c NUM) */
     if (global_capture_opts.has_autostop_written_packets && global_ld.packets_captured >= global_capture_opts.autostop_written_packets) {
-        fflush(global_ld.pdh);
+        pcapio_flush(global_ld.pdh);
         global_ld.go = false;
         return;
     }
@@ -4874,7 +5099,7 @@ capture_loop_write_pcapng_cb(capture_src *pcap_src, const pcapng_block_header_t
                                        bh->block_total_length,
                                        &global_ld.bytes_written, &err);
 
-        fflush(global_ld.pdh);
+        pcapio_flush(global_ld.pdh);
         if (!successful) {
             global_ld.go = false;
             global_ld.err = err;
@@ -4952,8 +5177,8 @@ capture_loop_queue_packet_cb(uint8_t *pcap_src_p, const struct pcap_pkthdr *phdr
                              const uint8_t *pd)
 {
     capture_src        *pcap_src = (capture_src *) (void *) pcap_src_p;
-    pcap_queue_element *queue_element;
-    bool                limit_reached;
+    pcap_queue_element  queue_element;
+    bool                queued;
 
     /* We may be called multiple times from pcap_dispatch(); if we've set
        the "stop capturing" flag, ignore this packet, as we're not
@@ -4963,54 +5188,42 @@ capture_loop_queue_packet_cb(uint8_t *pcap_src_p, const struct pcap_pkthdr *phdr
         return;
     }
 
-    queue_element = g_new(pcap_queue_element, 1);
-    if (queue_element == NULL) {
-       pcap_src->dropped++;
-       return;
-    }
-    queue_element->pcap_src = pcap_src;
-    queue_element->u.phdr = *phdr;
-    queue_element->pd = (uint8_t *)g_malloc(phdr->caplen);
-    if (queue_element->pd == NULL) {
-        pcap_src->dropped++;
-        g_free(queue_element);
-        return;
-    }
-    memcpy(queue_element->pd, pd, phdr->caplen);
-    g_async_queue_lock(pcap_queue);
-    if (((pcap_queue_byte_limit == 0) || (pcap_queue_bytes < pcap_queue_byte_limit)) &&
-        ((pcap_queue_packet_limit == 0) || (pcap_queue_packets < pcap_queue_packet_limit))) {
-        limit_reached = false;
-        g_async_queue_push_unlocked(pcap_queue, queue_element);
-        pcap_queue_bytes += phdr->caplen;
-        pcap_queue_packets += 1;
+    queue_element.pcap_src = pcap_src;
+    queue_element.u.phdr = *phdr;
+    if (((pcap_queue_byte_limit == 0) || ((gssize)g_atomic_pointer_get(&pcap_queue_bytes) < pcap_queue_byte_limit)) &&
+        ((pcap_queue_packet_limit == 0) || ((gssize)g_atomic_pointer_get(&pcap_queue_packets) < pcap_queue_packet_limit))) {
+        /* Count the packet first, so the main thread never sees the counts go negative. */
+        g_atomic_pointer_add(&pcap_queue_bytes, (gssize)phdr->caplen);
+        g_atomic_pointer_add(&pcap_queue_packets, 1);
+        queued = pcap_queue_push(pcap_src->queue, &queue_element, pd, phdr->caplen);
+        if (!queued) {
+            g_atomic_pointer_add(&pcap_queue_bytes, -(gssize)phdr->caplen);
+            g_atomic_pointer_add(&pcap_queue_packets, -1);
+        }
     } else {
-        limit_reached = true;
+        queued = false;
     }
-    g_async_queue_unlock(pcap_queue);
-    if (limit_reached) {
+    if (!queued) {
         pcap_src->dropped++;
-        g_free(queue_element->pd);
-        g_free(queue_element);
         ws_info("Dropped a packet of length %d captured on interface %u.",
               phdr->caplen, pcap_src->interface_id);
     } else {
         pcap_src->received++;
+        pcap_queue_wake_writer();
         ws_info("Queued a packet of length %d captured on interface %u.",
               phdr->caplen, pcap_src->interface_id);
     }
-    /* I don't want to hold the mutex over the debug output. So the
-       output may be wrong */
-    ws_info("Queue size is now %" PRId64 " bytes (%" PRId64 " packets)",
-          pcap_queue_bytes, pcap_queue_packets);
+    /* The other threads may change the counts, so the output may be wrong */
+    ws_info("Queue size is now %" G_GSSIZE_FORMAT " bytes (%" G_GSSIZE_FORMAT " packets)",
+          (gssize)g_atomic_pointer_get(&pcap_queue_bytes), (gssize)g_atomic_pointer_get(&pcap_queue_packets));
 }
 
 /* one pcapng block was captured, queue it */
 static void
 capture_loop_queue_pcapng_cb(capture_src *pcap_src, const pcapng_block_header_t *bh, uint8_t *pd)
 {
-    pcap_queue_element *queue_element;
-    bool                limit_reached;
+    pcap_queue_element  queue_element;
+    bool                queued;
 
     /* We may be called multiple times from pcap_dispatch(); if we've set
        the "stop capturing" flag, ignore this packet, as we're not
@@ -5020,46 +5233,33 @@ capture_loop_queue_pcapng_cb(capture_src *pcap_src, const pcapng_block_header_t
         return;
     }
 
-    queue_element = g_new(pcap_queue_element, 1);
-    if (queue_element == NULL) {
-       pcap_src->dropped++;
-       return;
-    }
-    queue_element->pcap_src = pcap_src;
-    queue_element->u.bh = *bh;
-    queue_element->pd = (uint8_t *)g_malloc(bh->block_total_length);
-    if (queue_element->pd == NULL) {
-        pcap_src->dropped++;
-        g_free(queue_element);
-        return;
-    }
-    memcpy(queue_element->pd, pd, bh->block_total_length);
-    g_async_queue_lock(pcap_queue);
-    if (((pcap_queue_byte_limit == 0) || (pcap_queue_bytes < pcap_queue_byte_limit)) &&
-        ((pcap_queue_packet_limit == 0) || (pcap_queue_packets < pcap_queue_packet_limit))) {
-        limit_reached = false;
-        g_async_queue_push_unlocked(pcap_queue, queue_element);
-        pcap_queue_bytes += bh->block_total_length;
-        pcap_queue_packets += 1;
+    queue_element.pcap_src = pcap_src;
+    queue_element.u.bh = *bh;
+    if (((pcap_queue_byte_limit == 0) || ((gssize)g_atomic_pointer_get(&pcap_queue_bytes) < pcap_queue_byte_limit)) &&
+        ((pcap_queue_packet_limit == 0) || ((gssize)g_atomic_pointer_get(&pcap_queue_packets) < pcap_queue_packet_limit))) {
+        g_atomic_pointer_add(&pcap_queue_bytes, (gssize)bh->block_total_length);
+        g_atomic_pointer_add(&pcap_queue_packets, 1);
+        queued = pcap_queue_push(pcap_src->queue, &queue_element, pd, bh->block_total_length);
+        if (!queued) {
+            g_atomic_pointer_add(&pcap_queue_bytes, -(gssize)bh->block_total_length);
+            g_atomic_pointer_add(&pcap_queue_packets, -1);
+        }
     } else {
-        limit_reached = true;
+        queued = false;
     }
-    g_async_queue_unlock(pcap_queue);
-    if (limit_reached) {
+    if (!queued) {
         pcap_src->dropped++;
-        g_free(queue_element->pd);
-        g_free(queue_element);
         ws_info("Dropped a packet of length %d captured on interface %u.",
               bh->block_total_length, pcap_src->interface_id);
     } else {
         pcap_src->received++;
+        pcap_queue_wake_writer();
         ws_info("Queued a block of type 0x%08x of length %d captured on interface %u.",
               bh->block_type, bh->block_total_length, pcap_src->interface_id);
     }
-    /* I don't want to hold the mutex over the debug output. So the
-       output may be wrong */
-    ws_info("Queue size is now %" PRId64 " bytes (%" PRId64 " packets)",
-          pcap_queue_bytes, pcap_queue_packets);
+    /* The other threads may change the counts, so the output may be wrong */
+    ws_info("Queue size is now %" G_GSSIZE_FORMAT " bytes (%" G_GSSIZE_FORMAT " packets)",
+          (gssize)g_atomic_pointer_get(&pcap_queue_bytes), (gssize)g_atomic_pointer_get(&pcap_queue_packets));
 }
 
 static int
@@ -5141,6 +5341,8 @@ gather_dumpcap_runtime_info(feature_list l)
 #ifdef _WIN32
 #define LONGOPT_SIGNAL_PIPE        LONGOPT_BASE_APPLICATION+4
 #endif
+#define LONGOPT_COMPRESS           LONGOPT_BASE_APPLICATION+5
+#define LONGOPT_COMPRESS_THREADS   LONGOPT_BASE_APPLICATION+6
 
 /* And now our feature presentation... [ fade to music ] */
 int
@@ -5158,6 +5360,8 @@ main(int argc, char *argv[])
 #ifdef _WIN32
         {"signal-pipe", ws_required_argument, NULL, LONGOPT_SIGNAL_PIPE},
 #endif
+        {"compress", ws_required_argument, NULL, LONGOPT_COMPRESS},
+        {"compress-threads", ws_required_argument, NULL, LONGOPT_COMPRESS_THREADS},
         {0, 0, 0, 0 }
     };
 
@@ -5176,6 +5380,8 @@ main(int argc, char *argv[])
     char             *set_chan_arg          = NULL;
     bool              machine_readable      = false;
     bool              print_statistics      = false;
+    bool              compress_output       = false;
+    unsigned          compress_threads      = 1;
     int               status, run_once_args = 0;
     int               i;
     unsigned          j;
@@ -5551,6 +5757,18 @@ main(int argc, char *argv[])
             }
             g_ptr_array_add(capture_comments, g_strdup(ws_optarg));
             break;
+        case LONGOPT_COMPRESS:
+            if (!ws_parallel_writer_compression_type(ws_optarg, &write_compression_type) ||
+                !ws_parallel_writer_can_compress(write_compression_type)) {
+                cmdarg_err("\"%s\" isn't a compression type this dumpcap can write",
+                           ws_optarg);
+                exit_main(1);
+            }
+            compress_output = true;
+            break;
+        case LONGOPT_COMPRESS_THREADS:
+            compress_threads = get_nonzero_uint32(ws_optarg, "number of compression threads");
+            break;
         case 'Z':
             capture_child = true;
             /*
@@ -5712,6 +5930,15 @@ main(int argc, char *argv[])
             exit_main(1);
         }
 
+        if (compress_output) {
+            if (global_capture_opts.compress_type != NULL &&
+                strcmp(global_capture_opts.compress_type, "none") != 0) {
+                cmdarg_err("--compress and --compress-type can't be used at the same time.");
+                exit_main(1);
+            }
+            write_compress_threads = compress_threads;
+        }
+
         /* Was the ring buffer option specified and, if so, does it make sense? */
         if (global_capture_opts.multi_files_on) {
             /* Ring buffer works only under certain conditions:
@@ -51,6 +51,7 @@
 #include <wsutil/cmdarg_err.h>
 #include <wsutil/filesystem.h>
 #include <wsutil/file_util.h>
+#include <wsutil/murmur3.h>
 #include <wsutil/plugins.h>
 #include <wsutil/privileges.h>
 #include <wsutil/report_message.h>
@@ -91,14 +92,33 @@ typedef struct _fd_hash_t {
     uint8_t    digest[16];
     uint32_t   len;
     nstime_t   frame_time;
+    uint64_t   seq;         /* number of the entry among all entries added */
+    uint64_t   prev_seq;    /* seq of the previous entry with the same digest
+                               and len, or seq if there is none */
 } fd_hash_t;
 
 #define DEFAULT_DUP_DEPTH       5   /* Used with -d */
-#define MAX_DUP_DEPTH     1000000   /* the maximum window (and actual size of fd_hash[]) for de-duplication */
+#define MAX_DUP_DEPTH     1000000   /* the maximum window (and size of fd_hash[]) for de-duplication */
 
-static fd_hash_t fd_hash[MAX_DUP_DEPTH];
-static int       dup_window    = DEFAULT_DUP_DEPTH;
-static int       cur_dup_entry;
+typedef enum {
+    DUP_HASH_MD5,
+    DUP_HASH_MURMUR3
+} dup_hash_e;
+
+/*
+ * fd_hash[] is a ring of the digests of the last dup_window frames.
+ * fd_hash_set holds the newest entry of fd_hash[] for each digest and
+ * length, so that looking for a duplicate doesn't mean comparing the
+ * digest with every entry.
+ */
+static fd_hash_t  *fd_hash;
+static unsigned    fd_hash_size;
+static GHashTable *fd_hash_set;
+static uint64_t    fd_hash_first_seq;   /* seq of the oldest entry in fd_hash[] */
+static uint64_t    fd_hash_next_seq;
+static fd_hash_t  *cur_dup_entry;
+static int         dup_window    = DEFAULT_DUP_DEPTH;
+static dup_hash_e  dup_hash      = DUP_HASH_MD5;
 
 static uint32_t  ignored_bytes;  /* Used with -I */
 
@@ -659,15 +679,115 @@ set_unused_info(const wtap_packet_header *phdr, uint8_t* fd) {
     }
 }
 
+static unsigned
+fd_hash_hash(const void *key)
+{
+    const fd_hash_t *entry = (const fd_hash_t *)key;
+
+    /* The digest is already well mixed. */
+    return pletoh32(entry->digest) ^ entry->len;
+}
+
+static gboolean
+fd_hash_equal(const void *a, const void *b)
+{
+    const fd_hash_t *entry_a = (const fd_hash_t *)a;
+    const fd_hash_t *entry_b = (const fd_hash_t *)b;
+
+    return entry_a->len == entry_b->len &&
+           memcmp(entry_a->digest, entry_b->digest, 16) == 0;
+}
+
+static void
+fd_hash_init(unsigned size)
+{
+    fd_hash_size = MAX(size, 1);
+    fd_hash = g_new(fd_hash_t, fd_hash_size);
+    fd_hash_set = g_hash_table_new(fd_hash_hash, fd_hash_equal);
+    fd_hash_first_seq = 0;
+    fd_hash_next_seq = 0;
+    cur_dup_entry = NULL;
+}
+
+static void
+fd_hash_cleanup(void)
+{
+    if (fd_hash_set != NULL) {
+        g_hash_table_destroy(fd_hash_set);
+        fd_hash_set = NULL;
+    }
+    g_free(fd_hash);
+    fd_hash = NULL;
+}
+
+/*
+ * Add the digest of a frame to fd_hash[], dropping the oldest entry if
+ * it's full, and make it the current entry.  Returns the newest earlier
+ * entry with the same digest and length, if there is one.
+ */
+static fd_hash_t *
+fd_hash_add(const uint8_t *fd, uint32_t len, uint32_t offset)
+{
+    fd_hash_t *entry, *prev;
+
+    if (fd_hash_next_seq - fd_hash_first_seq == fd_hash_size) {
+        entry = &fd_hash[fd_hash_first_seq % fd_hash_size];
+        if (g_hash_table_lookup(fd_hash_set, entry) == entry)
+            g_hash_table_remove(fd_hash_set, entry);
+        fd_hash_first_seq++;
+    }
+
+    entry = &fd_hash[fd_hash_next_seq % fd_hash_size];
+    entry->seq = fd_hash_next_seq++;
+    entry->len = len;
+    nstime_set_unset(&entry->frame_time);
+
+    /* Calculate our digest */
+    switch (dup_hash) {
+
+    case DUP_HASH_MURMUR3:
+        murmur3_128(&fd[offset], len - offset, 0, entry->digest);
+        break;
+
+    case DUP_HASH_MD5:
+    default:
+        gcry_md_hash_buffer(GCRY_MD_MD5, entry->digest, &fd[offset], len - offset);
+        break;
+    }
+
+    prev = (fd_hash_t *)g_hash_table_lookup(fd_hash_set, entry);
+    entry->prev_seq = (prev != NULL) ? prev->seq : entry->seq;
+    /* This replaces prev, if any, as the entry for the digest. */
+    g_hash_table_add(fd_hash_set, entry);
+
+    cur_dup_entry = entry;
+    return prev;
+}
+
+/*
+ * Returns the previous entry with the same digest and length as the
+ * given one, if it's still in fd_hash[].
+ */
+static fd_hash_t *
+fd_hash_prev(const fd_hash_t *entry)
+{
+    if (entry->prev_seq == entry->seq || entry->prev_seq < fd_hash_first_seq)
+        return NULL;
+    return &fd_hash[entry->prev_seq % fd_hash_size];
+}
+
+static const char *
+dup_hash_name(void)
+{
+    return (dup_hash == DUP_HASH_MURMUR3) ? "Murmur3" : "MD5";
+}
+
 static bool
 is_duplicate(uint8_t* fd, uint32_t len) {
-    int i;
     const struct ieee80211_radiotap_header* tap_header;
 
     /*Hint to ignore some bytes at the start of the frame for the digest calculation(-I option) */
     uint32_t offset = ignored_bytes;
-    uint32_t new_len;
-    uint8_t *new_fd;
 
     if (len <= ignored_bytes) {
         offset = 0;
@@ -681,65 +801,33 @@ is_duplicate(uint8_t* fd, uint32_t len) {
             offset = 0;
     }
 
-    new_fd  = &fd[offset];
-    new_len = len - (offset);
-
-    cur_dup_entry++;
-    if (cur_dup_entry >= dup_window)
-        cur_dup_entry = 0;
-
-    /* Calculate our digest */
-    gcry_md_hash_buffer(GCRY_MD_MD5, fd_hash[cur_dup_entry].digest, new_fd, new_len);
-
-    fd_hash[cur_dup_entry].len = len;
-
-    /* Look for duplicates */
-    for (i = 0; i < dup_window; i++) {
-        if (i == cur_dup_entry)
-            continue;
-
-        if (fd_hash[i].len == fd_hash[cur_dup_entry].len
-            && memcmp(fd_hash[i].digest, fd_hash[cur_dup_entry].digest, 16) == 0) {
-            return true;
-        }
-    }
-
-    return false;
+    /*
+     * Every entry in fd_hash[] other than the current one is one of
+     * the last dup_window - 1 frames.
+     */
+    return fd_hash_add(fd, len, offset) != NULL;
 }
 
 static bool
 is_duplicate_rel_time(uint8_t* fd, uint32_t len, const nstime_t *current) {
-    int i;
+    fd_hash_t *prev;
 
     /*Hint to ignore some bytes at the start of the frame for the digest calculation(-I option) */
     uint32_t offset = ignored_bytes;
-    uint32_t new_len;
-    uint8_t *new_fd;
 
     if (len <= ignored_bytes) {
         offset = 0;
     }
 
-    new_fd  = &fd[offset];
-    new_len = len - (offset);
-
-    cur_dup_entry++;
-    if (cur_dup_entry >= dup_window)
-        cur_dup_entry = 0;
-
-    /* Calculate our digest */
-    gcry_md_hash_buffer(GCRY_MD_MD5, fd_hash[cur_dup_entry].digest, new_fd, new_len);
-
-    fd_hash[cur_dup_entry].len = len;
-    fd_hash[cur_dup_entry].frame_time.secs = current->secs;
-    fd_hash[cur_dup_entry].frame_time.nsecs = current->nsecs;
+    prev = fd_hash_add(fd, len, offset);
+    cur_dup_entry->frame_time.secs = current->secs;
+    cur_dup_entry->frame_time.nsecs = current->nsecs;
 
     /*
      * Look for relative time related duplicates.
-     * This is hopefully a reasonably efficient mechanism for
-     * finding duplicates by rel time in the fd_hash[] cache.
-     * We check starting from the most recently added hash
-     * entries and work backwards towards older packets.
+     * We check the cached frames with the same digest, starting
+     * from the most recently added one and working backwards
+     * towards older packets.
      * This approach allows the dup test to be terminated
      * when the relative time of a cached entry is found to
      * be beyond the dup time window.
@@ -748,37 +836,13 @@ is_duplicate_rel_time(uint8_t* fd, uint32_t len, const nstime_t *current) {
      * "well-formed" in the sense that the packet timestamps are
      * in strict chronologically increasing order (which is NOT
      * always the case!!).
-     *
-     * The fd_hash[] table was deliberately created large (1,000,000).
-     * Looking for time related duplicates in large trace files with
-     * non-fractional dup time window values can potentially take
-     * a long time to complete.
      */
 
-    for (i = cur_dup_entry - 1;; i--) {
+    for (; prev != NULL; prev = fd_hash_prev(prev)) {
         nstime_t delta;
         int cmp;
 
-        if (i < 0)
-            i = dup_window - 1;
-
-        if (i == cur_dup_entry) {
-            /*
-             * We've decremented back to where we started.
-             * Check no more!
-             */
-            break;
-        }
-
-        if (nstime_is_unset(&(fd_hash[i].frame_time))) {
-            /*
-             * We've decremented to an unused fd_hash[] entry.
-             * Check no more!
-             */
-            break;
-        }
-
-        nstime_delta(&delta, current, &fd_hash[i].frame_time);
+        nstime_delta(&delta, current, &prev->frame_time);
 
         if (delta.secs < 0 || delta.nsecs < 0) {
             /*
@@ -811,10 +875,8 @@ is_duplicate_rel_time(uint8_t* fd, uint32_t len, const nstime_t *current) {
              * Check no more!
              */
             break;
-        } else if (fd_hash[i].len == fd_hash[cur_dup_entry].len
-                   && memcmp(fd_hash[i].digest, fd_hash[cur_dup_entry].digest, 16) == 0) {
-            return true;
         }
+        return true;
     }
 
     return false;
@@ -846,6 +908,8 @@ print_usage(FILE *output)
     fprintf(output, "                         Valid <dup window> values are 0 to %d.\n", MAX_DUP_DEPTH);
     fprintf(output, "                         NOTE: A <dup window> of 0 with -V (verbose option) is\n");
     fprintf(output, "                         useful to print MD5 hashes.\n");
+    fprintf(output, "  --dup-hash <hash>      hash to detect duplicates with: md5 (the default) or\n");
+    fprintf(output, "                         murmur3, which is much faster but not cryptographic.\n");
     fprintf(output, "  -w <dup time window>   remove packet if duplicate packet is found EQUAL TO OR\n");
     fprintf(output, "                         LESS THAN <dup time window> prior to current packet.\n");
     fprintf(output, "                         A <dup time window> is specified in relative seconds\n");
@@ -934,6 +998,9 @@ print_usage(FILE *output)
     fprintf(output, "                         when writing the output file.  Does not discard\n");
     fprintf(output, "                         comments added by \"-a\" in the same command line.\n");
     fprintf(output, "  --compress <type>      Compress the output file using the type compression format.\n");
+    fprintf(output, "  --compress-threads <threads>\n");
+    fprintf(output, "                         Compress the output file in parallel on <threads>\n");
+    fprintf(output, "                         worker threads.\n");
     fprintf(output, "\n");
     fprintf(output, "Miscellaneous:\n");
     fprintf(output, "  -h, --help             display this help and exit.\n");
@@ -1329,6 +1396,8 @@ main(int argc, char *argv[])
 #define LONGOPT_DISCARD_PACKET_COMMENTS LONGOPT_BASE_APPLICATION+9
 #define LONGOPT_EXTRACT_SECRETS         LONGOPT_BASE_APPLICATION+10
 #define LONGOPT_COMPRESS                LONGOPT_BASE_APPLICATION+11
+#define LONGOPT_COMPRESS_THREADS        LONGOPT_BASE_APPLICATION+12
+#define LONGOPT_DUP_HASH                LONGOPT_BASE_APPLICATION+13
 
     static const struct ws_option long_options[] = {
         {"novlan", ws_no_argument, NULL, LONGOPT_NO_VLAN},
@@ -1344,6 +1413,8 @@ main(int argc, char *argv[])
         {"discard-packet-comments", ws_no_argument, NULL, LONGOPT_DISCARD_PACKET_COMMENTS},
         {"extract-secrets", ws_no_argument, NULL, LONGOPT_EXTRACT_SECRETS},
         {"compress", ws_required_argument, NULL, LONGOPT_COMPRESS},
+        {"compress-threads", ws_required_argument, NULL, LONGOPT_COMPRESS_THREADS},
+        {"dup-hash", ws_required_argument, NULL, LONGOPT_DUP_HASH},
         {0, 0, 0, 0 }
     };
 
@@ -1385,6 +1456,7 @@ main(int argc, char *argv[])
     unsigned int                 seed = 0;
     bool                         edit_option_specified = false;
     wtap_compression_type compression_type   = WTAP_UNKNOWN_COMPRESSION;
+    uint32_t      compression_threads = 0;
 
     cmdarg_err_init(editcap_cmdarg_err, editcap_cmdarg_err_cont);
     memset(&read_rec, 0, sizeof *rec);
@@ -1558,6 +1630,27 @@ main(int argc, char *argv[])
             break;
         }
 
+        case LONGOPT_COMPRESS_THREADS:
+        {
+            compression_threads = get_uint32(ws_optarg, "number of compression threads");
+            break;
+        }
+
+        case LONGOPT_DUP_HASH:
+        {
+            if (g_ascii_strcasecmp(ws_optarg, "md5") == 0) {
+                dup_hash = DUP_HASH_MD5;
+            } else if (g_ascii_strcasecmp(ws_optarg, "murmur3") == 0) {
+                dup_hash = DUP_HASH_MURMUR3;
+            } else {
+                cmdarg_err("\"%s\" isn't a valid duplicate detection hash; use md5 or murmur3",
+                           ws_optarg);
+                ret = WS_EXIT_INVALID_OPTION;
+                goto clean_exit;
+            }
+            break;
+        }
+
         case 'a':
         {
             uint64_t frame_number;
@@ -1944,6 +2037,7 @@ main(int argc, char *argv[])
     }
 
     wtap_dump_params_init_no_idbs(&params, wth);
+    params.compression_threads = compression_threads;
 
     /*
      * Discard any secrets we read in while opening the file.
@@ -2052,11 +2146,7 @@ main(int argc, char *argv[])
         max_packet_number = UINT64_MAX;
 
     if (dup_detect || dup_detect_by_time) {
-        for (i = 0; i < dup_window; i++) {
-            memset(&fd_hash[i].digest, 0, 16);
-            fd_hash[i].len = 0;
-            nstime_set_unset(&fd_hash[i].frame_time);
-        }
+        fd_hash_init(dup_window);
     }
 
     /* Set up an array of all IDBs seen */
@@ -2393,12 +2483,13 @@ main(int argc, char *argv[])
                 if (dup_detect) {
                     if (is_duplicate(buf, rec->rec_header.packet_header.caplen)) {
                         if (verbose) {
-                            fprintf(stderr, "Skipped: %" PRIu64 ", Len: %u, MD5 Hash: ",
+                            fprintf(stderr, "Skipped: %" PRIu64 ", Len: %u, %s Hash: ",
                                     count,
-                                    rec->rec_header.packet_header.caplen);
+                                    rec->rec_header.packet_header.caplen,
+                                    dup_hash_name());
                             for (i = 0; i < 16; i++)
                                 fprintf(stderr, "%02x",
-                                        (unsigned char)fd_hash[cur_dup_entry].digest[i]);
+                                        (unsigned char)cur_dup_entry->digest[i]);
                             fprintf(stderr, "\n");
                         }
                         duplicate_count++;
@@ -2406,12 +2497,13 @@ main(int argc, char *argv[])
                         continue;
                     } else {
                         if (verbose) {
-                            fprintf(stderr, "Packet: %" PRIu64 ", Len: %u, MD5 Hash: ",
+                            fprintf(stderr, "Packet: %" PRIu64 ", Len: %u, %s Hash: ",
                                     count,
-                                    rec->rec_header.packet_header.caplen);
+                                    rec->rec_header.packet_header.caplen,
+                                    dup_hash_name());
                             for (i = 0; i < 16; i++)
                                 fprintf(stderr, "%02x",
-                                        (unsigned char)fd_hash[cur_dup_entry].digest[i]);
+                                        (unsigned char)cur_dup_entry->digest[i]);
                             fprintf(stderr, "\n");
                         }
                     }
@@ -2429,12 +2521,13 @@ main(int argc, char *argv[])
                                                   rec->rec_header.packet_header.caplen,
                                                   &current)) {
                             if (verbose) {
-                                fprintf(stderr, "Skipped: %" PRIu64 ", Len: %u, MD5 Hash: ",
+                                fprintf(stderr, "Skipped: %" PRIu64 ", Len: %u, %s Hash: ",
                                         count,
-                                        rec->rec_header.packet_header.caplen);
+                                        rec->rec_header.packet_header.caplen,
+                                        dup_hash_name());
                                 for (i = 0; i < 16; i++)
                                     fprintf(stderr, "%02x",
-                                            (unsigned char)fd_hash[cur_dup_entry].digest[i]);
+                                            (unsigned char)cur_dup_entry->digest[i]);
                                 fprintf(stderr, "\n");
                             }
                             duplicate_count++;
@@ -2442,12 +2535,13 @@ main(int argc, char *argv[])
                             continue;
                         } else {
                             if (verbose) {
-                                fprintf(stderr, "Packet: %" PRIu64 ", Len: %u, MD5 Hash: ",
+                                fprintf(stderr, "Packet: %" PRIu64 ", Len: %u, %s Hash: ",
                                         count,
-                                        rec->rec_header.packet_header.caplen);
+                                        rec->rec_header.packet_header.caplen,
+                                        dup_hash_name());
                                 for (i = 0; i < 16; i++)
                                     fprintf(stderr, "%02x",
-                                            (unsigned char)fd_hash[cur_dup_entry].digest[i]);
+                                            (unsigned char)cur_dup_entry->digest[i]);
                                 fprintf(stderr, "\n");
                             }
                         }
@@ -2683,6 +2777,7 @@ main(int argc, char *argv[])
 clean_exit:
     g_free(fprefix);
     g_free(fsuffix);
+    fd_hash_cleanup();
 
     if (filename) {
         g_free(filename);
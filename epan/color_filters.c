@@ -56,6 +56,46 @@ static bool filters_enabled = true;
  */
 static bool tmp_colors_set;
 
+/* The enabled filters in 'color_filter_list' combined into one program,
+ * built when first needed and discarded whenever the list changes. */
+static dfilter_t *color_filters_code;
+static color_filter_t **color_filters_code_filters;
+
+static void
+color_filters_code_invalidate(void)
+{
+    dfilter_free(color_filters_code);
+    color_filters_code = NULL;
+    g_free(color_filters_code_filters);
+    color_filters_code_filters = NULL;
+}
+
+static dfilter_t *
+color_filters_code_get(void)
+{
+    GPtrArray      *colorfs;
+    GPtrArray      *codes;
+    GSList         *curr;
+    color_filter_t *colorf;
+
+    if (color_filters_code != NULL)
+        return color_filters_code;
+
+    colorfs = g_ptr_array_new();
+    codes = g_ptr_array_new();
+    for (curr = color_filter_list; curr != NULL; curr = g_slist_next(curr)) {
+        colorf = (color_filter_t *)curr->data;
+        if ((!colorf->disabled) && colorf->c_colorfilter != NULL) {
+            g_ptr_array_add(colorfs, colorf);
+            g_ptr_array_add(codes, colorf->c_colorfilter);
+        }
+    }
+    color_filters_code = dfilter_multi_new((dfilter_t * const *)codes->pdata, codes->len);
+    color_filters_code_filters = (color_filter_t **)g_ptr_array_free(colorfs, FALSE);
+    g_ptr_array_free(codes, TRUE);
+    return color_filters_code;
+}
+
 /* Create a new filter */
 color_filter_t *
 color_filter_new(const char *name,          /* The name of the filter to create */
@@ -159,6 +199,9 @@ color_filters_set_tmp(uint8_t filt_nr, const char *filter, bool disabled, char *
     dfilter_t      *compiled_filter;
     uint8_t        i;
     df_error_t     *df_err = NULL;
+
+    color_filters_code_invalidate();
+
     /* Go through the temporary filters and look for the same filter string.
      * If found, clear it so that a filter can be "moved" up and down the list
      */
@@ -351,6 +394,7 @@ bool
 color_filters_init(char** err_msg, color_filter_add_cb_func add_cb)
 {
     /* delete all currently existing filters */
+    color_filters_code_invalidate();
     color_filter_list_delete(&color_filter_list);
 
     /* now try to construct the filters list */
@@ -360,6 +404,8 @@ color_filters_init(char** err_msg, color_filter_add_cb_func add_cb)
 bool
 color_filters_reload(char** err_msg, color_filter_add_cb_func add_cb)
 {
+    color_filters_code_invalidate();
+
     /* "move" old entries to the deleted list
      * we must keep them until the dissection no longer needs them */
     color_filter_deleted_list = g_slist_concat(color_filter_deleted_list, color_filter_list);
@@ -458,6 +504,8 @@ color_filters_apply(GSList *tmp_cfl, GSList *edit_cfl, char** err_msg)
 
     *err_msg = NULL;
 
+    color_filters_code_invalidate();
+
     /* "move" old entries to the deleted list
      * we must keep them until the dissection no longer needs them */
     color_filter_deleted_list = g_slist_concat(color_filter_deleted_list, color_filter_list);
@@ -499,24 +547,13 @@ tmp_color_filters_used(void)
     return tmp_colors_set;
 }
 
-/* prepare the epan_dissect_t for the filter */
-static void
-prime_edt(void *data, void *user_data)
-{
-    color_filter_t *colorf = (color_filter_t *)data;
-    epan_dissect_t *edt    = (epan_dissect_t *)user_data;
-
-    if (colorf->c_colorfilter != NULL)
-        epan_dissect_prime_with_dfilter(edt, colorf->c_colorfilter);
-}
-
 /* Prime the epan_dissect_t with all the compiler
  * color filters in 'color_filter_list'. */
 void
 color_filters_prime_edt(epan_dissect_t *edt)
 {
     if (color_filters_used())
-        g_slist_foreach(color_filter_list, prime_edt, edt);
+        epan_dissect_prime_with_dfilter(edt, color_filters_code_get());
 }
 
 static int
@@ -569,21 +606,15 @@ color_filters_use_proto(int proto_id)
 const color_filter_t *
 color_filters_colorize_packet(epan_dissect_t *edt)
 {
-    GSList         *curr;
-    color_filter_t *colorf;
+    int match;
 
-    /* If we have color filters, "search" for the matching one. */
+    /* If we have color filters, "search" for the matching one. The
+     * filters are applied in order, up to the first one that matches,
+     * sharing the fields they read from the tree. */
     if ((edt->tree != NULL) && (color_filters_used())) {
-        curr = color_filter_list;
-
-        while(curr != NULL) {
-            colorf = (color_filter_t *)curr->data;
-            if ( (!colorf->disabled) &&
-                 (colorf->c_colorfilter != NULL) &&
-                 dfilter_apply_edt(colorf->c_colorfilter, edt)) {
-                return colorf;
-            }
-            curr = g_slist_next(curr);
+        match = dfilter_multi_apply_edt(color_filters_code_get(), edt, NULL, NULL, true);
+        if (match >= 0) {
+            return color_filters_code_filters[match];
         }
     }
 
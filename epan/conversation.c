@@ -113,6 +113,34 @@ static const char *type_names[] = {
  */
 static wmem_map_t *conversation_hashtable_element_list;
 
+/*
+ * The same hash tables, keyed by conversation_element_list_signature()
+ * so that they can be looked up without building a name.
+ */
+static wmem_map_t *conversation_hashtable_signature;
+
+/*
+ * Functions to call for a protocol's data when a conversation is expired,
+ * keyed by protocol ID.
+ */
+static wmem_map_t *conversation_expire_funcs;
+
+/*
+ * Whether conversation_expire() may be used; see conversation_set_expire_enabled().
+ */
+static bool conversation_expire_enabled;
+
+/*
+ * The allocators returned by conversation_get_scope() that haven't been
+ * destroyed by conversation_expire() yet.
+ */
+static GHashTable *conversation_scopes;
+
+/*
+ * The number of conversations in the hash tables.
+ */
+static unsigned conversation_live_count;
+
 /*
  * Hash table for conversations based on addresses only
  */
@@ -208,6 +236,44 @@ conversation_element_list_name(wmem_allocator_t *allocator, conversation_element
     return wmem_strbuf_finalize(conv_hash_group);
 }
 
+/*
+ * Pack the element types of a list into an integer, four bits per
+ * element, so that lists of the same shape map to the same value.
+ * Types are offset by one so that no signature is zero.
+ */
+static unsigned
+conversation_element_list_signature(const conversation_element_t *elements)
+{
+    unsigned signature = 0;
+    size_t count = 0;
+
+    for (;;) {
+        DISSECTOR_ASSERT(elements[count].type < array_length(type_names));
+        signature |= (unsigned)(elements[count].type + 1) << (count * 4);
+        if (elements[count].type == CE_CONVERSATION_TYPE)
+            break;
+        count++;
+        DISSECTOR_ASSERT(count < MAX_CONVERSATION_ELEMENTS);
+    }
+    // Keying on the endpoint type alone isn't very useful.
+    DISSECTOR_ASSERT(count > 0);
+    return signature;
+}
+
+/*
+ * Add a hash table for an element list to the table of hash tables,
+ * under both its name and its signature.
+ */
+static void
+conversation_register_hashtable(conversation_element_t *elements, wmem_map_t *hashtable)
+{
+    char *map_key = conversation_element_list_name(wmem_epan_scope(), elements);
+
+    wmem_map_insert(conversation_hashtable_element_list, map_key, hashtable);
+    wmem_map_insert(conversation_hashtable_signature,
+                    GUINT_TO_POINTER(conversation_element_list_signature(elements)), hashtable);
+}
+
 #if 0 // debugging
 static char* conversation_element_list_values(conversation_element_t *elements) {
     char *sep = "";
@@ -389,11 +455,41 @@ conversation_create_from_template(conversation_t *conversation, const address *a
 /*
  * Compute the hash value for two given element lists if the match
  * is to be exact.
+ *
+ * Keys are looked up several times per packet, so values are mixed in a
+ * word at a time, MurmurHash3 style, rather than a byte at a time.
+ * Addresses are hashed by their data only; conversation_match_element_list()
+ * compares their types.
  */
-/* https://web.archive.org/web/20070615045827/http://eternallyconfuzzled.com/tuts/algorithms/jsw_tut_hashing.aspx#existing
- * (formerly at http://eternallyconfuzzled.com/tuts/algorithms/jsw_tut_hashing.aspx#existing)
- * One-at-a-Time hash
- */
+static inline unsigned
+conversation_hash_mix(unsigned hash_val, uint32_t k)
+{
+    k *= 0xcc9e2d51;
+    k = (k << 15) | (k >> 17);
+    k *= 0x1b873593;
+    hash_val ^= k;
+    hash_val = (hash_val << 13) | (hash_val >> 19);
+    return hash_val * 5 + 0xe6546b64;
+}
+
+static unsigned
+conversation_hash_bytes(unsigned hash_val, const void *data, size_t len)
+{
+    const uint8_t *p = (const uint8_t *)data;
+    uint32_t k;
+
+    for (; len >= 4; p += 4, len -= 4) {
+        memcpy(&k, p, 4);
+        hash_val = conversation_hash_mix(hash_val, k);
+    }
+    if (len > 0) {
+        k = 0;
+        memcpy(&k, p, len);
+        hash_val = conversation_hash_mix(hash_val, k);
+    }
+    return hash_val;
+}
+
 static unsigned
 conversation_hash_element_list(const void *v)
 {
@@ -401,51 +497,35 @@ conversation_hash_element_list(const void *v)
     unsigned hash_val = 0;
 
     for (;;) {
-        // XXX We could use a hash_arbitrary_bytes routine. Abuse add_address_to_hash in the mean time.
-        address tmp_addr;
         switch (element->type) {
         case CE_ADDRESS:
-            hash_val = add_address_to_hash(hash_val, &element->addr_val);
+            hash_val = conversation_hash_bytes(hash_val, element->addr_val.data, element->addr_val.len);
             break;
         case CE_PORT:
-            tmp_addr.len = (int) sizeof(element->port_val);
-            tmp_addr.data = &element->port_val;
-            hash_val = add_address_to_hash(hash_val, &tmp_addr);
+            hash_val = conversation_hash_mix(hash_val, element->port_val);
             break;
         case CE_STRING:
-            tmp_addr.len = (int) strlen(element->str_val);
-            tmp_addr.data = element->str_val;
-            hash_val = add_address_to_hash(hash_val, &tmp_addr);
+            hash_val = conversation_hash_bytes(hash_val, element->str_val, strlen(element->str_val));
             break;
         case CE_UINT:
-            tmp_addr.len = (int) sizeof(element->uint_val);
-            tmp_addr.data = &element->uint_val;
-            hash_val = add_address_to_hash(hash_val, &tmp_addr);
+            hash_val = conversation_hash_mix(hash_val, element->uint_val);
             break;
         case CE_UINT64:
-            tmp_addr.len = (int) sizeof(element->uint64_val);
-            tmp_addr.data = &element->uint64_val;
-            hash_val = add_address_to_hash(hash_val, &tmp_addr);
+            hash_val = conversation_hash_mix(hash_val, (uint32_t)element->uint64_val);
+            hash_val = conversation_hash_mix(hash_val, (uint32_t)(element->uint64_val >> 32));
             break;
         case CE_INT:
-            tmp_addr.len = (int) sizeof(element->int_val);
-            tmp_addr.data = &element->int_val;
-            hash_val = add_address_to_hash(hash_val, &tmp_addr);
+            hash_val = conversation_hash_mix(hash_val, (uint32_t)element->int_val);
             break;
         case CE_INT64:
-            tmp_addr.len = (int) sizeof(element->int64_val);
-            tmp_addr.data = &element->int64_val;
-            hash_val = add_address_to_hash(hash_val, &tmp_addr);
+            hash_val = conversation_hash_mix(hash_val, (uint32_t)element->int64_val);
+            hash_val = conversation_hash_mix(hash_val, (uint32_t)((uint64_t)element->int64_val >> 32));
             break;
         case CE_BLOB:
-            tmp_addr.len = (int) element->blob.len;
-            tmp_addr.data = element->blob.val;
-            hash_val = add_address_to_hash(hash_val, &tmp_addr);
+            hash_val = conversation_hash_bytes(hash_val, element->blob.val, element->blob.len);
             break;
         case CE_CONVERSATION_TYPE:
-            tmp_addr.len = (int) sizeof(element->conversation_type_val);
-            tmp_addr.data = &element->conversation_type_val;
-            hash_val = add_address_to_hash(hash_val, &tmp_addr);
+            hash_val = conversation_hash_mix(hash_val, element->conversation_type_val);
             goto done;
             break;
         }
@@ -453,9 +533,11 @@ conversation_hash_element_list(const void *v)
     }
 
 done:
-    hash_val += ( hash_val << 3 );
-    hash_val ^= ( hash_val >> 11 );
-    hash_val += ( hash_val << 15 );
+    hash_val ^= hash_val >> 16;
+    hash_val *= 0x85ebca6b;
+    hash_val ^= hash_val >> 13;
+    hash_val *= 0xc2b2ae35;
+    hash_val ^= hash_val >> 16;
 
     return hash_val;
 }
@@ -547,6 +629,9 @@ conversation_init(void)
      * above.
      */
     conversation_hashtable_element_list = wmem_map_new(wmem_epan_scope(), wmem_str_hash, g_str_equal);
+    conversation_hashtable_signature = wmem_map_new(wmem_epan_scope(), g_direct_hash, g_direct_equal);
+    if (conversation_expire_funcs == NULL)
+        conversation_expire_funcs = wmem_map_new(wmem_epan_scope(), g_direct_hash, g_direct_equal);
 
     conversation_element_t exact_elements[EXACT_IDX_COUNT] = {
         { CE_ADDRESS, .addr_val = ADDRESS_INIT_NONE },
@@ -555,24 +640,22 @@ conversation_init(void)
         { CE_PORT, .port_val = 0 },
         { CE_CONVERSATION_TYPE, .conversation_type_val = CONVERSATION_NONE }
     };
-    char *exact_map_key = conversation_element_list_name(wmem_epan_scope(), exact_elements);
     conversation_hashtable_exact_addr_port = wmem_map_new_autoreset(wmem_epan_scope(), wmem_file_scope(),
                                                                     conversation_hash_element_list,
                                                                     conversation_match_element_list);
-    wmem_map_insert(conversation_hashtable_element_list, wmem_strdup(wmem_epan_scope(), exact_map_key),
-                    conversation_hashtable_exact_addr_port);
+    wmem_map_set_open_addressing(conversation_hashtable_exact_addr_port);
+    conversation_register_hashtable(exact_elements, conversation_hashtable_exact_addr_port);
 
     conversation_element_t addrs_elements[ADDRS_IDX_COUNT] = {
         { CE_ADDRESS, .addr_val = ADDRESS_INIT_NONE },
         { CE_ADDRESS, .addr_val = ADDRESS_INIT_NONE },
         { CE_CONVERSATION_TYPE, .conversation_type_val = CONVERSATION_NONE }
     };
-    char *addrs_map_key = conversation_element_list_name(wmem_epan_scope(), addrs_elements);
     conversation_hashtable_exact_addr = wmem_map_new_autoreset(wmem_epan_scope(), wmem_file_scope(),
                                                                     conversation_hash_element_list,
                                                                     conversation_match_element_list);
-    wmem_map_insert(conversation_hashtable_element_list, wmem_strdup(wmem_epan_scope(), addrs_map_key),
-                    conversation_hashtable_exact_addr);
+    wmem_map_set_open_addressing(conversation_hashtable_exact_addr);
+    conversation_register_hashtable(addrs_elements, conversation_hashtable_exact_addr);
 
     conversation_element_t no_addr2_elements[NO_ADDR2_IDX_COUNT] = {
         { CE_ADDRESS, .addr_val = ADDRESS_INIT_NONE },
@@ -580,12 +663,11 @@ conversation_init(void)
         { CE_PORT, .port_val = 0 },
         { CE_CONVERSATION_TYPE, .conversation_type_val = CONVERSATION_NONE }
     };
-    char *no_addr2_map_key = conversation_element_list_name(wmem_epan_scope(), no_addr2_elements);
     conversation_hashtable_no_addr2 = wmem_map_new_autoreset(wmem_epan_scope(), wmem_file_scope(),
                                                        conversation_hash_element_list,
                                                        conversation_match_element_list);
-    wmem_map_insert(conversation_hashtable_element_list, wmem_strdup(wmem_epan_scope(), no_addr2_map_key),
-                    conversation_hashtable_no_addr2);
+    wmem_map_set_open_addressing(conversation_hashtable_no_addr2);
+    conversation_register_hashtable(no_addr2_elements, conversation_hashtable_no_addr2);
 
     conversation_element_t no_port2_elements[NO_PORT2_IDX_COUNT] = {
         { CE_ADDRESS, .addr_val = ADDRESS_INIT_NONE },
@@ -593,35 +675,31 @@ conversation_init(void)
         { CE_ADDRESS, .addr_val = ADDRESS_INIT_NONE },
         { CE_CONVERSATION_TYPE, .conversation_type_val = CONVERSATION_NONE }
     };
-    char *no_port2_map_key = conversation_element_list_name(wmem_epan_scope(), no_port2_elements);
     conversation_hashtable_no_port2 = wmem_map_new_autoreset(wmem_epan_scope(), wmem_file_scope(),
                                                        conversation_hash_element_list,
                                                        conversation_match_element_list);
-    wmem_map_insert(conversation_hashtable_element_list, wmem_strdup(wmem_epan_scope(), no_port2_map_key),
-                    conversation_hashtable_no_port2);
+    wmem_map_set_open_addressing(conversation_hashtable_no_port2);
+    conversation_register_hashtable(no_port2_elements, conversation_hashtable_no_port2);
 
     conversation_element_t no_addr2_or_port2_elements[NO_ADDR2_PORT2_IDX_COUNT] = {
         { CE_ADDRESS, .addr_val = ADDRESS_INIT_NONE },
         { CE_PORT, .port_val = 0 },
         { CE_CONVERSATION_TYPE, .conversation_type_val = CONVERSATION_NONE }
     };
-    char *no_addr2_or_port2_map_key = conversation_element_list_name(wmem_epan_scope(), no_addr2_or_port2_elements);
     conversation_hashtable_no_addr2_or_port2 = wmem_map_new_autoreset(wmem_epan_scope(), wmem_file_scope(),
                                                                     conversation_hash_element_list,
                                                                     conversation_match_element_list);
-    wmem_map_insert(conversation_hashtable_element_list, wmem_strdup(wmem_epan_scope(), no_addr2_or_port2_map_key),
-                    conversation_hashtable_no_addr2_or_port2);
+    wmem_map_set_open_addressing(conversation_hashtable_no_addr2_or_port2);
+    conversation_register_hashtable(no_addr2_or_port2_elements, conversation_hashtable_no_addr2_or_port2);
 
     conversation_element_t id_elements[2] = {
         { CE_UINT, .uint_val = 0 },
         { CE_CONVERSATION_TYPE, .conversation_type_val = CONVERSATION_NONE }
     };
-    char *id_map_key = conversation_element_list_name(wmem_epan_scope(), id_elements);
     conversation_hashtable_id = wmem_map_new_autoreset(wmem_epan_scope(), wmem_file_scope(),
                                                        conversation_hash_element_list,
                                                        conversation_match_element_list);
-    wmem_map_insert(conversation_hashtable_element_list, wmem_strdup(wmem_epan_scope(), id_map_key),
-                    conversation_hashtable_id);
+    conversation_register_hashtable(id_elements, conversation_hashtable_id);
 
     /*
      * Initialize the "deinterlacer" table, which is used as the basis for the
@@ -645,12 +723,10 @@ conversation_init(void)
         { CE_UINT, .uint_val = 0 },
         { CE_CONVERSATION_TYPE, .conversation_type_val = CONVERSATION_NONE }
     };
-    char *deinterlacer_map_key = conversation_element_list_name(wmem_epan_scope(), deinterlacer_elements);
     conversation_hashtable_deinterlacer = wmem_map_new_autoreset(wmem_epan_scope(), wmem_file_scope(),
                                                                     conversation_hash_element_list,
                                                                     conversation_match_element_list);
-    wmem_map_insert(conversation_hashtable_element_list, wmem_strdup(wmem_epan_scope(), deinterlacer_map_key),
-                    conversation_hashtable_deinterlacer);
+    conversation_register_hashtable(deinterlacer_elements, conversation_hashtable_deinterlacer);
 
     /*
      * Initialize the "_anc" tables, which are very similar to their standard counterparts
@@ -669,12 +745,10 @@ conversation_init(void)
         { CE_UINT, .uint_val = 0 },
         { CE_CONVERSATION_TYPE, .conversation_type_val = CONVERSATION_NONE }
     };
-    char *exact_anc_map_key = conversation_element_list_name(wmem_epan_scope(), exact_elements_anc);
     conversation_hashtable_exact_addr_port_anc = wmem_map_new_autoreset(wmem_epan_scope(), wmem_file_scope(),
                                                                     conversation_hash_element_list,
                                                                     conversation_match_element_list);
-    wmem_map_insert(conversation_hashtable_element_list, wmem_strdup(wmem_epan_scope(), exact_anc_map_key),
-                    conversation_hashtable_exact_addr_port_anc);
+    conversation_register_hashtable(exact_elements_anc, conversation_hashtable_exact_addr_port_anc);
 
     conversation_element_t addrs_elements_anc[ADDRS_IDX_COUNT+1] = {
         { CE_ADDRESS, .addr_val = ADDRESS_INIT_NONE },
@@ -682,13 +756,31 @@ conversation_init(void)
         { CE_UINT, .uint_val = 0 },
         { CE_CONVERSATION_TYPE, .conversation_type_val = CONVERSATION_NONE }
     };
-    char *addrs_anc_map_key = conversation_element_list_name(wmem_epan_scope(), addrs_elements_anc);
     conversation_hashtable_exact_addr_anc = wmem_map_new_autoreset(wmem_epan_scope(), wmem_file_scope(),
                                                                     conversation_hash_element_list,
                                                                     conversation_match_element_list);
-    wmem_map_insert(conversation_hashtable_element_list, wmem_strdup(wmem_epan_scope(), addrs_anc_map_key),
-                    conversation_hashtable_exact_addr_anc);
+    conversation_register_hashtable(addrs_elements_anc, conversation_hashtable_exact_addr_anc);
+
+}
+
+/*
+ * Destroy the scopes of the conversations that were never expired, when
+ * the file scope is freed.
+ */
+static bool
+conversation_scopes_destroy(wmem_allocator_t *allocator _U_, wmem_cb_event_t event _U_, void *user_data _U_)
+{
+    GHashTableIter iter;
+    void *scope;
 
+    g_hash_table_iter_init(&iter, conversation_scopes);
+    while (g_hash_table_iter_next(&iter, &scope, NULL)) {
+        wmem_destroy_allocator((wmem_allocator_t *)scope);
+    }
+    g_hash_table_remove_all(conversation_scopes);
+
+    /* Registered again by the next conversation_epan_reset(). */
+    return false;
 }
 
 /**
@@ -701,6 +793,14 @@ conversation_epan_reset(void)
      * Start the conversation indices over at 0.
      */
     new_index = 0;
+    conversation_live_count = 0;
+
+    /*
+     * The conversations and their scopes go away with the file.
+     */
+    if (conversation_scopes == NULL)
+        conversation_scopes = g_hash_table_new(g_direct_hash, g_direct_equal);
+    wmem_register_callback(wmem_file_scope(), conversation_scopes_destroy, NULL);
 }
 
 /*
@@ -723,6 +823,7 @@ conversation_insert_into_hashtable(wmem_map_t *hashtable, conversation_t *conv)
 
         wmem_map_insert(hashtable, conv->key_ptr, conv);
         DPRINT(("created a new conversation chain"));
+        conversation_live_count++;
     }
     else {
         /* There's an existing chain for this key */
@@ -746,10 +847,13 @@ conversation_insert_into_hashtable(wmem_map_t *hashtable, conversation_t *conv)
                 ;
 
             if (NULL==prev) {
-                /* Changing the head of the chain */
+                /* Changing the head of the chain. wmem_map_insert()
+                 * would keep the old head's key, which goes away if
+                 * that conversation is expired, so replace it. */
                 conv->next = chain_head;
                 conv->last = chain_tail;
                 chain_head->last = NULL;
+                wmem_map_steal(hashtable, chain_head->key_ptr);
                 wmem_map_insert(hashtable, conv->key_ptr, conv);
             }
             else {
@@ -759,6 +863,7 @@ conversation_insert_into_hashtable(wmem_map_t *hashtable, conversation_t *conv)
                 prev->next = conv;
             }
         }
+        conversation_live_count++;
     }
 }
 
@@ -772,6 +877,10 @@ conversation_remove_from_hashtable(wmem_map_t *hashtable, conversation_t *conv)
     conversation_t *chain_head, *cur, *prev;
 
     chain_head = (conversation_t *)wmem_map_lookup(hashtable, conv->key_ptr);
+    if (chain_head == NULL) {
+        /* Not in this table; it might have been expired. */
+        return;
+    }
 
     if (conv == chain_head) {
         /* We are currently the front of the chain */
@@ -783,7 +892,8 @@ conversation_remove_from_hashtable(wmem_map_t *hashtable, conversation_t *conv)
             wmem_map_steal(hashtable, conv->key_ptr);
         }
         else {
-            /* Update the head of the chain */
+            /* Update the head of the chain. Replace the key as
+             * well as the value, as ours may be freed. */
             chain_head = conv->next;
             chain_head->last = conv->last;
 
@@ -792,8 +902,10 @@ conversation_remove_from_hashtable(wmem_map_t *hashtable, conversation_t *conv)
             else
                 chain_head->latest_found = conv->latest_found;
 
+            wmem_map_steal(hashtable, conv->key_ptr);
             wmem_map_insert(hashtable, chain_head->key_ptr, chain_head);
         }
+        conversation_live_count--;
     }
     else {
         /* We are not the front of the chain. Loop through to find us.
@@ -819,6 +931,8 @@ conversation_remove_from_hashtable(wmem_map_t *hashtable, conversation_t *conv)
 
         if (chain_head->latest_found == conv)
             chain_head->latest_found = prev;
+
+        conversation_live_count--;
     }
 }
 
@@ -826,12 +940,12 @@ conversation_t *conversation_new_full(const uint32_t setup_frame, conversation_e
 {
     DISSECTOR_ASSERT(elements);
 
-    char *el_list_map_key = conversation_element_list_name(wmem_epan_scope(), elements);
-    wmem_map_t *el_list_map = (wmem_map_t *) wmem_map_lookup(conversation_hashtable_element_list, el_list_map_key);
+    wmem_map_t *el_list_map = (wmem_map_t *) wmem_map_lookup(conversation_hashtable_signature,
+            GUINT_TO_POINTER(conversation_element_list_signature(elements)));
     if (!el_list_map) {
         el_list_map = wmem_map_new_autoreset(wmem_epan_scope(), wmem_file_scope(), conversation_hash_element_list,
                 conversation_match_element_list);
-        wmem_map_insert(conversation_hashtable_element_list, wmem_strdup(wmem_epan_scope(), el_list_map_key), el_list_map);
+        conversation_register_hashtable(elements, el_list_map);
     }
 
     size_t element_count = conversation_element_count(elements);
@@ -1330,13 +1444,25 @@ static conversation_t *conversation_lookup_hashtable(wmem_map_t *conversation_ha
     conversation_t* convo = NULL;
     conversation_t* match = NULL;
     conversation_t* chain_head = NULL;
+
+    /*
+     * Most of the tables find_conversation() falls back on are empty in
+     * most captures; don't bother hashing the key for those.
+     */
+    if (wmem_map_size(conversation_hashtable) == 0)
+        return NULL;
+
     chain_head = (conversation_t *)wmem_map_lookup(conversation_hashtable, conv_key);
 
     if (chain_head && (chain_head->setup_frame <= frame_num)) {
         match = chain_head;
 
-        if (chain_head->last && (chain_head->last->setup_frame <= frame_num))
-            return chain_head->last;
+        if (chain_head->last && (chain_head->last->setup_frame <= frame_num)) {
+            match = chain_head->last;
+            if (conversation_expire_enabled && frame_num > match->last_frame)
+                match->last_frame = frame_num;
+            return match;
+        }
 
         if (chain_head->latest_found && (chain_head->latest_found->setup_frame <= frame_num))
             match = chain_head->latest_found;
@@ -1350,6 +1476,9 @@ static conversation_t *conversation_lookup_hashtable(wmem_map_t *conversation_ha
 
     if (match) {
         chain_head->latest_found = match;
+        /* Note that it's still active, for conversation_expire(). */
+        if (conversation_expire_enabled && frame_num > match->last_frame)
+            match->last_frame = frame_num;
     }
 
     return match;
@@ -1357,9 +1486,8 @@ static conversation_t *conversation_lookup_hashtable(wmem_map_t *conversation_ha
 
 conversation_t *find_conversation_full(const uint32_t frame_num, conversation_element_t *elements)
 {
-    char *el_list_map_key = conversation_element_list_name(NULL, elements);
-    wmem_map_t *el_list_map = (wmem_map_t *) wmem_map_lookup(conversation_hashtable_element_list, el_list_map_key);
-    g_free(el_list_map_key);
+    wmem_map_t *el_list_map = (wmem_map_t *) wmem_map_lookup(conversation_hashtable_signature,
+            GUINT_TO_POINTER(conversation_element_list_signature(elements)));
     if (!el_list_map) {
         return NULL;
     }
@@ -2078,7 +2206,7 @@ conversation_add_proto_data(conversation_t *conv, const int proto, void *proto_d
     }
     /* Add it to the list of items for this conversation. */
     if (conv->data_list == NULL)
-        conv->data_list = wmem_tree_new(wmem_file_scope());
+        conv->data_list = wmem_tree_new(conversation_get_scope(conv));
 
     wmem_tree_insert32(conv->data_list, proto, proto_data);
 }
@@ -2464,6 +2592,154 @@ conversation_get_id_from_elements(struct _packet_info *pinfo, conversation_type
     return pinfo->conv_elements[0].uint_val;
 }
 
+void
+conversation_set_closed(conversation_t *conv)
+{
+    conv->closed = true;
+}
+
+void
+conversation_register_expire_func(const int proto, conversation_expire_func func)
+{
+    wmem_map_insert(conversation_expire_funcs, GINT_TO_POINTER(proto), (void *)func);
+}
+
+void
+conversation_set_expire_enabled(const bool enabled)
+{
+    conversation_expire_enabled = enabled;
+}
+
+bool
+conversation_get_expire_enabled(void)
+{
+    return conversation_expire_enabled;
+}
+
+wmem_allocator_t *
+conversation_get_scope(conversation_t *conv)
+{
+    if (!conversation_expire_enabled)
+        return wmem_file_scope();
+
+    if (conv->scope == NULL) {
+        conv->scope = wmem_allocator_new(WMEM_ALLOCATOR_SIMPLE);
+        g_hash_table_add(conversation_scopes, conv->scope);
+    }
+    return conv->scope;
+}
+
+unsigned
+conversation_count(void)
+{
+    return conversation_live_count;
+}
+
+typedef struct {
+    uint32_t    idle_frame;
+    uint32_t    closed_frame;
+    GPtrArray  *expired;
+} conversation_expire_info_t;
+
+static void
+conversation_collect_expired(void *key _U_, void *value, void *user_data)
+{
+    conversation_expire_info_t *info = (conversation_expire_info_t *)user_data;
+
+    for (conversation_t *conv = (conversation_t *)value; conv; conv = conv->next) {
+        if (conv->last_frame < info->idle_frame ||
+                (conv->closed && conv->last_frame < info->closed_frame)) {
+            g_ptr_array_add(info->expired, conv);
+        }
+    }
+}
+
+static bool
+conversation_expire_proto_data(const void *key, void *value, void *user_data)
+{
+    conversation_t *conv = (conversation_t *)user_data;
+    conversation_expire_func func;
+
+    func = (conversation_expire_func)wmem_map_lookup(conversation_expire_funcs, key);
+    if (func)
+        func(conv, value);
+    return false;
+}
+
+static void
+conversation_expire_hashtable(void *key _U_, void *value, void *user_data)
+{
+    wmem_map_t *hashtable = (wmem_map_t *)value;
+    conversation_expire_info_t *info = (conversation_expire_info_t *)user_data;
+    unsigned first = info->expired->len;
+
+    /* Don't change the table while going through it. */
+    wmem_map_foreach(hashtable, conversation_collect_expired, info);
+    for (unsigned i = first; i < info->expired->len; i++) {
+        conversation_remove_from_hashtable(hashtable,
+                (conversation_t *)g_ptr_array_index(info->expired, i));
+    }
+}
+
+static void
+conversation_free(conversation_t *conv)
+{
+    conversation_element_t *key = conv->key_ptr;
+    size_t element_count = conversation_element_count(key);
+
+    if (conv->data_list) {
+        wmem_tree_foreach(conv->data_list, conversation_expire_proto_data, conv);
+        if (conv->scope == NULL)
+            wmem_tree_destroy(conv->data_list, false, false);
+    }
+    conv->data_list = NULL;
+    if (conv->scope) {
+        g_hash_table_remove(conversation_scopes, conv->scope);
+        wmem_destroy_allocator(conv->scope);
+        conv->scope = NULL;
+    }
+
+    for (size_t i = 0; i < element_count; i++) {
+        if (key[i].type == CE_ADDRESS) {
+            free_address_wmem(wmem_file_scope(), &key[i].addr_val);
+        } else if (key[i].type == CE_STRING) {
+            wmem_free(wmem_file_scope(), (void *)key[i].str_val);
+        } else if (key[i].type == CE_BLOB) {
+            wmem_free(wmem_file_scope(), (void *)key[i].blob.val);
+        }
+    }
+    wmem_free(wmem_file_scope(), key);
+    conv->key_ptr = NULL;
+
+    /*
+     * Keep the conversation itself until the file scope goes away.
+     * Many dissectors key their own file-scope tables by conversation
+     * pointer, and a new conversation at the same address would find
+     * the expired one's entries.  The dissector tree may be shared with
+     * conversations created from a template, so leave that too.
+     */
+}
+
+unsigned
+conversation_expire(const uint32_t idle_frame, const uint32_t closed_frame)
+{
+    conversation_expire_info_t info;
+    unsigned count;
+
+    info.idle_frame = idle_frame;
+    info.closed_frame = closed_frame;
+    info.expired = g_ptr_array_new();
+    wmem_map_foreach(conversation_hashtable_signature, conversation_expire_hashtable, &info);
+
+    for (unsigned i = 0; i < info.expired->len; i++) {
+        conversation_free((conversation_t *)g_ptr_array_index(info.expired, i));
+    }
+    count = info.expired->len;
+    g_ptr_array_free(info.expired, true);
+
+    return count;
+}
+
 wmem_map_t *
 get_conversation_hashtables(void)
 {
@@ -230,6 +230,8 @@ typedef struct conversation {
     wmem_tree_t *dissector_tree;	/** tree containing protocol dissector client associated with conversation */
     unsigned	options;		/** wildcard flags */
     conversation_element_t *key_ptr;	/** Keys are conversation element arrays terminated with a CE_CONVERSATION_TYPE */
+    bool	closed;			/** set by conversation_set_closed() */
+    wmem_allocator_t *scope;		/** allocator returned by conversation_get_scope(), if any */
 } conversation_t;
 
 /*
@@ -556,6 +558,91 @@ WS_DLL_PUBLIC void conversation_set_port2(conversation_t *conv, const uint32_t p
  */
 WS_DLL_PUBLIC void conversation_set_addr2(conversation_t *conv, const address *addr);
 
+/**
+ * Note that a conversation has been closed by the endpoints, e.g. with a
+ * TCP FIN or RST, so that conversation_expire() can remove it sooner than
+ * an idle one.
+ * @param conv Conversation. Must not be NULL.
+ */
+WS_DLL_PUBLIC void conversation_set_closed(conversation_t *conv);
+
+/**
+ * Function called when a conversation is expired, for each protocol that
+ * registered one and has data associated with the conversation, before
+ * the conversation's scope is freed.  It should unlink the data from
+ * anything outside that scope that refers to it, and free whatever the
+ * protocol allocated for the conversation elsewhere.
+ * @param conv The conversation being expired.
+ * @param proto_data The data added with conversation_add_proto_data().
+ */
+typedef void (*conversation_expire_func)(conversation_t *conv, void *proto_data);
+
+/**
+ * Register a function to be called when a conversation with data for a
+ * protocol is expired.
+ * @param proto Protocol ID.
+ * @param func The function to call.
+ */
+WS_DLL_PUBLIC void conversation_register_expire_func(const int proto, conversation_expire_func func);
+
+/**
+ * Allow conversation_expire() to be used.  This has conversation lookups
+ * note the last frame a conversation was seen in, and gives conversations
+ * their own scopes.  It must be set before any frames are dissected, and
+ * only if they aren't dissected again.
+ * @param enabled Whether conversations may be expired.
+ */
+WS_DLL_PUBLIC void conversation_set_expire_enabled(const bool enabled);
+
+/**
+ * Whether conversation_set_expire_enabled() was called.  Frames are then
+ * dissected only once, so data that a dissector keeps for a frame only to
+ * find it again when the frame is dissected again can go in pinfo->pool
+ * rather than in wmem_file_scope(), where it would pile up.
+ * @return Whether conversations may be expired.
+ */
+WS_DLL_PUBLIC bool conversation_get_expire_enabled(void);
+
+/**
+ * Get the allocator for data that belongs to a conversation, such as what
+ * is added with conversation_add_proto_data() and whatever only it points
+ * to.  Everything allocated in it is freed when the conversation is
+ * expired, or else with the file.  This is wmem_file_scope() unless
+ * conversation_set_expire_enabled() was called.
+ * @param conv Conversation. Must not be NULL.
+ * @return The conversation's allocator.
+ */
+WS_DLL_PUBLIC wmem_allocator_t *conversation_get_scope(conversation_t *conv);
+
+/**
+ * Get the number of conversations that are currently in the
+ * conversation tables, i.e. that haven't been expired.
+ * @return The number of conversations.
+ */
+WS_DLL_PUBLIC unsigned conversation_count(void);
+
+/**
+ * Remove conversations that haven't been seen for a while from the
+ * conversation tables and free them, so that long-running single-pass
+ * dissection of live traffic doesn't keep looking through and holding on
+ * to every conversation ever seen.  A conversation is seen in a frame when
+ * it's found or created for that frame.
+ *
+ * The functions registered with conversation_register_expire_func() are
+ * called first, then the conversation's scope and its key are freed.  The
+ * conversation_t itself stays allocated until the file is closed, so that
+ * tables keyed by conversation pointer never confuse it with a newer one,
+ * but it has no data and no key.  Dissectors must therefore not keep
+ * pointers to data in its scope from one frame to the next.  This must
+ * only be used after conversation_set_expire_enabled().
+ *
+ * @param idle_frame Conversations last seen before this frame are expired.
+ * @param closed_frame Closed conversations last seen before this frame are
+ * expired.
+ * @return The number of conversations expired.
+ */
+WS_DLL_PUBLIC unsigned conversation_expire(const uint32_t idle_frame, const uint32_t closed_frame);
+
 /**
  * @brief Get a hash table of conversation hash table.
  *
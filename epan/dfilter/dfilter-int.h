@@ -47,6 +47,14 @@ struct epan_dfilter {
 	/* Used to pass arguments to functions. List of Lists (list of registers). */
 	GSList		*function_stack;
 	GSList		*set_stack;
+	/* Used by programs combining several filters (dfilter_multi_new()).
+	 * Filters with the same text share a result slot; the filters of the
+	 * slots that aren't wanted are skipped. */
+	unsigned	num_results;
+	unsigned	*result_slots;
+	unsigned	num_slots;
+	bool		*slot_results;
+	bool		*slot_wanted;
 };
 
 typedef struct {
@@ -199,6 +199,9 @@ dfilter_free(dfilter_t *df)
 		g_slist_free_full(df->warnings, g_free);
 
 	g_free(df->registers);
+	g_free(df->result_slots);
+	g_free(df->slot_results);
+	g_free(df->slot_wanted);
 	g_free(df->expanded_text);
 	g_free(df->syntax_tree_str);
 	g_free(df);
@@ -702,6 +705,257 @@ dfilter_apply_full(dfilter_t *df, proto_tree *tree, GPtrArray **fvals)
 	return dfvm_apply_full(df, tree, fvals);
 }
 
+/* Registers of the combined program that hold fields read from the tree,
+ * so that they are only read once for all the filters. */
+typedef struct {
+	GHashTable	*fields;
+	GHashTable	*raw_fields;
+	unsigned	num_registers;
+} multi_registers_t;
+
+static unsigned
+multi_field_register(multi_registers_t *regs, dfvm_value_t *field)
+{
+	GHashTable	*fields;
+	void		*reg;
+
+	fields = field->type == RAW_HFINFO ? regs->raw_fields : regs->fields;
+	/* Stored as reg+1, like in dfw_append_read_tree(). */
+	reg = g_hash_table_lookup(fields, field->value.hfinfo);
+	if (reg != NULL)
+		return GPOINTER_TO_UINT(reg) - 1;
+	g_hash_table_insert(fields, field->value.hfinfo,
+				GUINT_TO_POINTER(regs->num_registers + 1));
+	return regs->num_registers++;
+}
+
+static dfvm_value_t *
+multi_copy_arg(dfvm_value_t *arg, int *reg_map, multi_registers_t *regs,
+				unsigned insn_offset)
+{
+	dfvm_value_t	*val;
+
+	if (arg == NULL)
+		return NULL;
+
+	switch (arg->type) {
+		case REGISTER:
+			if (reg_map[arg->value.numeric] < 0)
+				reg_map[arg->value.numeric] = regs->num_registers++;
+			val = dfvm_value_new_register(reg_map[arg->value.numeric]);
+			break;
+		case INSN_NUMBER:
+			val = dfvm_value_new(INSN_NUMBER);
+			val->value.numeric = arg->value.numeric + insn_offset;
+			break;
+		default:
+			/* Constants are shared with the original filter. */
+			val = arg;
+			break;
+	}
+	return dfvm_value_ref(val);
+}
+
+/* Appends the instructions of a filter, preceded by a SKIP_RESULT that
+ * jumps over them when its result slot isn't wanted, and ending with a
+ * SET_RESULT for the slot instead of a RETURN.
+ *
+ * The registers of the filter are renumbered so that each filter gets its
+ * own, except for those only loaded by READ_TREE: the code generator only
+ * reuses a register for the same field (see dfw_append_read_tree()), and
+ * read_tree() loads every value of the field, so the contents of such a
+ * register depend only on the field and the tree, whichever filter loads
+ * it first. A register loaded by READ_TREE_R only holds some layers of the
+ * field (and may be the same register as that of a READ_TREE of the field
+ * in the same filter), so it is kept private to the filter. */
+static void
+multi_append_filter(dfilter_t *df, const dfilter_t *src, unsigned slot,
+				multi_registers_t *regs)
+{
+	dfvm_insn_t	*insn, *src_insn;
+	int		*reg_map;
+	bool		*private_regs;
+	unsigned	insn_offset;
+
+	reg_map = g_new(int, src->num_registers);
+	private_regs = g_new0(bool, src->num_registers);
+	for (unsigned i = 0; i < src->num_registers; i++)
+		reg_map[i] = -1;
+
+	for (unsigned i = 0; i < src->insns->len; i++) {
+		src_insn = g_ptr_array_index(src->insns, i);
+		if (src_insn->op == DFVM_READ_TREE_R)
+			private_regs[src_insn->arg2->value.numeric] = true;
+	}
+	for (unsigned i = 0; i < src->insns->len; i++) {
+		src_insn = g_ptr_array_index(src->insns, i);
+		if (src_insn->op == DFVM_READ_TREE &&
+				!private_regs[src_insn->arg2->value.numeric]) {
+			reg_map[src_insn->arg2->value.numeric] =
+				multi_field_register(regs, src_insn->arg1);
+		}
+	}
+
+	insn = dfvm_insn_new(DFVM_SKIP_RESULT);
+	insn->arg1 = dfvm_value_ref(dfvm_value_new(INSN_NUMBER));
+	insn->arg1->value.numeric = df->insns->len + 1 + src->insns->len;
+	insn->arg2 = dfvm_value_ref(dfvm_value_new_uint(slot));
+	insn->id = df->insns->len;
+	g_ptr_array_add(df->insns, insn);
+	insn_offset = df->insns->len;
+
+	for (unsigned i = 0; i < src->insns->len; i++) {
+		src_insn = g_ptr_array_index(src->insns, i);
+		if (src_insn->op == DFVM_RETURN) {
+			insn = dfvm_insn_new(DFVM_SET_RESULT);
+			insn->arg1 = dfvm_value_ref(dfvm_value_new_uint(slot));
+		}
+		else {
+			insn = dfvm_insn_new(src_insn->op);
+			insn->arg1 = multi_copy_arg(src_insn->arg1, reg_map, regs, insn_offset);
+			insn->arg2 = multi_copy_arg(src_insn->arg2, reg_map, regs, insn_offset);
+			insn->arg3 = multi_copy_arg(src_insn->arg3, reg_map, regs, insn_offset);
+		}
+		insn->id = df->insns->len;
+		g_ptr_array_add(df->insns, insn);
+	}
+	g_free(private_regs);
+	g_free(reg_map);
+}
+
+static void
+multi_add_references(GHashTable *table, GHashTable *src_table)
+{
+	GHashTableIter	iter;
+	void		*hfinfo, *refs;
+
+	g_hash_table_iter_init(&iter, src_table);
+	while (g_hash_table_iter_next(&iter, &hfinfo, &refs)) {
+		if (!g_hash_table_contains(table, hfinfo))
+			g_hash_table_insert(table, hfinfo, refs);
+	}
+}
+
+dfilter_t *
+dfilter_multi_new(dfilter_t * const *dfcodes, unsigned count)
+{
+	dfilter_t		*df;
+	const dfilter_t		*src;
+	multi_registers_t	regs;
+	GHashTable		*slots;
+	GHashTable		*interesting;
+	GHashTableIter		iter;
+	void			*key, *value;
+	GString			*text;
+	dfvm_insn_t		*insn;
+	unsigned		slot;
+	int			i;
+
+	df = dfilter_new(NULL);
+	df->insns = g_ptr_array_new();
+	/* The arrays of references belong to the original filters. */
+	df->references = g_hash_table_new(g_direct_hash, g_direct_equal);
+	df->raw_references = g_hash_table_new(g_direct_hash, g_direct_equal);
+	df->num_results = count;
+	df->result_slots = g_new(unsigned, count);
+	/* Slot 0 is always true. */
+	df->num_slots = 1;
+
+	regs.fields = g_hash_table_new(g_direct_hash, g_direct_equal);
+	regs.raw_fields = g_hash_table_new(g_direct_hash, g_direct_equal);
+	regs.num_registers = 0;
+	slots = g_hash_table_new(g_str_hash, g_str_equal);
+	interesting = g_hash_table_new(g_direct_hash, g_direct_equal);
+	text = g_string_new(NULL);
+
+	for (unsigned n = 0; n < count; n++) {
+		src = dfcodes[n];
+		if (src == NULL) {
+			df->result_slots[n] = 0;
+			continue;
+		}
+		value = g_hash_table_lookup(slots, src->expanded_text);
+		if (value != NULL) {
+			df->result_slots[n] = GPOINTER_TO_UINT(value);
+			continue;
+		}
+		slot = df->num_slots++;
+		g_hash_table_insert(slots, src->expanded_text, GUINT_TO_POINTER(slot));
+		df->result_slots[n] = slot;
+
+		multi_append_filter(df, src, slot, &regs);
+		multi_add_references(df->references, src->references);
+		multi_add_references(df->raw_references, src->raw_references);
+		for (i = 0; i < src->num_interesting_fields; i++) {
+			g_hash_table_add(interesting, GINT_TO_POINTER(src->interesting_fields[i]));
+		}
+		if (text->len > 0)
+			g_string_append(text, "\n ");
+		g_string_append(text, src->expanded_text);
+	}
+
+	insn = dfvm_insn_new(DFVM_RETURN);
+	insn->id = df->insns->len;
+	g_ptr_array_add(df->insns, insn);
+
+	df->num_interesting_fields = g_hash_table_size(interesting);
+	df->interesting_fields = g_new(int, df->num_interesting_fields);
+	i = 0;
+	g_hash_table_iter_init(&iter, interesting);
+	while (g_hash_table_iter_next(&iter, &key, NULL)) {
+		df->interesting_fields[i++] = GPOINTER_TO_INT(key);
+	}
+
+	df->expanded_text = g_string_free(text, FALSE);
+	df->num_registers = regs.num_registers;
+	df->registers = g_new0(df_cell_t, df->num_registers);
+	df->slot_results = g_new0(bool, df->num_slots);
+	df->slot_wanted = g_new0(bool, df->num_slots);
+
+	g_hash_table_destroy(regs.fields);
+	g_hash_table_destroy(regs.raw_fields);
+	g_hash_table_destroy(slots);
+	g_hash_table_destroy(interesting);
+	return df;
+}
+
+int
+dfilter_multi_apply_edt(dfilter_t *df, epan_dissect_t *edt,
+			const bool *wanted, bool *results, bool stop_at_match)
+{
+	int first_match = -1;
+	bool result;
+	unsigned n;
+
+	ws_assert(df->slot_results != NULL);
+
+	if (wanted == NULL) {
+		memset(df->slot_wanted, true, df->num_slots * sizeof(bool));
+	}
+	else {
+		memset(df->slot_wanted, false, df->num_slots * sizeof(bool));
+		for (n = 0; n < df->num_results; n++) {
+			if (wanted[n])
+				df->slot_wanted[df->result_slots[n]] = true;
+		}
+	}
+
+	dfvm_apply_multi(df, edt->tree, stop_at_match);
+
+	for (n = 0; n < df->num_results; n++) {
+		result = (wanted == NULL || wanted[n]) &&
+				df->slot_results[df->result_slots[n]];
+		if (result && first_match < 0) {
+			first_match = n;
+			if (results == NULL)
+				break;
+		}
+		if (results != NULL)
+			results[n] = result;
+	}
+	return first_match;
+}
+
 void
 dfilter_prime_proto_tree(const dfilter_t *df, proto_tree *tree)
 {
@@ -131,6 +131,29 @@ dfilter_apply(dfilter_t *df, proto_tree *tree);
 bool
 dfilter_apply_full(dfilter_t *df, proto_tree *tree, GPtrArray **fvals);
 
+/* Combine several compiled dfilters into one program that is applied with
+ * dfilter_multi_apply_edt(). Fields that are used by more than one of the
+ * filters are read from the tree only once, and filters with the same text
+ * are only run once. A NULL dfilter matches every packet.
+ *
+ * The dfilters must not be freed before the combined program; references
+ * are shared with them, so loading the references of the dfilters also
+ * loads those of the combined program. */
+WS_DLL_PUBLIC
+dfilter_t *
+dfilter_multi_new(dfilter_t * const *dfcodes, unsigned count);
+
+/* Apply a combined program. If wanted is not NULL, only the dfilters for
+ * which wanted[i] is true are applied (the results of the others are
+ * false). If results is not NULL, results[i] is set to the result of the
+ * i-th dfilter. If stop_at_match is true, the dfilters following the first
+ * one that matches aren't applied (and their results are false). Returns
+ * the index of the first dfilter that matched, or -1. */
+WS_DLL_PUBLIC
+int
+dfilter_multi_apply_edt(dfilter_t *df, struct epan_dissect *edt,
+			const bool *wanted, bool *results, bool stop_at_match);
+
 /* Prime a proto_tree using the fields/protocols used in a dfilter. */
 void
 dfilter_prime_proto_tree(const dfilter_t *df, proto_tree *tree);
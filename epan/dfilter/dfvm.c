@@ -11,6 +11,8 @@
 
 #include "dfvm.h"
 
+#include <string.h>
+
 #include <ftypes/ftypes.h>
 #include <wsutil/array.h>
 #include <wsutil/ws_assert.h>
@@ -71,6 +73,11 @@ dfvm_opcode_tostr(dfvm_opcode_t code)
 		case DFVM_STACK_PUSH:		return "STACK_PUSH";
 		case DFVM_STACK_POP:		return "STACK_POP";
 		case DFVM_NOT_ALL_ZERO:		return "NOT_ALL_ZERO";
+		case DFVM_FIELD_IN_UINT:	return "FIELD_IN_UINT";
+		case DFVM_FIELD_IN_SINT:	return "FIELD_IN_SINT";
+		case DFVM_FIELD_IN_IPV4:	return "FIELD_IN_IPV4";
+		case DFVM_SET_RESULT:		return "SET_RESULT";
+		case DFVM_SKIP_RESULT:		return "SKIP_RESULT";
 		case DFVM_NO_OP:		return "NO_OP";
 	}
 	return "(fix-opcode-string)";
@@ -89,6 +96,9 @@ dfvm_value_free(dfvm_value_t *v)
 		case PCRE:
 			ws_regex_free(v->value.pcre);
 			break;
+		case CONST_SET:
+			dfvm_const_set_free(v->value.const_set);
+			break;
 		case EMPTY:
 		case HFINFO:
 		case RAW_HFINFO:
@@ -240,6 +250,34 @@ dfvm_value_new_uint(unsigned num)
 	return v;
 }
 
+dfvm_value_t*
+dfvm_value_new_const_set(dfvm_const_set_t *set)
+{
+	dfvm_value_t *v = dfvm_value_new(CONST_SET);
+	v->value.const_set = set;
+	return v;
+}
+
+void
+dfvm_const_set_free(dfvm_const_set_t *set)
+{
+	switch (set->ftype) {
+		case FT_UINT64:
+			g_free(set->set.uint_range);
+			break;
+		case FT_INT64:
+			g_free(set->set.sint_range);
+			break;
+		case FT_IPv4:
+			g_free(set->set.ipv4);
+			break;
+		default:
+			ws_assert_not_reached();
+	}
+	g_free(set->repr);
+	g_free(set);
+}
+
 static char *
 dfvm_value_tostr(dfvm_value_t *v)
 {
@@ -273,6 +311,9 @@ dfvm_value_tostr(dfvm_value_t *v)
 		case INTEGER:
 			s = ws_strdup_printf("%"PRIu32, v->value.numeric);
 			break;
+		case CONST_SET:
+			s = ws_strdup(v->value.const_set->repr);
+			break;
 		case EMPTY:
 			s = ws_strdup("EMPTY");
 			break;
@@ -534,6 +575,13 @@ append_op_args(wmem_strbuf_t *buf, dfvm_insn_t *insn, GSList **stack_print,
 						arg1_str, arg1_str_type);
 			break;
 
+		case DFVM_FIELD_IN_UINT:
+		case DFVM_FIELD_IN_SINT:
+		case DFVM_FIELD_IN_IPV4:
+			wmem_strbuf_append_printf(buf, "%s%s in %s",
+						arg1_str, arg1_str_type, arg2_str);
+			break;
+
 		case DFVM_ALL_CONTAINS:
 		case DFVM_ANY_CONTAINS:
 			wmem_strbuf_append_printf(buf, "%s%s contains %s%s",
@@ -617,6 +665,14 @@ append_op_args(wmem_strbuf_t *buf, dfvm_insn_t *insn, GSList **stack_print,
 			wmem_strbuf_append_printf(buf, "%u", arg1->value.numeric);
 			break;
 
+		case DFVM_SET_RESULT:
+			wmem_strbuf_append_printf(buf, "#%s", arg1_str);
+			break;
+
+		case DFVM_SKIP_RESULT:
+			wmem_strbuf_append_printf(buf, "#%s %u", arg2_str, arg1->value.numeric);
+			break;
+
 		case DFVM_RETURN:
 			if (arg1_str) {
 				wmem_strbuf_append_printf(buf, "%s%s", arg1_str, arg1_str_type);
@@ -1649,8 +1705,98 @@ check_exists(proto_tree *tree, dfvm_value_t *arg1, dfvm_value_t *arg2)
 	return false;
 }
 
-bool
-dfvm_apply_full(dfilter_t *df, proto_tree *tree, GPtrArray **fvals)
+/*
+ * The FIELD_IN_* instructions test the field values directly in the tree,
+ * without loading them into a register, against a set of unboxed constants.
+ * They replace a READ_TREE, IF_FALSE_GOTO and ANY_EQ (or SET_ADD...,
+ * SET_ANY_IN, SET_CLEAR) sequence, see specialize() in gencode.c.
+ */
+static bool
+field_in_uint(proto_tree *tree, dfvm_value_t *arg1, dfvm_value_t *arg2)
+{
+	header_field_info	*hfinfo = arg1->value.hfinfo;
+	const dfvm_const_set_t	*set = arg2->value.const_set;
+	const uint64_t		*range = set->set.uint_range;
+	GPtrArray		*finfos;
+	fvalue_t		*fv;
+	uint64_t		val;
+
+	for (; hfinfo != NULL; hfinfo = hfinfo->same_name_next) {
+		finfos = proto_get_finfo_ptr_array(tree, hfinfo->id);
+		if (finfos == NULL)
+			continue;
+		for (unsigned i = 0; i < finfos->len; i++) {
+			fv = ((field_info *)finfos->pdata[i])->value;
+			if (FT_IS_UINT32(hfinfo->type))
+				val = fvalue_get_uinteger(fv);
+			else
+				val = fvalue_get_uinteger64(fv);
+			for (unsigned j = 0; j < set->len; j++) {
+				if (val >= range[2*j] && val <= range[2*j + 1])
+					return true;
+			}
+		}
+	}
+	return false;
+}
+
+static bool
+field_in_sint(proto_tree *tree, dfvm_value_t *arg1, dfvm_value_t *arg2)
+{
+	header_field_info	*hfinfo = arg1->value.hfinfo;
+	const dfvm_const_set_t	*set = arg2->value.const_set;
+	const int64_t		*range = set->set.sint_range;
+	GPtrArray		*finfos;
+	fvalue_t		*fv;
+	int64_t			val;
+
+	for (; hfinfo != NULL; hfinfo = hfinfo->same_name_next) {
+		finfos = proto_get_finfo_ptr_array(tree, hfinfo->id);
+		if (finfos == NULL)
+			continue;
+		for (unsigned i = 0; i < finfos->len; i++) {
+			fv = ((field_info *)finfos->pdata[i])->value;
+			if (FT_IS_INT32(hfinfo->type))
+				val = fvalue_get_sinteger(fv);
+			else
+				val = fvalue_get_sinteger64(fv);
+			for (unsigned j = 0; j < set->len; j++) {
+				if (val >= range[2*j] && val <= range[2*j + 1])
+					return true;
+			}
+		}
+	}
+	return false;
+}
+
+static bool
+field_in_ipv4(proto_tree *tree, dfvm_value_t *arg1, dfvm_value_t *arg2)
+{
+	header_field_info	*hfinfo = arg1->value.hfinfo;
+	const dfvm_const_set_t	*set = arg2->value.const_set;
+	GPtrArray		*finfos;
+	const ipv4_addr_and_mask *val;
+	uint32_t		nmask;
+
+	for (; hfinfo != NULL; hfinfo = hfinfo->same_name_next) {
+		finfos = proto_get_finfo_ptr_array(tree, hfinfo->id);
+		if (finfos == NULL)
+			continue;
+		for (unsigned i = 0; i < finfos->len; i++) {
+			val = fvalue_get_ipv4(((field_info *)finfos->pdata[i])->value);
+			for (unsigned j = 0; j < set->len; j++) {
+				/* Same as cmp_order() for FT_IPv4. */
+				nmask = MIN(val->nmask, set->set.ipv4[j].nmask);
+				if ((val->addr & nmask) == (set->set.ipv4[j].addr & nmask))
+					return true;
+			}
+		}
+	}
+	return false;
+}
+
+static bool
+dfvm_run(dfilter_t *df, proto_tree *tree, GPtrArray **fvals, bool stop_at_match)
 {
 	int		id, length;
 	bool	accum = true;
@@ -1800,6 +1946,18 @@ dfvm_apply_full(dfilter_t *df, proto_tree *tree, GPtrArray **fvals)
 				accum = !all_test_unary(df, fvalue_is_zero, arg1);
 				break;
 
+			case DFVM_FIELD_IN_UINT:
+				accum = field_in_uint(tree, arg1, arg2);
+				break;
+
+			case DFVM_FIELD_IN_SINT:
+				accum = field_in_sint(tree, arg1, arg2);
+				break;
+
+			case DFVM_FIELD_IN_IPV4:
+				accum = field_in_ipv4(tree, arg1, arg2);
+				break;
+
 			case DFVM_ALL_CONTAINS:
 				accum = all_test(df, fvalue_contains, arg1, arg2);
 				break;
@@ -1852,6 +2010,27 @@ dfvm_apply_full(dfilter_t *df, proto_tree *tree, GPtrArray **fvals)
 				accum = !accum;
 				break;
 
+			case DFVM_SET_RESULT:
+				/* End of one of the filters of a combined program. */
+				if (df->slot_results != NULL) {
+					df->slot_results[arg1->value.numeric] = accum;
+				}
+				if (stop_at_match && accum) {
+					free_register_overhead(df);
+					return true;
+				}
+				accum = true;
+				break;
+
+			case DFVM_SKIP_RESULT:
+				/* Start of one of the filters of a combined program. */
+				if (df->slot_wanted != NULL &&
+						!df->slot_wanted[arg2->value.numeric]) {
+					id = arg1->value.numeric;
+					goto AGAIN;
+				}
+				break;
+
 			case DFVM_RETURN:
 				if (fvals && arg1) {
 					*fvals = df_cell_ref(&df->registers[arg1->value.numeric]);
@@ -1887,10 +2066,30 @@ dfvm_apply_full(dfilter_t *df, proto_tree *tree, GPtrArray **fvals)
 	ws_assert_not_reached();
 }
 
+bool
+dfvm_apply_full(dfilter_t *df, proto_tree *tree, GPtrArray **fvals)
+{
+	return dfvm_run(df, tree, fvals, false);
+}
+
 bool
 dfvm_apply(dfilter_t *df, proto_tree *tree)
 {
-	return dfvm_apply_full(df, tree, NULL);
+	return dfvm_run(df, tree, NULL, false);
+}
+
+/*
+ * Runs a program built from several filters, setting the result of each
+ * in df->slot_results. If stop_at_match is set, the filters following the
+ * first one that matches aren't run and their results are false.
+ */
+void
+dfvm_apply_multi(dfilter_t *df, proto_tree *tree, bool stop_at_match)
+{
+	memset(df->slot_results, 0, df->num_slots * sizeof(bool));
+	/* Slot 0 is used for the filters that match everything. */
+	df->slot_results[0] = true;
+	dfvm_run(df, tree, NULL, stop_at_match);
 }
 
 /*
@@ -30,8 +30,25 @@ typedef enum {
 	DRANGE,
 	FUNCTION_DEF,
 	PCRE,
+	CONST_SET,
 } dfvm_value_type_t;
 
+/*
+ * Unboxed constants for the specialized membership instructions. The
+ * set holds either inclusive low/high pairs of integers (an equality
+ * test is a pair with low == high) or IPv4 addresses with their netmask.
+ */
+typedef struct {
+	ftenum_t		ftype;	/* FT_UINT64, FT_INT64 or FT_IPv4 */
+	unsigned		len;
+	union {
+		uint64_t		*uint_range;	/* len low/high pairs */
+		int64_t			*sint_range;	/* len low/high pairs */
+		ipv4_addr_and_mask	*ipv4;		/* len addresses */
+	} set;
+	char			*repr;
+} dfvm_const_set_t;
+
 typedef struct {
 	dfvm_value_type_t	type;
 
@@ -42,6 +59,7 @@ typedef struct {
 		header_field_info	*hfinfo;
 		df_func_def_t		*funcdef;
 		ws_regex_t		*pcre;
+		dfvm_const_set_t	*const_set;
 	} value;
 
 	int ref_count;
@@ -99,6 +117,11 @@ typedef enum {
 	DFVM_STACK_PUSH,
 	DFVM_STACK_POP,
 	DFVM_NOT_ALL_ZERO,
+	DFVM_FIELD_IN_UINT,
+	DFVM_FIELD_IN_SINT,
+	DFVM_FIELD_IN_IPV4,
+	DFVM_SET_RESULT,
+	DFVM_SKIP_RESULT,
 	DFVM_NO_OP,
 } dfvm_opcode_t;
 
@@ -152,6 +175,12 @@ dfvm_value_new_pcre(ws_regex_t *re);
 dfvm_value_t*
 dfvm_value_new_uint(unsigned num);
 
+dfvm_value_t*
+dfvm_value_new_const_set(dfvm_const_set_t *set);
+
+void
+dfvm_const_set_free(dfvm_const_set_t *set);
+
 void
 dfvm_dump(FILE *f, dfilter_t *df, uint16_t flags);
 
@@ -164,6 +193,9 @@ dfvm_apply(dfilter_t *df, proto_tree *tree);
 bool
 dfvm_apply_full(dfilter_t *df, proto_tree *tree, GPtrArray **fvals);
 
+void
+dfvm_apply_multi(dfilter_t *df, proto_tree *tree, bool stop_at_match);
+
 fvalue_t *
 dfvm_get_raw_fvalue(const field_info *fi);
 
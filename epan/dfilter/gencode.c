@@ -918,6 +918,298 @@ optimize(dfwork_t *dfw)
 	}
 }
 
+/*
+ * Specialization of common relations.
+ *
+ * A field compared for equality with a constant, or tested for membership
+ * in a set of constants, is compiled to a READ_TREE, IF_FALSE_GOTO and
+ * ANY_EQ sequence (or SET_ADD..., SET_ANY_IN, SET_CLEAR). For integer and
+ * IPv4 fields the sequence is replaced by a single FIELD_IN_* instruction
+ * with the constants unboxed, that tests the field values in the tree
+ * directly without loading them into a register first.
+ */
+
+/* Maps a field type to the type of the unboxed constants. */
+static bool
+const_set_ftype(ftenum_t ftype, ftenum_t *set_ftype)
+{
+	if (FT_IS_UINT(ftype))
+		*set_ftype = FT_UINT64;
+	else if (FT_IS_INT(ftype))
+		*set_ftype = FT_INT64;
+	else if (ftype == FT_IPv4)
+		*set_ftype = FT_IPv4;
+	else
+		return false;
+	return true;
+}
+
+static bool
+const_set_accepts(ftenum_t set_ftype, dfvm_value_t *val)
+{
+	ftenum_t ftype;
+
+	if (val == NULL || val->type != FVALUE)
+		return false;
+	if (!const_set_ftype(fvalue_type_ftenum(dfvm_value_get_fvalue(val)), &ftype))
+		return false;
+	return ftype == set_ftype;
+}
+
+static void
+const_set_add(dfvm_const_set_t *set, unsigned idx,
+				dfvm_value_t *low, dfvm_value_t *high, GString *repr)
+{
+	fvalue_t	*fv_low = dfvm_value_get_fvalue(low);
+	fvalue_t	*fv_high = high ? dfvm_value_get_fvalue(high) : fv_low;
+	ftenum_t	ftype = fvalue_type_ftenum(fv_low);
+	char		*str;
+
+	switch (set->ftype) {
+		case FT_UINT64:
+			if (FT_IS_UINT32(ftype)) {
+				set->set.uint_range[2*idx] = fvalue_get_uinteger(fv_low);
+				set->set.uint_range[2*idx + 1] = fvalue_get_uinteger(fv_high);
+			}
+			else {
+				set->set.uint_range[2*idx] = fvalue_get_uinteger64(fv_low);
+				set->set.uint_range[2*idx + 1] = fvalue_get_uinteger64(fv_high);
+			}
+			break;
+		case FT_INT64:
+			if (FT_IS_INT32(ftype)) {
+				set->set.sint_range[2*idx] = fvalue_get_sinteger(fv_low);
+				set->set.sint_range[2*idx + 1] = fvalue_get_sinteger(fv_high);
+			}
+			else {
+				set->set.sint_range[2*idx] = fvalue_get_sinteger64(fv_low);
+				set->set.sint_range[2*idx + 1] = fvalue_get_sinteger64(fv_high);
+			}
+			break;
+		case FT_IPv4:
+			set->set.ipv4[idx] = *fvalue_get_ipv4(fv_low);
+			break;
+		default:
+			ws_assert_not_reached();
+	}
+
+	g_string_append(repr, idx == 0 ? "{" : " ");
+	str = fvalue_to_debug_repr(NULL, fv_low);
+	g_string_append(repr, str);
+	g_free(str);
+	if (high) {
+		g_string_append(repr, "..");
+		str = fvalue_to_debug_repr(NULL, fv_high);
+		g_string_append(repr, str);
+		g_free(str);
+	}
+}
+
+/*
+ * Tries to specialize the relation starting with the READ_TREE at "id".
+ * Returns the id of the last instruction that was replaced, or -1.
+ */
+static int
+specialize_relation(dfwork_t *dfw, int id, const bool *is_target)
+{
+	dfvm_insn_t	*insn, *insn1;
+	dfvm_value_t	*reg;
+	header_field_info *hfinfo;
+	dfvm_const_set_t *set;
+	ftenum_t	set_ftype, ftype;
+	dfvm_opcode_t	op;
+	int		length, first, last, count;
+	GString		*repr;
+
+	length = dfw->insns->len;
+	if (id + 2 >= length)
+		return -1;
+
+	insn = g_ptr_array_index(dfw->insns, id);
+	if (insn->arg1->type != HFINFO)
+		return -1;
+	hfinfo = insn->arg1->value.hfinfo;
+	reg = insn->arg2;
+
+	/* All the fields with this name must have the same kind of values. */
+	if (!const_set_ftype(hfinfo->type, &set_ftype))
+		return -1;
+	for (header_field_info *hfinfo1 = hfinfo->same_name_next; hfinfo1 != NULL;
+					hfinfo1 = hfinfo1->same_name_next) {
+		if (!const_set_ftype(hfinfo1->type, &ftype) || ftype != set_ftype)
+			return -1;
+	}
+
+	insn1 = g_ptr_array_index(dfw->insns, id + 1);
+	if (insn1->op != DFVM_IF_FALSE_GOTO)
+		return -1;
+
+	/* Find the end of the relation and check the constants. */
+	first = id + 2;
+	insn1 = g_ptr_array_index(dfw->insns, first);
+	if (insn1->op == DFVM_ANY_EQ) {
+		if (insn1->arg1->type != REGISTER ||
+				insn1->arg1->value.numeric != reg->value.numeric ||
+				!const_set_accepts(set_ftype, insn1->arg2))
+			return -1;
+		last = first;
+		count = 1;
+	}
+	else if (insn1->op == DFVM_SET_ADD || insn1->op == DFVM_SET_ADD_RANGE) {
+		for (last = first; last < length; last++) {
+			insn1 = g_ptr_array_index(dfw->insns, last);
+			if (insn1->op == DFVM_SET_ADD) {
+				if (!const_set_accepts(set_ftype, insn1->arg1))
+					return -1;
+			}
+			else if (insn1->op == DFVM_SET_ADD_RANGE) {
+				/* Address ranges aren't CIDR blocks. */
+				if (set_ftype == FT_IPv4 ||
+						!const_set_accepts(set_ftype, insn1->arg1) ||
+						!const_set_accepts(set_ftype, insn1->arg2))
+					return -1;
+			}
+			else {
+				break;
+			}
+		}
+		count = last - first;
+		if (last + 1 >= length)
+			return -1;
+		insn1 = g_ptr_array_index(dfw->insns, last);
+		if (insn1->op != DFVM_SET_ANY_IN ||
+				insn1->arg1->value.numeric != reg->value.numeric)
+			return -1;
+		last++;
+		insn1 = g_ptr_array_index(dfw->insns, last);
+		if (insn1->op != DFVM_SET_CLEAR)
+			return -1;
+	}
+	else {
+		return -1;
+	}
+
+	/* Nothing may jump into the middle of the relation. */
+	for (int i = id + 1; i <= last; i++) {
+		if (is_target[i])
+			return -1;
+	}
+
+	set = g_new0(dfvm_const_set_t, 1);
+	set->ftype = set_ftype;
+	set->len = count;
+	switch (set_ftype) {
+		case FT_UINT64:
+			set->set.uint_range = g_new(uint64_t, 2 * count);
+			op = DFVM_FIELD_IN_UINT;
+			break;
+		case FT_INT64:
+			set->set.sint_range = g_new(int64_t, 2 * count);
+			op = DFVM_FIELD_IN_SINT;
+			break;
+		case FT_IPv4:
+			set->set.ipv4 = g_new(ipv4_addr_and_mask, count);
+			op = DFVM_FIELD_IN_IPV4;
+			break;
+		default:
+			ws_assert_not_reached();
+	}
+	repr = g_string_new(NULL);
+	for (int i = 0; i < count; i++) {
+		insn1 = g_ptr_array_index(dfw->insns, first + i);
+		if (insn1->op == DFVM_ANY_EQ)
+			const_set_add(set, i, insn1->arg2, NULL, repr);
+		else if (insn1->op == DFVM_SET_ADD)
+			const_set_add(set, i, insn1->arg1, NULL, repr);
+		else
+			const_set_add(set, i, insn1->arg1, insn1->arg2, repr);
+	}
+	g_string_append_c(repr, '}');
+	set->repr = g_string_free(repr, FALSE);
+
+	/*
+	 * The register isn't loaded; any later use of it is preceded by its
+	 * own READ_TREE. If the field is missing the relation is false, as
+	 * it was when the IF_FALSE_GOTO jumped past it.
+	 */
+	insn->op = op;
+	dfvm_value_unref(insn->arg2);
+	insn->arg2 = dfvm_value_ref(dfvm_value_new_const_set(set));
+	for (int i = id + 1; i <= last; i++) {
+		dfvm_insn_replace_no_op(g_ptr_array_index(dfw->insns, i));
+	}
+	return last;
+}
+
+static void
+specialize(dfwork_t *dfw)
+{
+	int		id, last, length;
+	dfvm_insn_t	*insn;
+	bool		*is_target;
+
+	length = dfw->insns->len;
+	is_target = g_new0(bool, length);
+	for (id = 0; id < length; id++) {
+		insn = g_ptr_array_index(dfw->insns, id);
+		if (insn->op == DFVM_IF_TRUE_GOTO || insn->op == DFVM_IF_FALSE_GOTO) {
+			is_target[insn->arg1->value.numeric] = true;
+		}
+	}
+
+	for (id = 0; id < length; id++) {
+		insn = g_ptr_array_index(dfw->insns, id);
+		if (insn->op == DFVM_READ_TREE) {
+			last = specialize_relation(dfw, id, is_target);
+			if (last > 0)
+				id = last;
+		}
+	}
+	g_free(is_target);
+}
+
+/* Removes the no-ops left by optimizing and renumbers the jumps. */
+static void
+remove_no_ops(dfwork_t *dfw)
+{
+	int		id, length, next_id;
+	int		*new_id;
+	dfvm_insn_t	*insn;
+	GPtrArray	*insns;
+
+	length = dfw->insns->len;
+	new_id = g_new(int, length);
+	for (id = 0, next_id = 0; id < length; id++) {
+		insn = g_ptr_array_index(dfw->insns, id);
+		/* A jump to a no-op continues with the next instruction. */
+		new_id[id] = next_id;
+		if (insn->op != DFVM_NO_OP)
+			next_id++;
+	}
+	if (next_id == length) {
+		g_free(new_id);
+		return;
+	}
+
+	insns = g_ptr_array_sized_new(next_id);
+	for (id = 0; id < length; id++) {
+		insn = g_ptr_array_index(dfw->insns, id);
+		if (insn->op == DFVM_NO_OP) {
+			dfvm_insn_free(insn);
+			continue;
+		}
+		if (insn->op == DFVM_IF_TRUE_GOTO || insn->op == DFVM_IF_FALSE_GOTO) {
+			insn->arg1->value.numeric = new_id[insn->arg1->value.numeric];
+		}
+		insn->id = insns->len;
+		g_ptr_array_add(insns, insn);
+	}
+	g_ptr_array_free(dfw->insns, TRUE);
+	dfw->insns = insns;
+	dfw->next_insn_id = insns->len;
+	g_free(new_id);
+}
+
 void
 dfw_gencode(dfwork_t *dfw)
 {
@@ -930,6 +1222,8 @@ dfw_gencode(dfwork_t *dfw)
 	dfw_append_insn(dfw, insn);
 	if (dfw->flags & DF_OPTIMIZE) {
 		optimize(dfw);
+		specialize(dfw);
+		remove_no_ops(dfw);
 	}
 }
 
@@ -200,6 +200,7 @@ static const unit_name_string units_bytes_sec = { "bytes/sec", NULL };
 static int proto_dccp;
 static int dccp_tap;
 static int dccp_follow_tap;
+static register_follow_t *dccp_follower;
 
 static int hf_dccp_srcport;
 static int hf_dccp_dstport;
@@ -1165,6 +1166,7 @@ dissect_dccp(tvbuff_t *tvb, packet_info *pinfo, proto_tree *tree, void *data _U_
     dccpd = get_dccp_conversation_data(conv, pinfo);
     item = proto_tree_add_uint(dccp_tree, hf_dccp_stream, tvb, offset, 0, dccpd->stream);
     proto_item_set_generated(item);
+    follow_add_stream_frame(dccp_follower, pinfo, dccpd->stream);
 
     /* Copy the stream index into the header as well to make it available
     * to tap listeners.
@@ -1990,7 +1992,7 @@ proto_register_dccp(void)
 
     register_conversation_table(proto_dccp, false, dccpip_conversation_packet, dccpip_endpoint_packet);
     register_conversation_filter("dccp", "DCCP", dccp_filter_valid, dccp_build_filter, NULL);
-    register_follow_stream(proto_dccp, "dccp_follow", dccp_follow_conv_filter, dccp_follow_index_filter, dccp_follow_address_filter,
+    dccp_follower = register_follow_stream(proto_dccp, "dccp_follow", dccp_follow_conv_filter, dccp_follow_index_filter, dccp_follow_address_filter,
                            dccp_port_to_display, follow_tvb_tap_listener, get_dccp_stream_count, NULL);
 
     register_init_routine(dccp_init);
@@ -4633,8 +4633,8 @@ dissect_dns_common(tvbuff_t *tvb, packet_info *pinfo, proto_tree *tree,
     /* No.  Attach that information to the conversation, and add
      * it to the list of information structures.
      */
-    dns_info = wmem_new(wmem_file_scope(), dns_conv_info_t);
-    dns_info->pdus=wmem_tree_new(wmem_file_scope());
+    dns_info = wmem_new(conversation_get_scope(conversation), dns_conv_info_t);
+    dns_info->pdus=wmem_tree_new(conversation_get_scope(conversation));
     conversation_add_proto_data(conversation, proto_dns, dns_info);
   }
 
@@ -4668,7 +4668,7 @@ dissect_dns_common(tvbuff_t *tvb, packet_info *pinfo, proto_tree *tree,
         }
 
         if (new_transaction) {
-          dns_trans=wmem_new(wmem_file_scope(), dns_transaction_t);
+          dns_trans=wmem_new(conversation_get_scope(conversation), dns_transaction_t);
           dns_trans->req_frame=pinfo->num;
           dns_trans->rep_frame=0;
           dns_trans->req_time=pinfo->abs_ts;
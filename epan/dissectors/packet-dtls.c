@@ -2212,7 +2212,7 @@ dissect_dtls_handshake(tvbuff_t *tvb, packet_info *pinfo,
              */
             if (ssl && ssl->handshake_data.data_len) {
               ssl_debug_printf("%s erasing previous handshake_messages: %d\n", G_STRFUNC, ssl->handshake_data.data_len);
-              wmem_free(wmem_file_scope(), ssl->handshake_data.data);
+              wmem_free(ssl->scope, ssl->handshake_data.data);
               ssl->handshake_data.data = NULL;
               ssl->handshake_data.data_len = 0;
             }
@@ -1070,6 +1070,20 @@ dissect_http_kerberos(tvbuff_t *tvb, packet_info *pinfo, proto_tree *tree,
 }
 
 
+/*
+ * Called when a conversation is expired.  Everything else is freed with
+ * the conversation's scope, but the list of pending range requests isn't
+ * in wmem.
+ */
+static void
+http_conversation_expired(conversation_t *conv _U_, void *proto_data)
+{
+	http_conv_t *conv_data = (http_conv_t *)proto_data;
+
+	g_slist_free(conv_data->req_list);
+	conv_data->req_list = NULL;
+}
+
 static http_conv_t *
 get_http_conversation_data(packet_info *pinfo, conversation_t **conversation)
 {
@@ -1083,11 +1097,13 @@ get_http_conversation_data(packet_info *pinfo, conversation_t **conversation)
 	conv_data = (http_conv_t *)conversation_get_proto_data(*conversation, proto_http);
 	if(!conv_data) {
 		/* Setup the conversation structure itself */
-		conv_data = wmem_new0(wmem_file_scope(), http_conv_t);
-		conv_data->chunk_offsets_fwd = wmem_map_new(wmem_file_scope(), g_direct_hash, g_direct_equal);
-		conv_data->chunk_offsets_rev = wmem_map_new(wmem_file_scope(), g_direct_hash, g_direct_equal);
+		wmem_allocator_t *scope = conversation_get_scope(*conversation);
+		conv_data = wmem_new0(scope, http_conv_t);
+		conv_data->scope = scope;
+		conv_data->chunk_offsets_fwd = wmem_map_new(scope, g_direct_hash, g_direct_equal);
+		conv_data->chunk_offsets_rev = wmem_map_new(scope, g_direct_hash, g_direct_equal);
 		conv_data->req_list = NULL;
-		conv_data->matches_table = wmem_map_new(wmem_file_scope(), g_direct_hash, g_direct_equal);
+		conv_data->matches_table = wmem_map_new(scope, g_direct_hash, g_direct_equal);
 
 		conversation_add_proto_data(*conversation, proto_http,
 					    conv_data);
@@ -1103,11 +1119,11 @@ get_http_conversation_data(packet_info *pinfo, conversation_t **conversation)
 static http_req_res_t*
 push_req_res(http_conv_t *conv_data)
 {
-	http_req_res_t *req_res = wmem_new0(wmem_file_scope(), http_req_res_t);
+	http_req_res_t *req_res = wmem_new0(conv_data->scope, http_req_res_t);
 
 	nstime_set_unset(&(req_res->req_ts));
 	conv_data->req_res_tail = req_res;
-	req_res->private_data = wmem_new0(wmem_file_scope(), http_req_res_private_data_t);
+	req_res->private_data = wmem_new0(conv_data->scope, http_req_res_private_data_t);
 
 	return req_res;
 }
@@ -1725,7 +1741,7 @@ dissect_http_message(tvbuff_t *tvb, int offset, packet_info *pinfo,
 			if (!PINFO_FD_VISITED(pinfo)) {
 				if (http_type == MEDIA_CONTAINER_HTTP_REQUEST) {
 					curr = push_req(conv_data, pinfo);
-					curr->request_method = wmem_strdup(wmem_file_scope(), stat_info->request_method);
+					curr->request_method = wmem_strdup(conv_data->scope, stat_info->request_method);
 					prv_data = curr->private_data;
 					prv_data->req_fwd_flow = direction;
 				} else if (http_type == MEDIA_CONTAINER_HTTP_RESPONSE) {
@@ -1772,7 +1788,7 @@ dissect_http_message(tvbuff_t *tvb, int offset, packet_info *pinfo,
 		}
 		stat_info->full_uri = wmem_strdup(pinfo->pool, uri);
 		if (!PINFO_FD_VISITED(pinfo) && curr) {
-		        curr->full_uri = wmem_strdup(wmem_file_scope(), uri);
+		        curr->full_uri = wmem_strdup(conv_data->scope, uri);
 		}
 	}
 	else {
@@ -2474,7 +2490,7 @@ dissecting_body:
 			conv_data->startframe = pinfo->num;
 			conv_data->startoffset = offset;
 			conv_data->next_handle = next_handle;
-			copy_address_wmem(wmem_file_scope(), &conv_data->server_addr, &pinfo->src);
+			copy_address_wmem(conv_data->scope, &conv_data->server_addr, &pinfo->src);
 			conv_data->server_port = pinfo->srcport;
 		}
 	}
@@ -2493,7 +2509,7 @@ dissecting_body:
 static void
 basic_request_dissector(packet_info *pinfo, tvbuff_t *tvb, proto_tree *tree,
 			int offset, const unsigned char *line, const unsigned char *lineend,
-			http_conv_t *conv_data _U_, http_req_res_t *curr)
+			http_conv_t *conv_data, http_req_res_t *curr)
 {
 	const unsigned char *next_token;
 	const char *request_uri;
@@ -2525,7 +2541,7 @@ basic_request_dissector(packet_info *pinfo, tvbuff_t *tvb, proto_tree *tree,
 
 	stat_info->request_uri = wmem_strdup(pinfo->pool, request_uri);
 	if (!PINFO_FD_VISITED(pinfo) && curr) {
-		curr->request_uri = wmem_strdup(wmem_file_scope(), request_uri);
+		curr->request_uri = wmem_strdup(conv_data->scope, request_uri);
 	}
 	ti = proto_tree_add_string(tree, hf_http_request_uri, tvb, offset, tokenlen, request_uri);
 	http_add_path_components_to_tree(tvb, pinfo, ti, offset, tokenlen);
@@ -3690,7 +3706,7 @@ process_header(tvbuff_t *tvb, int offset, int next_offset,
 		case HDR_HOST:
 			stat_info->http_host = wmem_strndup(pinfo->pool, value, value_len);
 			if (!PINFO_FD_VISITED(pinfo) && curr_req_res) {
-				curr_req_res->http_host = wmem_strndup(wmem_file_scope(), value, value_len);
+				curr_req_res->http_host = wmem_strndup(conv_data->scope, value, value_len);
 			}
 			break;
 
@@ -3735,13 +3751,13 @@ process_header(tvbuff_t *tvb, int offset, int next_offset,
 
 		case HDR_WEBSOCKET_PROTOCOL:
 			if (http_type == MEDIA_CONTAINER_HTTP_RESPONSE) {
-				conv_data->websocket_protocol = wmem_strndup(wmem_file_scope(), value, value_len);
+				conv_data->websocket_protocol = wmem_strndup(conv_data->scope, value, value_len);
 			}
 			break;
 
 		case HDR_WEBSOCKET_EXTENSIONS:
 			if (http_type == MEDIA_CONTAINER_HTTP_RESPONSE) {
-				conv_data->websocket_extensions = wmem_strndup(wmem_file_scope(), value, value_len);
+				conv_data->websocket_extensions = wmem_strndup(conv_data->scope, value, value_len);
 			}
 			break;
 
@@ -3853,7 +3869,7 @@ process_header(tvbuff_t *tvb, int offset, int next_offset,
 			*  because there are rarely more than 10 requests in the list."
 			*/
 			if (first_range_num > 0) {
-				request_trans_t* req_trans = wmem_new(wmem_file_scope(), request_trans_t);
+				request_trans_t* req_trans = wmem_new(conv_data->scope, request_trans_t);
 				req_trans->first_range_num = first_range_num;
 				req_trans->req_frame = pinfo->num;
 				req_trans->abs_time = pinfo->fd->abs_ts;
@@ -3945,7 +3961,7 @@ process_header(tvbuff_t *tvb, int offset, int next_offset,
 				}
 
 				if (first_crange_num != 0 && req_trans) {
-					match_trans = wmem_new(wmem_file_scope(), match_trans_t);
+					match_trans = wmem_new(conv_data->scope, match_trans_t);
 					match_trans->req_frame = req_trans->req_frame;
 					match_trans->resp_frame = pinfo->num;
 					nstime_delta(&ns, &pinfo->fd->abs_ts, &req_trans->abs_time);
@@ -4359,7 +4375,7 @@ dissect_http_tcp(tvbuff_t *tvb, packet_info *pinfo, proto_tree *tree, void* data
 		if (conv_data->startframe == 0 && !PINFO_FD_VISITED(pinfo)) {
 			conv_data->startframe = pinfo->num;
 			conv_data->startoffset = 0;
-			copy_address_wmem(wmem_file_scope(), &conv_data->server_addr, &pinfo->dst);
+			copy_address_wmem(conv_data->scope, &conv_data->server_addr, &pinfo->dst);
 			conv_data->server_port = pinfo->destport;
 		}
 		http_payload_subdissector(tvb, tree, pinfo, conv_data, data);
@@ -4836,6 +4852,7 @@ proto_register_http(void)
 	proto_register_subtree_array(ett, array_length(ett));
 	expert_http = expert_register_protocol(proto_http);
 	expert_register_field_array(expert_http, ei, array_length(ei));
+	conversation_register_expire_func(proto_http, http_conversation_expired);
 
 	http_handle = register_dissector("http", dissect_http, proto_http);
 	http_tcp_handle = register_dissector("http-over-tcp", dissect_http_tcp, proto_http);
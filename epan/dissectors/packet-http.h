@@ -97,6 +97,10 @@ typedef struct _http_conv_t {
 	GSList *req_list;
         wmem_map_t *matches_table;
 
+	/* Where this and the requests and responses are allocated; see
+	 * conversation_get_scope() */
+	wmem_allocator_t *scope;
+
 } http_conv_t;
 
 /* Used for HTTP Export Object feature */
@@ -69,6 +69,7 @@ void proto_reg_handoff_quic(void);
 void proto_register_quic(void);
 
 static int quic_follow_tap;
+static register_follow_t *quic_follower;
 
 /* Initialize the protocol and registered fields */
 static int proto_quic;
@@ -3727,6 +3728,7 @@ quic_add_connection_info(tvbuff_t *tvb, packet_info *pinfo, proto_tree *tree, qu
     conversation_set_elements_by_id(pinfo, CONVERSATION_QUIC, conn->number);
     pi = proto_tree_add_uint(ctree, hf_quic_connection_number, tvb, 0, 0, conn->number);
     proto_item_set_generated(pi);
+    follow_add_stream_frame(quic_follower, pinfo, conn->number);
 #if 0
     proto_tree_add_debug_text(ctree, "Client CID: %s", cid_to_string(pinfo->pool, &conn->client_cids.data));
     proto_tree_add_debug_text(ctree, "Server CID: %s", cid_to_string(pinfo->pool, &conn->server_cids.data));
@@ -5662,7 +5664,7 @@ proto_register_quic(void)
     register_init_routine(quic_init);
     register_cleanup_routine(quic_cleanup);
 
-    register_follow_stream(proto_quic, "quic_follow", quic_follow_conv_filter, quic_follow_index_filter, quic_follow_address_filter,
+    quic_follower = register_follow_stream(proto_quic, "quic_follow", quic_follow_conv_filter, quic_follow_index_filter, quic_follow_address_filter,
                            udp_port_to_display, follow_quic_tap_listener, get_quic_connections_count,
                            quic_get_sub_stream_id);
 
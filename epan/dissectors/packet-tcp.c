@@ -46,6 +46,7 @@ static void conversation_completeness_fill(char*, uint32_t);
 
 static int tcp_tap;
 static int tcp_follow_tap;
+static register_follow_t *tcp_follower;
 static int mptcp_tap;
 static int exported_pdu_tap;
 
@@ -1997,39 +1998,42 @@ process_tcp_payload(tvbuff_t *tvb, volatile int offset, packet_info *pinfo,
 
 
 static struct tcp_analysis *
-init_tcp_conversation_data(packet_info *pinfo, int direction)
+init_tcp_conversation_data(packet_info *pinfo, conversation_t *conv, int direction)
 {
     struct tcp_analysis *tcpd;
+    wmem_allocator_t *scope;
 
     /* Initialize the tcp protocol data structure to add to the tcp conversation */
-    tcpd=wmem_new0(wmem_file_scope(), struct tcp_analysis);
+    scope = conversation_get_scope(conv);
+    tcpd=wmem_new0(scope, struct tcp_analysis);
+    tcpd->scope = scope;
     tcpd->flow1.win_scale = (direction >= 0) ? pinfo->src_win_scale : pinfo->dst_win_scale;
     tcpd->flow1.window = UINT32_MAX;
-    tcpd->flow1.multisegment_pdus=wmem_tree_new(wmem_file_scope());
+    tcpd->flow1.multisegment_pdus=wmem_tree_new(scope);
 
     tcpd->flow2.window = UINT32_MAX;
     tcpd->flow2.win_scale = (direction >= 0) ? pinfo->dst_win_scale : pinfo->src_win_scale;
-    tcpd->flow2.multisegment_pdus=wmem_tree_new(wmem_file_scope());
+    tcpd->flow2.multisegment_pdus=wmem_tree_new(scope);
 
     if (tcp_reassemble_out_of_order) {
-        tcpd->flow1.ooo_segments=wmem_list_new(wmem_file_scope());
-        tcpd->flow2.ooo_segments=wmem_list_new(wmem_file_scope());
+        tcpd->flow1.ooo_segments=wmem_list_new(scope);
+        tcpd->flow2.ooo_segments=wmem_list_new(scope);
     }
 
     /* Only allocate the data if its actually going to be analyzed */
     if (tcp_analyze_seq)
     {
-        tcpd->flow1.tcp_analyze_seq_info = wmem_new0(wmem_file_scope(), struct tcp_analyze_seq_flow_info_t);
-        tcpd->flow2.tcp_analyze_seq_info = wmem_new0(wmem_file_scope(), struct tcp_analyze_seq_flow_info_t);
+        tcpd->flow1.tcp_analyze_seq_info = wmem_new0(scope, struct tcp_analyze_seq_flow_info_t);
+        tcpd->flow2.tcp_analyze_seq_info = wmem_new0(scope, struct tcp_analyze_seq_flow_info_t);
     }
     /* Only allocate the data if its actually going to be displayed */
     if (tcp_display_process_info)
     {
-        tcpd->flow1.process_info = wmem_new0(wmem_file_scope(), struct tcp_process_info_t);
-        tcpd->flow2.process_info = wmem_new0(wmem_file_scope(), struct tcp_process_info_t);
+        tcpd->flow1.process_info = wmem_new0(scope, struct tcp_process_info_t);
+        tcpd->flow2.process_info = wmem_new0(scope, struct tcp_process_info_t);
     }
 
-    tcpd->acked_table=wmem_tree_new(wmem_file_scope());
+    tcpd->acked_table=wmem_tree_new(scope);
     tcpd->ts_first.secs=pinfo->abs_ts.secs;
     tcpd->ts_first.nsecs=pinfo->abs_ts.nsecs;
     nstime_set_zero(&tcpd->ts_mru_syn);
@@ -2078,6 +2082,26 @@ mptcp_attach_subflow(struct mptcp_analysis* mptcpd, struct tcp_analysis* tcpd) {
     tcpd->mptcp_analysis = mptcpd;
 }
 
+/*
+ * Called when an idle or closed conversation is expired, before its scope,
+ * and with it tcpd, is freed.  An MPTCP connection outlives its subflows,
+ * so take this one out of it.
+ */
+static void
+tcp_conversation_expired(conversation_t *conv _U_, void *proto_data)
+{
+    struct tcp_analysis *tcpd = (struct tcp_analysis *)proto_data;
+    struct mptcp_analysis *mptcpd;
+
+    if (tcpd == NULL || tcpd->mptcp_analysis == NULL)
+        return;
+
+    mptcpd = tcpd->mptcp_analysis;
+    wmem_list_remove(mptcpd->subflows, tcpd);
+    if (mptcpd->master == tcpd)
+        mptcpd->master = NULL;
+}
+
 struct tcp_analysis *
 get_tcp_conversation_data_idempotent(conversation_t *conv)
 {
@@ -2118,7 +2142,7 @@ get_tcp_conversation_data(conversation_t *conv, packet_info *pinfo)
      * a new tcpd structure for the conversation.
      */
     if (!tcpd) {
-        tcpd = init_tcp_conversation_data(pinfo, direction);
+        tcpd = init_tcp_conversation_data(pinfo, conv, direction);
         conversation_add_proto_data(conv, proto_tcp, tcpd);
     }
 
@@ -2172,12 +2196,12 @@ add_tcp_process_info(uint32_t frame_num, address *local_addr, address *remote_ad
     }
 
     if (flow->process_info == NULL)
-        flow->process_info = wmem_new0(wmem_file_scope(), struct tcp_process_info_t);
+        flow->process_info = wmem_new0(tcpd->scope, struct tcp_process_info_t);
 
     flow->process_info->process_uid = uid;
     flow->process_info->process_pid = pid;
-    flow->process_info->username = wmem_strdup(wmem_file_scope(), username);
-    flow->process_info->command = wmem_strdup(wmem_file_scope(), command);
+    flow->process_info->username = wmem_strdup(tcpd->scope, username);
+    flow->process_info->command = wmem_strdup(tcpd->scope, command);
 }
 
 /* Return the current stream count */
@@ -2192,14 +2216,42 @@ uint32_t get_mptcp_stream_count(void)
     return mptcp_stream_count;
 }
 
+/*
+ * The per-packet data is kept in file scope, to be found when the packet
+ * is dissected again.  When conversations are expired, packets are only
+ * dissected once, so it goes in the packet's pool instead of piling up;
+ * it's keyed by hf_tcp_stream_pnum there, as proto_tcp has the TCP tree.
+ */
+static struct tcp_per_packet_data_t *
+tcp_get_per_packet_data(packet_info *pinfo)
+{
+    if (conversation_get_expire_enabled())
+        return (struct tcp_per_packet_data_t *)p_get_proto_data(pinfo->pool, pinfo, hf_tcp_stream_pnum, pinfo->curr_layer_num);
+    return (struct tcp_per_packet_data_t *)p_get_proto_data(wmem_file_scope(), pinfo, proto_tcp, pinfo->curr_layer_num);
+}
+
+static struct tcp_per_packet_data_t *
+tcp_add_per_packet_data(packet_info *pinfo)
+{
+    struct tcp_per_packet_data_t *tcppd;
+
+    if (conversation_get_expire_enabled()) {
+        tcppd = wmem_new(pinfo->pool, struct tcp_per_packet_data_t);
+        p_add_proto_data(pinfo->pool, pinfo, hf_tcp_stream_pnum, pinfo->curr_layer_num, tcppd);
+    } else {
+        tcppd = wmem_new(wmem_file_scope(), struct tcp_per_packet_data_t);
+        p_add_proto_data(wmem_file_scope(), pinfo, proto_tcp, pinfo->curr_layer_num, tcppd);
+    }
+    return tcppd;
+}
+
 /* Calculate the timestamps relative to this conversation */
 static void
 tcp_calculate_timestamps(packet_info *pinfo, struct tcp_analysis *tcpd,
             struct tcp_per_packet_data_t *tcppd)
 {
     if( !tcppd ) {
-        tcppd = wmem_new(wmem_file_scope(), struct tcp_per_packet_data_t);
-        p_add_proto_data(wmem_file_scope(), pinfo, proto_tcp, pinfo->curr_layer_num, tcppd);
+        tcppd = tcp_add_per_packet_data(pinfo);
     }
 
     if (!tcpd)
@@ -2234,7 +2286,7 @@ tcp_print_timestamps(packet_info *pinfo, tvbuff_t *tvb, proto_tree *parent_tree,
     proto_item_set_generated(item);
 
     if( !tcppd )
-        tcppd = (struct tcp_per_packet_data_t *)p_get_proto_data(wmem_file_scope(), pinfo, proto_tcp, pinfo->curr_layer_num);
+        tcppd = tcp_get_per_packet_data(pinfo);
 
     if( tcppd ) {
         item = proto_tree_add_time(tree, hf_tcp_ts_delta, tvb, 0, 0,
@@ -2339,14 +2391,15 @@ scan_for_next_pdu(tvbuff_t *tvb, proto_tree *tcp_tree, packet_info *pinfo, int o
 }
 
 /* if we saw a PDU that extended beyond the end of the segment,
-   use this function to remember where the next pdu starts
+   use this function to remember where the next pdu starts.
+   The msp is allocated in scope, which should be that of the tree.
 */
-struct tcp_multisegment_pdu *
-pdu_store_sequencenumber_of_next_pdu(packet_info *pinfo, uint32_t seq, uint32_t nxtpdu, wmem_tree_t *multisegment_pdus)
+static struct tcp_multisegment_pdu *
+pdu_store_sequencenumber_of_next_pdu_scoped(wmem_allocator_t *scope, packet_info *pinfo, uint32_t seq, uint32_t nxtpdu, wmem_tree_t *multisegment_pdus)
 {
     struct tcp_multisegment_pdu *msp;
 
-    msp=wmem_new(wmem_file_scope(), struct tcp_multisegment_pdu);
+    msp=wmem_new(scope, struct tcp_multisegment_pdu);
     msp->nxtpdu=nxtpdu;
     msp->seq=seq;
     msp->first_frame=pinfo->num;
@@ -2359,6 +2412,12 @@ pdu_store_sequencenumber_of_next_pdu(packet_info *pinfo, uint32_t seq, uint32_t
     return msp;
 }
 
+struct tcp_multisegment_pdu *
+pdu_store_sequencenumber_of_next_pdu(packet_info *pinfo, uint32_t seq, uint32_t nxtpdu, wmem_tree_t *multisegment_pdus)
+{
+    return pdu_store_sequencenumber_of_next_pdu_scoped(wmem_file_scope(), pinfo, seq, nxtpdu, multisegment_pdus);
+}
+
 /* This is called for SYN and SYN+ACK packets and the purpose is to verify
  * that we have seen window scaling in both directions.
  * If we can't find window scaling being set in both directions
@@ -2441,7 +2500,7 @@ tcp_analyze_get_acked_struct(uint32_t frame, uint32_t seq, uint32_t ack, bool cr
 
     tcpd->ta = (struct tcp_acked *)wmem_tree_lookup32_array(tcpd->acked_table, key);
     if((!tcpd->ta) && createflag) {
-        tcpd->ta = wmem_new0(wmem_file_scope(), struct tcp_acked);
+        tcpd->ta = wmem_new0(tcpd->scope, struct tcp_acked);
         wmem_tree_insert32_array(tcpd->acked_table, key, (void *)tcpd->ta);
     }
 }
@@ -2984,7 +3043,7 @@ finished_checking_retransmission_type:
         /* Add this new sequence number to the fwd list.  But only if there
          * aren't "too many" unacked segments (e.g., we're not seeing the ACKs).
          */
-        ual = wmem_new(wmem_file_scope(), tcp_unacked_t);
+        ual = wmem_new(tcpd->scope, tcp_unacked_t);
         ual->next=tcpd->fwd->tcp_analyze_seq_info->segments;
         tcpd->fwd->tcp_analyze_seq_info->segments=ual;
         tcpd->fwd->tcp_analyze_seq_info->segment_count++;
@@ -3156,7 +3215,7 @@ finished_checking_retransmission_type:
         else{
             prevual->next = tmpual;
         }
-        wmem_free(wmem_file_scope(), ual);
+        wmem_free(tcpd->scope, ual);
         ual = tmpual;
         tcpd->rev->tcp_analyze_seq_info->segment_count--;
     }
@@ -4211,7 +4270,7 @@ split_msp(packet_info *pinfo, struct tcp_multisegment_pdu *msp, struct tcp_analy
 
     uint32_t new_seq = msp->seq + pinfo->desegment_offset;
     struct tcp_multisegment_pdu *newmsp;
-    newmsp = pdu_store_sequencenumber_of_next_pdu(pinfo, new_seq,
+    newmsp = pdu_store_sequencenumber_of_next_pdu_scoped(tcpd->scope, pinfo, new_seq,
         new_seq+1, tcpd->fwd->multisegment_pdus);
     newmsp->first_frame = first_frame;
     newmsp->nxtpdu = msp->nxtpdu;
@@ -4342,7 +4401,7 @@ msp_add_out_of_order(packet_info *pinfo, struct tcp_multisegment_pdu *msp, struc
              * of the first segment, so first_frame_with_seq
              * is already correct (and unnecessary) and
              * we don't need MSP_FLAGS_MISSING_FIRST_SEGMENT. */
-            msp = pdu_store_sequencenumber_of_next_pdu(pinfo,
+            msp = pdu_store_sequencenumber_of_next_pdu_scoped(tcpd->scope, pinfo,
                 seq, fd->seq + fd->len,
                 tcpd->fwd->multisegment_pdus);
             fragment_add_out_of_order(&tcp_reassembly_table,
@@ -4827,13 +4886,13 @@ again:
          */
         if (!PINFO_FD_VISITED(pinfo)) {
             ooo_segment_item *fd;
-            fd = wmem_new0(wmem_file_scope(), ooo_segment_item);
+            fd = wmem_new0(tcpd->scope, ooo_segment_item);
             fd->frame = pinfo->num;
             fd->seq = seq;
             fd->len = nxtseq - seq;
             /* We only enter here if dissect_tcp set can_desegment,
              * which means that these bytes exist. */
-            fd->data = tvb_memdup(wmem_file_scope(), tvb, offset, fd->len);
+            fd->data = tvb_memdup(tcpd->scope, tvb, offset, fd->len);
             wmem_list_append_sorted(tcpd->fwd->ooo_segments, fd, compare_ooo_segment_item);
         }
         ipfd_head = NULL;
@@ -5130,7 +5189,7 @@ again:
                      * but set this msp flag so we can pick it up
                      * above.
                      */
-                    msp = pdu_store_sequencenumber_of_next_pdu(pinfo, deseg_seq,
+                    msp = pdu_store_sequencenumber_of_next_pdu_scoped(tcpd->scope, pinfo, deseg_seq,
                         nxtseq+1, tcpd->fwd->multisegment_pdus);
                     msp->flags |= MSP_FLAGS_REASSEMBLE_ENTIRE_SEGMENT;
                 } else if (pinfo->desegment_len == DESEGMENT_UNTIL_FIN) {
@@ -5146,10 +5205,10 @@ again:
                      * larger than the largest possible stream size. Hopefully
                      * 1GiB (0x40000000 bytes) should be enough.
                      */
-                    msp = pdu_store_sequencenumber_of_next_pdu(pinfo, deseg_seq,
+                    msp = pdu_store_sequencenumber_of_next_pdu_scoped(tcpd->scope, pinfo, deseg_seq,
                         nxtseq+0x40000000, tcpd->fwd->multisegment_pdus);
                 } else {
-                    msp = pdu_store_sequencenumber_of_next_pdu(pinfo,
+                    msp = pdu_store_sequencenumber_of_next_pdu_scoped(tcpd->scope, pinfo,
                         deseg_seq, nxtseq+pinfo->desegment_len, tcpd->fwd->multisegment_pdus);
                 }
 
@@ -7928,7 +7987,7 @@ process_tcp_payload(tvbuff_t *tvb, volatile int offset, packet_info *pinfo,
                 if(tcpd && (!pinfo->fd->visited) &&
                     tcp_analyze_seq && pinfo->want_pdu_tracking) {
                     if(seq || nxtseq) {
-                        pdu_store_sequencenumber_of_next_pdu(
+                        pdu_store_sequencenumber_of_next_pdu_scoped(tcpd->scope,
                             pinfo,
                             seq,
                             nxtseq+pinfo->bytes_until_next_pdu,
@@ -7958,7 +8017,7 @@ process_tcp_payload(tvbuff_t *tvb, volatile int offset, packet_info *pinfo,
              */
             if(tcpd && (!pinfo->fd->visited) && tcp_analyze_seq && pinfo->want_pdu_tracking) {
                 if(seq || nxtseq) {
-                    pdu_store_sequencenumber_of_next_pdu(pinfo,
+                    pdu_store_sequencenumber_of_next_pdu_scoped(tcpd->scope, pinfo,
                         seq,
                         nxtseq+pinfo->bytes_until_next_pdu,
                         tcpd->fwd->multisegment_pdus);
@@ -8292,7 +8351,7 @@ dissect_tcp(tvbuff_t *tvb, packet_info *pinfo, proto_tree *tree, void* data _U_)
 
     /* Do we need to calculate timestamps relative to the tcp-stream? */
     if (tcp_calculate_ts) {
-        tcppd = (struct tcp_per_packet_data_t *)p_get_proto_data(wmem_file_scope(), pinfo, proto_tcp, pinfo->curr_layer_num);
+        tcppd = tcp_get_per_packet_data(pinfo);
 
         /*
          * Calculate the timestamps relative to this conversation (but only on
@@ -8306,6 +8365,7 @@ dissect_tcp(tvbuff_t *tvb, packet_info *pinfo, proto_tree *tree, void* data _U_)
         item = proto_tree_add_uint(tcp_tree, hf_tcp_stream, tvb, offset, 0, tcpd->stream);
         proto_item_set_generated(item);
         tcpinfo.stream = tcpd->stream;
+        follow_add_stream_frame(tcp_follower, pinfo, tcpd->stream);
 
         if (tcppd) {
             item = proto_tree_add_uint(tcp_tree, hf_tcp_stream_pnum, tvb, offset, 0, tcppd->pnum);
@@ -8350,7 +8410,7 @@ dissect_tcp(tvbuff_t *tvb, packet_info *pinfo, proto_tree *tree, void* data _U_)
 
     /* is there any manual analysis waiting ? */
     if(pinfo->fd->tcp_snd_manual_analysis > 0) {
-        tcppd = (struct tcp_per_packet_data_t *)p_get_proto_data(wmem_file_scope(), pinfo, proto_tcp, pinfo->curr_layer_num);
+        tcppd = tcp_get_per_packet_data(pinfo);
         tcppd->tcp_snd_manual_analysis = pinfo->fd->tcp_snd_manual_analysis;
     }
 
@@ -8603,12 +8663,18 @@ dissect_tcp(tvbuff_t *tvb, packet_info *pinfo, proto_tree *tree, void* data _U_)
       if (tcpd->conversation_completeness) {
           if (tcpd->conversation_completeness != conversation_completeness) {
               tcpd->conversation_completeness = conversation_completeness;
-              tcpd->conversation_completeness_str = completeness_flags_to_str_first_letter(wmem_file_scope(), tcpd->conversation_completeness) ;
+              tcpd->conversation_completeness_str = completeness_flags_to_str_first_letter(tcpd->scope, tcpd->conversation_completeness) ;
           }
       }
       else {
           tcpd->conversation_completeness = conversation_completeness;
-          tcpd->conversation_completeness_str = completeness_flags_to_str_first_letter(wmem_file_scope(), tcpd->conversation_completeness) ;
+          tcpd->conversation_completeness_str = completeness_flags_to_str_first_letter(tcpd->scope, tcpd->conversation_completeness) ;
+      }
+
+      /* Once it's being torn down, it can be expired sooner. */
+      if (!pinfo->fd->visited &&
+          (conversation_completeness & (TCP_COMPLETENESS_FIN|TCP_COMPLETENESS_RST))) {
+          conversation_set_closed(conv);
       }
     }
 
@@ -10442,6 +10508,9 @@ proto_register_tcp(void)
     register_init_routine(tcp_init);
     reassembly_table_register(&tcp_reassembly_table,
                           &tcp_reassembly_table_functions);
+    /* Segments of large PDUs are mostly dissected in place; don't copy them. */
+    reassembly_table_set_composite(&tcp_reassembly_table, true);
+    conversation_register_expire_func(proto_tcp, tcp_conversation_expired);
 
     register_decode_as(&tcp_da);
 
@@ -10486,7 +10555,7 @@ proto_register_tcp(void)
         &mptcp_intersubflows_retransmission);
 
     register_conversation_table(proto_mptcp, false, mptcpip_conversation_packet, tcpip_endpoint_packet);
-    register_follow_stream(proto_tcp, "tcp_follow", tcp_follow_conv_filter, tcp_follow_index_filter, tcp_follow_address_filter,
+    tcp_follower = register_follow_stream(proto_tcp, "tcp_follow", tcp_follow_conv_filter, tcp_follow_index_filter, tcp_follow_address_filter,
                             tcp_port_to_display, follow_tcp_tap_listener, get_tcp_stream_count, NULL);
 
     tcp_tap = register_tap("tcp");
@@ -512,6 +512,11 @@ struct tcp_analysis {
 	bool had_acc_ecn_setup_syn;
 	bool had_acc_ecn_setup_syn_ack;
 	bool had_acc_ecn_option;
+
+	/* Where this and what it points to are allocated; see
+	 * conversation_get_scope()
+	 */
+	wmem_allocator_t *scope;
 };
 
 /* Structure that keeps per packet data. First used to be able
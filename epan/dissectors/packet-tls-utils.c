@@ -4307,7 +4307,7 @@ static void ssl_zfree(void* opaque _U_, void* addr)
 #endif
 
 static SslDecompress*
-ssl_create_decompressor(int compression)
+ssl_create_decompressor(wmem_allocator_t *scope, int compression)
 {
     SslDecompress *decomp;
 #if defined (HAVE_ZLIB) || defined (HAVE_ZLIBNG)
@@ -4316,7 +4316,7 @@ ssl_create_decompressor(int compression)
 
     if (compression == 0) return NULL;
     ssl_debug_printf("ssl_create_decompressor: compression method %d\n", compression);
-    decomp = wmem_new(wmem_file_scope(), SslDecompress);
+    decomp = wmem_new(scope, SslDecompress);
     decomp->compression = compression;
     switch (decomp->compression) {
 #if defined (HAVE_ZLIB) || defined (HAVE_ZLIBNG)
@@ -4390,14 +4390,14 @@ ssl_decompress_record(SslDecompress* decomp _U_, const unsigned char* in _U_, un
 
 /* Create a new structure to store decrypted chunks. {{{ */
 static SslFlow*
-ssl_create_flow(void)
+ssl_create_flow(wmem_allocator_t *scope)
 {
   SslFlow *flow;
 
-  flow = wmem_new(wmem_file_scope(), SslFlow);
+  flow = wmem_new(scope, SslFlow);
   flow->byte_seq = 0;
   flow->flags = 0;
-  flow->multisegment_pdus = wmem_tree_new(wmem_file_scope());
+  flow->multisegment_pdus = wmem_tree_new(scope);
   return flow;
 }
 /* }}} */
@@ -4422,13 +4422,13 @@ static bool
 ssl_decoder_destroy_cb(wmem_allocator_t *, wmem_cb_event_t, void *);
 
 static SslDecoder*
-ssl_create_decoder(const SslCipherSuite *cipher_suite, int cipher_algo,
+ssl_create_decoder(wmem_allocator_t *scope, const SslCipherSuite *cipher_suite, int cipher_algo,
         int compression, uint8_t *mk, uint8_t *sk, uint8_t *sn_key, uint8_t *iv, unsigned iv_length)
 {
     SslDecoder *dec;
     ssl_cipher_mode_t mode = cipher_suite->mode;
 
-    dec = wmem_new0(wmem_file_scope(), SslDecoder);
+    dec = wmem_new0(scope, SslDecoder);
     /* init mac buffer: mac storage is embedded into decoder struct to save a
      memory allocation and waste samo more memory*/
     dec->cipher_suite=cipher_suite;
@@ -4447,8 +4447,8 @@ ssl_create_decoder(const SslCipherSuite *cipher_suite, int cipher_algo,
         ssl_data_set(&dec->write_iv, iv, iv_length);
     }
     dec->seq = 0;
-    dec->decomp = ssl_create_decompressor(compression);
-    wmem_register_callback(wmem_file_scope(), ssl_decoder_destroy_cb, dec);
+    dec->decomp = ssl_create_decompressor(scope, compression);
+    wmem_register_callback(scope, ssl_decoder_destroy_cb, dec);
 
     if (ssl_cipher_init(&dec->evp,cipher_algo,sk,iv,cipher_suite->mode) < 0) {
         ssl_debug_printf("%s: can't create cipher id:%d mode:%d\n", G_STRFUNC,
@@ -4572,7 +4572,7 @@ ssl_generate_pre_master_secret(SslDecryptSession *ssl_session,
 
         pre_master_len = psk_len * 2 + 4;
 
-        pre_master_secret.data = (unsigned char *)wmem_alloc(wmem_file_scope(), pre_master_len);
+        pre_master_secret.data = (unsigned char *)wmem_alloc(ssl_session->scope, pre_master_len);
         pre_master_secret.data_len = pre_master_len;
         /* 2 bytes psk_len*/
         pre_master_secret.data[0] = psk_len >> 8;
@@ -4735,7 +4735,7 @@ ssl_generate_keyring_material(SslDecryptSession*ssl_session)
                 return -1;
             }
 
-            wmem_free(wmem_file_scope(), ssl_session->handshake_data.data);
+            wmem_free(ssl_session->scope, ssl_session->handshake_data.data);
             ssl_session->handshake_data.data = NULL;
             ssl_session->handshake_data.data_len = 0;
 
@@ -4957,21 +4957,21 @@ ssl_generate_keyring_material(SslDecryptSession*ssl_session)
 create_decoders:
     /* create both client and server ciphers*/
     ssl_debug_printf("%s ssl_create_decoder(client)\n", G_STRFUNC);
-    ssl_session->client_new = ssl_create_decoder(cipher_suite, cipher_algo, ssl_session->session.compression, c_mk, c_wk, NULL, c_iv, write_iv_len);
+    ssl_session->client_new = ssl_create_decoder(ssl_session->scope, cipher_suite, cipher_algo, ssl_session->session.compression, c_mk, c_wk, NULL, c_iv, write_iv_len);
     if (!ssl_session->client_new) {
         ssl_debug_printf("%s can't init client decoder\n", G_STRFUNC);
         goto fail;
     }
     ssl_debug_printf("%s ssl_create_decoder(server)\n", G_STRFUNC);
-    ssl_session->server_new = ssl_create_decoder(cipher_suite, cipher_algo, ssl_session->session.compression, s_mk, s_wk, NULL, s_iv, write_iv_len);
+    ssl_session->server_new = ssl_create_decoder(ssl_session->scope, cipher_suite, cipher_algo, ssl_session->session.compression, s_mk, s_wk, NULL, s_iv, write_iv_len);
     if (!ssl_session->server_new) {
         ssl_debug_printf("%s can't init server decoder\n", G_STRFUNC);
         goto fail;
     }
 
     /* Continue the SSL stream after renegotiation with new keys. */
-    ssl_session->client_new->flow = ssl_session->client ? ssl_session->client->flow : ssl_create_flow();
-    ssl_session->server_new->flow = ssl_session->server ? ssl_session->server->flow : ssl_create_flow();
+    ssl_session->client_new->flow = ssl_session->client ? ssl_session->client->flow : ssl_create_flow(ssl_session->scope);
+    ssl_session->server_new->flow = ssl_session->server ? ssl_session->server->flow : ssl_create_flow(ssl_session->scope);
 
     ssl_debug_printf("%s: client seq %" PRIu64 ", server seq %" PRIu64 "\n",
         G_STRFUNC, ssl_session->client_new->seq, ssl_session->server_new->seq);
@@ -5058,7 +5058,7 @@ tls13_generate_keys(SslDecryptSession *ssl_session, const StringInfo *secret, bo
     }
 
     ssl_debug_printf("%s ssl_create_decoder(%s)\n", G_STRFUNC, is_from_server ? "server" : "client");
-    decoder = ssl_create_decoder(cipher_suite, cipher_algo, 0, NULL, write_key, sn_key, write_iv, iv_length);
+    decoder = ssl_create_decoder(ssl_session->scope, cipher_suite, cipher_algo, 0, NULL, write_key, sn_key, write_iv, iv_length);
     if (!decoder) {
         ssl_debug_printf("%s can't init %s decoder\n", G_STRFUNC, is_from_server ? "server" : "client");
         goto end;
@@ -5067,10 +5067,10 @@ tls13_generate_keys(SslDecryptSession *ssl_session, const StringInfo *secret, bo
     /* Continue the TLS session with new keys, but reuse old flow to keep things
      * like "Follow TLS" working (by linking application data records). */
     if (is_from_server) {
-        decoder->flow = ssl_session->server ? ssl_session->server->flow : ssl_create_flow();
+        decoder->flow = ssl_session->server ? ssl_session->server->flow : ssl_create_flow(ssl_session->scope);
         ssl_session->server = decoder;
     } else {
-        decoder->flow = ssl_session->client ? ssl_session->client->flow : ssl_create_flow();
+        decoder->flow = ssl_session->client ? ssl_session->client->flow : ssl_create_flow(ssl_session->scope);
         ssl_session->client = decoder;
     }
     ssl_debug_printf("%s %s ready using cipher suite 0x%04x (cipher %s hash %s)\n", G_STRFUNC,
@@ -5140,7 +5140,7 @@ ssl_decrypt_pre_master_secret(SslDecryptSession *ssl_session,
         return false;
     }
 
-    ssl_session->pre_master_secret.data = (uint8_t *)wmem_memdup(wmem_file_scope(), pms.data, 48);
+    ssl_session->pre_master_secret.data = (uint8_t *)wmem_memdup(ssl_session->scope, pms.data, 48);
     ssl_session->pre_master_secret.data_len = 48;
     if (pk) {
         gnutls_free(pms.data);
@@ -5853,7 +5853,7 @@ ssl_find_private_key_by_pubkey(SslDecryptSession *ssl,
     }
 
     ssl_print_data("Certificate.KeyID", key_id.key_id, key_id_len);
-    ssl->cert_key_id = wmem_new(wmem_file_scope(), cert_key_id_t);
+    ssl->cert_key_id = wmem_new(ssl->scope, cert_key_id_t);
     *ssl->cert_key_id = key_id;
 
 end:
@@ -5872,14 +5872,23 @@ ssl_get_session(conversation_t *conversation, dissector_handle_t tls_handle)
     void               *conv_data;
     SslDecryptSession  *ssl_session;
     int                 proto_ssl;
+    wmem_allocator_t   *scope;
 
     proto_ssl = dissector_handle_get_protocol_index(tls_handle);
     conv_data = conversation_get_proto_data(conversation, proto_ssl);
     if (conv_data != NULL)
         return (SslDecryptSession *)conv_data;
 
-    /* no previous SSL conversation info, initialize it. */
-    ssl_session = wmem_new0(wmem_file_scope(), SslDecryptSession);
+    /* no previous SSL conversation info, initialize it.
+     * A DTLS session with a Connection ID can be found from other
+     * conversations (see ssl_add_session_by_cid()), so only TLS sessions
+     * go away with their conversation. */
+    if (proto_ssl == proto_get_id_by_filter_name("dtls"))
+        scope = wmem_file_scope();
+    else
+        scope = conversation_get_scope(conversation);
+    ssl_session = wmem_new0(scope, SslDecryptSession);
+    ssl_session->scope = scope;
 
     /* data_len is the part that is meaningful, not the allocated length */
     ssl_session->master_secret.data_len = 0;
@@ -5930,7 +5939,7 @@ void ssl_reset_session(SslSession *session, SslDecryptSession *ssl, bool is_clie
             if (ssl->handshake_data.data_len > 0) {
                 // The EMS handshake hash starts with at the Client Hello,
                 // ensure that any messages before it are forgotten.
-                wmem_free(wmem_file_scope(), ssl->handshake_data.data);
+                wmem_free(ssl->scope, ssl->handshake_data.data);
                 ssl->handshake_data.data = NULL;
                 ssl->handshake_data.data_len = 0;
             }
@@ -6434,7 +6443,7 @@ ssl_restore_master_key(SslDecryptSession *ssl, const char *label,
     if (is_pre_master) {
         /* unlike master secret, pre-master secret has a variable size (48 for
          * RSA, varying for PSK) and is therefore not statically allocated */
-        ssl->pre_master_secret.data = (unsigned char *) wmem_alloc(wmem_file_scope(),
+        ssl->pre_master_secret.data = (unsigned char *) wmem_alloc(ssl->scope,
                                                             ms->data_len);
         ssl_data_set(&ssl->pre_master_secret, ms->data, ms->data_len);
         ssl->state |= SSL_PRE_MASTER_SECRET;
@@ -6605,12 +6614,12 @@ tls13_change_key(SslDecryptSession *ssl, ssl_master_key_map_t *mk_map,
         SslDecoder *decoder = is_from_server ? ssl->server : ssl->client;
         StringInfo *app_secret = &decoder->app_traffic_secret;
         if (type == TLS_SECRET_APP) {
-            app_secret->data = (unsigned char *) wmem_realloc(wmem_file_scope(),
+            app_secret->data = (unsigned char *) wmem_realloc(ssl->scope,
                                                        app_secret->data,
                                                        secret->data_len);
             ssl_data_set(app_secret, secret->data, secret->data_len);
         } else {
-            wmem_free(wmem_file_scope(), app_secret->data);
+            wmem_free(ssl->scope, app_secret->data);
             app_secret->data = NULL;
             app_secret->data_len = 0;
         }
@@ -6667,7 +6676,7 @@ tls13_key_update(SslDecryptSession *ssl, bool is_from_server)
          */
         decoder = is_from_server ? ssl->server : ssl->client;
         app_secret = &decoder->app_traffic_secret;
-        app_secret->data = (unsigned char *) wmem_realloc(wmem_file_scope(),
+        app_secret->data = (unsigned char *) wmem_realloc(ssl->scope,
                                                    app_secret->data,
                                                    hash_len);
         ssl_data_set(app_secret, new_secret, hash_len);
@@ -8304,7 +8313,7 @@ ssl_dissect_hnd_hello_ext_session_ticket(ssl_common_dissect_t *hf, tvbuff_t *tvb
         tvb_ensure_bytes_exist(tvb, offset, ext_len);
         /* Save the Session Ticket such that it can be used as identifier for
          * restoring a previous Master Secret (in ChangeCipherSpec) */
-        ssl->session_ticket.data = (unsigned char*)wmem_realloc(wmem_file_scope(),
+        ssl->session_ticket.data = (unsigned char*)wmem_realloc(ssl->scope,
                                     ssl->session_ticket.data, ext_len);
         ssl->session_ticket.data_len = ext_len;
         tvb_memcpy(tvb,ssl->session_ticket.data, offset, ext_len);
@@ -10566,7 +10575,7 @@ ssl_dissect_hnd_new_ses_ticket(ssl_common_dissect_t *hf, tvbuff_t *tvb, packet_i
     /* save the session ticket to cache for ssl_finalize_decryption */
     if (ssl && !is_tls13) {
         tvb_ensure_bytes_exist(tvb, offset, ticket_len);
-        ssl->session_ticket.data = (unsigned char*)wmem_realloc(wmem_file_scope(),
+        ssl->session_ticket.data = (unsigned char*)wmem_realloc(ssl->scope,
                                     ssl->session_ticket.data, ticket_len);
         ssl->session_ticket.data_len = ticket_len;
         tvb_memcpy(tvb, ssl->session_ticket.data, offset, ticket_len);
@@ -12211,7 +12220,7 @@ ssl_calculate_handshake_hash(SslDecryptSession *ssl_session, tvbuff_t *tvb, uint
         ssl_debug_printf("Calculating hash with offset %d %d\n", offset, length);
         if (tvb) {
             if (tvb_bytes_exist(tvb, offset, length)) {
-                ssl_session->handshake_data.data = (unsigned char *)wmem_realloc(wmem_file_scope(), ssl_session->handshake_data.data, old_length + length);
+                ssl_session->handshake_data.data = (unsigned char *)wmem_realloc(ssl_session->scope, ssl_session->handshake_data.data, old_length + length);
                 tvb_memcpy(tvb, ssl_session->handshake_data.data + old_length, offset, length);
                 ssl_session->handshake_data.data_len += length;
             }
@@ -12221,7 +12230,7 @@ ssl_calculate_handshake_hash(SslDecryptSession *ssl_session, tvbuff_t *tvb, uint
              * in a null tvbuff to add 3 bytes for a zero fragment offset.
              */
             DISSECTOR_ASSERT_CMPINT(length, <, 4);
-            ssl_session->handshake_data.data = (unsigned char *)wmem_realloc(wmem_file_scope(), ssl_session->handshake_data.data, old_length + length);
+            ssl_session->handshake_data.data = (unsigned char *)wmem_realloc(ssl_session->scope, ssl_session->handshake_data.data, old_length + length);
             memset(ssl_session->handshake_data.data + old_length, 0, length);
             ssl_session->handshake_data.data_len += length;
         }
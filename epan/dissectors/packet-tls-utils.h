@@ -543,6 +543,8 @@ typedef struct _SslDecryptSession {
     StringInfo app_data_segment;
     SslSession session;
     bool       has_early_data;
+    /* where this, its decoders and its secrets are allocated */
+    wmem_allocator_t *scope;
 
 } SslDecryptSession;
 
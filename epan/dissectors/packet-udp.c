@@ -45,6 +45,7 @@ static capture_dissector_handle_t udplite_cap_handle;
 
 static int udp_tap;
 static int udp_follow_tap;
+static register_follow_t *udp_follower;
 static int exported_pdu_tap;
 
 static int proto_udp;
@@ -127,6 +128,35 @@ typedef struct {
     uint32_t pnum;
 } udp_p_info_t;
 
+/*
+ * The per-packet data is kept in file scope, to be found when the packet
+ * is dissected again.  When conversations are expired, packets are only
+ * dissected once, so it goes in the packet's pool instead of piling up;
+ * it's keyed by hf_udp_stream_pnum there, as proto_udp has the UDP tree.
+ */
+static udp_p_info_t *
+udp_get_p_info(packet_info *pinfo, int proto, uint8_t layer_num)
+{
+    if (conversation_get_expire_enabled())
+        return (udp_p_info_t *)p_get_proto_data(pinfo->pool, pinfo, hf_udp_stream_pnum, layer_num);
+    return (udp_p_info_t *)p_get_proto_data(wmem_file_scope(), pinfo, proto, layer_num);
+}
+
+static udp_p_info_t *
+udp_add_p_info(packet_info *pinfo, int proto, uint8_t layer_num)
+{
+    udp_p_info_t *udp_p_info;
+
+    if (conversation_get_expire_enabled()) {
+        udp_p_info = wmem_new0(pinfo->pool, udp_p_info_t);
+        p_add_proto_data(pinfo->pool, pinfo, hf_udp_stream_pnum, layer_num, udp_p_info);
+    } else {
+        udp_p_info = wmem_new0(wmem_file_scope(), udp_p_info_t);
+        p_add_proto_data(wmem_file_scope(), pinfo, proto, layer_num, udp_p_info);
+    }
+    return udp_p_info;
+}
+
 static void
 udp_src_prompt(packet_info *pinfo, char *result)
 {
@@ -169,12 +199,12 @@ udp_both_prompt(packet_info *pinfo, char *result)
 
 /* Conversation and process code originally copied from packet-tcp.c */
 static struct udp_analysis *
-init_udp_conversation_data(packet_info *pinfo)
+init_udp_conversation_data(conversation_t *conv, packet_info *pinfo)
 {
     struct udp_analysis *udpd;
 
     /* Initialize the udp protocol data structure to add to the udp conversation */
-    udpd = wmem_new0(wmem_file_scope(), struct udp_analysis);
+    udpd = wmem_new0(conversation_get_scope(conv), struct udp_analysis);
     /*
     udpd->flow1.username = NULL;
     udpd->flow1.command = NULL;
@@ -208,7 +238,7 @@ get_udp_conversation_data(conversation_t *conv, packet_info *pinfo)
      * a new udpd structure for the conversation.
      */
     if (!udpd) {
-        udpd = init_udp_conversation_data(pinfo);
+        udpd = init_udp_conversation_data(conv, pinfo);
         conversation_add_proto_data(conv, proto_udp, udpd);
     }
 
@@ -456,8 +486,8 @@ add_udp_process_info(uint32_t frame_num, address *local_addr, address *remote_ad
 
     flow->process_uid = uid;
     flow->process_pid = pid;
-    flow->username = wmem_strdup(wmem_file_scope(), username);
-    flow->command = wmem_strdup(wmem_file_scope(), command);
+    flow->username = wmem_strdup(conversation_get_scope(conv), username);
+    flow->command = wmem_strdup(conversation_get_scope(conv), command);
 }
 
 
@@ -556,7 +586,7 @@ decode_udp_ports(tvbuff_t *tvb, int offset, packet_info *pinfo,
     proto_tree* tree = proto_tree_get_parent_tree(udp_tree);
 
     /* populate per packet data variable */
-    udp_p_info = (udp_p_info_t*)p_get_proto_data(wmem_file_scope(), pinfo, proto_udp, pinfo->curr_layer_num);
+    udp_p_info = udp_get_p_info(pinfo, proto_udp, pinfo->curr_layer_num);
 
     len = tvb_captured_length_remaining(tvb, offset);
     reported_len = tvb_reported_length_remaining(tvb, offset);
@@ -644,8 +674,7 @@ decode_udp_ports(tvbuff_t *tvb, int offset, packet_info *pinfo,
         /* Do lookup with the heuristic subdissector table */
         if (dissector_try_heuristic(heur_subdissector_list, next_tvb, pinfo, tree, &hdtbl_entry, NULL)) {
             if (!udp_p_info) {
-                udp_p_info = wmem_new0(wmem_file_scope(), udp_p_info_t);
-                p_add_proto_data(wmem_file_scope(), pinfo, proto_udp, curr_layer_num, udp_p_info);
+                udp_p_info = udp_add_p_info(pinfo, proto_udp, curr_layer_num);
             }
 
             udp_p_info->heur_dtbl_entry = hdtbl_entry;
@@ -682,8 +711,7 @@ decode_udp_ports(tvbuff_t *tvb, int offset, packet_info *pinfo,
         /* Do lookup with the heuristic subdissector table */
         if (dissector_try_heuristic(heur_subdissector_list, next_tvb, pinfo, tree, &hdtbl_entry, NULL)) {
             if (!udp_p_info) {
-                udp_p_info = wmem_new0(wmem_file_scope(), udp_p_info_t);
-                p_add_proto_data(wmem_file_scope(), pinfo, proto_udp, curr_layer_num, udp_p_info);
+                udp_p_info = udp_add_p_info(pinfo, proto_udp, curr_layer_num);
             }
 
             udp_p_info->heur_dtbl_entry = hdtbl_entry;
@@ -884,11 +912,10 @@ udp_compute_timestamps(packet_info *pinfo, struct udp_analysis *udp_data, int pr
         return;
 
     /* get per packet date for UDP/UDP-Lite based on protocol id */
-    udp_p_info_t *udp_per_packet_data = (udp_p_info_t *)p_get_proto_data(wmem_file_scope(), pinfo, proto, pinfo->curr_layer_num);
+    udp_p_info_t *udp_per_packet_data = udp_get_p_info(pinfo, proto, pinfo->curr_layer_num);
 
     if(!udp_per_packet_data) {
-        udp_per_packet_data = wmem_new0(wmem_file_scope(), udp_p_info_t);
-        p_add_proto_data(wmem_file_scope(), pinfo, proto, pinfo->curr_layer_num, udp_per_packet_data);
+        udp_per_packet_data = udp_add_p_info(pinfo, proto, pinfo->curr_layer_num);
     }
 
     /* pre-increment so packet numbers start at 1 */
@@ -912,7 +939,7 @@ udp_print_timestamps(packet_info *pinfo, tvbuff_t *tvb, proto_tree *parent_tree,
         return;
 
     /* get per packet date for UDP/UDP-Lite based on protocol id */
-    udp_p_info_t *udp_per_packet_data = (udp_p_info_t *)p_get_proto_data(wmem_file_scope(), pinfo, proto, pinfo->curr_layer_num);
+    udp_p_info_t *udp_per_packet_data = udp_get_p_info(pinfo, proto, pinfo->curr_layer_num);
 
     if (udp_per_packet_data) {
         item = proto_tree_add_uint(parent_tree, hf_udp_stream_pnum, tvb, 0, 0,
@@ -1227,6 +1254,7 @@ dissect(tvbuff_t *tvb, packet_info *pinfo, proto_tree *tree, uint32_t ip_proto)
     if (udpd) {
         item = proto_tree_add_uint(udp_tree, hf_udp_stream, tvb, offset, 0, udpd->stream);
         proto_item_set_generated(item);
+        follow_add_stream_frame(udp_follower, pinfo, udpd->stream);
 
         /* Copy the stream index into the header as well to make it available
         * to tap listeners.
@@ -1522,7 +1550,7 @@ proto_register_udp(void)
     register_decode_as(&udp_da);
     register_conversation_table(proto_udp, false, udpip_conversation_packet, udpip_endpoint_packet);
     register_conversation_filter("udp", "UDP", udp_filter_valid, udp_build_filter_by_id, NULL);
-    register_follow_stream(proto_udp, "udp_follow", udp_follow_conv_filter, udp_follow_index_filter, udp_follow_address_filter,
+    udp_follower = register_follow_stream(proto_udp, "udp_follow", udp_follow_conv_filter, udp_follow_index_filter, udp_follow_address_filter,
                         udp_port_to_display, follow_tvb_tap_listener, get_udp_stream_count, NULL);
 
     register_init_routine(udp_init);
@@ -39,6 +39,7 @@
 #include "except.h"
 #include "packet.h"
 #include "prefs.h"
+#include "prefs-int.h"
 #include "column-info.h"
 #include "tap.h"
 #include "addr_resolv.h"
@@ -467,6 +468,9 @@ epan_cleanup(void)
 struct epan_session {
 	struct packet_provider_data *prov;	/* packet provider data for this session */
 	struct packet_provider_funcs funcs;	/* functions using that data */
+	uint8_t *protos_dissected;		/* bitmap, by protocol ID, of the protocols whose dissectors have been called */
+	unsigned protos_dissected_size;		/* size of that bitmap, in bytes */
+	uint64_t dissector_tables_fingerprint;	/* dissector_tables_fingerprint() when the session was created */
 };
 
 epan_t *
@@ -481,6 +485,10 @@ epan_new(struct packet_provider_data *prov,
 	/* XXX, it should take session as param */
 	init_dissection();
 
+	/* Nothing's been dissected with the preferences changed before now. */
+	prefs_clear_dissection_changes();
+	session->dissector_tables_fingerprint = dissector_tables_fingerprint();
+
 	return session;
 }
 
@@ -534,10 +542,77 @@ epan_free(epan_t *session)
 		/* XXX, it should take session as param */
 		cleanup_dissection();
 
+		g_free(session->protos_dissected);
 		g_slice_free(epan_t, session);
 	}
 }
 
+void
+epan_note_protocol_dissected(epan_t *session, int proto_id)
+{
+	protocol_t *protocol;
+	unsigned byte;
+	unsigned new_size;
+
+	if (session == NULL || proto_id < 0)
+		return;
+
+	/* A protocol in name only has its parent's preferences. */
+	protocol = find_protocol_by_id(proto_id);
+	if (protocol != NULL && proto_is_pino(protocol))
+		proto_id = proto_get_parent_id(protocol);
+
+	byte = (unsigned)proto_id / 8;
+	if (byte >= session->protos_dissected_size) {
+		new_size = MAX(byte + 1, session->protos_dissected_size * 2);
+		session->protos_dissected = (uint8_t *)g_realloc(session->protos_dissected, new_size);
+		memset(session->protos_dissected + session->protos_dissected_size, 0,
+		    new_size - session->protos_dissected_size);
+		session->protos_dissected_size = new_size;
+	}
+	session->protos_dissected[byte] |= 1 << (proto_id % 8);
+}
+
+static bool
+epan_protocol_dissected(const epan_t *session, int proto_id)
+{
+	unsigned byte = (unsigned)proto_id / 8;
+
+	return byte < session->protos_dissected_size &&
+	    (session->protos_dissected[byte] & (1 << (proto_id % 8))) != 0;
+}
+
+bool
+epan_prefs_changes_affect_session(epan_t *session)
+{
+	const GPtrArray *changes = prefs_get_dissection_changes();
+	bool affected = false;
+	module_t *module;
+	int proto_id;
+	unsigned i;
+
+	if (changes == NULL) {
+		/* Something other than a preference changed. */
+		affected = true;
+	} else if (dissector_tables_fingerprint() != session->dissector_tables_fingerprint) {
+		/* Packets might be handed to different dissectors now. */
+		affected = true;
+	} else {
+		for (i = 0; i < changes->len; i++) {
+			module = (module_t *)g_ptr_array_index(changes, i);
+			/* A protocol's module has the protocol's filter name. */
+			proto_id = proto_get_id_by_filter_name(module->name);
+			if (proto_id == -1 || epan_protocol_dissected(session, proto_id)) {
+				affected = true;
+				break;
+			}
+		}
+	}
+
+	prefs_clear_dissection_changes();
+	return affected;
+}
+
 void
 epan_conversation_init(void)
 {
@@ -161,6 +161,27 @@ WS_DLL_PUBLIC const char *epan_get_interface_description(const epan_t *session,
 
 const nstime_t *epan_get_frame_ts(const epan_t *session, uint32_t frame_num);
 
+/** Record that a dissector for a protocol has been called in the session,
+ * whether or not it was added to the packet's layers. The dissector might
+ * have rejected the packet; its preferences could still change that.
+ * A protocol in name only is recorded as its parent protocol.
+ */
+void epan_note_protocol_dissected(epan_t *session, int proto_id);
+
+/** Returns true if the preferences affecting dissection that have been
+ * applied since the session was created, or since this was last called,
+ * could have changed the state built by dissecting the packets seen so
+ * far, so that they need to be redissected from scratch; it returns
+ * false if the only preferences changed belong to protocols none of whose
+ * dissectors have been called in the session, and no dissector tables
+ * changed. That assumes a protocol's preferences only affect packets its
+ * dissectors are called for.
+ *
+ * It returns true if no preferences were applied, as something else must
+ * have changed.
+ */
+WS_DLL_PUBLIC bool epan_prefs_changes_affect_session(epan_t *session);
+
 WS_DLL_PUBLIC void epan_free(epan_t *session);
 
 WS_DLL_PUBLIC const char*
@@ -30,16 +30,39 @@ struct register_follow {
     tap_packet_cb tap_handler; /* tap listener handler */
     follow_stream_count_func stream_count; /* maximum stream count, used for UI */
     follow_sub_stream_id_func sub_stream_id; /* sub-stream id, used for UI */
+    wmem_map_t *stream_frames; /* stream index -> frames in the stream, shared by followers with the same index filter */
 };
 
 static wmem_tree_t *registered_followers;
 
-void register_follow_stream(const int proto_id, const char* tap_listener,
+/* Whether follow_add_stream_frame() records anything; see follow_set_record_stream_frames(). */
+static bool record_stream_frames;
+
+typedef struct {
+  follow_index_filter_func index_filter;
+  wmem_map_t *stream_frames;
+} follow_find_stream_frames_t;
+
+static bool
+follow_find_stream_frames(const void *key _U_, void *value, void *userdata)
+{
+  register_follow_t *follower = (register_follow_t *)value;
+  follow_find_stream_frames_t *find = (follow_find_stream_frames_t *)userdata;
+
+  if (follower->index_filter == find->index_filter) {
+    find->stream_frames = follower->stream_frames;
+    return true;
+  }
+  return false;
+}
+
+register_follow_t* register_follow_stream(const int proto_id, const char* tap_listener,
                             follow_conv_filter_func conv_filter, follow_index_filter_func index_filter, follow_address_filter_func address_filter,
                             follow_port_to_display_func port_to_display, tap_packet_cb tap_handler,
                             follow_stream_count_func stream_count, follow_sub_stream_id_func sub_stream_id)
 {
   register_follow_t *follower;
+  follow_find_stream_frames_t find;
   DISSECTOR_ASSERT(tap_listener);
   DISSECTOR_ASSERT(conv_filter);
   DISSECTOR_ASSERT(index_filter);
@@ -62,7 +85,17 @@ void register_follow_stream(const int proto_id, const char* tap_listener,
   if (registered_followers == NULL)
     registered_followers = wmem_tree_new(wmem_epan_scope());
 
+  /* Followers whose index filters are the same follow the same frames. */
+  find.index_filter = index_filter;
+  find.stream_frames = NULL;
+  wmem_tree_foreach(registered_followers, follow_find_stream_frames, &find);
+  if (find.stream_frames == NULL)
+    find.stream_frames = wmem_map_new_autoreset(wmem_epan_scope(), wmem_file_scope(), g_direct_hash, g_direct_equal);
+  follower->stream_frames = find.stream_frames;
+
   wmem_tree_insert_string(registered_followers, proto_get_protocol_short_name(find_protocol_by_id(proto_id)), follower, 0);
+
+  return follower;
 }
 
 int get_follow_proto_id(register_follow_t* follower)
@@ -143,6 +176,38 @@ char* follow_get_stat_tap_string(register_follow_t* follower)
     return g_string_free(cmd_str, FALSE);
 }
 
+void follow_set_record_stream_frames(bool record)
+{
+  record_stream_frames = record;
+}
+
+void follow_add_stream_frame(register_follow_t* follower, packet_info *pinfo, unsigned stream)
+{
+  wmem_array_t *frames;
+  uint32_t num = pinfo->num;
+
+  if (!record_stream_frames || follower == NULL || PINFO_FD_VISITED(pinfo))
+    return;
+
+  frames = (wmem_array_t *)wmem_map_lookup(follower->stream_frames, GUINT_TO_POINTER(stream));
+  if (frames == NULL) {
+    frames = wmem_array_new(wmem_file_scope(), sizeof(uint32_t));
+    wmem_map_insert(follower->stream_frames, GUINT_TO_POINTER(stream), frames);
+  } else if (*(uint32_t *)wmem_array_index(frames, wmem_array_get_count(frames) - 1) == num) {
+    /* Another PDU of the stream in the same frame */
+    return;
+  }
+  wmem_array_append_one(frames, num);
+}
+
+wmem_array_t* follow_get_stream_frames(register_follow_t* follower, unsigned stream)
+{
+  if (follower == NULL)
+    return NULL;
+
+  return (wmem_array_t *)wmem_map_lookup(follower->stream_frames, GUINT_TO_POINTER(stream));
+}
+
 /* here we are going to try and reconstruct the data portion of a TCP
    session. We will try and handle duplicates, TCP fragments, and out
    of order packets in a smart way. */
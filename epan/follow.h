@@ -73,8 +73,12 @@ typedef char* (*follow_port_to_display_func)(wmem_allocator_t *allocator, unsign
 typedef uint32_t (*follow_stream_count_func)(void);
 typedef bool (*follow_sub_stream_id_func)(unsigned stream, unsigned sub_stream, bool le, unsigned *sub_stream_out);
 
+/** Register a follower
+ *
+ * @return the registered follower, for follow_add_stream_frame()
+ */
 WS_DLL_PUBLIC
-void register_follow_stream(const int proto_id, const char* tap_listener,
+register_follow_t* register_follow_stream(const int proto_id, const char* tap_listener,
                             follow_conv_filter_func conv_filter, follow_index_filter_func index_filter, follow_address_filter_func address_filter,
                             follow_port_to_display_func port_to_display, tap_packet_cb tap_handler,
                             follow_stream_count_func stream_count, follow_sub_stream_id_func sub_stream_id);
@@ -184,6 +188,38 @@ WS_DLL_PUBLIC void follow_iterate_followers(wmem_foreach_func func, void *user_d
  */
 WS_DLL_PUBLIC char* follow_get_stat_tap_string(register_follow_t* follower);
 
+/** Have follow_add_stream_frame() record the frames in each stream, for
+ * programs that follow streams by retapping the frames in them later.
+ * This is off by default, as the record grows with every frame in a
+ * stream, and is only worth keeping if something may follow a stream.
+ *
+ * @param record [in] Whether to record the frames in each stream
+ */
+WS_DLL_PUBLIC void follow_set_record_stream_frames(bool record);
+
+/** Record that a frame is in a stream, so that following the stream only
+ * needs to dissect the frames in it. Dissectors call this for each frame
+ * with the stream index that their index filter matches the frame with;
+ * it does nothing after the first pass, or unless
+ * follow_set_record_stream_frames() was called. Followers with the same
+ * index filter share their record of the frames in each stream.
+ *
+ * @param follower [in] Registered follower
+ * @param pinfo [in] Packet info of the frame
+ * @param stream [in] Stream index
+ */
+WS_DLL_PUBLIC void follow_add_stream_frame(register_follow_t* follower, packet_info *pinfo, unsigned stream);
+
+/** Get the frames recorded in a stream by follow_add_stream_frame()
+ *
+ * @param follower [in] Registered follower
+ * @param stream [in] Stream index
+ * @return A wmem_array_t of the uint32_t numbers of the frames, in
+ * increasing order, or NULL if none were recorded, in which case every
+ * frame has to be dissected to follow the stream
+ */
+WS_DLL_PUBLIC wmem_array_t* follow_get_stream_frames(register_follow_t* follower, unsigned stream);
+
 /** Clear payload, fragments, counters, addresses, and ports of follow_info_t
  * for retapping. (Does not clear substream_id, which is used for selecting
  * which tvbs are tapped.)
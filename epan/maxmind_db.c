@@ -41,6 +41,7 @@ static mmdb_lookup_t mmdb_not_found;
 #include <wsutil/filesystem.h>
 #include <wsutil/ws_pipe.h>
 #include <wsutil/strtoi.h>
+#include <wsutil/pint.h>
 #include <wsutil/glib-compat.h>
 
 // To do:
@@ -153,6 +154,582 @@ static void init_lookup(mmdb_lookup_t *lookup) {
     *lookup = empty_lookup;
 }
 
+/*
+ * In-process lookups.
+ *
+ * We can't link with libmaxminddb, which is why mmdbresolve exists, but
+ * the MaxMind DB format is simple enough to read directly: a binary
+ * search tree over the address bits, whose leaves point into a data
+ * section of maps, arrays, strings and numbers, followed by a map of
+ * metadata.
+ *   https://maxmind.github.io/MaxMind-DB/
+ * We map each file read-only and walk it in the lookup functions, and
+ * only spawn mmdbresolve if any of the files can't be read this way.
+ */
+
+#define MMDB_METADATA_MARKER        "\xAB\xCD\xEFMaxMind.com"
+#define MMDB_METADATA_MARKER_LEN    14
+#define MMDB_METADATA_MAX_SIZE      (128 * 1024)
+#define MMDB_DATA_SECTION_SEPARATOR 16
+#define MMDB_MAX_DEPTH              32
+
+enum {
+    MMDB_TYPE_EXTENDED = 0,
+    MMDB_TYPE_POINTER = 1,
+    MMDB_TYPE_UTF8_STRING = 2,
+    MMDB_TYPE_DOUBLE = 3,
+    MMDB_TYPE_BYTES = 4,
+    MMDB_TYPE_UINT16 = 5,
+    MMDB_TYPE_UINT32 = 6,
+    MMDB_TYPE_MAP = 7,
+    MMDB_TYPE_INT32 = 8,
+    MMDB_TYPE_UINT64 = 9,
+    MMDB_TYPE_UINT128 = 10,
+    MMDB_TYPE_ARRAY = 11,
+    MMDB_TYPE_CONTAINER = 12,
+    MMDB_TYPE_END_MARKER = 13,
+    MMDB_TYPE_BOOLEAN = 14,
+    MMDB_TYPE_FLOAT = 15
+};
+
+typedef struct _mmdb_section_t {
+    const uint8_t *data;
+    size_t len;
+} mmdb_section_t;
+
+typedef struct _mmdb_value_t {
+    unsigned type;
+    uint32_t size;          // Length, number of entries, or the value of a boolean
+    const uint8_t *payload;
+} mmdb_value_t;
+
+typedef struct _mmdb_file_t {
+    GMappedFile *mapped;
+    const uint8_t *tree;
+    uint32_t node_count;
+    unsigned record_size;   // In bits; each node has two records
+    unsigned ip_version;
+    uint32_t ipv4_start_node;
+    mmdb_section_t data_section;
+} mmdb_file_t;
+
+static GPtrArray *mmdb_files; // mmdb_file_t *, if every .mmdb file could be mapped
+
+// Decoded records, keyed by the offsets of the records for an address in
+// each file, so that the addresses in a network share one decoding.
+static wmem_map_t *mmdb_record_map;
+
+static const char *mmdb_co_iso_key[]     = { "country", "iso_code", NULL };
+static const char *mmdb_co_name_key[]    = { "country", "names", "en", NULL };
+static const char *mmdb_ci_name_key[]    = { "city", "names", "en", NULL };
+static const char *mmdb_asn_o_key[]      = { "autonomous_system_organization", NULL };
+static const char *mmdb_asn_key[]        = { "autonomous_system_number", NULL };
+static const char *mmdb_l_lat_key[]      = { "location", "latitude", NULL };
+static const char *mmdb_l_lon_key[]      = { "location", "longitude", NULL };
+static const char *mmdb_l_accuracy_key[] = { "location", "accuracy_radius", NULL };
+
+/*
+ * Read the control byte(s) of the value at *offset and advance *offset
+ * past them. A pointer isn't followed; its target is returned in size.
+ */
+static bool
+mmdb_read_control(const mmdb_section_t *section, size_t *offset, unsigned *type, uint32_t *size)
+{
+    const uint8_t *p;
+    size_t remaining;
+    size_t used = 1;
+
+    if (*offset >= section->len) {
+        return false;
+    }
+    p = section->data + *offset;
+    remaining = section->len - *offset;
+
+    *type = p[0] >> 5;
+    if (*type == MMDB_TYPE_POINTER) {
+        unsigned ptr_len = ((p[0] >> 3) & 0x3) + 1;
+        uint32_t target = p[0] & 0x7;
+
+        if (remaining < 1 + ptr_len) {
+            return false;
+        }
+        switch (ptr_len) {
+        case 1:
+            target = (target << 8) | p[1];
+            break;
+        case 2:
+            target = ((target << 16) | pntoh16(p + 1)) + 2048;
+            break;
+        case 3:
+            target = ((target << 24) | pntoh24(p + 1)) + 526336;
+            break;
+        default:
+            target = pntoh32(p + 1);
+            break;
+        }
+        *size = target;
+        *offset += 1 + ptr_len;
+        return true;
+    }
+
+    if (*type == MMDB_TYPE_EXTENDED) {
+        if (remaining < 2) {
+            return false;
+        }
+        *type = 7 + p[1];
+        used = 2;
+    }
+
+    *size = p[0] & 0x1f;
+    if (*size >= 29) {
+        size_t size_len = *size - 28;
+
+        if (remaining < used + size_len) {
+            return false;
+        }
+        switch (size_len) {
+        case 1:
+            *size = 29 + p[used];
+            break;
+        case 2:
+            *size = 285 + pntoh16(p + used);
+            break;
+        default:
+            *size = 65821 + pntoh24(p + used);
+            break;
+        }
+        used += size_len;
+    }
+
+    *offset += used;
+    return true;
+}
+
+/* Get the value at offset, following a pointer. */
+static bool
+mmdb_get_value(const mmdb_section_t *section, size_t offset, mmdb_value_t *value)
+{
+    if (!mmdb_read_control(section, &offset, &value->type, &value->size)) {
+        return false;
+    }
+    if (value->type == MMDB_TYPE_POINTER) {
+        offset = value->size;
+        if (!mmdb_read_control(section, &offset, &value->type, &value->size) ||
+                value->type == MMDB_TYPE_POINTER) {
+            return false;
+        }
+    }
+    value->payload = section->data + offset;
+
+    switch (value->type) {
+    case MMDB_TYPE_MAP:
+    case MMDB_TYPE_ARRAY:
+    case MMDB_TYPE_BOOLEAN:
+        return true;
+    default:
+        return value->size <= section->len - offset;
+    }
+}
+
+/* Advance *offset past the value there, without following pointers. */
+static bool
+mmdb_skip_value(const mmdb_section_t *section, size_t *offset, unsigned depth)
+{
+    unsigned type;
+    uint32_t size, i;
+
+    if (depth > MMDB_MAX_DEPTH || !mmdb_read_control(section, offset, &type, &size)) {
+        return false;
+    }
+
+    switch (type) {
+    case MMDB_TYPE_POINTER:
+    case MMDB_TYPE_BOOLEAN:
+        return true;
+    case MMDB_TYPE_MAP:
+        for (i = 0; i < size; i++) {
+            if (!mmdb_skip_value(section, offset, depth + 1) ||
+                    !mmdb_skip_value(section, offset, depth + 1)) {
+                return false;
+            }
+        }
+        return true;
+    case MMDB_TYPE_ARRAY:
+        for (i = 0; i < size; i++) {
+            if (!mmdb_skip_value(section, offset, depth + 1)) {
+                return false;
+            }
+        }
+        return true;
+    default:
+        if (size > section->len - *offset) {
+            return false;
+        }
+        *offset += size;
+        return true;
+    }
+}
+
+/* Get the value at the end of a path of map keys from the value at offset. */
+static bool
+mmdb_get_path(const mmdb_section_t *section, size_t offset, const char **path, mmdb_value_t *value)
+{
+    for (; *path; path++) {
+        size_t key_len = strlen(*path);
+        uint32_t i;
+
+        if (!mmdb_get_value(section, offset, value) || value->type != MMDB_TYPE_MAP) {
+            return false;
+        }
+        offset = value->payload - section->data;
+        for (i = 0; i < value->size; i++) {
+            mmdb_value_t key;
+
+            if (!mmdb_get_value(section, offset, &key) || key.type != MMDB_TYPE_UTF8_STRING ||
+                    !mmdb_skip_value(section, &offset, 0)) {
+                return false;
+            }
+            if (key.size == key_len && memcmp(key.payload, *path, key_len) == 0) {
+                break;
+            }
+            if (!mmdb_skip_value(section, &offset, 0)) {
+                return false;
+            }
+        }
+        if (i == value->size) {
+            return false;
+        }
+    }
+
+    return mmdb_get_value(section, offset, value);
+}
+
+static bool
+mmdb_value_to_uint(const mmdb_value_t *value, uint64_t *uint)
+{
+    switch (value->type) {
+    case MMDB_TYPE_UINT16:
+    case MMDB_TYPE_UINT32:
+    case MMDB_TYPE_INT32:
+    case MMDB_TYPE_UINT64:
+        if (value->size > 8) {
+            return false;
+        }
+        *uint = 0;
+        for (uint32_t i = 0; i < value->size; i++) {
+            *uint = (*uint << 8) | value->payload[i];
+        }
+        return true;
+    default:
+        return false;
+    }
+}
+
+static bool
+mmdb_value_to_double(const mmdb_value_t *value, double *dbl)
+{
+    if (value->type == MMDB_TYPE_DOUBLE && value->size == 8) {
+        union { uint64_t u; double d; } ieee;
+        ieee.u = pntoh64(value->payload);
+        *dbl = ieee.d;
+        return true;
+    }
+    if (value->type == MMDB_TYPE_FLOAT && value->size == 4) {
+        union { uint32_t u; float f; } ieee;
+        ieee.u = pntoh32(value->payload);
+        *dbl = ieee.f;
+        return true;
+    }
+    return false;
+}
+
+static const char *
+mmdb_value_to_string(const mmdb_value_t *value)
+{
+    if (value->type != MMDB_TYPE_UTF8_STRING || value->size == 0) {
+        return NULL;
+    }
+    char *str = g_strndup((const char *) value->payload, value->size);
+    const char *chunk_string = chunkify_string(str);
+    g_free(str);
+    return chunk_string;
+}
+
+static uint32_t
+mmdb_read_record(const mmdb_file_t *mmdb_file, uint32_t node, unsigned bit)
+{
+    const uint8_t *p = mmdb_file->tree + (size_t) node * mmdb_file->record_size / 4;
+
+    switch (mmdb_file->record_size) {
+    case 24:
+        return pntoh24(p + bit * 3);
+    case 28:
+        if (bit) {
+            return ((uint32_t) (p[3] & 0x0f) << 24) | pntoh24(p + 4);
+        }
+        return ((uint32_t) (p[3] & 0xf0) << 20) | pntoh24(p);
+    default:
+        return pntoh32(p + bit * 4);
+    }
+}
+
+/* Walk the search tree to the data section offset of an address's record. */
+static bool
+mmdb_find_record(const mmdb_file_t *mmdb_file, const uint8_t *addr, unsigned bits, size_t *offset)
+{
+    uint32_t node = 0;
+
+    if (bits == 32 && mmdb_file->ip_version == 6) {
+        node = mmdb_file->ipv4_start_node;
+    } else if (bits == 128 && mmdb_file->ip_version != 6) {
+        return false;
+    }
+
+    for (unsigned i = 0; i < bits && node < mmdb_file->node_count; i++) {
+        node = mmdb_read_record(mmdb_file, node, (addr[i / 8] >> (7 - (i % 8))) & 1);
+    }
+
+    // node_count means there's no record; less means we ran out of bits.
+    if ((uint64_t) node < (uint64_t) mmdb_file->node_count + MMDB_DATA_SECTION_SEPARATOR) {
+        return false;
+    }
+    *offset = (size_t) node - mmdb_file->node_count - MMDB_DATA_SECTION_SEPARATOR;
+    return *offset < mmdb_file->data_section.len;
+}
+
+static void
+mmdb_file_close(void *data)
+{
+    mmdb_file_t *mmdb_file = (mmdb_file_t *) data;
+
+    g_mapped_file_unref(mmdb_file->mapped);
+    g_free(mmdb_file);
+}
+
+static mmdb_file_t *
+mmdb_file_open(const char *path)
+{
+    GError *err = NULL;
+    GMappedFile *mapped = g_mapped_file_new(path, false, &err);
+
+    if (!mapped) {
+        ws_info("can't map %s: %s", path, err->message);
+        g_clear_error(&err);
+        return NULL;
+    }
+
+    const uint8_t *data = (const uint8_t *) g_mapped_file_get_contents(mapped);
+    size_t len = g_mapped_file_get_length(mapped);
+    const uint8_t *metadata = NULL;
+    size_t search_start = len > MMDB_METADATA_MAX_SIZE ? len - MMDB_METADATA_MAX_SIZE : 0;
+
+    // The metadata follows the last marker in the file.
+    for (size_t i = len; i >= search_start + MMDB_METADATA_MARKER_LEN; i--) {
+        if (memcmp(data + i - MMDB_METADATA_MARKER_LEN, MMDB_METADATA_MARKER, MMDB_METADATA_MARKER_LEN) == 0) {
+            metadata = data + i;
+            break;
+        }
+    }
+    if (!metadata) {
+        ws_info("%s has no metadata", path);
+        g_mapped_file_unref(mapped);
+        return NULL;
+    }
+
+    mmdb_section_t metadata_section = { metadata, (size_t) (data + len - metadata) };
+    static const char *node_count_key[] = { "node_count", NULL };
+    static const char *record_size_key[] = { "record_size", NULL };
+    static const char *ip_version_key[] = { "ip_version", NULL };
+    static const char *major_version_key[] = { "binary_format_major_version", NULL };
+    mmdb_value_t value;
+    uint64_t node_count, record_size, ip_version, major_version;
+
+    if (!mmdb_get_path(&metadata_section, 0, node_count_key, &value) || !mmdb_value_to_uint(&value, &node_count) ||
+            !mmdb_get_path(&metadata_section, 0, record_size_key, &value) || !mmdb_value_to_uint(&value, &record_size) ||
+            !mmdb_get_path(&metadata_section, 0, ip_version_key, &value) || !mmdb_value_to_uint(&value, &ip_version) ||
+            !mmdb_get_path(&metadata_section, 0, major_version_key, &value) || !mmdb_value_to_uint(&value, &major_version)) {
+        ws_info("%s has invalid metadata", path);
+        g_mapped_file_unref(mapped);
+        return NULL;
+    }
+
+    uint64_t tree_size = node_count * record_size / 4;
+    uint64_t metadata_start = metadata - MMDB_METADATA_MARKER_LEN - data;
+    if (major_version != 2 || (record_size != 24 && record_size != 28 && record_size != 32) ||
+            (ip_version != 4 && ip_version != 6) || node_count >= UINT32_MAX ||
+            tree_size + MMDB_DATA_SECTION_SEPARATOR > metadata_start) {
+        ws_info("%s has an unsupported format", path);
+        g_mapped_file_unref(mapped);
+        return NULL;
+    }
+
+    mmdb_file_t *mmdb_file = g_new0(mmdb_file_t, 1);
+    mmdb_file->mapped = mapped;
+    mmdb_file->tree = data;
+    mmdb_file->node_count = (uint32_t) node_count;
+    mmdb_file->record_size = (unsigned) record_size;
+    mmdb_file->ip_version = (unsigned) ip_version;
+    mmdb_file->data_section.data = data + tree_size + MMDB_DATA_SECTION_SEPARATOR;
+    mmdb_file->data_section.len = (size_t) (metadata_start - tree_size - MMDB_DATA_SECTION_SEPARATOR);
+
+    // IPv4 addresses are looked up in IPv6 trees as ::a.b.c.d.
+    uint32_t node = 0;
+    if (mmdb_file->ip_version == 6) {
+        for (unsigned i = 0; i < 96 && node < mmdb_file->node_count; i++) {
+            node = mmdb_read_record(mmdb_file, node, 0);
+        }
+    }
+    mmdb_file->ipv4_start_node = node;
+
+    ws_info("mapped %s: %u nodes, %u bit records, IPv%u", path, mmdb_file->node_count, mmdb_file->record_size, mmdb_file->ip_version);
+    return mmdb_file;
+}
+
+static void mmdb_files_close(void) {
+    if (mmdb_files) {
+        g_ptr_array_free(mmdb_files, true);
+        mmdb_files = NULL;
+    }
+}
+
+static gboolean
+mmdb_record_remove_cb(void *key _U_, void *value _U_, void *user_data _U_)
+{
+    return true;
+}
+
+/* Map every .mmdb file, or none of them. */
+static bool mmdb_files_open(void) {
+    mmdb_files_close();
+
+    mmdb_files = g_ptr_array_new_with_free_func(mmdb_file_close);
+    for (unsigned i = 0; i < mmdb_file_arr->len; i++) {
+        mmdb_file_t *mmdb_file = mmdb_file_open((const char *) g_ptr_array_index(mmdb_file_arr, i));
+        if (!mmdb_file) {
+            mmdb_files_close();
+            return false;
+        }
+        g_ptr_array_add(mmdb_files, mmdb_file);
+    }
+
+    // The offsets are those of the files we had before.
+    wmem_map_foreach_remove(mmdb_record_map, mmdb_record_remove_cb, NULL);
+    return true;
+}
+
+static unsigned
+mmdb_record_hash(const void *key)
+{
+    const uint32_t *offsets = (const uint32_t *) key;
+    unsigned hash = 0;
+
+    // offsets[0] is the number of offsets.
+    for (uint32_t i = 0; i <= offsets[0]; i++) {
+        hash = hash * 31 + offsets[i];
+    }
+    return hash;
+}
+
+static gboolean
+mmdb_record_equal(const void *a, const void *b)
+{
+    const uint32_t *offsets_a = (const uint32_t *) a;
+    const uint32_t *offsets_b = (const uint32_t *) b;
+
+    return offsets_a[0] == offsets_b[0] &&
+        memcmp(offsets_a + 1, offsets_b + 1, offsets_a[0] * sizeof(uint32_t)) == 0;
+}
+
+/*
+ * Look up an address in every file, as mmdbresolve does: a value found in
+ * a later file replaces one found in an earlier one.
+ */
+static mmdb_lookup_t *
+mmdb_files_lookup(const uint8_t *addr, unsigned bits)
+{
+    uint32_t *offsets = g_new(uint32_t, mmdb_files->len + 1);
+    bool any_found = false;
+
+    // Offsets are stored plus one, so that zero means not found.
+    offsets[0] = mmdb_files->len;
+    for (unsigned i = 0; i < mmdb_files->len; i++) {
+        size_t offset;
+
+        offsets[i + 1] = 0;
+        if (mmdb_find_record((const mmdb_file_t *) g_ptr_array_index(mmdb_files, i), addr, bits, &offset) &&
+                offset < UINT32_MAX) {
+            offsets[i + 1] = (uint32_t) offset + 1;
+            any_found = true;
+        }
+    }
+
+    if (!any_found) {
+        g_free(offsets);
+        return &mmdb_not_found;
+    }
+
+    mmdb_lookup_t *mmdb_val = (mmdb_lookup_t *) wmem_map_lookup(mmdb_record_map, offsets);
+    if (mmdb_val) {
+        g_free(offsets);
+        return mmdb_val;
+    }
+
+    mmdb_val = wmem_new(wmem_epan_scope(), mmdb_lookup_t);
+    init_lookup(mmdb_val);
+    for (unsigned i = 0; i < mmdb_files->len; i++) {
+        const mmdb_section_t *section = &((const mmdb_file_t *) g_ptr_array_index(mmdb_files, i))->data_section;
+        size_t offset = (size_t) offsets[i + 1] - 1;
+        mmdb_value_t value;
+        const char *str;
+        uint64_t uint;
+        double dbl;
+
+        if (offsets[i + 1] == 0) {
+            continue;
+        }
+        if (mmdb_get_path(section, offset, mmdb_co_iso_key, &value) && (str = mmdb_value_to_string(&value)) != NULL) {
+            mmdb_val->found = true;
+            mmdb_val->country_iso = str;
+        }
+        if (mmdb_get_path(section, offset, mmdb_co_name_key, &value) && (str = mmdb_value_to_string(&value)) != NULL) {
+            mmdb_val->found = true;
+            mmdb_val->country = str;
+        }
+        if (mmdb_get_path(section, offset, mmdb_ci_name_key, &value) && (str = mmdb_value_to_string(&value)) != NULL) {
+            mmdb_val->found = true;
+            mmdb_val->city = str;
+        }
+        if (mmdb_get_path(section, offset, mmdb_asn_o_key, &value) && (str = mmdb_value_to_string(&value)) != NULL) {
+            mmdb_val->found = true;
+            mmdb_val->as_org = str;
+        }
+        if (mmdb_get_path(section, offset, mmdb_asn_key, &value) && mmdb_value_to_uint(&value, &uint) && uint <= UINT32_MAX) {
+            mmdb_val->found = true;
+            mmdb_val->as_number = (uint32_t) uint;
+        }
+        if (mmdb_get_path(section, offset, mmdb_l_lat_key, &value) && mmdb_value_to_double(&value, &dbl)) {
+            mmdb_val->found = true;
+            mmdb_val->latitude = dbl;
+        }
+        if (mmdb_get_path(section, offset, mmdb_l_lon_key, &value) && mmdb_value_to_double(&value, &dbl)) {
+            mmdb_val->found = true;
+            mmdb_val->longitude = dbl;
+        }
+        if (mmdb_get_path(section, offset, mmdb_l_accuracy_key, &value) && mmdb_value_to_uint(&value, &uint) && uint <= UINT16_MAX) {
+            mmdb_val->found = true;
+            mmdb_val->accuracy = (uint16_t) uint;
+        }
+    }
+
+    if (!mmdb_val->found) {
+        wmem_free(wmem_epan_scope(), mmdb_val);
+        mmdb_val = &mmdb_not_found;
+    }
+    wmem_map_insert(mmdb_record_map, wmem_memdup(wmem_epan_scope(), offsets, (mmdb_files->len + 1) * sizeof(uint32_t)), mmdb_val);
+    g_free(offsets);
+    return mmdb_val;
+}
+
 static bool mmdbr_pipe_valid(void) {
     g_rw_lock_reader_lock(&mmdbr_pipe_mtx);
     bool pipe_valid = ws_pipe_valid(&mmdbr_pipe);
@@ -373,6 +950,8 @@ static void mmdb_resolve_stop(void) {
     char *request;
     mmdb_response_t *response;
 
+    mmdb_files_close();
+
     while (mmdbr_request_q && (request = (char *) g_async_queue_try_pop(mmdbr_request_q)) != NULL) {
         g_free(request);
     }
@@ -473,6 +1052,10 @@ static void mmdb_resolve_start(void) {
         mmdb_ipv6_chunk = wmem_map_new(wmem_epan_scope(), ipv6_oat_hash, ipv6_equal);
     }
 
+    if (!mmdb_record_map) {
+        mmdb_record_map = wmem_map_new(wmem_epan_scope(), mmdb_record_hash, mmdb_record_equal);
+    }
+
     if (!mmdb_file_arr) {
         ws_debug("unexpected mmdb_file_arr == NULL");
         return;
@@ -485,6 +1068,11 @@ static void mmdb_resolve_start(void) {
         return;
     }
 
+    if (mmdb_files_open()) {
+        return;
+    }
+    ws_info("falling back to mmdbresolve");
+
     GPtrArray *args = g_ptr_array_new();
     char *mmdbresolve = get_executable_path("mmdbresolve");
     g_ptr_array_add(args, mmdbresolve);
@@ -656,12 +1244,14 @@ void maxmind_db_pref_cleanup(void)
 
 void maxmind_db_pref_apply(void)
 {
+    bool resolving = mmdb_files || mmdbr_pipe_valid();
+
     if (gbl_resolv_flags.maxmind_geoip) {
-        if (!mmdbr_pipe_valid()) {
+        if (!resolving) {
             mmdb_resolve_start();
         }
     } else {
-        if (mmdbr_pipe_valid()) {
+        if (resolving) {
             mmdb_resolve_stop();
         }
     }
@@ -743,6 +1333,12 @@ maxmind_db_lookup_ipv4(const ws_in4_addr *addr) {
 
     mmdb_lookup_t *result = (mmdb_lookup_t *) wmem_map_lookup(mmdb_ipv4_map, GUINT_TO_POINTER(*addr));
 
+    if (!result && mmdb_files) {
+        // *addr is in network byte order.
+        result = mmdb_files_lookup((const uint8_t *) addr, 32);
+        wmem_map_insert(mmdb_ipv4_map, GUINT_TO_POINTER(*addr), result);
+    }
+
     if (!result) {
         result = &mmdb_not_found;
         wmem_map_insert(mmdb_ipv4_map, GUINT_TO_POINTER(*addr), result);
@@ -770,6 +1366,11 @@ maxmind_db_lookup_ipv6(const ws_in6_addr *addr) {
 
     mmdb_lookup_t * result = (mmdb_lookup_t *) wmem_map_lookup(mmdb_ipv6_map, addr->bytes);
 
+    if (!result && mmdb_files) {
+        result = mmdb_files_lookup(addr->bytes, 128);
+        wmem_map_insert(mmdb_ipv6_map, chunkify_v6_addr(addr), result);
+    }
+
     if (!result) {
         result = &mmdb_not_found;
         wmem_map_insert(mmdb_ipv6_map, chunkify_v6_addr(addr), result);
@@ -782,6 +782,7 @@ add_layer(packet_info *pinfo, int proto_id)
 
 	pinfo->curr_layer_num++;
 	wmem_list_append(pinfo->layers, GINT_TO_POINTER(proto_id));
+	epan_note_protocol_dissected(pinfo->epan, proto_id);
 
 	/* Increment layer number for this proto id. */
 	if (pinfo->proto_layers == NULL) {
@@ -854,9 +855,17 @@ call_dissector_through_handle(dissector_handle_t handle, tvbuff_t *tvb,
 
 	saved_proto = pinfo->current_proto;
 
-	if ((handle->protocol != NULL) && (!proto_is_pino(handle->protocol))) {
-		pinfo->current_proto =
-			proto_get_protocol_short_name(handle->protocol);
+	if (handle->protocol != NULL) {
+		/*
+		 * Note the protocol as dissected whether or not it's added
+		 * to the layers; changes to its preferences could affect
+		 * this packet either way.
+		 */
+		epan_note_protocol_dissected(pinfo->epan, proto_get_id(handle->protocol));
+		if (!proto_is_pino(handle->protocol)) {
+			pinfo->current_proto =
+				proto_get_protocol_short_name(handle->protocol);
+		}
 	}
 
 	switch (handle->dissector_type) {
@@ -2742,6 +2751,61 @@ dissector_all_tables_foreach_table (DATFunc_table func,
 	}
 }
 
+static uint64_t
+dissector_tables_mix(const void *entry, const void *current)
+{
+	uint64_t h = (uint64_t)(uintptr_t)entry * UINT64_C(0x9e3779b97f4a7c15);
+
+	h ^= (uint64_t)(uintptr_t)current + UINT64_C(0xbf58476d1ce4e5b9) + (h << 6) + (h >> 2);
+	return h * UINT64_C(0x94d049bb133111eb);
+}
+
+static void
+dissector_tables_fingerprint_entry(void *key _U_, void *value, void *user_data)
+{
+	dtbl_entry_t *dtbl_entry = (dtbl_entry_t *)value;
+	uint64_t     *fingerprint = (uint64_t *)user_data;
+
+	*fingerprint += dissector_tables_mix(dtbl_entry, dtbl_entry->current);
+}
+
+static void
+dissector_tables_fingerprint_table(void *key _U_, void *value, void *user_data)
+{
+	dissector_table_t sub_dissectors = (dissector_table_t)value;
+
+	g_hash_table_foreach(sub_dissectors->hash_table, dissector_tables_fingerprint_entry, user_data);
+}
+
+static void
+dissector_tables_fingerprint_heur_list(void *key _U_, void *value, void *user_data)
+{
+	heur_dissector_list_t sub_dissectors = (heur_dissector_list_t)value;
+	uint64_t             *fingerprint = (uint64_t *)user_data;
+	GSList               *entry;
+	heur_dtbl_entry_t    *hdtbl_entry;
+
+	for (entry = sub_dissectors->dissectors; entry != NULL; entry = g_slist_next(entry)) {
+		hdtbl_entry = (heur_dtbl_entry_t *)entry->data;
+		*fingerprint += dissector_tables_mix(hdtbl_entry, GINT_TO_POINTER(hdtbl_entry->enabled));
+	}
+}
+
+/*
+ * Combine the entries of all the dissector tables, and the entries of
+ * all the heuristic dissector lists and whether they're enabled, into a
+ * value that changes if any of them are added, removed or changed.
+ */
+uint64_t
+dissector_tables_fingerprint(void)
+{
+	uint64_t fingerprint = 0;
+
+	g_hash_table_foreach(dissector_tables, dissector_tables_fingerprint_table, &fingerprint);
+	g_hash_table_foreach(heur_dissector_lists, dissector_tables_fingerprint_heur_list, &fingerprint);
+	return fingerprint;
+}
+
 dissector_table_t
 register_dissector_table(const char *name, const char *ui_name, const int proto, const ftenum_t type,
 			 const int param)
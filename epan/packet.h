@@ -165,6 +165,16 @@ WS_DLL_PUBLIC void dissector_table_foreach_handle(const char *table_name, DATFun
 WS_DLL_PUBLIC void dissector_all_tables_foreach_table (DATFunc_table func,
     void *user_data, GCompareFunc compare_key_func);
 
+/** Get a fingerprint of the dissectors in all the dissector tables.
+ *
+ * The value changes if an entry is added to, removed from, or changed in
+ * any dissector table, e.g. by "Decode As" or by a preference registered
+ * with dissector_add_uint_with_preference(), or if a heuristic dissector
+ * is added, removed, enabled or disabled.  If it hasn't changed, packets
+ * are handed to the same dissectors as before.
+ */
+uint64_t dissector_tables_fingerprint(void);
+
 /* a protocol uses the function to register a sub-dissector table
  *
  * 'param' is the display base for integer tables, STRING_CASE_SENSITIVE
@@ -219,6 +219,18 @@ WS_DLL_PUBLIC
 void
 prefs_range_remove_value(pref_t *pref, uint32_t val);
 
+/** Get the modules, as module_t pointers, whose preferences affecting
+ * dissection (PREF_EFFECT_DISSECTION) have been applied by prefs_apply()
+ * or prefs_apply_all() since the last call to
+ * prefs_clear_dissection_changes().
+ *
+ * @return The modules, or NULL if there aren't any.
+ */
+const GPtrArray *prefs_get_dissection_changes(void);
+
+/** Forget the modules returned by prefs_get_dissection_changes(). */
+void prefs_clear_dissection_changes(void);
+
 
 WS_DLL_PUBLIC unsigned int prefs_set_bool_value(pref_t *pref, bool value, pref_source_t source);
 WS_DLL_PUBLIC bool prefs_get_bool_value(pref_t *pref, pref_source_t source);
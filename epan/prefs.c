@@ -333,6 +333,12 @@ static wmem_tree_t *prefs_top_level_modules;
  */
 static wmem_tree_t *prefs_module_aliases;
 
+/*
+ * Modules whose preferences affecting dissection have been applied since
+ * the last call to prefs_clear_dissection_changes().
+ */
+static GPtrArray *prefs_dissection_changes;
+
 /** Sets up memory used by proto routines. Called at program startup */
 void
 prefs_init(void)
@@ -434,6 +440,11 @@ prefs_cleanup(void)
     /* Shut down mmdbresolve */
     maxmind_db_pref_cleanup();
 
+    if (prefs_dissection_changes) {
+        g_ptr_array_free(prefs_dissection_changes, true);
+        prefs_dissection_changes = NULL;
+    }
+
     g_free(prefs.saved_at_version);
     g_free(gpf_path);
     gpf_path = NULL;
@@ -955,6 +966,12 @@ call_apply_cb(const void *key _U_, void *value, void *data _U_)
     if (module->prefs_changed_flags) {
         if (module->apply_cb != NULL)
             (*module->apply_cb)();
+        if (module->prefs_changed_flags & PREF_EFFECT_DISSECTION) {
+            if (prefs_dissection_changes == NULL)
+                prefs_dissection_changes = g_ptr_array_new();
+            if (!g_ptr_array_find(prefs_dissection_changes, module, NULL))
+                g_ptr_array_add(prefs_dissection_changes, module);
+        }
         module->prefs_changed_flags = 0;
     }
     if (module->submodules)
@@ -987,6 +1004,25 @@ prefs_apply(module_t *module)
         call_apply_cb(NULL, module, NULL);
 }
 
+/*
+ * Get the modules whose preferences affecting dissection have been
+ * applied, or NULL if there aren't any.
+ */
+const GPtrArray *
+prefs_get_dissection_changes(void)
+{
+    if (prefs_dissection_changes == NULL || prefs_dissection_changes->len == 0)
+        return NULL;
+    return prefs_dissection_changes;
+}
+
+void
+prefs_clear_dissection_changes(void)
+{
+    if (prefs_dissection_changes)
+        g_ptr_array_set_size(prefs_dissection_changes, 0);
+}
+
 static module_t *
 prefs_find_module_alias(const char *name)
 {
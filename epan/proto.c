@@ -935,6 +935,95 @@ proto_field_is_referenced(proto_tree *tree, int proto_id)
 	return false;
 }
 
+/* Same as above, for the list of fields a dissector adds to a subtree.
+   The same name chain doesn't have to be followed, as priming the tree
+   marks every field with a referenced name.
+   Like TRY_TO_FAKE_THIS_ITEM(), items added to a tree whose item isn't
+   hidden (or that has no item) aren't faked, so they are needed.
+*/
+bool
+proto_fields_are_referenced(proto_tree *tree, int * const *fields)
+{
+	register header_field_info *hfinfo;
+
+	if (!tree)
+		return false;
+
+	if (PTREE_DATA(tree)->visible)
+		return true;
+
+	if (!PROTO_ITEM_IS_HIDDEN(tree))
+		return true;
+
+	for (; *fields; fields++) {
+		PROTO_REGISTRAR_GET_NTH(**fields, hfinfo);
+		if (hfinfo->ref_type != HF_REF_TYPE_NONE)
+			return true;
+
+		if (hfinfo->type == FT_PROTOCOL && !PTREE_DATA(tree)->fake_protocols)
+			return true;
+	}
+
+	return false;
+}
+
+/* Is the string representation of this item ever going to be looked at?
+   This is the opposite of the TRY_TO_FAKE_THIS_REPR() test. */
+static inline bool
+proto_item_label_is_needed(proto_item *pi)
+{
+	if (!pi)
+		return false;
+
+	return PTREE_DATA(pi)->visible || !proto_item_is_hidden(pi);
+}
+
+/* Would proto_item_add_bitmask_tree() append some text for this field?
+   Used to return the same value when the text isn't appended because
+   nobody will look at it. */
+static bool
+proto_item_bitmask_field_appends(const header_field_info *hf, uint64_t value,
+				 const int flags)
+{
+	uint64_t tmpval;
+
+	switch (hf->type) {
+	case FT_CHAR:
+		return hf->display == BASE_CUSTOM || hf->strings ||
+		       !(flags & BMT_NO_INT);
+
+	case FT_UINT8:
+	case FT_UINT16:
+	case FT_UINT24:
+	case FT_UINT32:
+	case FT_INT8:
+	case FT_INT16:
+	case FT_INT24:
+	case FT_INT32:
+	case FT_UINT40:
+	case FT_UINT48:
+	case FT_UINT56:
+	case FT_UINT64:
+	case FT_INT40:
+	case FT_INT48:
+	case FT_INT56:
+	case FT_INT64:
+		return hf->display == BASE_CUSTOM ||
+		       (hf->strings && !(hf->display & (BASE_UNIT_STRING|BASE_SPECIAL_VALS))) ||
+		       !(flags & BMT_NO_INT);
+
+	case FT_BOOLEAN:
+		if (hf->strings && !(flags & BMT_NO_TFS)) {
+			tmpval = (value & hf->bitmask) >> hfinfo_bitshift(hf);
+			return tmpval || !(flags & BMT_NO_FALSE);
+		}
+		return (hf->bitmask & value) != 0;
+
+	default:
+		return false;
+	}
+}
+
 
 /* Finds a record in the hfinfo array by id. */
 header_field_info *
@@ -8585,6 +8674,12 @@ proto_is_pino(const protocol_t *protocol)
 	return (protocol->parent_proto_id != -1);
 }
 
+int
+proto_get_parent_id(const protocol_t *protocol)
+{
+	return protocol->parent_proto_id;
+}
+
 bool
 // NOLINTNEXTLINE(misc-no-recursion)
 proto_is_protocol_enabled(const protocol_t *protocol)
@@ -12387,6 +12482,8 @@ proto_item_add_bitmask_tree(proto_item *item, tvbuff_t *tvb, const int offset,
 	uint32_t           integer32;
 	int                bit_offset;
 	int                no_of_bits;
+	bool               add_items;
+	bool               append_text;
 
 	if (!*fields)
 		REPORT_DISSECTOR_BUG("Illegal call of proto_item_add_bitmask_tree without fields");
@@ -12405,6 +12502,11 @@ proto_item_add_bitmask_tree(proto_item *item, tvbuff_t *tvb, const int offset,
 	if (use_parent_tree == false)
 		tree = proto_item_add_subtree(item, ett);
 
+	/* When filtering without a visible tree, most of the time neither
+	 * the items nor the text appended to the parent are needed. */
+	add_items = proto_fields_are_referenced(tree, fields);
+	append_text = !(flags & BMT_NO_APPEND) && proto_item_label_is_needed(item);
+
 	while (*fields) {
 		uint64_t present_bits;
 		PROTO_REGISTRAR_GET_NTH(**fields,hf);
@@ -12419,48 +12521,53 @@ proto_item_add_bitmask_tree(proto_item *item, tvbuff_t *tvb, const int offset,
 			continue;
 		}
 
-		switch (hf->type) {
-		case FT_CHAR:
-		case FT_UINT8:
-		case FT_UINT16:
-		case FT_UINT24:
-		case FT_UINT32:
-			proto_tree_add_uint(tree, **fields, tvb, offset, len, (uint32_t)value);
-			break;
+		if (add_items) {
+			switch (hf->type) {
+			case FT_CHAR:
+			case FT_UINT8:
+			case FT_UINT16:
+			case FT_UINT24:
+			case FT_UINT32:
+				proto_tree_add_uint(tree, **fields, tvb, offset, len, (uint32_t)value);
+				break;
 
-		case FT_INT8:
-		case FT_INT16:
-		case FT_INT24:
-		case FT_INT32:
-			proto_tree_add_int(tree, **fields, tvb, offset, len, (int32_t)value);
-			break;
+			case FT_INT8:
+			case FT_INT16:
+			case FT_INT24:
+			case FT_INT32:
+				proto_tree_add_int(tree, **fields, tvb, offset, len, (int32_t)value);
+				break;
 
-		case FT_UINT40:
-		case FT_UINT48:
-		case FT_UINT56:
-		case FT_UINT64:
-			proto_tree_add_uint64(tree, **fields, tvb, offset, len, value);
-			break;
+			case FT_UINT40:
+			case FT_UINT48:
+			case FT_UINT56:
+			case FT_UINT64:
+				proto_tree_add_uint64(tree, **fields, tvb, offset, len, value);
+				break;
 
-		case FT_INT40:
-		case FT_INT48:
-		case FT_INT56:
-		case FT_INT64:
-			proto_tree_add_int64(tree, **fields, tvb, offset, len, (int64_t)value);
-			break;
+			case FT_INT40:
+			case FT_INT48:
+			case FT_INT56:
+			case FT_INT64:
+				proto_tree_add_int64(tree, **fields, tvb, offset, len, (int64_t)value);
+				break;
 
-		case FT_BOOLEAN:
-			proto_tree_add_boolean(tree, **fields, tvb, offset, len, value);
-			break;
+			case FT_BOOLEAN:
+				proto_tree_add_boolean(tree, **fields, tvb, offset, len, value);
+				break;
 
-		default:
-			REPORT_DISSECTOR_BUG("field %s has type %d (%s) not handled in proto_item_add_bitmask_tree()",
-					     hf->abbrev,
-					     hf->type,
-					     ftype_name(hf->type));
-			break;
+			default:
+				REPORT_DISSECTOR_BUG("field %s has type %d (%s) not handled in proto_item_add_bitmask_tree()",
+						     hf->abbrev,
+						     hf->type,
+						     ftype_name(hf->type));
+				break;
+			}
 		}
-		if (flags & BMT_NO_APPEND) {
+		if (!append_text) {
+			if (!(flags & BMT_NO_APPEND) && first &&
+			    proto_item_bitmask_field_appends(hf, value, flags))
+				first = false;
 			fields++;
 			continue;
 		}
@@ -1102,6 +1102,20 @@ extern void proto_cleanup(void);
 */
 WS_DLL_PUBLIC bool proto_field_is_referenced(proto_tree *tree, int proto_id);
 
+/** This function takes a tree and a NULL-terminated list of field ids, such
+    as the one passed to proto_tree_add_bitmask(), and returns true/false for
+    whether any of the fields is referenced by a filter, a tap, a custom
+    column or an output field, or whether the tree is visible.
+    If this function returns false, adding the fields would only create
+    faked items, so a dissector can skip building the whole subtree the
+    fields are added to, including formatting their text.
+    Anything that isn't part of the tree, like columns and expert info
+    not attached to one of the skipped items, must still be done.
+ @param tree the tree the fields would be added to
+ @param fields NULL-terminated list of pointers to field ids
+ @return true if any of the fields is needed */
+WS_DLL_PUBLIC bool proto_fields_are_referenced(proto_tree *tree, int * const *fields);
+
 /** Create a subtree under an existing item.
  @param pi the parent item of the new subtree
  @param idx one of the ett_ array elements registered with proto_register_subtree_array()
@@ -2769,6 +2783,10 @@ WS_DLL_PUBLIC bool proto_is_protocol_enabled_by_default(const protocol_t *protoc
  @return true if helper, false if not */
 WS_DLL_PUBLIC bool proto_is_pino(const protocol_t *protocol);
 
+/** Get the protocol that a protocol in name only belongs to.
+ @return the parent protocol's id, or -1 if it isn't a pino */
+WS_DLL_PUBLIC int proto_get_parent_id(const protocol_t *protocol);
+
 /** Get a protocol's filter name by its item number.
  @param proto_id protocol id (0-indexed)
  @return its filter name. */
@@ -351,7 +351,7 @@ free_all_fragments(void *key_arg _U_, void *value, void *user_data _U_)
 }
 
 /* ------------------------- */
-static fragment_head *new_head(const uint32_t flags)
+static fragment_head *new_head(const reassembly_table *table, const uint32_t flags)
 {
 	fragment_head *fd_head;
 	/* If head/first structure in list only holds no other data than
@@ -361,6 +361,8 @@ static fragment_head *new_head(const uint32_t flags)
 	fd_head=g_slice_new0(fragment_head);
 
 	fd_head->flags=flags;
+	if (table->composite_tvbs)
+		fd_head->flags |= FD_COMPOSITE;
 	return fd_head;
 }
 
@@ -413,8 +415,10 @@ reassembled_table_insert(GHashTable *reassembled_table, reassembled_key *key, fr
 			 * address via set_address_tvb(). (See #19094.)
 			 */
 			if (old_fd_head->tvb_data && fd_head->tvb_data) {
-				/* Free it when the new tvb is freed */
-				tvb_set_child_real_data_tvbuff(fd_head->tvb_data, old_fd_head->tvb_data);
+				/* Free it when the new tvb is freed (it
+				 * might be a composite tvb, so not with
+				 * tvb_set_child_real_data_tvbuff()) */
+				tvb_add_to_chain(fd_head->tvb_data, old_fd_head->tvb_data);
 			}
 			/* XXX: Set the old data to NULL regardless. If we
 			 * have old data but not new data, that is odd (we're
@@ -457,6 +461,14 @@ reassembly_table_register(reassembly_table *table,
 	reassembly_table_list = g_list_prepend(reassembly_table_list, reg_table);
 }
 
+void
+reassembly_table_set_composite(reassembly_table *table, const bool composite)
+{
+	DISSECTOR_ASSERT(table);
+
+	table->composite_tvbs = composite;
+}
+
 /*
  * Initialize a reassembly table, with specified functions.
  */
@@ -754,6 +766,41 @@ static void fragment_items_removed(fragment_head *fd_head, fragment_item *modifi
 	fragment_reset_first_gap(fd_head);
 }
 
+/*
+ * When a reassembly is undone to extend it, give a fragment without data
+ * of its own a tvb for its data, from the reassembled data, which holds it
+ * from offset on.
+ */
+static void
+fragment_set_subset_tvb(fragment_head *fd_head, fragment_item *fd_i, const uint32_t offset)
+{
+	uint32_t length;
+
+	if (!(fd_head->flags & FD_COMPOSITE)) {
+		fd_i->tvb_data = tvb_new_subset_remaining(fd_head->tvb_data, offset);
+		fd_i->flags |= FD_SUBSET_TVB;
+		return;
+	}
+
+	/*
+	 * The composite tvb is freed when the reassembly completes again,
+	 * with the tvbs it owns handed on to the new one; make a composite
+	 * of the parts of its members that hold the fragment, which will
+	 * be freed with those, rather than a subset of it.
+	 */
+	length = tvb_captured_length(fd_head->tvb_data);
+	length = (offset < length) ? MIN(fd_i->len, length - offset) : 0;
+	if (length == 0) {
+		/* Nothing of it is there; it has no data. */
+		fd_i->tvb_data = tvb_new_real_data(NULL, 0, 0);
+		return;
+	}
+	fd_i->tvb_data = tvb_new_composite();
+	tvb_composite_append_range(fd_i->tvb_data, fd_head->tvb_data, offset, length);
+	tvb_composite_finalize(fd_i->tvb_data);
+	fd_i->flags |= FD_SUBSET_TVB;
+}
+
 /*
  * For use with fragment_add (and not the fragment_add_seq functions).
  * When the reassembled result is wrong (perhaps it needs to be extended), this
@@ -769,8 +816,7 @@ fragment_reset_defragmentation(fragment_head *fd_head)
 
 	for (fragment_item *fd_i = fd_head->next; fd_i; fd_i = fd_i->next) {
 		if (!fd_i->tvb_data) {
-			fd_i->tvb_data = tvb_new_subset_remaining(fd_head->tvb_data, fd_i->offset);
-			fd_i->flags |= FD_SUBSET_TVB;
+			fragment_set_subset_tvb(fd_head, fd_i, fd_i->offset);
 		}
 		fd_i->flags &= (~FD_TOOLONGFRAGMENT) & (~FD_MULTIPLETAILS);
 	}
@@ -1173,6 +1219,45 @@ MERGE_FRAG(fragment_head *fd_head, fragment_item *fd)
 	update_first_gap(fd_head, inserted, multi_insert);
 }
 
+/* An overlap to check, once the composite tvb it overlaps is complete. */
+typedef struct {
+	fragment_item *fd;
+	uint32_t cmp_len;
+} fragment_overlap_t;
+
+/*
+ * Start a composite tvb for the data of a reassembly with FD_COMPOSITE set.
+ * It's built on the fragments' data rather than a copy of it, so it takes
+ * the fragments' tvbs, which the fragments keep pointing to (as subsets),
+ * and the tvbs of the reassembly being extended, if any, which those may
+ * be parts of. If that was a composite tvb, only the tvbs it owned are
+ * taken, so that reassemblies extended many times don't pile up; it is
+ * freed along with parent, or now if there's no parent.
+ */
+static tvbuff_t *
+fragment_composite_new(fragment_head *fd_head, tvbuff_t *old_tvb_data, tvbuff_t *parent)
+{
+	fragment_item *fd_i;
+	tvbuff_t *tvb = tvb_new_composite();
+
+	if (old_tvb_data) {
+		if (!tvb_composite_take_from(tvb, old_tvb_data))
+			tvb_composite_take(tvb, old_tvb_data);
+		else if (parent)
+			tvb_add_to_chain(parent, old_tvb_data);
+		else
+			tvb_free(old_tvb_data);
+	}
+	for (fd_i = fd_head->next; fd_i; fd_i = fd_i->next) {
+		if (!fd_i->tvb_data)
+			continue;
+		if (!(fd_i->flags & FD_SUBSET_TVB))
+			tvb_composite_take(tvb, fd_i->tvb_data);
+		fd_i->flags |= FD_SUBSET_TVB;
+	}
+	return tvb;
+}
+
 /*
  * This function adds a new fragment to the fragment hash table.
  * If this is the first fragment seen for this datagram, a new entry
@@ -1205,6 +1290,7 @@ fragment_add_work(fragment_head *fd_head, tvbuff_t *tvb, const int offset,
 	uint32_t dfpos, fraglen, overlap;
 	tvbuff_t *old_tvb_data;
 	uint8_t *data;
+	GArray *overlaps = NULL;
 
 	/* create new fd describing this fragment */
 	fd = g_slice_new(fragment_item);
@@ -1377,9 +1463,15 @@ fragment_add_work(fragment_head *fd_head, tvbuff_t *tvb, const int offset,
 	 */
 	/* store old data just in case */
 	old_tvb_data=fd_head->tvb_data;
-	data = (uint8_t *) g_malloc(fd_head->datalen);
-	fd_head->tvb_data = tvb_new_real_data(data, fd_head->datalen, fd_head->datalen);
-	tvb_set_free_cb(fd_head->tvb_data, g_free);
+	if ((fd_head->flags & FD_COMPOSITE) && fd_head->datalen) {
+		fd_head->tvb_data = fragment_composite_new(fd_head, old_tvb_data, tvb);
+		old_tvb_data = NULL;
+		data = NULL;
+	} else {
+		data = (uint8_t *) g_malloc(fd_head->datalen);
+		fd_head->tvb_data = tvb_new_real_data(data, fd_head->datalen, fd_head->datalen);
+		tvb_set_free_cb(fd_head->tvb_data, g_free);
+	}
 
 	/* add all data fragments */
 	for (dfpos=0,fd_i=fd_head->next;fd_i;fd_i=fd_i->next) {
@@ -1459,7 +1551,15 @@ fragment_add_work(fragment_head *fd_head, tvbuff_t *tvb, const int offset,
 
 					fd_i->flags    |= FD_OVERLAP;
 					fd_head->flags |= FD_OVERLAP;
-					if ( memcmp(data + fd_i->offset,
+					if (!data) {
+						/* Compare once the composite
+						 * tvb is complete, below. */
+						fragment_overlap_t ov = { fd_i, cmp_len };
+
+						if (!overlaps)
+							overlaps = g_array_new(false, false, sizeof(fragment_overlap_t));
+						g_array_append_val(overlaps, ov);
+					} else if ( memcmp(data + fd_i->offset,
 							tvb_get_ptr(fd_i->tvb_data, 0, cmp_len),
 							cmp_len)
 							 ) {
@@ -1487,13 +1587,21 @@ fragment_add_work(fragment_head *fd_head, tvbuff_t *tvb, const int offset,
 				 * out rather than mixed with the new ones?
 				 */
 				if (fd_i->offset + fraglen > dfpos) {
-					memcpy(data+dfpos,
-						tvb_get_ptr(fd_i->tvb_data, overlap, fraglen-overlap),
-						fraglen-overlap);
+					if (data)
+						memcpy(data+dfpos,
+							tvb_get_ptr(fd_i->tvb_data, overlap, fraglen-overlap),
+							fraglen-overlap);
+					else
+						tvb_composite_append_range(fd_head->tvb_data,
+							fd_i->tvb_data, overlap, fraglen-overlap);
 					dfpos = fd_i->offset + fraglen;
 				}
 			}
 
+			/* The composite tvb is built on the fragments' data. */
+			if (!data)
+				continue;
+
 			if (fd_i->flags & FD_SUBSET_TVB)
 				fd_i->flags &= ~FD_SUBSET_TVB;
 			else if (fd_i->tvb_data)
@@ -1503,6 +1611,37 @@ fragment_add_work(fragment_head *fd_head, tvbuff_t *tvb, const int offset,
 		}
 	}
 
+	if (!data && dfpos == 0) {
+		/*
+		 * Nothing was added to the composite tvb, because the
+		 * reassembly had an error; free it, and what it took, with
+		 * the packet, and leave an empty tvb in its place.
+		 */
+		tvb_add_to_chain(tvb, fd_head->tvb_data);
+		fd_head->tvb_data = tvb_new_real_data(NULL, 0, 0);
+		for (fd_i = fd_head->next; fd_i; fd_i = fd_i->next) {
+			fd_i->flags &= ~FD_SUBSET_TVB;
+			fd_i->tvb_data = NULL;
+		}
+		if (overlaps)
+			g_array_free(overlaps, true);
+	} else if (!data) {
+		tvb_composite_finalize(fd_head->tvb_data);
+		if (overlaps) {
+			for (unsigned i = 0; i < overlaps->len; i++) {
+				fragment_overlap_t *ov = &g_array_index(overlaps, fragment_overlap_t, i);
+
+				if (tvb_memeql(fd_head->tvb_data, ov->fd->offset,
+						tvb_get_ptr(ov->fd->tvb_data, 0, ov->cmp_len),
+						ov->cmp_len)) {
+					ov->fd->flags  |= FD_OVERLAPCONFLICT;
+					fd_head->flags |= FD_OVERLAPCONFLICT;
+				}
+			}
+			g_array_free(overlaps, true);
+		}
+	}
+
 	if (old_tvb_data)
 		tvb_add_to_chain(tvb, old_tvb_data);
 	/* mark this packet as defragmented.
@@ -1688,7 +1827,7 @@ fragment_add_common(reassembly_table *table, tvbuff_t *tvb, const int offset,
 		/* not found, this must be the first snooped fragment for this
 		 * packet. Create list-head.
 		 */
-		fd_head = new_head(0);
+		fd_head = new_head(table, 0);
 
 		/*
 		 * Insert it into the hash table.
@@ -1802,7 +1941,7 @@ fragment_add_check_with_fallback(reassembly_table *table, tvbuff_t *tvb, const i
 		/* not found, this must be the first snooped fragment for this
 		 * packet. Create list-head.
 		 */
-		fd_head = new_head(0);
+		fd_head = new_head(table, 0);
 
 		/*
 		 * Save the key, for unhashing it later.
@@ -1878,9 +2017,15 @@ fragment_defragment_and_free (fragment_head *fd_head, const packet_info *pinfo)
 
 	/* store old data in case the fd_i->data pointers refer to it */
 	old_tvb_data=fd_head->tvb_data;
-	data = (uint8_t *) g_malloc(size);
-	fd_head->tvb_data = tvb_new_real_data(data, size, size);
-	tvb_set_free_cb(fd_head->tvb_data, g_free);
+	if ((fd_head->flags & FD_COMPOSITE) && size) {
+		fd_head->tvb_data = fragment_composite_new(fd_head, old_tvb_data, NULL);
+		old_tvb_data = NULL;
+		data = NULL;
+	} else {
+		data = (uint8_t *) g_malloc(size);
+		fd_head->tvb_data = tvb_new_real_data(data, size, size);
+		tvb_set_free_cb(fd_head->tvb_data, g_free);
+	}
 	fd_head->len = size;		/* record size for caller	*/
 
 	/* add all data fragments */
@@ -1889,7 +2034,10 @@ fragment_defragment_and_free (fragment_head *fd_head, const packet_info *pinfo)
 		if (fd_i->len) {
 			if(!last_fd || last_fd->offset != fd_i->offset) {
 				/* First fragment or in-sequence fragment */
-				memcpy(data+dfpos, tvb_get_ptr(fd_i->tvb_data, 0, fd_i->len), fd_i->len);
+				if (data)
+					memcpy(data+dfpos, tvb_get_ptr(fd_i->tvb_data, 0, fd_i->len), fd_i->len);
+				else
+					tvb_composite_append_range(fd_head->tvb_data, fd_i->tvb_data, 0, fd_i->len);
 				dfpos += fd_i->len;
 			} else {
 				/* duplicate/retransmission/overlap */
@@ -1905,13 +2053,18 @@ fragment_defragment_and_free (fragment_head *fd_head, const packet_info *pinfo)
 		last_fd=fd_i;
 	}
 
-	/* we have defragmented the pdu, now free all fragments*/
-	for (fd_i=fd_head->next;fd_i;fd_i=fd_i->next) {
-		if (fd_i->flags & FD_SUBSET_TVB)
-			fd_i->flags &= ~FD_SUBSET_TVB;
-		else if (fd_i->tvb_data)
-			tvb_free(fd_i->tvb_data);
-		fd_i->tvb_data=NULL;
+	/* we have defragmented the pdu, now free all fragments
+	 * (unless the composite tvb is built on them) */
+	if (!data) {
+		tvb_composite_finalize(fd_head->tvb_data);
+	} else {
+		for (fd_i=fd_head->next;fd_i;fd_i=fd_i->next) {
+			if (fd_i->flags & FD_SUBSET_TVB)
+				fd_i->flags &= ~FD_SUBSET_TVB;
+			else if (fd_i->tvb_data)
+				tvb_free(fd_i->tvb_data);
+			fd_i->tvb_data=NULL;
+		}
 	}
 	if (old_tvb_data)
 		tvb_free(old_tvb_data);
@@ -1965,13 +2118,12 @@ fragment_add_seq_work(fragment_head *fd_head, tvbuff_t *tvb, const int offset,
 				if( fd_i->flags & FD_OVERLAP ) {
 					/* this is a duplicate of the previous
 					 * fragment. */
-					fd_i->tvb_data = tvb_new_subset_remaining(fd_head->tvb_data, lastdfpos);
+					fragment_set_subset_tvb(fd_head, fd_i, lastdfpos);
 				} else {
-					fd_i->tvb_data = tvb_new_subset_remaining(fd_head->tvb_data, dfpos);
+					fragment_set_subset_tvb(fd_head, fd_i, dfpos);
 					lastdfpos = dfpos;
 					dfpos += fd_i->len;
 				}
-				fd_i->flags |= FD_SUBSET_TVB;
 			}
 			fd_i->flags &= (~FD_TOOLONGFRAGMENT) & (~FD_MULTIPLETAILS);
 		}
@@ -2211,7 +2363,7 @@ fragment_add_seq_common(reassembly_table *table, tvbuff_t *tvb,
 		/* not found, this must be the first snooped fragment for this
 		 * packet. Create list-head.
 		 */
-		fd_head= new_head(FD_BLOCKSEQUENCE);
+		fd_head= new_head(table, FD_BLOCKSEQUENCE);
 
 		if((flags & (REASSEMBLE_FLAGS_NO_FRAG_NUMBER|REASSEMBLE_FLAGS_802_11_HACK))
 		   && !more_frags) {
@@ -2515,7 +2667,7 @@ fragment_add_seq_single_work(reassembly_table *table, tvbuff_t *tvb,
 		}
 		if (fh == NULL) {
 			/* Not found. Create list-head. */
-			fh = new_head(FD_BLOCKSEQUENCE);
+			fh = new_head(table, FD_BLOCKSEQUENCE);
 			insert_fd_head(table, fh, pinfo, id-frag_number, data);
 		}
 		/* As this is the first fragment, we might have added segments
@@ -2601,7 +2753,7 @@ fragment_add_seq_single_work(reassembly_table *table, tvbuff_t *tvb,
 		if (fh == NULL) { /* Didn't find location, use default */
 			frag_number = 1;
 			/* Already looked for frag_number 1, so just create */
-			fh = new_head(FD_BLOCKSEQUENCE);
+			fh = new_head(table, FD_BLOCKSEQUENCE);
 			insert_fd_head(table, fh, pinfo, id-frag_number, data);
 		}
 	}
@@ -2648,7 +2800,7 @@ fragment_add_seq_single_work(reassembly_table *table, tvbuff_t *tvb,
 			new_fh = lookup_fd_head(table, pinfo, id+1, data, NULL);
 			if (new_fh==NULL) {
 				/* Not found. Create list-head. */
-				new_fh = new_head(FD_BLOCKSEQUENCE);
+				new_fh = new_head(table, FD_BLOCKSEQUENCE);
 				insert_fd_head(table, new_fh, pinfo, id+1, data);
 			}
 			tmp_offset = 0;
@@ -2767,6 +2919,8 @@ fragment_start_seq_check(reassembly_table *table, const packet_info *pinfo,
 		fd_head->reassembled_in = 0;
 		fd_head->reas_in_layer_num = 0;
 		fd_head->flags = FD_BLOCKSEQUENCE|FD_DATALEN_SET;
+		if (table->composite_tvbs)
+			fd_head->flags |= FD_COMPOSITE;
 		fd_head->tvb_data = NULL;
 		fd_head->error = NULL;
 
@@ -3153,6 +3307,70 @@ reassembly_table_cleanup_reg_tables(void)
 	g_list_foreach(reassembly_table_list, reassembly_table_cleanup_reg_table, NULL);
 }
 
+typedef struct {
+	uint32_t frame_num;
+	unsigned freed;
+} reassembly_expire_info_t;
+
+/*
+ * For a fragment hash table entry, free the fragments if no fragment has
+ * been added since before the given frame.  Heads without fragments yet
+ * and heads also in the reassembled table are left alone.
+ */
+static gboolean
+free_expired_fragments(void *key_arg, void *value, void *user_data)
+{
+	fragment_head *fd_head = (fragment_head *)value;
+	reassembly_expire_info_t *info = (reassembly_expire_info_t *)user_data;
+
+	if (fd_head == NULL || fd_head->next == NULL ||
+	    fd_head->ref_count != 0 || fd_head->frame >= info->frame_num)
+		return FALSE;
+	info->freed++;
+	return free_all_fragments(key_arg, value, NULL);
+}
+
+/*
+ * For a reassembled-packet hash table entry, remove it if it's for a
+ * frame before the given frame; unref_fd_head() frees the data once no
+ * entry refers to it.
+ */
+static gboolean
+reassembled_entry_expired(void *key_arg, void *value, void *user_data)
+{
+	const reassembled_key *key = (const reassembled_key *)key_arg;
+	const fragment_head *fd_head = (const fragment_head *)value;
+	reassembly_expire_info_t *info = (reassembly_expire_info_t *)user_data;
+
+	if (key->frame >= info->frame_num)
+		return FALSE;
+	if (fd_head->ref_count == 1)
+		info->freed++;
+	return TRUE;
+}
+
+unsigned
+reassembly_tables_expire(const uint32_t frame_num)
+{
+	register_reassembly_table_t *reg_table;
+	reassembly_expire_info_t info;
+
+	info.frame_num = frame_num;
+	info.freed = 0;
+	for (GList *item = reassembly_table_list; item; item = item->next) {
+		reg_table = (register_reassembly_table_t *)item->data;
+		if (reg_table->table->fragment_table != NULL) {
+			g_hash_table_foreach_remove(reg_table->table->fragment_table,
+			    free_expired_fragments, &info);
+		}
+		if (reg_table->table->reassembled_table != NULL) {
+			g_hash_table_foreach_remove(reg_table->table->reassembled_table,
+			    reassembled_entry_expired, &info);
+		}
+	}
+	return info.freed;
+}
+
 void reassembly_tables_init(void)
 {
 	register_init_routine(&reassembly_table_init_reg_tables);
@@ -49,6 +49,11 @@
  */
 #define FD_DATALEN_SET		0x0400
 
+/* only in fd_head: the reassembled data is a composite tvb built on the
+ * fragments' data, rather than a copy of it; see
+ * reassembly_table_set_composite() */
+#define FD_COMPOSITE		0x0800
+
 typedef struct _fragment_item {
 	struct _fragment_item *next;
 	uint32_t frame;			/**< frame number where the fragment is from */
@@ -141,6 +146,7 @@ typedef struct {
 	fragment_temporary_key temporary_key_func;
 	fragment_persistent_key persistent_key_func;
 	GDestroyNotify free_temporary_key_func;		/* temporary key destruction function */
+	bool composite_tvbs;				/* see reassembly_table_set_composite() */
 } reassembly_table;
 
 /*
@@ -173,6 +179,19 @@ WS_DLL_PUBLIC void
 reassembly_table_register(reassembly_table *table,
 		      const reassembly_table_functions *funcs);
 
+/*
+ * Have reassemblies in a table produce a composite tvb built on the data of
+ * their fragments, rather than copying that data into a new buffer. This
+ * saves a copy of each reassembled PDU, and the time to make it, at the cost
+ * of a lookup on each access and of copying the bytes of any access that
+ * straddles fragments. It suits tables holding large PDUs, such as the
+ * bodies of transfers over TCP, that subdissectors mostly access in parts.
+ *
+ * Call it when registering the table.
+ */
+WS_DLL_PUBLIC void
+reassembly_table_set_composite(reassembly_table *table, const bool composite);
+
 /*
  * Initialize/destroy a reassembly table.
  *
@@ -186,6 +205,19 @@ reassembly_table_init(reassembly_table *table,
 WS_DLL_PUBLIC void
 reassembly_table_destroy(reassembly_table *table);
 
+/*
+ * Free, in all registered reassembly tables, reassemblies to which no
+ * fragment has been added since before frame_num, and the results of
+ * reassemblies completed in frames before frame_num, so that memory use
+ * doesn't grow without bound when dissecting an unbounded stream of
+ * packets in a single pass.  This must only be used if frames before
+ * frame_num won't be dissected again.
+ *
+ * Returns the number of reassemblies freed.
+ */
+WS_DLL_PUBLIC unsigned
+reassembly_tables_expire(const uint32_t frame_num);
+
 /*
  * This function adds a new fragment to the reassembly table
  * If this is the first fragment seen for this datagram, a new entry
@@ -104,6 +104,7 @@ static struct _fd_flags {
     {FD_OVERLAPCONFLICT      ,"OC"},
     {FD_MULTIPLETAILS        ,"MT"},
     {FD_TOOLONGFRAGMENT      ,"TL"},
+    {FD_COMPOSITE            ,"CO"},
 };
 #define N_FD_FLAGS array_length(fd_flags)
 
@@ -3203,6 +3204,137 @@ test_fragment_add_check_duplicate_conflict(void)
         print_fragment_table();
     }
 }
+/* Test case for reassembly into a composite tvb.
+ * Adds two segments, reassembles them, extends the reassembly with a
+ * third in the way TCP does, and checks that the reassembled data is the
+ * fragments' data rather than a copy of it.
+ */
+static void
+test_fragment_add_composite_partial_reassembly(void)
+{
+    fragment_head *fd_head;
+    fragment_item *fd;
+
+    printf("Starting test test_fragment_add_composite_partial_reassembly\n");
+
+    reassembly_table_set_composite(&test_reassembly_table, true);
+
+    pinfo.num = 1;
+    fd_head=fragment_add(&test_reassembly_table, tvb, 10, &pinfo, 12, NULL,
+                         0, 50, true);
+    ASSERT_EQ_POINTER(NULL,fd_head);
+
+    pinfo.num = 2;
+    fd_head=fragment_add(&test_reassembly_table, tvb, 5, &pinfo, 12, NULL,
+                         50, 60, false);
+    ASSERT_NE_POINTER(NULL,fd_head);
+
+    ASSERT_EQ(110,fd_head->datalen);
+    ASSERT_EQ(FD_DEFRAGMENTED|FD_DATALEN_SET|FD_COMPOSITE,fd_head->flags);
+    ASSERT_NE_POINTER(NULL,fd_head->tvb_data);
+    ASSERT_EQ(110,tvb_captured_length(fd_head->tvb_data));
+    ASSERT(!tvb_memeql(fd_head->tvb_data,0,data+10,50));
+    ASSERT(!tvb_memeql(fd_head->tvb_data,50,data+5,60));
+
+    /* The fragments keep their data, and the composite tvb refers to it */
+    fd=fd_head->next;
+    ASSERT_NE_POINTER(NULL,fd);
+    ASSERT_EQ(FD_SUBSET_TVB,fd->flags);
+    ASSERT_EQ_POINTER(tvb_get_ptr(fd->tvb_data,0,50),tvb_get_ptr(fd_head->tvb_data,0,50));
+    fd=fd->next;
+    ASSERT_NE_POINTER(NULL,fd);
+    ASSERT_EQ(FD_SUBSET_TVB,fd->flags);
+    ASSERT_EQ_POINTER(tvb_get_ptr(fd->tvb_data,0,60),tvb_get_ptr(fd_head->tvb_data,50,60));
+    ASSERT_EQ_POINTER(NULL,fd->next);
+
+    /* now we announce that the reassembly wasn't complete after all. */
+    fragment_set_partial_reassembly(&test_reassembly_table, &pinfo, 12, NULL);
+
+    pinfo.num = 3;
+    fd_head=fragment_add(&test_reassembly_table, tvb, 0, &pinfo, 12, NULL,
+                         110, 40, false);
+    ASSERT_NE_POINTER(NULL,fd_head);
+
+    ASSERT_EQ(3,fd_head->frame);
+    ASSERT_EQ(150,fd_head->datalen);
+    ASSERT_EQ(FD_DEFRAGMENTED|FD_DATALEN_SET|FD_COMPOSITE,fd_head->flags);
+    ASSERT_EQ(150,tvb_captured_length(fd_head->tvb_data));
+    ASSERT(!tvb_memeql(fd_head->tvb_data,0,data+10,50));
+    ASSERT(!tvb_memeql(fd_head->tvb_data,50,data+5,60));
+    ASSERT(!tvb_memeql(fd_head->tvb_data,110,data,40));
+
+    fd=fd_head->next;
+    ASSERT_EQ(1,fd->frame);
+    ASSERT_EQ(FD_SUBSET_TVB,fd->flags);
+    ASSERT_EQ_POINTER(tvb_get_ptr(fd->tvb_data,0,50),tvb_get_ptr(fd_head->tvb_data,0,50));
+    fd=fd->next->next;
+    ASSERT_EQ(3,fd->frame);
+    ASSERT_EQ(FD_SUBSET_TVB,fd->flags);
+    ASSERT_EQ_POINTER(tvb_get_ptr(fd->tvb_data,0,40),tvb_get_ptr(fd_head->tvb_data,110,40));
+    ASSERT_EQ_POINTER(NULL,fd->next);
+
+    /* A read across fragments still gets contiguous data */
+    ASSERT_EQ(0,memcmp(tvb_get_ptr(fd_head->tvb_data,100,20),data+55,10));
+    ASSERT_EQ(0,memcmp(tvb_get_ptr(fd_head->tvb_data,100,20)+10,data,10));
+
+    if (debug) {
+        print_fragment_table();
+    }
+
+    reassembly_table_set_composite(&test_reassembly_table, false);
+}
+
+/* Test case for reassembly_tables_expire().
+ * Leaves one reassembly pending since frame 1, completes another in frames
+ * 2 and 3, and starts a third in frame 4, then expires everything before
+ * frame 4.
+ */
+static void
+test_reassembly_tables_expire(void)
+{
+    fragment_head *fd_head;
+
+    printf("Starting test test_reassembly_tables_expire\n");
+
+    pinfo.num = 1;
+    fd_head=fragment_add_seq_check(&test_reassembly_table, tvb, 10, &pinfo, 10, NULL,
+                                   0, 50, true);
+    ASSERT_EQ_POINTER(NULL,fd_head);
+
+    pinfo.num = 2;
+    fd_head=fragment_add_seq_check(&test_reassembly_table, tvb, 10, &pinfo, 11, NULL,
+                                   0, 50, true);
+    ASSERT_EQ_POINTER(NULL,fd_head);
+
+    pinfo.num = 3;
+    fd_head=fragment_add_seq_check(&test_reassembly_table, tvb, 5, &pinfo, 11, NULL,
+                                   1, 60, false);
+    ASSERT_NE_POINTER(NULL,fd_head);
+
+    pinfo.num = 4;
+    fd_head=fragment_add_seq_check(&test_reassembly_table, tvb, 10, &pinfo, 12, NULL,
+                                   0, 50, true);
+    ASSERT_EQ_POINTER(NULL,fd_head);
+
+    ASSERT_EQ(2,g_hash_table_size(test_reassembly_table.fragment_table));
+    ASSERT_EQ(2,g_hash_table_size(test_reassembly_table.reassembled_table));
+
+    /* The pending reassembly from frame 1 and the one completed in frame 3 */
+    ASSERT_EQ(2,reassembly_tables_expire(4));
+
+    ASSERT_EQ(1,g_hash_table_size(test_reassembly_table.fragment_table));
+    ASSERT_EQ(0,g_hash_table_size(test_reassembly_table.reassembled_table));
+    fd_head=fragment_get(&test_reassembly_table, &pinfo, 12, NULL);
+    ASSERT_NE_POINTER(NULL,fd_head);
+
+    /* Nothing else is old enough */
+    ASSERT_EQ(0,reassembly_tables_expire(4));
+
+    if (debug) {
+        print_fragment_table();
+    }
+}
+
 /**********************************************************************************
  *
  * main
@@ -3241,6 +3373,7 @@ main(int argc _U_, char **argv _U_)
         test_fragment_add_duplicate_middle,
         test_fragment_add_duplicate_last,
         test_fragment_add_duplicate_conflict,
+        test_fragment_add_composite_partial_reassembly,
         test_simple_fragment_add_check,              /* frag table only   */
 #if 0
         test_fragment_add_check_partial_reassembly,
@@ -3251,6 +3384,7 @@ main(int argc _U_, char **argv _U_)
         test_fragment_add_check_duplicate_last,
 #endif
         test_fragment_add_check_duplicate_conflict,
+        test_reassembly_tables_expire,
     };
 
     /* a tvbuff for testing with */
@@ -3267,6 +3401,10 @@ main(int argc _U_, char **argv _U_)
     set_address(&pinfo.src,AT_IPv4,4,src);
     set_address(&pinfo.dst,AT_IPv4,4,dst);
 
+    /* so that reassembly_tables_expire() looks at it */
+    reassembly_table_register(&test_reassembly_table,
+                              &addresses_reassembly_table_functions);
+
     /*************************************************************************/
     for(i=0; i < array_length(tests); i++ ) {
         /* re-init the fragment tables */
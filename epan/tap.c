@@ -86,6 +86,8 @@ typedef struct _tap_listener_t {
 	unsigned flags;
 	char *fstring;
 	dfilter_t *code;
+	bool filter_applied;	/* filter_passed is set for the current packet */
+	bool filter_passed;
 	void *tapdata;
 	tap_reset_cb reset;
 	tap_packet_cb packet;
@@ -95,6 +97,12 @@ typedef struct _tap_listener_t {
 
 static tap_listener_t *tap_listener_queue;
 
+/* The filters of all the tap listeners combined into one program, built
+ * when first needed and discarded whenever a listener or filter changes. */
+static dfilter_t *tap_listeners_code;
+static bool *tap_listeners_wanted;
+static bool *tap_listeners_results;
+
 static GSList *tap_plugins;
 
 #ifdef HAVE_PLUGINS
@@ -297,6 +305,61 @@ tap_queue_init(epan_dissect_t *edt)
 	tap_build_interesting (edt);
 }
 
+static void
+tap_listeners_code_invalidate(void)
+{
+	dfilter_free(tap_listeners_code);
+	tap_listeners_code = NULL;
+	g_free(tap_listeners_wanted);
+	tap_listeners_wanted = NULL;
+	g_free(tap_listeners_results);
+	tap_listeners_results = NULL;
+}
+
+/* Apply the filters of the tap listeners that have tapped packets queued
+   for this packet at once, so that the fields they test are only read once. */
+static void
+tap_listeners_apply_filters(epan_dissect_t *edt)
+{
+	tap_listener_t *tl;
+	tap_packet_t *tp;
+	GPtrArray *codes;
+	unsigned i, j;
+
+	if(!tap_listeners_code){
+		codes = g_ptr_array_new();
+		for(tl=tap_listener_queue;tl;tl=tl->next){
+			g_ptr_array_add(codes, tl->code);
+		}
+		tap_listeners_code = dfilter_multi_new((dfilter_t * const *)codes->pdata, codes->len);
+		tap_listeners_wanted = g_new(bool, codes->len);
+		tap_listeners_results = g_new(bool, codes->len);
+		g_ptr_array_free(codes, TRUE);
+	}
+
+	for(tl=tap_listener_queue, i=0;tl;tl=tl->next, i++){
+		tap_listeners_wanted[i] = false;
+		if(!tl->code || !tl->packet || tl->failed){
+			continue;
+		}
+		for(j=0;j<tap_packet_index;j++){
+			tp=&tap_packet_array[j];
+			if(tp->tap_id==tl->tap_id &&
+			    (!(tp->flags & TAP_PACKET_IS_ERROR_PACKET) || (tl->flags & TL_REQUIRES_ERROR_PACKETS))){
+				tap_listeners_wanted[i] = true;
+				break;
+			}
+		}
+	}
+
+	dfilter_multi_apply_edt(tap_listeners_code, edt, tap_listeners_wanted, tap_listeners_results, false);
+
+	for(tl=tap_listener_queue, i=0;tl;tl=tl->next, i++){
+		tl->filter_applied = tap_listeners_wanted[i];
+		tl->filter_passed = tap_listeners_results[i];
+	}
+}
+
 /* this function is called after a packet has been fully dissected to push the tapped
    data to all extensions that has callbacks registered.
 */
@@ -306,6 +369,7 @@ tap_push_tapped_queue(epan_dissect_t *edt)
 	tap_packet_t *tp;
 	tap_listener_t *tl;
 	unsigned i;
+	bool filters_applied = false;
 
 	/* nothing to do, just return */
 	if(!tapping_is_active){
@@ -350,7 +414,19 @@ tap_push_tapped_queue(epan_dissect_t *edt)
 					 */
 					unsigned flags = tl->flags;
 					if(tl->code){
-						if (!dfilter_apply_edt(tl->code, edt)){
+						bool passed;
+
+						if(!filters_applied){
+							tap_listeners_apply_filters(edt);
+							filters_applied = true;
+						}
+						if(tl->filter_applied){
+							passed = tl->filter_passed;
+						} else {
+							/* Registered or changed while pushing this packet. */
+							passed = dfilter_apply_edt(tl->code, edt);
+						}
+						if (!passed){
 							/* The packet didn't
 							 * pass the filter. */
 							if (tl->flags & TL_IGNORE_DISPLAY_FILTER)
@@ -568,6 +644,8 @@ register_tap_listener(const char *tapname, void *tapdata, const char *fstring,
 		tl->code=code;
 	}
 
+	tap_listeners_code_invalidate();
+
 	tl->tap_id=tap_id;
 	tl->tapdata=tapdata;
 	tl->reset=reset;
@@ -608,10 +686,12 @@ set_tap_dfilter(void *tapdata, const char *fstring)
 	}
 
 	if(tl){
+		tap_listeners_code_invalidate();
 		if(tl->code){
 			dfilter_free(tl->code);
 			tl->code=NULL;
 		}
+		tl->filter_applied=false;
 		tl->needs_redraw=true;
 		g_free(tl->fstring);
 		if(fstring){
@@ -669,11 +749,14 @@ tap_listeners_dfilter_recompile(void)
 	tap_listener_t *tl;
 	dfilter_t *code;
 
+	tap_listeners_code_invalidate();
+
 	for(tl=tap_listener_queue;tl;tl=tl->next){
 		if(tl->code){
 			dfilter_free(tl->code);
 			tl->code=NULL;
 		}
+		tl->filter_applied=false;
 		tl->needs_redraw=true;
 		code=NULL;
 		if(tl->fstring){
@@ -714,6 +797,7 @@ remove_tap_listener(void *tapdata)
 			return;
 		}
 	}
+	tap_listeners_code_invalidate();
 	free_tap_listener(tl);
 }
 
@@ -826,6 +910,8 @@ void tap_cleanup(void)
 	tap_dissector_t *elem_dl;
 	tap_dissector_t *head_dl = tap_dissector_list;
 
+	tap_listeners_code_invalidate();
+
 	while(head_lq){
 		elem_lq = head_lq;
 		head_lq = head_lq->next;
@@ -11,6 +11,13 @@
 #include "strutil.h"
 #include <wsutil/utf8_entities.h>
 
+#include <epan/epan.h>
+#include <epan/epan_dissect.h>
+#include <epan/frame_data.h>
+#include <epan/packet.h>
+#include <epan/prefs.h>
+#include <wiretap/wtap.h>
+
 /*
  * FIXME: LABEL_LENGTH includes the nul byte terminator.
  * This is confusing but matches ITEM_LABEL_LENGTH.
@@ -74,6 +81,107 @@ void test_label_escape_control(void)
     g_assert_cmpuint(pos, ==, strlen(dst));
 }
 
+/*
+ * An outer protocol that hands packets to an inner protocol through a
+ * dissector table without adding it to the layers, as many dissectors
+ * do for options and attributes, and a protocol that's never called.
+ */
+static int proto_test_outer = -1;
+static int proto_test_inner = -1;
+static int proto_test_unused = -1;
+static dissector_table_t test_inner_table;
+static bool test_inner_pref;
+static bool test_unused_pref;
+
+static int
+dissect_test_outer(tvbuff_t *tvb, packet_info *pinfo, proto_tree *tree, void *data _U_)
+{
+    dissector_try_uint_new(test_inner_table, 1, tvb, pinfo, tree, false, NULL);
+    return tvb_captured_length(tvb);
+}
+
+static int
+dissect_test_inner(tvbuff_t *tvb, packet_info *pinfo _U_, proto_tree *tree _U_, void *data _U_)
+{
+    return tvb_captured_length(tvb);
+}
+
+static const nstime_t *
+test_get_frame_ts(struct packet_provider_data *prov _U_, uint32_t frame_num _U_)
+{
+    static nstime_t empty;
+
+    return &empty;
+}
+
+static void
+test_set_pref(const char *setting)
+{
+    char *prefarg = g_strdup(setting);
+    char *errmsg = NULL;
+
+    g_assert_cmpint(prefs_set_pref(prefarg, &errmsg), ==, PREFS_SET_OK);
+    g_free(prefarg);
+    prefs_apply_all();
+}
+
+void test_prefs_changes_affect_session(void)
+{
+    static const struct packet_provider_funcs funcs = {
+        test_get_frame_ts,
+        NULL,
+        NULL,
+        NULL
+    };
+    static const uint8_t packet[] = { 0x01, 0x02, 0x03, 0x04 };
+    module_t *module;
+    epan_t *session;
+    epan_dissect_t *edt;
+    wtap_rec rec;
+    frame_data fdata;
+
+    proto_test_outer = proto_register_protocol("Test Outer", "TESTOUTER", "test_outer");
+    proto_test_inner = proto_register_protocol("Test Inner", "TESTINNER", "test_inner");
+    proto_test_unused = proto_register_protocol("Test Unused", "TESTUNUSED", "test_unused");
+    test_inner_table = register_dissector_table("test_outer.inner", "Test Inner",
+                                                proto_test_outer, FT_UINT8, BASE_DEC);
+    dissector_add_uint("test_outer.inner", 1,
+                       create_dissector_handle(dissect_test_inner, proto_test_inner));
+    dissector_add_uint("wtap_encap", WTAP_ENCAP_USER15,
+                       create_dissector_handle(dissect_test_outer, proto_test_outer));
+    module = prefs_register_protocol(proto_test_inner, NULL);
+    prefs_register_bool_preference(module, "flag", "Flag", "A test flag", &test_inner_pref);
+    module = prefs_register_protocol(proto_test_unused, NULL);
+    prefs_register_bool_preference(module, "flag", "Flag", "A test flag", &test_unused_pref);
+
+    session = epan_new(NULL, &funcs);
+    edt = epan_dissect_new(session, false, false);
+    memset(&rec, 0, sizeof(rec));
+    rec.rec_type = REC_TYPE_PACKET;
+    rec.rec_header.packet_header.caplen = sizeof packet;
+    rec.rec_header.packet_header.len = sizeof packet;
+    rec.rec_header.packet_header.pkt_encap = WTAP_ENCAP_USER15;
+    rec.presence_flags = WTAP_HAS_TS | WTAP_HAS_CAP_LEN;
+    frame_data_init(&fdata, 1, &rec, 0, 0);
+    epan_dissect_run(edt, WTAP_FILE_TYPE_SUBTYPE_UNKNOWN, &rec,
+                     tvb_new_real_data(packet, sizeof packet, sizeof packet), &fdata, NULL);
+    frame_data_destroy(&fdata);
+    epan_dissect_free(edt);
+
+    /* Something other than a preference changed. */
+    g_assert_true(epan_prefs_changes_affect_session(session));
+
+    /* No packet went to the protocol. */
+    test_set_pref("test_unused.flag:TRUE");
+    g_assert_false(epan_prefs_changes_affect_session(session));
+
+    /* The inner protocol wasn't added to the layers, but was called. */
+    test_set_pref("test_inner.flag:TRUE");
+    g_assert_true(epan_prefs_changes_affect_session(session));
+
+    epan_free(session);
+}
+
 int main(int argc, char **argv)
 {
     int ret;
@@ -82,12 +190,20 @@ int main(int argc, char **argv)
 
     g_test_init(&argc, &argv, NULL);
 
+    wtap_init(false);
+    if (!epan_init(NULL, NULL, false))
+        return 1;
+
     g_test_add_func("/label/strcat", test_label_strcat);
     g_test_add_func("/label/escape_whitespace", test_label_strcat_escape_whitespace);
     g_test_add_func("/label/escape_control", test_label_escape_control);
+    g_test_add_func("/epan/prefs_changes_affect_session", test_prefs_changes_affect_session);
 
     ret = g_test_run();
 
+    epan_cleanup();
+    wtap_cleanup();
+
     return ret;
 }
 
@@ -609,6 +609,43 @@ run_tests(void)
 	tvb_free_chain(tvb_parent);  /* should free all tvb's and associated data */
 }
 
+/* Composites that own their members' data, and composites of ranges of
+ * other composites, as reassembly builds. */
+static void
+composite_range_tests(void)
+{
+	static const uint8_t data[] = "0123456789abcdefghijklmnopqrstuvwxyz";
+	tvbuff_t	*tvb_part[3];
+	tvbuff_t	*tvb_owner, *tvb_rope;
+	unsigned	i;
+
+	printf("Making Owning Composite\n");
+	tvb_owner = tvb_new_composite();
+	for (i = 0; i < 3; i++) {
+		uint8_t *part = (uint8_t *)g_memdup2(&data[12 * i], 12);
+
+		tvb_part[i] = tvb_new_real_data(part, 12, 12);
+		tvb_set_free_cb(tvb_part[i], g_free);
+		tvb_composite_take(tvb_owner, tvb_part[i]);
+	}
+	/* "23456789ab", "cdefghijklmn", "opqrst" */
+	tvb_composite_append_range(tvb_owner, tvb_part[0], 2, 10);
+	tvb_composite_append_range(tvb_owner, tvb_part[1], 0, 12);
+	tvb_composite_append_range(tvb_owner, tvb_part[2], 0, 6);
+	tvb_composite_finalize(tvb_owner);
+
+	/* Built on the owning composite's members; freed with them. */
+	printf("Making Composite of a Composite Range\n");
+	tvb_rope = tvb_new_composite();
+	tvb_composite_append_range(tvb_rope, tvb_owner, 5, 20);
+	tvb_composite_finalize(tvb_rope);
+
+	test(tvb_owner, "Owning Composite", (uint8_t *)&data[2], 28, 28);
+	test(tvb_rope, "Composite of a Composite Range", (uint8_t *)&data[7], 20, 20);
+
+	tvb_free(tvb_owner);  /* should free all tvb's and associated data */
+}
+
 typedef struct
 {
 	// Raw bytes
@@ -814,6 +851,7 @@ main(void)
 
 	except_init();
 	run_tests();
+	composite_range_tests();
 	varint_tests();
 	zstd_tests ();
 	except_deinit();
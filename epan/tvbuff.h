@@ -226,9 +226,26 @@ WS_DLL_PUBLIC void tvb_composite_append(tvbuff_t *tvb, tvbuff_t *member);
 /** Prepend to the list of tvbuffs that make up this composite tvbuff */
 extern void tvb_composite_prepend(tvbuff_t *tvb, tvbuff_t *member);
 
+/** Append length bytes of member, starting at offset, to this composite
+ * tvbuff. If member is itself a composite tvbuff, the parts of its members
+ * are appended instead, so that composites built from composites don't
+ * nest. */
+WS_DLL_PUBLIC void tvb_composite_append_range(tvbuff_t *tvb, tvbuff_t *member,
+    const unsigned offset, const unsigned length);
+
 /** Create an empty composite tvbuff. */
 WS_DLL_PUBLIC tvbuff_t *tvb_new_composite(void);
 
+/** Make a composite tvbuff own a tvbuff and the tvbuffs chained to it,
+ * freeing them when it is freed, rather than being freed along with its
+ * first member. Must be called before any member is added. */
+WS_DLL_PUBLIC void tvb_composite_take(tvbuff_t *tvb, tvbuff_t *owned);
+
+/** Take over the tvbuffs that another composite tvbuff owns, so that it
+ * can be freed without them. Returns false, doing nothing, if from isn't
+ * a composite tvbuff that owns tvbuffs. */
+WS_DLL_PUBLIC bool tvb_composite_take_from(tvbuff_t *tvb, tvbuff_t *from);
+
 /** Mark a composite tvbuff as initialized. No further appends or prepends
  * occur, data access can finally happen after this finalization. */
 WS_DLL_PUBLIC void tvb_composite_finalize(tvbuff_t *tvb);
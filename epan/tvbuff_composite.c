@@ -18,12 +18,23 @@
 typedef struct {
 	GQueue		*tvbs;
 
-	/* Used for quick testing to see if this
-	 * is the tvbuff that a COMPOSITE is
-	 * interested in. */
+	/* Filled in by tvb_composite_finalize(): the members in
+	 * order, and the offsets of their first and last bytes,
+	 * for a binary search for the member holding an offset. */
+	tvbuff_t	**members;
+	unsigned	num_members;
 	unsigned		*start_offsets;
 	unsigned		*end_offsets;
 
+	/* Copies of ranges that straddle members, made by
+	 * composite_get_ptr(), and how many bytes they hold. */
+	GSList		*copies;
+	unsigned	copied;
+
+	/* Chain of tvbuffs freed along with this one; see
+	 * tvb_composite_take(). */
+	tvbuff_t	*owned;
+
 } tvb_comp_t;
 
 struct tvb_composite {
@@ -32,17 +43,29 @@ struct tvb_composite {
 	tvb_comp_t	composite;
 };
 
+typedef struct {
+	unsigned	offset;
+	unsigned	length;
+	uint8_t		data[];
+} tvb_comp_copy_t;
+
 static void
 composite_free(tvbuff_t *tvb)
 {
 	struct tvb_composite *composite_tvb = (struct tvb_composite *) tvb;
 	tvb_comp_t *composite = &composite_tvb->composite;
 
-	g_queue_free(composite->tvbs);
+	if (composite->tvbs)
+		g_queue_free(composite->tvbs);
 
+	g_free(composite->members);
 	g_free(composite->start_offsets);
 	g_free(composite->end_offsets);
+	g_slist_free_full(composite->copies, g_free);
 	g_free((void *)tvb->real_data);
+
+	if (composite->owned)
+		tvb_free_chain(composite->owned);
 }
 
 static unsigned
@@ -51,36 +74,89 @@ composite_offset(const tvbuff_t *tvb _U_, const unsigned counter)
 	return counter;
 }
 
+/*
+ * Return the index of the member holding abs_offset, or num_members
+ * if abs_offset is at (or past) the end.
+ */
+static unsigned
+composite_find_member(const tvb_comp_t *composite, const unsigned abs_offset)
+{
+	unsigned lo = 0, hi = composite->num_members;
+
+	while (lo < hi) {
+		unsigned mid = lo + (hi - lo) / 2;
+
+		if (composite->end_offsets[mid] < abs_offset)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+static void *
+composite_memcpy(tvbuff_t *tvb, void* _target, unsigned abs_offset, unsigned abs_length)
+{
+	struct tvb_composite *composite_tvb = (struct tvb_composite *) tvb;
+	uint8_t *target = (uint8_t *) _target;
+
+	unsigned	    i;
+	tvb_comp_t *composite;
+	unsigned	    member_offset, member_length;
+
+	/* DISSECTOR_ASSERT(tvb->ops == &tvb_composite_ops); */
+
+	composite = &composite_tvb->composite;
+	i = composite_find_member(composite, abs_offset);
+
+	/* special case */
+	if (i == composite->num_members) {
+		DISSECTOR_ASSERT(abs_offset == tvb->length && abs_length == 0);
+		return target;
+	}
+
+	/* Copy the part that's in each member tvb in turn, until
+	 * we have copied all data. */
+	while (abs_length > 0) {
+		DISSECTOR_ASSERT(i < composite->num_members);
+
+		member_offset = abs_offset - composite->start_offsets[i];
+		member_length = MIN(abs_length, composite->end_offsets[i] - abs_offset + 1);
+
+		tvb_memcpy(composite->members[i], target, member_offset, member_length);
+		target		+= member_length;
+		abs_offset	+= member_length;
+		abs_length	-= member_length;
+		i++;
+	}
+
+	return _target;
+}
+
 static const uint8_t*
 composite_get_ptr(tvbuff_t *tvb, unsigned abs_offset, unsigned abs_length)
 {
 	struct tvb_composite *composite_tvb = (struct tvb_composite *) tvb;
 	unsigned	    i;
 	tvb_comp_t *composite;
-	tvbuff_t   *member_tvb = NULL;
+	tvbuff_t   *member_tvb;
 	unsigned	member_offset;
+	tvb_comp_copy_t *copy;
 
 	/* DISSECTOR_ASSERT(tvb->ops == &tvb_composite_ops); */
 
 	/* Maybe the range specified by offset/length
 	 * is contiguous inside one of the member tvbuffs */
 	composite = &composite_tvb->composite;
-	GList *item = (GList*)composite->tvbs->head;
-
-
-	for (i = 0; i < g_queue_get_length(composite->tvbs); i++, item=item->next) {
-		if (abs_offset <= composite->end_offsets[i]) {
-			member_tvb = (tvbuff_t *)item->data;
-			break;
-		}
-	}
+	i = composite_find_member(composite, abs_offset);
 
 	/* special case */
-	if (!member_tvb) {
+	if (i == composite->num_members) {
 		DISSECTOR_ASSERT(abs_offset == tvb->length && abs_length == 0);
 		return "";
 	}
 
+	member_tvb = composite->members[i];
 	member_offset = abs_offset - composite->start_offsets[i];
 
 	if (tvb_bytes_exist(member_tvb, member_offset, abs_length)) {
@@ -90,6 +166,31 @@ composite_get_ptr(tvbuff_t *tvb, unsigned abs_offset, unsigned abs_length)
 		DISSECTOR_ASSERT(!tvb->real_data);
 		return tvb_get_ptr(member_tvb, member_offset, abs_length);
 	}
+
+	/*
+	 * The range straddles members, so it has to be copied somewhere
+	 * that lasts as long as the composite tvb. Reuse the last copy
+	 * if it has the range (a field is often fetched more than once),
+	 * or copy just the range, unless the copies would add up to more
+	 * than half of the composite tvb; then copy the whole of it,
+	 * once, for this and every later access.
+	 */
+	if (composite->copies) {
+		copy = (tvb_comp_copy_t *)composite->copies->data;
+		if (abs_offset >= copy->offset &&
+		    abs_offset + abs_length <= copy->offset + copy->length)
+			return copy->data + (abs_offset - copy->offset);
+	}
+
+	if (composite->copied + abs_length <= tvb->length / 2) {
+		copy = (tvb_comp_copy_t *)g_malloc(sizeof(tvb_comp_copy_t) + abs_length);
+		copy->offset = abs_offset;
+		copy->length = abs_length;
+		composite_memcpy(tvb, copy->data, abs_offset, abs_length);
+		composite->copies = g_slist_prepend(composite->copies, copy);
+		composite->copied += abs_length;
+		return copy->data;
+	}
 	else {
 		/* Use a temporary variable as tvb_memcpy is also checking tvb->real_data pointer */
 		void *real_data = g_malloc(tvb->length);
@@ -101,67 +202,56 @@ composite_get_ptr(tvbuff_t *tvb, unsigned abs_offset, unsigned abs_length)
 	DISSECTOR_ASSERT_NOT_REACHED();
 }
 
-static void *
-composite_memcpy(tvbuff_t *tvb, void* _target, unsigned abs_offset, unsigned abs_length)
+/*
+ * Searches go through the members in turn, so that they don't need the
+ * range searched to be made contiguous.
+ */
+static int
+composite_find_uint8(tvbuff_t *tvb, unsigned abs_offset, unsigned limit, uint8_t needle)
 {
 	struct tvb_composite *composite_tvb = (struct tvb_composite *) tvb;
-	uint8_t *target = (uint8_t *) _target;
-
+	tvb_comp_t *composite = &composite_tvb->composite;
 	unsigned	    i;
-	tvb_comp_t *composite;
-	tvbuff_t   *member_tvb = NULL;
 	unsigned	    member_offset, member_length;
+	int		    result;
 
-	/* DISSECTOR_ASSERT(tvb->ops == &tvb_composite_ops); */
+	for (i = composite_find_member(composite, abs_offset); limit > 0 && i < composite->num_members; i++) {
+		member_offset = abs_offset - composite->start_offsets[i];
+		member_length = MIN(limit, composite->end_offsets[i] - abs_offset + 1);
 
-	/* Maybe the range specified by offset/length
-	 * is contiguous inside one of the member tvbuffs */
-	composite   = &composite_tvb->composite;
+		result = tvb_find_uint8(composite->members[i], member_offset, member_length, needle);
+		if (result != -1)
+			return result + composite->start_offsets[i];
 
-	GList *item = (GList*)composite->tvbs->head;
-	for (i = 0; i < g_queue_get_length(composite->tvbs); i++, item=item->next) {
-		if (abs_offset <= composite->end_offsets[i]) {
-			member_tvb = (tvbuff_t *)item->data;
-			break;
-		}
+		abs_offset += member_length;
+		limit	   -= member_length;
 	}
 
-	/* special case */
-	if (!member_tvb) {
-		DISSECTOR_ASSERT(abs_offset == tvb->length && abs_length == 0);
-		return target;
-	}
-
-	member_offset = abs_offset - composite->start_offsets[i];
-
-	if (tvb_bytes_exist(member_tvb, member_offset, abs_length)) {
-		DISSECTOR_ASSERT(!tvb->real_data);
-		return tvb_memcpy(member_tvb, target, member_offset, abs_length);
-	}
-	else {
-		/* The requested data is non-contiguous inside
-		 * the member tvb. We have to memcpy() the part that's in the member tvb,
-		 * then iterate across the other member tvb's, copying their portions
-		 * until we have copied all data.
-		 */
-		member_length = tvb_captured_length_remaining(member_tvb, member_offset);
+	return -1;
+}
 
-		/* composite_memcpy() can't handle a member_length of zero. */
-		DISSECTOR_ASSERT(member_length > 0);
+static int
+composite_pbrk_uint8(tvbuff_t *tvb, unsigned abs_offset, unsigned limit, const ws_mempbrk_pattern* pattern, unsigned char *found_needle)
+{
+	struct tvb_composite *composite_tvb = (struct tvb_composite *) tvb;
+	tvb_comp_t *composite = &composite_tvb->composite;
+	unsigned	    i;
+	unsigned	    member_offset, member_length;
+	int		    result;
 
-		tvb_memcpy(member_tvb, target, member_offset, member_length);
-		abs_offset	+= member_length;
-		abs_length	-= member_length;
+	for (i = composite_find_member(composite, abs_offset); limit > 0 && i < composite->num_members; i++) {
+		member_offset = abs_offset - composite->start_offsets[i];
+		member_length = MIN(limit, composite->end_offsets[i] - abs_offset + 1);
 
-		/* Recurse */
-		if (abs_length > 0) {
-			composite_memcpy(tvb, target + member_length, abs_offset, abs_length);
-		}
+		result = tvb_ws_mempbrk_pattern_uint8(composite->members[i], member_offset, member_length, pattern, found_needle);
+		if (result != -1)
+			return result + composite->start_offsets[i];
 
-		return target;
+		abs_offset += member_length;
+		limit	   -= member_length;
 	}
 
-	DISSECTOR_ASSERT_NOT_REACHED();
+	return -1;
 }
 
 static const struct tvb_ops tvb_composite_ops = {
@@ -171,8 +261,8 @@ static const struct tvb_ops tvb_composite_ops = {
 	composite_offset,     /* offset */
 	composite_get_ptr,    /* get_ptr */
 	composite_memcpy,     /* memcpy */
-	NULL,                 /* find_uint8 XXX */
-	NULL,                 /* pbrk_uint8 XXX */
+	composite_find_uint8, /* find_uint8 */
+	composite_pbrk_uint8, /* pbrk_uint8 */
 	NULL,                 /* clone */
 };
 
@@ -183,7 +273,7 @@ static const struct tvb_ops tvb_composite_ops = {
  * them MUST be part of the same chain (the same memory "scope"). The
  * caller of tvb_new_composite MUST immediately call tvb_composite_append or
  * tvb_composite_prepend to ensure that the composite TVB is properly freed as
- * needed.
+ * needed, unless it calls tvb_composite_take first.
  *
  * Failure to satisfy the same chain requirement can result in memory-safety
  * issues such as use-after-free or double-free.
@@ -196,12 +286,69 @@ tvb_new_composite(void)
 	tvb_comp_t *composite = &composite_tvb->composite;
 
 	composite->tvbs		 = g_queue_new();
+	composite->members	 = NULL;
+	composite->num_members	 = 0;
 	composite->start_offsets = NULL;
 	composite->end_offsets	 = NULL;
+	composite->copies	 = NULL;
+	composite->copied	 = 0;
+	composite->owned	 = NULL;
 
 	return tvb;
 }
 
+/*
+ * Make a composite TVB own a TVB, and the TVBs chained to it: they are
+ * freed when the composite TVB is, rather than the composite TVB being
+ * freed with its first member. The members must then be in the chains
+ * of the owned TVBs, and the composite TVB itself must be freed (or
+ * added to some other chain) by its creator. This lets a composite TVB
+ * outlive the TVBs it was built from, e.g. the fragments of a reassembly.
+ *
+ * This must be called before any member is added.
+ */
+void
+tvb_composite_take(tvbuff_t *tvb, tvbuff_t *owned)
+{
+	struct tvb_composite *composite_tvb = (struct tvb_composite *) tvb;
+	tvb_comp_t *composite;
+
+	DISSECTOR_ASSERT(tvb && !tvb->initialized);
+	DISSECTOR_ASSERT(tvb->ops == &tvb_composite_ops);
+	DISSECTOR_ASSERT(owned);
+
+	composite = &composite_tvb->composite;
+	DISSECTOR_ASSERT(g_queue_is_empty(composite->tvbs));
+
+	if (composite->owned)
+		tvb_add_to_chain(composite->owned, owned);
+	else
+		composite->owned = owned;
+}
+
+/*
+ * Take over what another composite TVB owns, leaving it owning nothing, so
+ * that it can be freed without freeing the TVBs built on them. Returns
+ * false, and does nothing, if from isn't a composite TVB that owns TVBs.
+ */
+bool
+tvb_composite_take_from(tvbuff_t *tvb, tvbuff_t *from)
+{
+	tvb_comp_t *from_composite;
+
+	DISSECTOR_ASSERT(from);
+	if (from->ops != &tvb_composite_ops)
+		return false;
+
+	from_composite = &((struct tvb_composite *) from)->composite;
+	if (!from_composite->owned)
+		return false;
+
+	tvb_composite_take(tvb, from_composite->owned);
+	from_composite->owned = NULL;
+	return true;
+}
+
 void
 tvb_composite_append(tvbuff_t *tvb, tvbuff_t *member)
 {
@@ -218,8 +365,9 @@ tvb_composite_append(tvbuff_t *tvb, tvbuff_t *member)
 		composite       = &composite_tvb->composite;
 		g_queue_push_tail(composite->tvbs, member);
 
-		/* Attach the composite TVB to the first TVB only. */
-		if (g_queue_get_length(composite->tvbs) == 1) {
+		/* Attach the composite TVB to the first TVB only, unless it's
+		 * freed with the TVBs it owns. */
+		if (g_queue_get_length(composite->tvbs) == 1 && !composite->owned) {
 			tvb_add_to_chain((tvbuff_t *)g_queue_peek_head(composite->tvbs), tvb);
 		}
 	}
@@ -241,13 +389,60 @@ tvb_composite_prepend(tvbuff_t *tvb, tvbuff_t *member)
 		composite       = &composite_tvb->composite;
 		g_queue_push_head(composite->tvbs, member);
 
-		/* Attach the composite TVB to the first TVB only. */
-		if (g_queue_get_length(composite->tvbs) == 1) {
+		/* Attach the composite TVB to the first TVB only, unless it's
+		 * freed with the TVBs it owns. */
+		if (g_queue_get_length(composite->tvbs) == 1 && !composite->owned) {
 			tvb_add_to_chain((tvbuff_t *)g_queue_peek_head(composite->tvbs), tvb);
 		}
 	}
 }
 
+/*
+ * Append length bytes of member, starting at offset. If member is itself
+ * a composite TVB, the parts of its members in that range are appended
+ * instead, so that a composite built from a composite doesn't add a level
+ * of indirection (and a binary search) to every access.
+ */
+void
+tvb_composite_append_range(tvbuff_t *tvb, tvbuff_t *member, const unsigned offset, const unsigned length)
+{
+	unsigned	abs_offset, remaining;
+	unsigned	member_offset, member_length;
+	unsigned	i;
+
+	DISSECTOR_ASSERT(tvb && !tvb->initialized);
+	DISSECTOR_ASSERT(tvb->ops == &tvb_composite_ops);
+	DISSECTOR_ASSERT(member && member->initialized);
+
+	if (length == 0)
+		return;
+
+	if (member->ops == &tvb_composite_ops) {
+		tvb_comp_t *composite = &((struct tvb_composite *) member)->composite;
+
+		DISSECTOR_ASSERT(offset + length >= offset && offset + length <= member->length);
+
+		abs_offset = offset;
+		remaining = length;
+		for (i = composite_find_member(composite, abs_offset); remaining > 0; i++) {
+			DISSECTOR_ASSERT(i < composite->num_members);
+
+			member_offset = abs_offset - composite->start_offsets[i];
+			member_length = MIN(remaining, composite->end_offsets[i] - abs_offset + 1);
+			tvb_composite_append_range(tvb, composite->members[i], member_offset, member_length);
+
+			abs_offset += member_length;
+			remaining  -= member_length;
+		}
+		return;
+	}
+
+	if (offset == 0 && length == member->length && length == member->reported_length)
+		tvb_composite_append(tvb, member);
+	else
+		tvb_composite_append(tvb, tvb_new_subset_length_caplen(member, offset, length, length));
+}
+
 void
 tvb_composite_finalize(tvbuff_t *tvb)
 {
@@ -274,12 +469,15 @@ tvb_composite_finalize(tvbuff_t *tvb)
 	 */
 	DISSECTOR_ASSERT(num_members);
 
+	composite->members = g_new(tvbuff_t *, num_members);
+	composite->num_members = num_members;
 	composite->start_offsets = g_new(unsigned, num_members);
 	composite->end_offsets = g_new(unsigned, num_members);
 
 	GList *item = (GList*)composite->tvbs->head;
 	for (i=0; i < num_members; i++, item=item->next) {
 		member_tvb = (tvbuff_t *)item->data;
+		composite->members[i] = member_tvb;
 		composite->start_offsets[i] = tvb->length;
 		tvb->length += member_tvb->length;
 		tvb->reported_length += member_tvb->reported_length;
@@ -287,6 +485,10 @@ tvb_composite_finalize(tvbuff_t *tvb)
 		composite->end_offsets[i] = tvb->length - 1;
 	}
 
+	/* Only the array is needed from now on. */
+	g_queue_free(composite->tvbs);
+	composite->tvbs = NULL;
+
 	tvb->initialized = true;
 	tvb->ds_tvb = tvb;
 }
@@ -42,7 +42,7 @@
 #define DPAUXMON_VERSION_MINOR "1"
 #define DPAUXMON_VERSION_RELEASE "0"
 
-FILE* pcap_fp;
+pcapio_stream* pcap_fp;
 
 enum {
 	EXTCAP_BASE_OPTIONS_ENUM,
@@ -95,33 +95,35 @@ static int list_config(char *interface)
 	return EXIT_SUCCESS;
 }
 
-static int setup_dumpfile(const char* fifo, FILE** fp)
+static int setup_dumpfile(const char* fifo, pcapio_stream** fp)
 {
 	uint64_t bytes_written = 0;
 	int err;
+	FILE* fh;
 
 	if (!g_strcmp0(fifo, "-")) {
-		*fp = stdout;
+		*fp = pcapio_stdio_stream(stdout);
 		return EXIT_SUCCESS;
 	}
 
-	*fp = fopen(fifo, "wb");
-	if (!(*fp)) {
+	fh = fopen(fifo, "wb");
+	if (!fh) {
 		ws_warning("Error creating output file: %s", g_strerror(errno));
 		return EXIT_FAILURE;
 	}
+	*fp = pcapio_stdio_stream(fh);
 
 	if (!libpcap_write_file_header(*fp, 275, PCAP_SNAPLEN, false, &bytes_written, &err)) {
 		ws_warning("Can't write pcap file header");
 		return EXIT_FAILURE;
 	}
 
-        fflush(*fp);
+        pcapio_flush(*fp);
 
 	return EXIT_SUCCESS;
 }
 
-static int dump_packet(FILE* fp, const char* buf, const uint32_t buflen, uint64_t ts_usecs)
+static int dump_packet(pcapio_stream* fp, const char* buf, const uint32_t buflen, uint64_t ts_usecs)
 {
 	uint64_t bytes_written = 0;
 	int err;
@@ -132,7 +134,7 @@ static int dump_packet(FILE* fp, const char* buf, const uint32_t buflen, uint64_
 		ret = EXIT_FAILURE;
 	}
 
-	fflush(fp);
+	pcapio_flush(fp);
 
 	return ret;
 }
@@ -468,7 +470,7 @@ err_out:
 free_out:
 	nl_socket_free(sock);
 close_out:
-	fclose(pcap_fp);
+	pcapio_close(pcap_fp, NULL);
 }
 
 int main(int argc, char *argv[])
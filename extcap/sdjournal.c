@@ -66,7 +66,7 @@ static const struct ws_option longopts[] = {
 #define ENTRY_BUF_LENGTH WTAP_MAX_PACKET_SIZE_STANDARD
 #define MAX_EXPORT_ENTRY_LENGTH (ENTRY_BUF_LENGTH - 4 - 4 - 4) // Block type - total length - total length
 
-static int sdj_dump_entries(sd_journal *jnl, FILE* fp)
+static int sdj_dump_entries(sd_journal *jnl, pcapio_stream* fp)
 {
 	int ret = EXIT_SUCCESS;
 	uint8_t *entry_buff = g_new(uint8_t, ENTRY_BUF_LENGTH);
@@ -178,7 +178,7 @@ static int sdj_dump_entries(sd_journal *jnl, FILE* fp)
 			break;
 		}
 
-		fflush(fp);
+		pcapio_flush(fp);
 	}
 
 end:
@@ -188,7 +188,8 @@ end:
 
 static int sdj_start_export(const int start_from_entries, const bool start_from_end, const char* fifo)
 {
-	FILE* fp = stdout;
+	FILE* fh = stdout;
+	pcapio_stream* fp;
 	uint64_t bytes_written = 0;
 	int err;
 	sd_journal *jnl = NULL;
@@ -202,12 +203,13 @@ static int sdj_start_export(const int start_from_entries, const bool start_from_
 
 	if (g_strcmp0(fifo, "-")) {
 		/* Open or create the output file */
-		fp = fopen(fifo, "wb");
-		if (fp == NULL) {
+		fh = fopen(fifo, "wb");
+		if (fh == NULL) {
 			ws_warning("Error creating output file: %s (%s)", fifo, g_strerror(errno));
 			return EXIT_FAILURE;
 		}
 	}
+	fp = pcapio_stdio_stream(fh);
 
 
 	appname = ws_strdup_printf(SDJOURNAL_EXTCAP_INTERFACE " (Wireshark) %s.%s.%s",
@@ -299,9 +301,7 @@ cleanup:
 	g_free(err_info);
 
 	/* clean up and exit */
-	if (g_strcmp0(fifo, "-")) {
-		fclose(fp);
-	}
+	pcapio_close(fp, NULL);
 	return ret;
 }
 
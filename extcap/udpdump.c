@@ -148,28 +148,30 @@ cleanup_setup_listener:
 
 }
 
-static int setup_dumpfile(const char* fifo, FILE** fp)
+static int setup_dumpfile(const char* fifo, pcapio_stream** fp)
 {
 	uint64_t bytes_written = 0;
 	int err;
+	FILE* fh;
 
 	if (!g_strcmp0(fifo, "-")) {
-		*fp = stdout;
+		*fp = pcapio_stdio_stream(stdout);
 		return EXIT_SUCCESS;
 	}
 
-	*fp = fopen(fifo, "wb");
-	if (!(*fp)) {
+	fh = fopen(fifo, "wb");
+	if (!fh) {
 		ws_warning("Error creating output file: %s", g_strerror(errno));
 		return EXIT_FAILURE;
 	}
+	*fp = pcapio_stdio_stream(fh);
 
 	if (!libpcap_write_file_header(*fp, 252, PCAP_SNAPLEN, false, &bytes_written, &err)) {
 		ws_warning("Can't write pcap file header: %s", g_strerror(err));
 		return EXIT_FAILURE;
 	}
 
-	fflush(*fp);
+	pcapio_flush(*fp);
 
 	return EXIT_SUCCESS;
 }
@@ -239,7 +241,7 @@ static void add_end_options(uint8_t* mbuf, unsigned* offset)
 }
 
 static int dump_packet(const char* proto_name, const uint16_t listenport, const char* buf,
-		const ssize_t buflen, const struct sockaddr_in clientaddr, FILE* fp)
+		const ssize_t buflen, const struct sockaddr_in clientaddr, pcapio_stream* fp)
 {
 	uint8_t* mbuf;
 	unsigned offset = 0;
@@ -268,7 +270,7 @@ static int dump_packet(const char* proto_name, const uint16_t listenport, const
 		ret = EXIT_FAILURE;
 	}
 
-	fflush(fp);
+	pcapio_flush(fp);
 
 	g_free(mbuf);
 	return ret;
@@ -281,11 +283,11 @@ static void run_listener(const char* fifo, const uint16_t port, const char* prot
 	socket_handle_t sock;
 	char* buf;
 	ssize_t buflen;
-	FILE* fp = NULL;
+	pcapio_stream* fp = NULL;
 
 	if (setup_dumpfile(fifo, &fp) == EXIT_FAILURE) {
 		if (fp)
-			fclose(fp);
+			pcapio_close(fp, NULL);
 		return;
 	}
 
@@ -328,7 +330,7 @@ static void run_listener(const char* fifo, const uint16_t port, const char* prot
 		}
 	}
 
-	fclose(fp);
+	pcapio_close(fp, NULL);
 	closesocket(sock);
 	g_free(buf);
 }
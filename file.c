@@ -1618,6 +1618,22 @@ cf_redissect_packets(capture_file *cf)
     }
 }
 
+void
+cf_redissect_packets_for_prefs(capture_file *cf)
+{
+    bool affected = cf->epan == NULL || epan_prefs_changes_affect_session(cf->epan);
+
+    if (!affected && !cf->read_lock && cf->redissection_queued == RESCAN_NONE &&
+        cf->state != FILE_CLOSED) {
+        /* None of the changed preferences belong to a protocol that any
+         * packet was dissected with, so the state the dissectors built is
+         * still good; just filter and colorize the packets again. */
+        rescan_packets(cf, "Reprocessing", "all packets", false);
+        return;
+    }
+    cf_redissect_packets(cf);
+}
+
 bool
 cf_read_record(capture_file *cf, const frame_data *fdata,
         wtap_rec *rec, Buffer *buf)
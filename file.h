@@ -419,6 +419,15 @@ unsigned long cf_get_computed_elapsed(capture_file *cf);
  */
 void cf_redissect_packets(capture_file *cf);
 
+/**
+ * Preferences affecting dissection have been applied; rescan all packets,
+ * redissecting them from scratch only if the preferences could have
+ * affected how any of them were dissected.
+ *
+ * @param cf the capture file
+ */
+void cf_redissect_packets_for_prefs(capture_file *cf);
+
 /**
  * Rescan all packets and just run taps - don't reconstruct the display.
  *
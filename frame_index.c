@@ -0,0 +1,309 @@
+/* frame_index.c
+ * Persistent index of the frames in a capture file
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include <config.h>
+
+#include <errno.h>
+#include <string.h>
+
+#include <glib.h>
+
+#include <epan/packet.h>
+#include <wsutil/file_util.h>
+#include <wsutil/wslog.h>
+
+#include "frame_index.h"
+
+/*
+ * The index is a header followed by one entry per frame.  Both are
+ * written in host byte order; an index written on a host with the other
+ * byte order is simply ignored, as is an index with another version.
+ */
+#define FRAME_INDEX_MAGIC       "WSFRIDX\n"
+#define FRAME_INDEX_BYTE_ORDER  0x01020304
+#define FRAME_INDEX_VERSION     1
+
+/* How much of the start of the capture file is hashed. */
+#define FRAME_INDEX_DIGEST_LEN  (64 * 1024)
+
+typedef struct {
+    char     magic[8];
+    uint32_t byte_order;
+    uint32_t version;
+    /* The capture file this index describes. */
+    uint64_t file_size;
+    int64_t  file_mtime;
+    uint8_t  file_digest[FRAME_INDEX_DIGEST_SIZE];
+    int32_t  file_type_subtype;
+    /* What had been read from the capture file when it was indexed. */
+    uint32_t num_shbs;
+    uint32_t num_idbs;
+    uint32_t num_dsbs;
+    uint32_t has_nrb;
+    uint32_t frame_count;
+    int64_t  elapsed_secs;
+    int32_t  elapsed_nsecs;
+    uint32_t reserved;
+} frame_index_header_t;
+
+#define FRAME_INDEX_FLAG_HAS_TS     0x00000001
+#define FRAME_INDEX_FLAG_EBCDIC     0x00000002
+#define FRAME_INDEX_TSPREC_SHIFT    8
+#define FRAME_INDEX_TSPREC_MASK     0x00000F00
+
+typedef struct {
+    int64_t  file_off;
+    int64_t  ts_secs;
+    int32_t  ts_nsecs;
+    uint32_t pkt_len;
+    uint32_t cap_len;
+    uint32_t cum_bytes;
+    uint32_t frame_ref_num;
+    uint32_t prev_dis_num;
+    uint32_t flags;
+    uint32_t reserved;
+} frame_index_entry_t;
+
+/* Keep entries 8-byte aligned when the index is mapped. */
+G_STATIC_ASSERT(sizeof(frame_index_header_t) % 8 == 0);
+G_STATIC_ASSERT(sizeof(frame_index_entry_t) % 8 == 0);
+
+char *
+frame_index_file_name(const char *cf_name)
+{
+    return ws_strdup_printf("%s%s", cf_name, FRAME_INDEX_SUFFIX);
+}
+
+bool
+frame_index_file_digest(const char *cf_name, uint8_t *digest)
+{
+    GChecksum  *checksum;
+    uint8_t    *data;
+    int         fd;
+    ws_file_ssize_t bytes_read;
+    size_t      digest_len = FRAME_INDEX_DIGEST_SIZE;
+
+    fd = ws_open(cf_name, O_RDONLY | O_BINARY, 0000);
+    if (fd == -1)
+        return false;
+    data = (uint8_t *)g_malloc(FRAME_INDEX_DIGEST_LEN);
+    bytes_read = ws_read(fd, data, FRAME_INDEX_DIGEST_LEN);
+    ws_close(fd);
+    if (bytes_read < 0) {
+        g_free(data);
+        return false;
+    }
+    checksum = g_checksum_new(G_CHECKSUM_SHA256);
+    g_checksum_update(checksum, data, bytes_read);
+    g_checksum_get_digest(checksum, digest, &digest_len);
+    g_checksum_free(checksum);
+    g_free(data);
+    return true;
+}
+
+/*
+ * Fill in the parts of the header that identify the capture file and
+ * describe what has been read from it so far.
+ */
+static bool
+frame_index_describe_file(capture_file *cf, frame_index_header_t *hdr)
+{
+    ws_statb64  statb;
+    wtapng_iface_descriptions_t *idb_info;
+
+    memset(hdr, 0, sizeof *hdr);
+    memcpy(hdr->magic, FRAME_INDEX_MAGIC, sizeof hdr->magic);
+    hdr->byte_order = FRAME_INDEX_BYTE_ORDER;
+    hdr->version = FRAME_INDEX_VERSION;
+
+    if (ws_stat64(cf->filename, &statb) != 0)
+        return false;
+    hdr->file_size = (uint64_t)statb.st_size;
+    hdr->file_mtime = (int64_t)statb.st_mtime;
+
+    if (!frame_index_file_digest(cf->filename, hdr->file_digest))
+        return false;
+
+    hdr->file_type_subtype = wtap_file_type_subtype(cf->provider.wth);
+    hdr->num_shbs = wtap_file_get_num_shbs(cf->provider.wth);
+    idb_info = wtap_file_get_idb_info(cf->provider.wth);
+    hdr->num_idbs = idb_info->interface_data->len;
+    g_free(idb_info);
+    hdr->num_dsbs = wtap_file_get_num_dsbs(cf->provider.wth);
+    hdr->has_nrb = wtap_file_get_nrb(cf->provider.wth) != NULL;
+    return true;
+}
+
+bool
+frame_index_load(capture_file *cf, uint32_t *cum_bytes)
+{
+    char                 *idx_name;
+    GMappedFile          *mapped;
+    const char           *contents;
+    size_t                length;
+    frame_index_header_t  hdr, cur;
+    frame_index_entry_t   entry;
+    frame_data            fdata;
+
+    /*
+     * Random access into a compressed file needs the seek points
+     * gathered by reading it sequentially, so there's nothing to gain.
+     */
+    if (wtap_get_compression_type(cf->provider.wth) != WTAP_UNCOMPRESSED)
+        return false;
+
+    idx_name = frame_index_file_name(cf->filename);
+    mapped = g_mapped_file_new(idx_name, FALSE, NULL);
+    if (mapped == NULL) {
+        g_free(idx_name);
+        return false;
+    }
+    contents = g_mapped_file_get_contents(mapped);
+    length = g_mapped_file_get_length(mapped);
+
+    if (length < sizeof hdr)
+        goto unusable;
+    memcpy(&hdr, contents, sizeof hdr);
+    if (memcmp(hdr.magic, FRAME_INDEX_MAGIC, sizeof hdr.magic) != 0 ||
+            hdr.byte_order != FRAME_INDEX_BYTE_ORDER ||
+            hdr.version != FRAME_INDEX_VERSION)
+        goto unusable;
+    if ((length - sizeof hdr) / sizeof entry != hdr.frame_count ||
+            (length - sizeof hdr) % sizeof entry != 0)
+        goto unusable;
+
+    /*
+     * Is it for this file, unchanged, and has everything that applies
+     * to the frames already been read when opening the file?  If there
+     * are, for example, interfaces or sections that are only found
+     * further on in the file, we must read all of it.
+     */
+    if (!frame_index_describe_file(cf, &cur))
+        goto unusable;
+    if (hdr.file_size != cur.file_size || hdr.file_mtime != cur.file_mtime ||
+            memcmp(hdr.file_digest, cur.file_digest, sizeof hdr.file_digest) != 0 ||
+            hdr.file_type_subtype != cur.file_type_subtype) {
+        ws_debug("Index %s is out of date", idx_name);
+        goto unusable;
+    }
+    if (hdr.num_shbs != cur.num_shbs || hdr.num_idbs != cur.num_idbs ||
+            hdr.num_dsbs != cur.num_dsbs || hdr.has_nrb != cur.has_nrb) {
+        ws_debug("Index %s can't be used; %s has blocks after the first record",
+                idx_name, cf->filename);
+        goto unusable;
+    }
+
+    cf->provider.frames = new_frame_data_sequence();
+    memset(&fdata, 0, sizeof fdata);
+    fdata.passed_dfilter = 1;
+    *cum_bytes = 0;
+    for (uint32_t i = 0; i < hdr.frame_count; i++) {
+        memcpy(&entry, contents + sizeof hdr + i * sizeof entry, sizeof entry);
+        fdata.num = i + 1;
+        fdata.file_off = entry.file_off;
+        fdata.pkt_len = entry.pkt_len;
+        fdata.cap_len = entry.cap_len;
+        fdata.cum_bytes = entry.cum_bytes;
+        fdata.abs_ts.secs = (time_t)entry.ts_secs;
+        fdata.abs_ts.nsecs = entry.ts_nsecs;
+        fdata.has_ts = (entry.flags & FRAME_INDEX_FLAG_HAS_TS) ? 1 : 0;
+        fdata.encoding = (entry.flags & FRAME_INDEX_FLAG_EBCDIC) ?
+            PACKET_CHAR_ENC_CHAR_EBCDIC : PACKET_CHAR_ENC_CHAR_ASCII;
+        fdata.tsprec = (entry.flags & FRAME_INDEX_TSPREC_MASK) >> FRAME_INDEX_TSPREC_SHIFT;
+        fdata.frame_ref_num = entry.frame_ref_num;
+        fdata.prev_dis_num = entry.prev_dis_num;
+        frame_data_sequence_add(cf->provider.frames, &fdata);
+        *cum_bytes = entry.cum_bytes;
+    }
+    cf->count = hdr.frame_count;
+    cf->elapsed_time.secs = (time_t)hdr.elapsed_secs;
+    cf->elapsed_time.nsecs = hdr.elapsed_nsecs;
+
+    ws_debug("Loaded %u frames from index %s", hdr.frame_count, idx_name);
+    g_mapped_file_unref(mapped);
+    g_free(idx_name);
+    return true;
+
+unusable:
+    g_mapped_file_unref(mapped);
+    g_free(idx_name);
+    return false;
+}
+
+bool
+frame_index_save(capture_file *cf)
+{
+    frame_index_header_t  hdr;
+    frame_index_entry_t   entry;
+    frame_data           *fdata;
+    char                 *idx_name, *tmp_name;
+    FILE                 *fh;
+    bool                  ok = true;
+
+    if (cf->provider.frames == NULL ||
+            wtap_get_compression_type(cf->provider.wth) != WTAP_UNCOMPRESSED)
+        return false;
+
+    if (!frame_index_describe_file(cf, &hdr))
+        return false;
+    hdr.frame_count = cf->count;
+    hdr.elapsed_secs = (int64_t)cf->elapsed_time.secs;
+    hdr.elapsed_nsecs = cf->elapsed_time.nsecs;
+
+    /* Write to a temporary file so an interrupted write isn't picked up. */
+    idx_name = frame_index_file_name(cf->filename);
+    tmp_name = ws_strdup_printf("%s.tmp", idx_name);
+    fh = ws_fopen(tmp_name, "wb");
+    if (fh == NULL) {
+        ws_debug("Can't create index %s: %s", tmp_name, g_strerror(errno));
+        g_free(tmp_name);
+        g_free(idx_name);
+        return false;
+    }
+
+    if (fwrite(&hdr, sizeof hdr, 1, fh) != 1)
+        ok = false;
+    memset(&entry, 0, sizeof entry);
+    for (uint32_t framenum = 1; ok && framenum <= cf->count; framenum++) {
+        fdata = frame_data_sequence_find(cf->provider.frames, framenum);
+        entry.file_off = fdata->file_off;
+        entry.ts_secs = (int64_t)fdata->abs_ts.secs;
+        entry.ts_nsecs = fdata->abs_ts.nsecs;
+        entry.pkt_len = fdata->pkt_len;
+        entry.cap_len = fdata->cap_len;
+        entry.cum_bytes = fdata->cum_bytes;
+        entry.frame_ref_num = fdata->frame_ref_num;
+        entry.prev_dis_num = fdata->prev_dis_num;
+        entry.flags = (fdata->tsprec << FRAME_INDEX_TSPREC_SHIFT) & FRAME_INDEX_TSPREC_MASK;
+        if (fdata->has_ts)
+            entry.flags |= FRAME_INDEX_FLAG_HAS_TS;
+        if (fdata->encoding == PACKET_CHAR_ENC_CHAR_EBCDIC)
+            entry.flags |= FRAME_INDEX_FLAG_EBCDIC;
+        if (fwrite(&entry, sizeof entry, 1, fh) != 1)
+            ok = false;
+    }
+    if (fclose(fh) != 0)
+        ok = false;
+
+    if (ok) {
+        /* On Windows, rename() fails if the target exists. */
+        ws_unlink(idx_name);
+        if (ws_rename(tmp_name, idx_name) != 0)
+            ok = false;
+    }
+    if (!ok) {
+        ws_debug("Can't write index %s: %s", idx_name, g_strerror(errno));
+        ws_unlink(tmp_name);
+    }
+
+    g_free(tmp_name);
+    g_free(idx_name);
+    return ok;
+}
@@ -0,0 +1,92 @@
+/** @file
+ *
+ * Persistent index of the frames in a capture file
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef __FRAME_INDEX_H__
+#define __FRAME_INDEX_H__
+
+#include "cfile.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/*
+ * A frame index is a file written next to a capture file, with the
+ * suffix FRAME_INDEX_SUFFIX, holding the frame_data values that are
+ * gathered by the first sequential pass over the file (offsets,
+ * lengths, time stamps, cumulative byte counts and flags).
+ *
+ * When the capture file is opened again, the index is memory-mapped and
+ * used to fill in the frame_data_sequence without reading the capture
+ * file, so that random access with wtap_seek_read() can start right away.
+ * The index is only used if the capture file's size, modification time
+ * and leading bytes match those recorded in the index, and if everything
+ * needed for random access (sections, interfaces, name resolution and
+ * decryption secrets) was already seen when the capture file was opened.
+ *
+ * Loading frames from an index doesn't dissect them; the caller is
+ * responsible for dissecting each frame for the first time in order.
+ */
+
+#define FRAME_INDEX_SUFFIX  ".wsidx"
+
+/* Size of the digest identifying a capture file (SHA-256). */
+#define FRAME_INDEX_DIGEST_SIZE 32
+
+/**
+ * Get the name of the index file for a capture file.
+ *
+ * @param cf_name The name of the capture file.
+ * @return The name of the index file; must be freed with g_free().
+ */
+extern char *frame_index_file_name(const char *cf_name);
+
+/**
+ * Compute the digest of the leading bytes of a capture file, which,
+ * along with its size and modification time, tells whether data derived
+ * from the file is still valid for it.
+ *
+ * @param cf_name The name of the capture file.
+ * @param digest Set to the digest; must hold FRAME_INDEX_DIGEST_SIZE bytes.
+ * @return true on success, false if the file couldn't be read.
+ */
+extern bool frame_index_file_digest(const char *cf_name, uint8_t *digest);
+
+/**
+ * Fill in the frame_data_sequence of a capture file that was just opened,
+ * and not yet read, from its index.
+ *
+ * On success, cf->provider.frames, cf->count and cf->elapsed_time are
+ * set, and *cum_bytes is set to the cumulative byte count of the last frame.
+ *
+ * @param cf The capture file.
+ * @param cum_bytes Set to the cumulative byte count of the last frame.
+ * @return true if the index was usable, false if the capture file must
+ * be read.
+ */
+extern bool frame_index_load(capture_file *cf, uint32_t *cum_bytes);
+
+/**
+ * Write the index of a capture file that has been read completely.
+ *
+ * Failing to write the index is not an error for the caller, as the
+ * index is only an optimization; the failure is logged.
+ *
+ * @param cf The capture file.
+ * @return true if the index was written.
+ */
+extern bool frame_index_save(capture_file *cf);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __FRAME_INDEX_H__ */
@@ -47,6 +47,7 @@
 #include "ui/failure_message.h"
 
 #define LONGOPT_COMPRESS                LONGOPT_BASE_APPLICATION+1
+#define LONGOPT_READ_AHEAD              LONGOPT_BASE_APPLICATION+2
 
 /*
  * Show the usage
@@ -68,6 +69,7 @@ print_usage(FILE *output)
     fprintf(output, "  -I <IDB merge mode> set the merge mode for Interface Description Blocks; default is 'all'.\n");
     fprintf(output, "                    an empty \"-I\" option will list the merge modes.\n");
     fprintf(output, "  --compress <type> compress the output file using the type compression format.\n");
+    fprintf(output, "  --read-ahead      read ahead from the input files on a separate thread.\n");
     fprintf(output, "\n");
     fprintf(output, "Miscellaneous:\n");
     fprintf(output, "  -h, --help        display this help and exit.\n");
@@ -221,6 +223,7 @@ main(int argc, char *argv[])
         {"help", ws_no_argument, NULL, 'h'},
         {"version", ws_no_argument, NULL, 'v'},
         {"compress", ws_required_argument, NULL, LONGOPT_COMPRESS},
+        {"read-ahead", ws_no_argument, NULL, LONGOPT_READ_AHEAD},
         {0, 0, 0, 0 }
     };
     bool                  do_append        = false;
@@ -232,6 +235,7 @@ main(int argc, char *argv[])
     bool                  status           = true;
     idb_merge_mode        mode             = IDB_MERGE_MODE_MAX;
     wtap_compression_type compression_type = WTAP_UNKNOWN_COMPRESSION;
+    bool                  read_ahead       = false;
     merge_progress_callback_t cb;
 
     cmdarg_err_init(mergecap_cmdarg_err, mergecap_cmdarg_err_cont);
@@ -334,6 +338,11 @@ main(int argc, char *argv[])
                     goto clean_exit;
                 }
                 break;
+
+            case LONGOPT_READ_AHEAD:
+                read_ahead = true;
+                break;
+
             case '?':              /* Bad options if GNU getopt */
                 switch(ws_optopt) {
                     case'F':
@@ -421,7 +430,13 @@ main(int argc, char *argv[])
     }
 
     /* open the outfile */
-    if (strcmp(out_filename, "-") == 0) {
+    if (read_ahead) {
+        /* merge the files, reading ahead from them on another thread */
+        status = merge_files_read_ahead(strcmp(out_filename, "-") == 0 ? NULL : out_filename,
+                file_type, (const char *const *) &argv[ws_optind], in_file_count,
+                do_append, mode, snaplen, get_appname_and_version(),
+                verbose ? &cb : NULL, compression_type, true);
+    } else if (strcmp(out_filename, "-") == 0) {
         /* merge the files to the standard output */
         status = merge_files_to_stdout(file_type,
                 (const char *const *) &argv[ws_optind],
@@ -11,6 +11,7 @@
 #include <config.h>
 #define WS_LOG_DOMAIN  LOG_DOMAIN_MAIN
 
+#include <errno.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -21,9 +22,11 @@
 
 #include <wiretap/wtap.h>
 
+#include <wsutil/clopts_common.h>
 #include <wsutil/cmdarg_err.h>
 #include <wsutil/filesystem.h>
 #include <wsutil/file_util.h>
+#include <wsutil/glib-compat.h>
 #include <wsutil/privileges.h>
 #include <cli_main.h>
 #include <wsutil/version_info.h>
@@ -41,6 +44,13 @@
 /* Additional exit codes */
 #define OUTPUT_FILE_ERROR 1
 
+#define LONGOPT_WINDOW                  LONGOPT_BASE_APPLICATION+1
+#define LONGOPT_MEMORY_LIMIT            LONGOPT_BASE_APPLICATION+2
+#define LONGOPT_TEMP_DIR                LONGOPT_BASE_APPLICATION+3
+
+/* Memory for the late frames of --window, unless --memory-limit is given */
+#define WINDOW_LATE_MEMORY_LIMIT        64
+
 /* Show command-line usage */
 static void
 print_usage(FILE *output)
@@ -50,6 +60,16 @@ print_usage(FILE *output)
     fprintf(output, "\n");
     fprintf(output, "Options:\n");
     fprintf(output, "  -n                don't write to output file if the input file is ordered.\n");
+    fprintf(output, "  --window <frames> reorder in a single pass, holding at most <frames> frames\n");
+    fprintf(output, "                    in memory; frames further out of place are merged in\n");
+    fprintf(output, "                    at the end.\n");
+    fprintf(output, "  --memory-limit <MiB>\n");
+    fprintf(output, "                    sort runs of at most <MiB> mebibytes of frames in memory,\n");
+    fprintf(output, "                    write them to temporary files and merge them; with\n");
+    fprintf(output, "                    --window, only for the frames further out of place.\n");
+    fprintf(output, "  --temp-dir <directory>\n");
+    fprintf(output, "                    write the temporary files to\n");
+    fprintf(output, "                    <directory> rather than the system temporary directory.\n");
     fprintf(output, "  -h, --help        display this help and exit.\n");
     fprintf(output, "  -v, --version     print version information and exit.\n");
 }
@@ -132,6 +152,733 @@ frames_compare(const void *a, const void *b)
     return nstime_cmp(time1, time2);
 }
 
+/*
+ * A frame held in memory, rather than re-read from the input file, for
+ * --window and --memory-limit.
+ */
+typedef struct BufferedFrame_t {
+    wtap_rec     rec;
+    uint8_t     *data;
+    unsigned     num;
+
+    nstime_t     frame_time;
+} BufferedFrame_t;
+
+/* Length of the data of a record, as wtap_dump() will write it */
+static uint32_t
+rec_data_length(const wtap_rec *rec)
+{
+    switch (rec->rec_type) {
+
+    case REC_TYPE_PACKET:
+        return rec->rec_header.packet_header.caplen;
+
+    case REC_TYPE_FT_SPECIFIC_EVENT:
+    case REC_TYPE_FT_SPECIFIC_REPORT:
+        return rec->rec_header.ft_specific_header.record_len;
+
+    case REC_TYPE_SYSCALL:
+        return rec->rec_header.syscall_header.event_filelen;
+
+    case REC_TYPE_SYSTEMD_JOURNAL_EXPORT:
+        return rec->rec_header.systemd_journal_export_header.record_len;
+
+    case REC_TYPE_CUSTOM_BLOCK:
+        return rec->rec_header.custom_block_header.length;
+
+    default:
+        return 0;
+    }
+}
+
+/*
+ * Take the record just read into rec and buf.  rec is left without a
+ * block, ready to be reset and read into again.
+ */
+static BufferedFrame_t *
+buffered_frame_new(wtap_rec *rec, Buffer *buf, unsigned num, size_t *size)
+{
+    BufferedFrame_t *frame;
+    uint32_t length = rec_data_length(rec);
+
+    frame = g_new(BufferedFrame_t, 1);
+    frame->rec = *rec;
+    /*
+     * The record's options_buf stays with rec; nothing puts anything in
+     * it, and giving each frame its own would cost more than the frame.
+     */
+    memset(&frame->rec.options_buf, 0, sizeof frame->rec.options_buf);
+    rec->block = NULL;
+    rec->block_was_modified = false;
+    frame->data = (uint8_t *)g_memdup2(ws_buffer_start_ptr(buf), length);
+    frame->num = num;
+    if (rec->presence_flags & WTAP_HAS_TS) {
+        frame->frame_time = rec->ts;
+    } else {
+        nstime_set_unset(&frame->frame_time);
+    }
+
+    *size = sizeof *frame + length;
+    return frame;
+}
+
+static void
+buffered_frame_free(BufferedFrame_t *frame)
+{
+    wtap_block_unref(frame->rec.block);
+    g_free(frame->data);
+    g_free(frame);
+}
+
+/* Order frames by timestamp, and frames with the same timestamp as
+   they were in the input file. */
+static int
+buffered_frames_compare(const void *a, const void *b)
+{
+    const BufferedFrame_t *frame1 = *(const BufferedFrame_t *const *) a;
+    const BufferedFrame_t *frame2 = *(const BufferedFrame_t *const *) b;
+    int cmp;
+
+    cmp = nstime_cmp(&frame1->frame_time, &frame2->frame_time);
+    if (cmp != 0)
+        return cmp;
+    return (frame1->num > frame2->num) - (frame1->num < frame2->num);
+}
+
+/*
+ * A binary min-heap, in a GPtrArray, of items compared with a
+ * GCompareFunc that gets pointers to the items, as for g_ptr_array_sort().
+ */
+static void
+heap_sift_down(GPtrArray *heap, unsigned i, GCompareFunc compare)
+{
+    for (;;) {
+        unsigned smallest = i;
+        unsigned child = 2 * i + 1;
+        void *tmp;
+
+        if (child < heap->len &&
+            compare(&heap->pdata[child], &heap->pdata[smallest]) < 0)
+            smallest = child;
+        child++;
+        if (child < heap->len &&
+            compare(&heap->pdata[child], &heap->pdata[smallest]) < 0)
+            smallest = child;
+        if (smallest == i)
+            break;
+        tmp = heap->pdata[i];
+        heap->pdata[i] = heap->pdata[smallest];
+        heap->pdata[smallest] = tmp;
+        i = smallest;
+    }
+}
+
+static void
+heap_push(GPtrArray *heap, void *item, GCompareFunc compare)
+{
+    unsigned i = heap->len;
+
+    g_ptr_array_add(heap, item);
+    while (i > 0) {
+        unsigned parent = (i - 1) / 2;
+        void *tmp;
+
+        if (compare(&heap->pdata[i], &heap->pdata[parent]) >= 0)
+            break;
+        tmp = heap->pdata[i];
+        heap->pdata[i] = heap->pdata[parent];
+        heap->pdata[parent] = tmp;
+        i = parent;
+    }
+}
+
+static void *
+heap_pop(GPtrArray *heap, GCompareFunc compare)
+{
+    void *top = heap->pdata[0];
+
+    heap->pdata[0] = heap->pdata[heap->len - 1];
+    g_ptr_array_set_size(heap, heap->len - 1);
+    heap_sift_down(heap, 0, compare);
+    return top;
+}
+
+static void
+rec_write(wtap_dumper *pdh, wtap_rec *rec, const uint8_t *data, unsigned num,
+          wtap *wth, const char *infile, const char *outfile)
+{
+    int    err;
+    char   *err_info;
+
+    if (!wtap_dump(pdh, rec, data, &err, &err_info)) {
+        cfile_write_failure_message(infile, outfile, err, err_info, num,
+                                    wtap_file_type_subtype(wth));
+        exit(1);
+    }
+}
+
+static wtap_dumper *
+output_open(const char *outfile, wtap *wth, wtap_dump_params *params)
+{
+    wtap_dumper *pdh;
+    int err;
+    char *err_info;
+
+    /* Open outfile (same filetype/encap as input file) */
+    if (strcmp(outfile, "-") == 0) {
+        pdh = wtap_dump_open_stdout(wtap_file_type_subtype(wth),
+                                    WTAP_UNCOMPRESSED, params, &err, &err_info);
+    } else {
+        pdh = wtap_dump_open(outfile, wtap_file_type_subtype(wth),
+                             WTAP_UNCOMPRESSED, params, &err, &err_info);
+    }
+    if (pdh == NULL) {
+        cfile_dump_open_failure_message(outfile, err, err_info,
+                                        wtap_file_type_subtype(wth));
+    }
+    return pdh;
+}
+
+static bool
+output_close(wtap_dumper *pdh, const char *outfile)
+{
+    int err;
+    char *err_info;
+
+    if (!wtap_dump_close(pdh, NULL, &err, &err_info)) {
+        cfile_close_failure_message(outfile, err, err_info);
+        return false;
+    }
+    return true;
+}
+
+/*
+ * Add any IDBs read since this was last called to the output file,
+ * if it has IDBs.
+ */
+static void
+output_add_new_idbs(wtap *wth, wtap_dumper *pdh, const char *outfile)
+{
+    wtap_block_t if_data;
+    int err;
+    char *err_info;
+
+    while ((if_data = wtap_get_next_interface_description(wth)) != NULL) {
+        if (wtap_file_type_subtype_supports_block(wtap_dump_file_type_subtype(pdh),
+                                                  WTAP_BLOCK_IF_ID_AND_INFO) == BLOCK_NOT_SUPPORTED)
+            continue;
+        if (!wtap_dump_add_idb(pdh, if_data, &err, &err_info)) {
+            cfile_write_failure_message(NULL, outfile, err, err_info, 0,
+                                        wtap_dump_file_type_subtype(pdh));
+            exit(1);
+        }
+    }
+}
+
+/*
+ * A sorted run of frames for --memory-limit, or of the late frames for
+ * --window, either in a temporary file or, for the last run, still in
+ * memory.
+ */
+typedef struct ReorderRun_t {
+    unsigned     index;
+    char        *filename;
+    wtap        *wth;
+    wtap_rec     rec;
+    Buffer       buf;
+    GPtrArray   *frames;
+    unsigned     next_frame;
+
+    /* The run's current frame */
+    wtap_rec    *cur_rec;
+    uint8_t     *cur_data;
+    nstime_t     cur_time;
+} ReorderRun_t;
+
+/*
+ * The names of the temporary files of runs that haven't been freed
+ * yet, so that they're removed even if we exit on an error.
+ */
+static GPtrArray *run_filenames;
+
+static void
+run_files_remove(void)
+{
+    unsigned i;
+
+    if (run_filenames == NULL)
+        return;
+    for (i = 0; i < run_filenames->len; i++) {
+        ws_unlink((const char *)run_filenames->pdata[i]);
+    }
+    g_ptr_array_set_size(run_filenames, 0);
+}
+
+/* Order runs by the timestamp of their current frames, and runs
+   with frames with the same timestamp by the order of the runs. */
+static int
+runs_compare(const void *a, const void *b)
+{
+    const ReorderRun_t *run1 = *(const ReorderRun_t *const *) a;
+    const ReorderRun_t *run2 = *(const ReorderRun_t *const *) b;
+    int cmp;
+
+    cmp = nstime_cmp(&run1->cur_time, &run2->cur_time);
+    if (cmp != 0)
+        return cmp;
+    return (run1->index > run2->index) - (run1->index < run2->index);
+}
+
+/* Sort frames and write them to a new temporary file */
+static ReorderRun_t *
+run_write(wtap *wth, GPtrArray *frames, unsigned index, const char *tmpdir,
+          const char *infile)
+{
+    ReorderRun_t *run;
+    wtap_dump_params params;
+    wtap_dumper *pdh;
+    int err;
+    char *err_info;
+    unsigned i;
+
+    g_ptr_array_sort(frames, buffered_frames_compare);
+
+    /* Name resolution, secrets and so on are written to the output file. */
+    wtap_dump_params_init(&params, wth);
+    wtap_dump_params_discard_name_resolution(&params);
+    wtap_dump_params_discard_decryption_secrets(&params);
+    wtap_dump_params_discard_meta_events(&params);
+
+    run = g_new0(ReorderRun_t, 1);
+    run->index = index;
+    pdh = wtap_dump_open_tempfile(tmpdir, &run->filename, "reordercap",
+                                  wtap_file_type_subtype(wth), WTAP_UNCOMPRESSED,
+                                  &params, &err, &err_info);
+    g_free(params.idb_inf);
+    params.idb_inf = NULL;
+    wtap_dump_params_cleanup(&params);
+    if (run->filename != NULL)
+        g_ptr_array_add(run_filenames, run->filename);
+    if (pdh == NULL) {
+        cfile_dump_open_failure_message(run->filename != NULL ? run->filename : "temporary file",
+                                        err, err_info, wtap_file_type_subtype(wth));
+        exit(1);
+    }
+
+    for (i = 0; i < frames->len; i++) {
+        BufferedFrame_t *frame = (BufferedFrame_t *)frames->pdata[i];
+
+        rec_write(pdh, &frame->rec, frame->data, frame->num, wth, infile, run->filename);
+        buffered_frame_free(frame);
+    }
+    g_ptr_array_set_size(frames, 0);
+
+    if (!output_close(pdh, run->filename))
+        exit(1);
+
+    DEBUG_PRINT("Wrote run %u to %s\n", index, run->filename);
+    return run;
+}
+
+/* Make the next frame of a run its current frame, if it has one */
+static bool
+run_next(ReorderRun_t *run)
+{
+    int err;
+    char *err_info;
+    int64_t data_offset;
+
+    if (run->wth == NULL) {
+        BufferedFrame_t *frame;
+
+        if (run->next_frame == run->frames->len)
+            return false;
+        frame = (BufferedFrame_t *)run->frames->pdata[run->next_frame++];
+        run->cur_rec = &frame->rec;
+        run->cur_data = frame->data;
+        run->cur_time = frame->frame_time;
+        return true;
+    }
+
+    wtap_rec_reset(&run->rec);
+    if (!wtap_read(run->wth, &run->rec, &run->buf, &err, &err_info, &data_offset)) {
+        if (err != 0) {
+            cfile_read_failure_message(run->filename, err, err_info);
+            exit(1);
+        }
+        return false;
+    }
+    run->cur_rec = &run->rec;
+    run->cur_data = ws_buffer_start_ptr(&run->buf);
+    if (run->rec.presence_flags & WTAP_HAS_TS) {
+        run->cur_time = run->rec.ts;
+    } else {
+        nstime_set_unset(&run->cur_time);
+    }
+    return true;
+}
+
+static void
+run_free(ReorderRun_t *run)
+{
+    unsigned i;
+
+    if (run->wth != NULL) {
+        wtap_close(run->wth);
+        wtap_rec_cleanup(&run->rec);
+        ws_buffer_free(&run->buf);
+    }
+    if (run->filename != NULL) {
+        ws_unlink(run->filename);
+        g_ptr_array_remove_fast(run_filenames, run->filename);
+        g_free(run->filename);
+    }
+    if (run->frames != NULL) {
+        for (i = 0; i < run->frames->len; i++) {
+            buffered_frame_free((BufferedFrame_t *)run->frames->pdata[i]);
+        }
+        g_ptr_array_free(run->frames, TRUE);
+    }
+    g_free(run);
+}
+
+/* Merge the frames of the runs into the output file. */
+static void
+runs_merge(wtap_dumper *pdh, GPtrArray *runs, wtap *wth, const char *infile,
+           const char *outfile)
+{
+    GPtrArray *heap;
+    unsigned frame_count = 0;
+    int err;
+    char *err_info;
+    unsigned i;
+
+    heap = g_ptr_array_sized_new(runs->len);
+    for (i = 0; i < runs->len; i++) {
+        ReorderRun_t *run = (ReorderRun_t *)runs->pdata[i];
+
+        if (run->filename != NULL) {
+            run->wth = wtap_open_offline(run->filename, WTAP_TYPE_AUTO, &err, &err_info, false);
+            if (run->wth == NULL) {
+                cfile_open_failure_message(run->filename, err, err_info);
+                exit(1);
+            }
+            wtap_rec_init(&run->rec);
+            ws_buffer_init(&run->buf, 1514);
+        }
+        if (run_next(run))
+            heap_push(heap, run, runs_compare);
+    }
+    while (heap->len > 0) {
+        ReorderRun_t *run = (ReorderRun_t *)heap->pdata[0];
+
+        rec_write(pdh, run->cur_rec, run->cur_data, ++frame_count, wth, infile, outfile);
+        if (run_next(run)) {
+            heap_sift_down(heap, 0, runs_compare);
+        } else {
+            heap_pop(heap, runs_compare);
+        }
+    }
+    g_ptr_array_free(heap, TRUE);
+}
+
+/*
+ * Make sure the temporary files of runs don't outlive us, even though
+ * the error paths for the runs exit().
+ */
+static void
+run_files_init(void)
+{
+    if (run_filenames == NULL) {
+        run_filenames = g_ptr_array_new();
+        atexit(run_files_remove);
+    }
+}
+
+/*
+ * Reorder with an external merge sort: read frames until they take up
+ * memory_limit bytes, sort them and write them to a temporary file,
+ * and repeat; then merge the sorted runs, and the frames still in
+ * memory, into the output file.  Frames are only read sequentially,
+ * so this works with input that can't be seeked, such as a pipe.
+ */
+static int
+reorder_external(wtap *wth, const char *infile, const char *outfile,
+                 size_t memory_limit, const char *tmpdir,
+                 bool write_output_regardless)
+{
+    wtap_dump_params params;
+    wtap_dumper *pdh = NULL;
+    wtap_rec rec;
+    Buffer buf;
+    int err;
+    char *err_info;
+    int64_t data_offset;
+    GPtrArray *frames;
+    GPtrArray *runs;
+    size_t memory_used = 0;
+    unsigned frame_count = 0;
+    unsigned wrong_order_count = 0;
+    nstime_t prev_time;
+    unsigned i;
+    int ret = EXIT_SUCCESS;
+
+    frames = g_ptr_array_new();
+    runs = g_ptr_array_new();
+    nstime_set_unset(&prev_time);
+
+    run_files_init();
+
+    wtap_rec_init(&rec);
+    ws_buffer_init(&buf, 1514);
+    while (wtap_read(wth, &rec, &buf, &err, &err_info, &data_offset)) {
+        BufferedFrame_t *frame;
+        size_t size;
+
+        frame = buffered_frame_new(&rec, &buf, ++frame_count, &size);
+        if (frame_count > 1 && nstime_cmp(&frame->frame_time, &prev_time) < 0) {
+            wrong_order_count++;
+        }
+        prev_time = frame->frame_time;
+        g_ptr_array_add(frames, frame);
+        wtap_rec_reset(&rec);
+
+        memory_used += size + sizeof (void *);
+        if (memory_used >= memory_limit) {
+            g_ptr_array_add(runs, run_write(wth, frames, runs->len, tmpdir, infile));
+            memory_used = 0;
+        }
+    }
+    wtap_rec_cleanup(&rec);
+    ws_buffer_free(&buf);
+    if (err != 0) {
+      /* Print a message noting that the read failed somewhere along the line. */
+      cfile_read_failure_message(infile, err, err_info);
+    }
+
+    printf("%u frames, %u out of order\n", frame_count, wrong_order_count);
+
+    /* The frames still in memory are the last run. */
+    if (frames->len > 0) {
+        ReorderRun_t *run = g_new0(ReorderRun_t, 1);
+
+        g_ptr_array_sort(frames, buffered_frames_compare);
+        run->index = runs->len;
+        run->frames = frames;
+        g_ptr_array_add(runs, run);
+    } else {
+        g_ptr_array_free(frames, TRUE);
+    }
+
+    /* Avoid writing if already sorted and configured to */
+    if (!write_output_regardless && wrong_order_count == 0) {
+        printf("Not writing output file because input file is already in order.\n");
+        goto cleanup;
+    }
+
+    wtap_dump_params_init(&params, wth);
+    pdh = output_open(outfile, wth, &params);
+    g_free(params.idb_inf);
+    params.idb_inf = NULL;
+    if (pdh == NULL) {
+        wtap_dump_params_cleanup(&params);
+        ret = OUTPUT_FILE_ERROR;
+        goto cleanup;
+    }
+
+    runs_merge(pdh, runs, wth, infile, outfile);
+
+    if (!output_close(pdh, outfile))
+        ret = OUTPUT_FILE_ERROR;
+    wtap_dump_params_cleanup(&params);
+
+cleanup:
+    for (i = 0; i < runs->len; i++) {
+        run_free((ReorderRun_t *)runs->pdata[i]);
+    }
+    g_ptr_array_free(runs, TRUE);
+    return ret;
+}
+
+/*
+ * Reorder in a single pass, holding the last window_size frames read
+ * in a heap and writing out the earliest one when another is read.
+ * That puts in order any frame that's no more than window_size frames
+ * from where it should be, which is often all of them.  Frames that
+ * come out of the heap too late to be written in order are kept in
+ * runs, written to temporary files when they take up more than
+ * memory_limit bytes, and merged with the output file at the end.
+ */
+static int
+reorder_window(wtap *wth, const char *infile, const char *outfile,
+               unsigned window_size, size_t memory_limit, const char *tmpdir)
+{
+    wtap_dump_params params;
+    wtap_dumper *pdh;
+    wtap_rec rec;
+    Buffer buf;
+    int err;
+    char *err_info;
+    int64_t data_offset;
+    GPtrArray *heap;
+    GPtrArray *late_frames;
+    GPtrArray *runs;
+    size_t late_memory_used = 0;
+    unsigned frame_count = 0;
+    unsigned wrong_order_count = 0;
+    unsigned late_count = 0;
+    bool end_of_input = false;
+    nstime_t prev_time;
+    nstime_t last_written_time;
+    unsigned i;
+    int ret = EXIT_SUCCESS;
+
+    /* IDBs are added as they're read. */
+    wtap_dump_params_init_no_idbs(&params, wth);
+    pdh = output_open(outfile, wth, &params);
+    g_free(params.idb_inf);
+    params.idb_inf = NULL;
+    wtap_dump_params_cleanup(&params);
+    if (pdh == NULL) {
+        return OUTPUT_FILE_ERROR;
+    }
+    output_add_new_idbs(wth, pdh, outfile);
+
+    run_files_init();
+    heap = g_ptr_array_sized_new(window_size + 1);
+    late_frames = g_ptr_array_new();
+    runs = g_ptr_array_new();
+    nstime_set_unset(&prev_time);
+    nstime_set_unset(&last_written_time);
+
+    wtap_rec_init(&rec);
+    ws_buffer_init(&buf, 1514);
+    err = 0;
+    err_info = NULL;
+    for (;;) {
+        BufferedFrame_t *frame;
+        size_t size;
+
+        if (!end_of_input &&
+            wtap_read(wth, &rec, &buf, &err, &err_info, &data_offset)) {
+            output_add_new_idbs(wth, pdh, outfile);
+
+            frame = buffered_frame_new(&rec, &buf, ++frame_count, &size);
+            if (frame_count > 1 && nstime_cmp(&frame->frame_time, &prev_time) < 0) {
+                wrong_order_count++;
+            }
+            prev_time = frame->frame_time;
+            heap_push(heap, frame, buffered_frames_compare);
+            wtap_rec_reset(&rec);
+
+            if (heap->len <= window_size)
+                continue;
+        } else {
+            end_of_input = true;
+            if (heap->len == 0)
+                break;
+        }
+
+        /* Write out the earliest frame we have, unless it's too late. */
+        frame = (BufferedFrame_t *)heap_pop(heap, buffered_frames_compare);
+        if (nstime_cmp(&frame->frame_time, &last_written_time) < 0) {
+            late_count++;
+            g_ptr_array_add(late_frames, frame);
+            late_memory_used += sizeof *frame + rec_data_length(&frame->rec) + sizeof (void *);
+            if (late_memory_used >= memory_limit) {
+                /* Run 0 is the output file. */
+                g_ptr_array_add(runs, run_write(wth, late_frames, runs->len + 1, tmpdir, infile));
+                late_memory_used = 0;
+            }
+            continue;
+        }
+        last_written_time = frame->frame_time;
+        rec_write(pdh, &frame->rec, frame->data, frame->num, wth, infile, outfile);
+        buffered_frame_free(frame);
+    }
+    wtap_rec_cleanup(&rec);
+    ws_buffer_free(&buf);
+    g_ptr_array_free(heap, TRUE);
+    if (err != 0) {
+        /* Print a message noting that the read failed somewhere along the line. */
+        cfile_read_failure_message(infile, err, err_info);
+    }
+
+    printf("%u frames, %u out of order\n", frame_count, wrong_order_count);
+
+    /* The late frames still in memory are the last run. */
+    if (late_frames->len > 0) {
+        ReorderRun_t *run = g_new0(ReorderRun_t, 1);
+
+        g_ptr_array_sort(late_frames, buffered_frames_compare);
+        run->index = runs->len + 1;
+        run->frames = late_frames;
+        g_ptr_array_add(runs, run);
+    } else {
+        g_ptr_array_free(late_frames, TRUE);
+    }
+
+    if (runs->len == 0) {
+        if (!output_close(pdh, outfile))
+            ret = OUTPUT_FILE_ERROR;
+    } else if (strcmp(outfile, "-") == 0) {
+        /* We can't read back what we wrote; the late frames go at the end. */
+        runs_merge(pdh, runs, wth, infile, outfile);
+        if (!output_close(pdh, outfile))
+            ret = OUTPUT_FILE_ERROR;
+        printf("%u frames were more than %u frames out of place, and are still out of order.\n",
+               late_count, window_size);
+    } else {
+        /*
+         * Move what we wrote out of the way, and merge it with the late
+         * frames into a new output file.  The frames in it come before
+         * any late frames with the same timestamp in the input file.
+         */
+        ReorderRun_t *run;
+
+        if (!output_close(pdh, outfile)) {
+            ret = OUTPUT_FILE_ERROR;
+            goto cleanup;
+        }
+        run = g_new0(ReorderRun_t, 1);
+        run->index = 0;
+        run->filename = g_strdup_printf("%s.unsorted", outfile);
+        if (ws_rename(outfile, run->filename) != 0) {
+            cmdarg_err("Can't rename \"%s\" to \"%s\": %s.",
+                       outfile, run->filename, g_strerror(errno));
+            g_free(run->filename);
+            g_free(run);
+            ret = OUTPUT_FILE_ERROR;
+            goto cleanup;
+        }
+        g_ptr_array_add(run_filenames, run->filename);
+        g_ptr_array_add(runs, run);
+
+        wtap_dump_params_init(&params, wth);
+        pdh = output_open(outfile, wth, &params);
+        g_free(params.idb_inf);
+        params.idb_inf = NULL;
+        if (pdh == NULL) {
+            wtap_dump_params_cleanup(&params);
+            ret = OUTPUT_FILE_ERROR;
+            goto cleanup;
+        }
+        runs_merge(pdh, runs, wth, infile, outfile);
+        if (!output_close(pdh, outfile))
+            ret = OUTPUT_FILE_ERROR;
+        wtap_dump_params_cleanup(&params);
+        printf("%u frames were more than %u frames out of place, and were merged in.\n",
+               late_count, window_size);
+    }
+
+cleanup:
+    for (i = 0; i < runs->len; i++) {
+        run_free((ReorderRun_t *)runs->pdata[i]);
+    }
+    g_ptr_array_free(runs, TRUE);
+    return ret;
+}
+
 /*
  * General errors and warnings are reported with an console message
  * in reordercap.
@@ -185,6 +932,9 @@ main(int argc, char *argv[])
     unsigned i;
     wtap_dump_params params;
     int                          ret = EXIT_SUCCESS;
+    unsigned window_size = 0;
+    uint32_t memory_limit = 0;
+    const char *tmpdir = NULL;
 
     GPtrArray *frames;
     FrameRecord_t *prevFrame = NULL;
@@ -193,6 +943,9 @@ main(int argc, char *argv[])
     static const struct ws_option long_options[] = {
         {"help", ws_no_argument, NULL, 'h'},
         {"version", ws_no_argument, NULL, 'v'},
+        {"window", ws_required_argument, NULL, LONGOPT_WINDOW},
+        {"memory-limit", ws_required_argument, NULL, LONGOPT_MEMORY_LIMIT},
+        {"temp-dir", ws_required_argument, NULL, LONGOPT_TEMP_DIR},
         {0, 0, 0, 0 }
     };
     int file_count;
@@ -246,6 +999,15 @@ main(int argc, char *argv[])
             case 'v':
                 show_version();
                 goto clean_exit;
+            case LONGOPT_WINDOW:
+                window_size = get_nonzero_uint32(ws_optarg, "window size");
+                break;
+            case LONGOPT_MEMORY_LIMIT:
+                memory_limit = get_nonzero_uint32(ws_optarg, "memory limit");
+                break;
+            case LONGOPT_TEMP_DIR:
+                tmpdir = ws_optarg;
+                break;
             case '?':
                 print_usage(stderr);
                 ret = WS_EXIT_INVALID_OPTION;
@@ -265,10 +1027,20 @@ main(int argc, char *argv[])
         goto clean_exit;
     }
 
+    if (window_size > 0 && !write_output_regardless) {
+        /* The output file is written while the input file is read. */
+        cmdarg_err("-n can't be used with --window.");
+        ret = WS_EXIT_INVALID_OPTION;
+        goto clean_exit;
+    }
+
     /* Open infile */
     /* TODO: if reordercap is ever changed to give the user a choice of which
        open_routine reader to use, then the following needs to change. */
-    wth = wtap_open_offline(infile, WTAP_TYPE_AUTO, &err, &err_info, true);
+    /* --window and --memory-limit only read the input file sequentially,
+       so it can be a pipe or the standard input. */
+    wth = wtap_open_offline(infile, WTAP_TYPE_AUTO, &err, &err_info,
+                            window_size == 0 && memory_limit == 0);
     if (wth == NULL) {
         cfile_open_failure_message(infile, err, err_info);
         ret = WS_EXIT_OPEN_ERROR;
@@ -276,6 +1048,20 @@ main(int argc, char *argv[])
     }
     DEBUG_PRINT("file_type_subtype is %d\n", wtap_file_type_subtype(wth));
 
+    if (window_size > 0 || memory_limit > 0) {
+        if (window_size > 0) {
+            ret = reorder_window(wth, infile, outfile, window_size,
+                                 (size_t)(memory_limit > 0 ? memory_limit : WINDOW_LATE_MEMORY_LIMIT) * 1024 * 1024,
+                                 tmpdir);
+        } else {
+            ret = reorder_external(wth, infile, outfile,
+                                   (size_t)memory_limit * 1024 * 1024, tmpdir,
+                                   write_output_regardless);
+        }
+        wtap_close(wth);
+        goto clean_exit;
+    }
+
     /* Allocate the array of frame pointers. */
     frames = g_ptr_array_new();
 
@@ -85,11 +85,12 @@ typedef struct _ringbuf_data {
     bool          unlimited;           /**< true if unlimited number of files */
 
     int           fd;                  /**< Current ringbuffer file descriptor */
-    FILE         *pdh;
-    char         *io_buffer;              /**< The IO buffer used to write to the file */
+    pcapio_stream *pdh;
     bool          group_read_access;   /**< true if files need to be opened with group read access */
     FILE         *name_h;              /**< write names of completed files to this handle */
     char         *compress_type;       /**< compress type */
+    ws_parallel_compression_t write_compression_type; /**< compression to write the files with */
+    unsigned      write_compress_threads; /**< threads to compress with while writing, or 0 */
 
     GMutex        mutex;               /**< mutex for oldnames */
     char         *oldnames[MAX_FILENAME_QUEUE];       /**< filename list of pending to be deleted */
@@ -278,11 +279,14 @@ ringbuf_open_file(rb_file *rfile, int *err)
  */
 int
 ringbuf_init(const char *capfile_name, unsigned num_files, bool group_read_access,
-        char *compress_type, bool has_nametimenum)
+        char *compress_type, ws_parallel_compression_t write_compression_type,
+        unsigned write_compress_threads, bool has_nametimenum)
 {
     unsigned int i;
     char        *pfx;
     char        *dir_name, *base_name;
+    char        *capfile_base;
+    char        *compress_suffix = NULL;
 
     rb_data.files = NULL;
     rb_data.curr_file_num = 0;
@@ -292,10 +296,11 @@ ringbuf_init(const char *capfile_name, unsigned num_files, bool group_read_acces
     rb_data.unlimited = false;
     rb_data.fd = -1;
     rb_data.pdh = NULL;
-    rb_data.io_buffer = NULL;
     rb_data.group_read_access = group_read_access;
     rb_data.name_h = NULL;
     rb_data.compress_type = compress_type;
+    rb_data.write_compression_type = write_compression_type;
+    rb_data.write_compress_threads = write_compress_threads;
     g_mutex_init(&rb_data.mutex);
 
     /* just to be sure ... */
@@ -313,8 +318,19 @@ ringbuf_init(const char *capfile_name, unsigned num_files, bool group_read_acces
 
     /* set file name prefix/suffix */
 
-    base_name = g_path_get_basename(capfile_name);
-    dir_name = g_path_get_dirname(capfile_name);
+    capfile_base = g_strdup(capfile_name);
+    if (write_compress_threads != 0) {
+        /* The files are written compressed; keep the compression suffix
+           at the very end of their names, e.g. "foo_00001_....pcapng.zst"
+           rather than "foo.pcapng_00001_....zst", adding it if the name
+           doesn't have it. */
+        compress_suffix = g_strconcat(".", ws_parallel_writer_extension(write_compression_type), NULL);
+        if (g_str_has_suffix(capfile_base, compress_suffix)) {
+            capfile_base[strlen(capfile_base) - strlen(compress_suffix)] = '\0';
+        }
+    }
+    base_name = g_path_get_basename(capfile_base);
+    dir_name = g_path_get_dirname(capfile_base);
     pfx = strrchr(base_name, '.');
     if (pfx != NULL) {
         /* The basename has a "." in it.
@@ -322,22 +338,20 @@ ringbuf_init(const char *capfile_name, unsigned num_files, bool group_read_acces
            Treat it as a separator between the rest of the file name and
            the file name suffix, and arrange that the names given to the
            ring buffer files have the specified suffix, i.e. put the
-           changing part of the name *before* the suffix.
-
-           XXX - If we ever handle writing compressed files directly
-           (#19159) make sure we deal with any compression suffix
-           appropriately. */
+           changing part of the name *before* the suffix. */
         pfx[0] = '\0';
         rb_data.fprefix = g_build_filename(dir_name, base_name, NULL);
         pfx[0] = '.'; /* restore capfile_name */
-        rb_data.fsuffix = g_strdup(pfx);
+        rb_data.fsuffix = g_strconcat(pfx, compress_suffix, NULL);
     } else {
         /* The last component has no suffix. */
-        rb_data.fprefix = g_strdup(capfile_name);
-        rb_data.fsuffix = NULL;
+        rb_data.fprefix = g_strdup(capfile_base);
+        rb_data.fsuffix = g_strdup(compress_suffix);
     }
     g_free(dir_name);
     g_free(base_name);
+    g_free(capfile_base);
+    g_free(compress_suffix);
 
     /* allocate rb_file structures (only one if unlimited since there is no
        need to save all file names in that case) */
@@ -411,30 +425,21 @@ ringbuf_current_filename(void)
 }
 
 /*
- * Calls ws_fdopen() for the current ringbuffer file
+ * Starts writing the current ringbuffer file
  */
-FILE *
+pcapio_stream *
 ringbuf_init_libpcap_fdopen(int *err)
 {
-    rb_data.pdh = ws_fdopen(rb_data.fd, "wb");
-    if (rb_data.pdh == NULL) {
-        if (err != NULL) {
-            *err = errno;
-        }
-    } else {
-        size_t buffsize = IO_BUF_SIZE;
-#ifdef HAVE_STRUCT_STAT_ST_BLKSIZE
-        ws_statb64 statb;
+    int open_err;
 
-        if (ws_fstat64(rb_data.fd, &statb) == 0) {
-            if (statb.st_blksize > IO_BUF_SIZE) {
-                buffsize = statb.st_blksize;
-            }
-        }
-#endif
-        /* Increase the size of the IO buffer */
-        rb_data.io_buffer = (char *)g_realloc(rb_data.io_buffer, buffsize);
-        setvbuf(rb_data.pdh, rb_data.io_buffer, _IOFBF, buffsize);
+    if (rb_data.write_compress_threads != 0) {
+        rb_data.pdh = pcapio_fdopen_compressed(rb_data.fd, rb_data.write_compression_type,
+                                               rb_data.write_compress_threads, &open_err);
+    } else {
+        rb_data.pdh = pcapio_fdopen(rb_data.fd, &open_err);
+    }
+    if (rb_data.pdh == NULL && err != NULL) {
+        *err = open_err;
     }
 
     return rb_data.pdh;
@@ -444,22 +449,16 @@ ringbuf_init_libpcap_fdopen(int *err)
  * Switches to the next ringbuffer file
  */
 bool
-ringbuf_switch_file(FILE **pdh, char **save_file, int *save_file_fd, int *err)
+ringbuf_switch_file(pcapio_stream **pdh, char **save_file, int *save_file_fd, int *err)
 {
     int     next_file_index;
     rb_file *next_rfile = NULL;
 
     /* close current file */
 
-    if (fclose(rb_data.pdh) == EOF) {
-        if (err != NULL) {
-            *err = errno;
-        }
-        ws_close(rb_data.fd);  /* XXX - the above should have closed this already */
+    if (!pcapio_close(rb_data.pdh, err)) {
         rb_data.pdh = NULL;    /* it's still closed, we just got an error while closing */
         rb_data.fd = -1;
-        g_free(rb_data.io_buffer);
-        rb_data.io_buffer = NULL;
         return false;
     }
 
@@ -494,7 +493,7 @@ ringbuf_switch_file(FILE **pdh, char **save_file, int *save_file_fd, int *err)
 }
 
 /*
- * Calls fclose() for the current ringbuffer file
+ * Calls pcapio_close() for the current ringbuffer file
  */
 bool
 ringbuf_libpcap_dump_close(char **save_file, int *err)
@@ -503,18 +502,11 @@ ringbuf_libpcap_dump_close(char **save_file, int *err)
 
     /* close current file, if it's open */
     if (rb_data.pdh != NULL) {
-        if (fclose(rb_data.pdh) == EOF) {
-            if (err != NULL) {
-                *err = errno;
-            }
-            ws_close(rb_data.fd);
+        if (!pcapio_close(rb_data.pdh, err)) {
             ret_val = false;
         }
         rb_data.pdh = NULL;
         rb_data.fd  = -1;
-        g_free(rb_data.io_buffer);
-        rb_data.io_buffer = NULL;
-
     }
 
     if (rb_data.name_h != NULL) {
@@ -571,9 +563,8 @@ ringbuf_error_cleanup(void)
 
     /* try to close via wtap */
     if (rb_data.pdh != NULL) {
-        if (fclose(rb_data.pdh) == 0) {
-            rb_data.fd = -1;
-        }
+        pcapio_close(rb_data.pdh, NULL);
+        rb_data.fd = -1;
         rb_data.pdh = NULL;
     }
 
@@ -590,9 +581,6 @@ ringbuf_error_cleanup(void)
             }
         }
     }
-    g_free(rb_data.io_buffer);
-    rb_data.io_buffer = NULL;
-
     if (rb_data.name_h != NULL) {
         if (EOF == fclose(rb_data.name_h)) {
             /* Can't really do much about this, can we? */
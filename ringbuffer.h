@@ -14,6 +14,7 @@
 
 #include <stdio.h>
 #include "wiretap/wtap.h"
+#include "writecap/pcapio.h"
 
 #define RINGBUFFER_UNLIMITED_FILES 0
 /* Minimum number of ringbuffer files */
@@ -24,12 +25,16 @@
 /* Maximum number for FAT filesystems */
 #define RINGBUFFER_WARN_NUM_FILES 65535
 
+/* If write_compress_threads isn't 0, the files are written compressed with
+   write_compression_type on that many threads, rather than compressed
+   afterwards as compress_type asks. */
 int ringbuf_init(const char *capture_name, unsigned num_files, bool group_read_access, char* compress_type,
+                 ws_parallel_compression_t write_compression_type, unsigned write_compress_threads,
                  bool nametimenum);
 bool ringbuf_is_initialized(void);
 const char *ringbuf_current_filename(void);
-FILE *ringbuf_init_libpcap_fdopen(int *err);
-bool ringbuf_switch_file(FILE **pdh, char **save_file, int *save_file_fd,
+pcapio_stream *ringbuf_init_libpcap_fdopen(int *err);
+bool ringbuf_switch_file(pcapio_stream **pdh, char **save_file, int *save_file_fd,
                              int *err);
 bool ringbuf_libpcap_dump_close(char **save_file, int *err);
 void ringbuf_free(void);
@@ -37,6 +37,7 @@
 #include <epan/timestamp.h>
 #include <epan/packet.h>
 #include "frame_tvbuff.h"
+#include "frame_index.h"
 #include <epan/disabled_protos.h>
 #include <epan/prefs.h>
 #include <epan/column.h>
@@ -50,6 +51,7 @@
 #include "ui/failure_message.h"
 #include "wtap.h"
 #include <epan/epan_dissect.h>
+#include <epan/follow.h>
 #include <epan/tap.h>
 #include <epan/uat-int.h>
 #include <epan/secrets.h>
@@ -73,6 +75,14 @@ capture_file cfile;
 static uint32_t cum_bytes;
 static frame_data ref_frame;
 
+/*
+ * Frames 1 through first_pass_count have been dissected at least once.
+ * That's all of them after a normal load, but none of them if they were
+ * loaded from an index; dissectors expect to see each frame for the
+ * first time in order, so frames are then dissected in order as needed.
+ */
+static uint32_t first_pass_count;
+
 static void sharkd_cmdarg_err(const char *msg_format, va_list ap);
 static void sharkd_cmdarg_err_cont(const char *msg_format, va_list ap);
 
@@ -180,6 +190,9 @@ main(int argc, char *argv[])
 
     codecs_init();
 
+    /* Follow requests retap only the frames in the stream. */
+    follow_set_record_stream_frames(true);
+
     /* Load libwireshark settings from the current profile. */
     prefs_p = epan_load_settings();
 
@@ -310,7 +323,8 @@ process_packet(capture_file *cf, epan_dissect_t *edt,
 
 
 static int
-load_cap_file(capture_file *cf, int max_packet_count, int64_t max_byte_count)
+load_cap_file(capture_file *cf, int max_packet_count, int64_t max_byte_count,
+        bool use_index)
 {
     int          err;
     char        *err_info = NULL;
@@ -319,6 +333,16 @@ load_cap_file(capture_file *cf, int max_packet_count, int64_t max_byte_count)
     Buffer       buf;
     epan_dissect_t *edt = NULL;
 
+    use_index = use_index && max_packet_count == 0 && max_byte_count == 0 &&
+        cf->rfcode == NULL && cf->dfcode == NULL;
+
+    if (use_index && frame_index_load(cf, &cum_bytes)) {
+        /* Nothing has been dissected yet. */
+        first_pass_count = 0;
+        wtap_sequential_close(cf->provider.wth);
+        return 0;
+    }
+
     {
         /* Allocate a frame_data_sequence for all the frames. */
         cf->provider.frames = new_frame_data_sequence();
@@ -382,13 +406,77 @@ load_cap_file(capture_file *cf, int max_packet_count, int64_t max_byte_count)
         cf->provider.prev_cap = NULL;
     }
 
+    first_pass_count = cf->count;
+
     if (err != 0) {
         cfile_read_failure_message(cf->filename, err, err_info);
+    } else if (use_index) {
+        frame_index_save(cf);
     }
 
     return err;
 }
 
+/*
+ * Note that a frame has been dissected; if it's the first frame not yet
+ * dissected, the first pass has made progress.
+ */
+static void
+sharkd_frame_dissected(uint32_t framenum)
+{
+    if (framenum != first_pass_count + 1)
+        return;
+
+    first_pass_count = framenum;
+    if (first_pass_count == cfile.count) {
+        /* This completes the sequential run-through of the packets. */
+        postseq_cleanup_all_protocols();
+    }
+}
+
+/*
+ * Make sure all frames before a frame have been dissected, in order,
+ * before that frame is dissected.
+ */
+static bool
+sharkd_complete_first_pass(uint32_t framenum, int *err, char **err_info)
+{
+    frame_data     *fdata;
+    epan_dissect_t  edt;
+    wtap_rec        rec;
+    Buffer          buf;
+    bool            ok = true;
+
+    if (framenum <= first_pass_count + 1)
+        return true;
+
+    wtap_rec_init(&rec);
+    ws_buffer_init(&buf, 1514);
+    epan_dissect_init(&edt, cfile.epan, postdissectors_want_hfids(), false);
+
+    while (first_pass_count + 1 < framenum) {
+        fdata = sharkd_get_frame(first_pass_count + 1);
+
+        if (!wtap_seek_read(cfile.provider.wth, fdata->file_off, &rec, &buf, err, err_info)) {
+            ok = false;
+            break;
+        }
+
+        prime_epan_dissect_with_postdissector_wanted_hfids(&edt);
+        epan_dissect_run(&edt, cfile.cd_t, &rec,
+                frame_tvbuff_new_buffer(&cfile.provider, fdata, &buf),
+                fdata, NULL);
+        sharkd_frame_dissected(fdata->num);
+        wtap_rec_reset(&rec);
+        epan_dissect_reset(&edt);
+    }
+
+    wtap_rec_cleanup(&rec);
+    ws_buffer_free(&buf);
+    epan_dissect_cleanup(&edt);
+    return ok;
+}
+
 cf_status_t
 cf_open(capture_file *cf, const char *fname, unsigned int type, bool is_tempfile, int *err)
 {
@@ -470,10 +558,35 @@ sharkd_cf_open(const char *fname, unsigned int type, bool is_tempfile, int *err)
     return cf_open(&cfile, fname, type, is_tempfile, err);
 }
 
+/*
+ * Close the capture file and free the frames read from it.
+ */
+void
+sharkd_cf_close(void)
+{
+    if (cfile.provider.wth) {
+        wtap_close(cfile.provider.wth);
+        cfile.provider.wth = NULL;
+    }
+    if (cfile.provider.frames != NULL) {
+        free_frame_data_sequence(cfile.provider.frames);
+        cfile.provider.frames = NULL;
+    }
+    if (cfile.provider.frames_modified_blocks) {
+        g_tree_destroy(cfile.provider.frames_modified_blocks);
+        cfile.provider.frames_modified_blocks = NULL;
+    }
+    g_free(cfile.filename);
+    cfile.filename = NULL;
+    cfile.count = 0;
+    cfile.state = FILE_CLOSED;
+    first_pass_count = 0;
+}
+
 int
-sharkd_load_cap_file(void)
+sharkd_load_cap_file(bool use_index)
 {
-    return load_cap_file(&cfile, 0, 0);
+    return load_cap_file(&cfile, 0, 0, use_index);
 }
 
 frame_data *
@@ -497,7 +610,8 @@ sharkd_dissect_request(uint32_t framenum, uint32_t frame_ref_num,
     if (fdata == NULL)
         return DISSECT_REQUEST_NO_SUCH_FRAME;
 
-    if (!wtap_seek_read(cfile.provider.wth, fdata->file_off, rec, buf, err, err_info)) {
+    if (!sharkd_complete_first_pass(framenum, err, err_info) ||
+            !wtap_seek_read(cfile.provider.wth, fdata->file_off, rec, buf, err, err_info)) {
         if (cinfo != NULL)
             col_fill_in_error(cinfo, fdata, false, false /* fill_fd_columns */);
         return DISSECT_REQUEST_READ_ERROR; /* error reading the record */
@@ -526,6 +640,7 @@ sharkd_dissect_request(uint32_t framenum, uint32_t frame_ref_num,
     epan_dissect_run(&edt, cfile.cd_t, rec,
             frame_tvbuff_new_buffer(&cfile.provider, fdata, buf),
             fdata, cinfo);
+    sharkd_frame_dissected(framenum);
 
     if (cinfo) {
         /* "Stringify" non frame_data vals */
@@ -541,10 +656,15 @@ sharkd_dissect_request(uint32_t framenum, uint32_t frame_ref_num,
     return DISSECT_REQUEST_SUCCESS;
 }
 
-int
-sharkd_retap(void)
+/*
+ * Retap the frames with the given numbers, in increasing order, or all
+ * frames if frames is NULL.
+ */
+static int
+sharkd_retap_frames_internal(const uint32_t *frames, unsigned frames_count)
 {
-    uint32_t         framenum;
+    uint32_t         framenum, prev_dis_num = 0;
+    unsigned         i;
     frame_data      *fdata;
     Buffer           buf;
     wtap_rec         rec;
@@ -579,20 +699,27 @@ sharkd_retap(void)
 
     reset_tap_listeners();
 
-    for (framenum = 1; framenum <= cfile.count; framenum++) {
+    if (frames == NULL)
+        frames_count = cfile.count;
+    for (i = 0; i < frames_count; i++) {
+        framenum = (frames != NULL) ? frames[i] : i + 1;
         fdata = sharkd_get_frame(framenum);
+        if (fdata == NULL)
+            break;
 
         if (!wtap_seek_read(cfile.provider.wth, fdata->file_off, &rec, &buf, &err, &err_info))
             break;
 
         fdata->ref_time = false;
         fdata->frame_ref_num = (framenum != 1) ? 1 : 0;
-        fdata->prev_dis_num = framenum - 1;
+        fdata->prev_dis_num = prev_dis_num;
         epan_dissect_run_with_taps(&edt, cfile.cd_t, &rec,
                 frame_tvbuff_new_buffer(&cfile.provider, fdata, &buf),
                 fdata, cinfo);
+        sharkd_frame_dissected(framenum);
         wtap_rec_reset(&rec);
         epan_dissect_reset(&edt);
+        prev_dis_num = framenum;
     }
 
     wtap_rec_cleanup(&rec);
@@ -605,54 +732,112 @@ sharkd_retap(void)
 }
 
 int
-sharkd_filter(const char *dftext, uint8_t **result)
+sharkd_retap(void)
 {
-    dfilter_t  *dfcode = NULL;
+    return sharkd_retap_frames_internal(NULL, 0);
+}
+
+static void
+sharkd_depended_frames_add(GHashTable *depended_table, frame_data *fdata)
+{
+    if (g_hash_table_add(depended_table, GUINT_TO_POINTER(fdata->num)) && fdata->dependent_frames) {
+        GHashTableIter iter;
+        void *key;
+
+        g_hash_table_iter_init(&iter, fdata->dependent_frames);
+        while (g_hash_table_iter_next(&iter, &key, NULL)) {
+            frame_data *depended_fd = sharkd_get_frame(GPOINTER_TO_UINT(key));
 
+            if (depended_fd != NULL)
+                sharkd_depended_frames_add(depended_table, depended_fd);
+        }
+    }
+}
+
+static int
+sharkd_compare_framenum(const void *a, const void *b)
+{
+    uint32_t num_a = *(const uint32_t *)a;
+    uint32_t num_b = *(const uint32_t *)b;
+
+    return (num_a > num_b) - (num_a < num_b);
+}
+
+/*
+ * Retap only the given frames, and the frames they depend on, such as
+ * the earlier frames of reassembled PDUs; frames is an array of uint32_t
+ * frame numbers, e.g. from follow_get_stream_frames().
+ */
+int
+sharkd_retap_frames(wmem_array_t *frames)
+{
+    GHashTable *depended_table;
+    GHashTableIter iter;
+    void *key;
+    uint32_t *framenums;
+    unsigned count, i;
+    int ret;
+
+    depended_table = g_hash_table_new(g_direct_hash, g_direct_equal);
+    for (i = 0; i < wmem_array_get_count(frames); i++) {
+        frame_data *fdata = sharkd_get_frame(*(uint32_t *)wmem_array_index(frames, i));
+
+        if (fdata != NULL)
+            sharkd_depended_frames_add(depended_table, fdata);
+    }
+
+    count = g_hash_table_size(depended_table);
+    framenums = g_new(uint32_t, count);
+    i = 0;
+    g_hash_table_iter_init(&iter, depended_table);
+    while (g_hash_table_iter_next(&iter, &key, NULL)) {
+        framenums[i++] = GPOINTER_TO_UINT(key);
+    }
+    g_hash_table_destroy(depended_table);
+    qsort(framenums, count, sizeof (uint32_t), sharkd_compare_framenum);
+
+    ret = sharkd_retap_frames_internal(framenums, count);
+    g_free(framenums);
+    return ret;
+}
+
+/*
+ * Evaluate several compiled filters in one dissection pass over all
+ * frames.  results[i] is set to a bitmap of the frames matching
+ * dfcodes[i], with bit (framenum % 8) of byte (framenum / 8) set for a
+ * matching frame.
+ */
+static uint32_t
+sharkd_filter_pass(dfilter_t **dfcodes, unsigned count, uint8_t **results)
+{
     uint32_t framenum, prev_dis_num = 0;
     uint32_t frames_count;
     Buffer buf;
     wtap_rec rec;
     int err;
     char *err_info = NULL;
-
-    uint8_t *result_bits;
-    uint8_t passed_bits;
+    unsigned i;
 
     epan_dissect_t edt;
 
-    if (!dfilter_compile(dftext, &dfcode, NULL)) {
-        return -1;
-    }
-
-    /* if dfilter_compile() success, but (dfcode == NULL) all frames are matching */
-    if (dfcode == NULL) {
-        *result = NULL;
-        return 0;
-    }
-
     frames_count = cfile.count;
 
     wtap_rec_init(&rec);
     ws_buffer_init(&buf, 1514);
     epan_dissect_init(&edt, cfile.epan, true, false);
 
-    passed_bits = 0;
-    result_bits = (uint8_t *) g_malloc(2 + (frames_count / 8));
+    for (i = 0; i < count; i++)
+        results[i] = (uint8_t *) g_malloc0(2 + (frames_count / 8));
 
     for (framenum = 1; framenum <= frames_count; framenum++) {
         frame_data *fdata = sharkd_get_frame(framenum);
 
-        if ((framenum & 7) == 0) {
-            result_bits[(framenum / 8) - 1] = passed_bits;
-            passed_bits = 0;
-        }
-
         if (!wtap_seek_read(cfile.provider.wth, fdata->file_off, &rec, &buf, &err, &err_info))
             break;
 
         /* frame_data_set_before_dissect */
-        epan_dissect_prime_with_dfilter(&edt, dfcode);
+        for (i = 0; i < count; i++)
+            epan_dissect_prime_with_dfilter(&edt, dfcodes[i]);
 
         fdata->ref_time = false;
         fdata->frame_ref_num = (framenum != 1) ? 1 : 0;
@@ -660,10 +845,14 @@ sharkd_filter(const char *dftext, uint8_t **result)
         epan_dissect_run(&edt, cfile.cd_t, &rec,
                 frame_tvbuff_new_buffer(&cfile.provider, fdata, &buf),
                 fdata, NULL);
+        sharkd_frame_dissected(framenum);
 
-        if (dfilter_apply_edt(dfcode, &edt)) {
-            passed_bits |= (1 << (framenum % 8));
-            prev_dis_num = framenum;
+        for (i = 0; i < count; i++) {
+            if (dfilter_apply_edt(dfcodes[i], &edt)) {
+                results[i][framenum / 8] |= (1 << (framenum % 8));
+                if (count == 1)
+                    prev_dis_num = framenum;
+            }
         }
 
         /* if passed or ref -> frame_data_set_after_dissect */
@@ -672,19 +861,86 @@ sharkd_filter(const char *dftext, uint8_t **result)
         epan_dissect_reset(&edt);
     }
 
-    if ((framenum & 7) == 0)
-        framenum--;
-    result_bits[framenum / 8] = passed_bits;
-
     wtap_rec_cleanup(&rec);
     ws_buffer_free(&buf);
     epan_dissect_cleanup(&edt);
 
-    dfilter_free(dfcode);
+    return framenum;
+}
+
+int
+sharkd_filter_batch(dfilter_t **dfcodes, unsigned count, uint8_t **results)
+{
+    GPtrArray *shared;
+    GArray    *shared_idx;
+    uint8_t  **shared_results;
+    int        hf_delta_displayed;
+    uint32_t   ret = 0;
+    unsigned   i;
 
-    *result = result_bits;
+    /*
+     * frame.time_delta_displayed depends on which frames passed the
+     * filter being evaluated, so a filter that refers to it gets a pass
+     * of its own.  A NULL filter matches all frames.
+     */
+    hf_delta_displayed = proto_registrar_get_id_byname("frame.time_delta_displayed");
 
-    return framenum;
+    shared = g_ptr_array_new();
+    shared_idx = g_array_new(false, false, sizeof(unsigned));
+
+    for (i = 0; i < count; i++) {
+        results[i] = NULL;
+        if (dfcodes[i] == NULL)
+            continue;
+
+        if (hf_delta_displayed != -1 && dfilter_interested_in_field(dfcodes[i], hf_delta_displayed)) {
+            ret = sharkd_filter_pass(&dfcodes[i], 1, &results[i]);
+            continue;
+        }
+
+        g_ptr_array_add(shared, dfcodes[i]);
+        g_array_append_val(shared_idx, i);
+    }
+
+    if (shared->len == 1) {
+        /* A single filter also gets frame.time_delta_displayed right. */
+        ret = sharkd_filter_pass((dfilter_t **) shared->pdata, 1,
+                &results[g_array_index(shared_idx, unsigned, 0)]);
+    } else if (shared->len > 1) {
+        shared_results = g_new(uint8_t *, shared->len);
+        ret = sharkd_filter_pass((dfilter_t **) shared->pdata, shared->len, shared_results);
+        for (i = 0; i < shared->len; i++)
+            results[g_array_index(shared_idx, unsigned, i)] = shared_results[i];
+        g_free(shared_results);
+    }
+
+    g_ptr_array_free(shared, true);
+    g_array_free(shared_idx, true);
+
+    return ret;
+}
+
+int
+sharkd_filter(const char *dftext, uint8_t **result)
+{
+    dfilter_t  *dfcode = NULL;
+    int ret;
+
+    if (!dfilter_compile(dftext, &dfcode, NULL)) {
+        return -1;
+    }
+
+    /* if dfilter_compile() success, but (dfcode == NULL) all frames are matching */
+    if (dfcode == NULL) {
+        *result = NULL;
+        return 0;
+    }
+
+    ret = sharkd_filter_batch(&dfcode, 1, result);
+
+    dfilter_free(dfcode);
+
+    return ret;
 }
 
 /*
@@ -30,9 +30,12 @@ typedef void (*sharkd_dissect_func_t)(epan_dissect_t *edt, proto_tree *tree, str
 
 /* sharkd.c */
 cf_status_t sharkd_cf_open(const char *fname, unsigned int type, bool is_tempfile, int *err);
-int sharkd_load_cap_file(void);
+void sharkd_cf_close(void);
+int sharkd_load_cap_file(bool use_index);
 int sharkd_retap(void);
+int sharkd_retap_frames(wmem_array_t *frames);
 int sharkd_filter(const char *dftext, uint8_t **result);
+int sharkd_filter_batch(dfilter_t **dfcodes, unsigned count, uint8_t **results);
 frame_data *sharkd_get_frame(uint32_t framenum);
 enum dissect_request_status {
   DISSECT_REQUEST_SUCCESS,
@@ -56,6 +59,7 @@ int sharkd_loop(int argc _U_, char* argv[] _U_);
 
 /* sharkd_session.c */
 int sharkd_session_main(int mode_setting);
+int sharkd_session_worker_main(int mode_setting);
 
 #endif /* __SHARKD_H */
 
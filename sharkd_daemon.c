@@ -34,11 +34,15 @@
 
 #ifndef _WIN32
 #include <sys/un.h>
+#include <sys/wait.h>
 #include <netinet/tcp.h>
+#include <unistd.h>
 #endif
 
 #include <wsutil/strtoi.h>
 #include <wsutil/version_info.h>
+#include <wsutil/wmem/wmem.h>
+#include <wsutil/wsjson.h>
 
 #include "sharkd.h"
 
@@ -51,6 +55,7 @@
 #endif
 
 static int mode;
+static bool shared;
 static socket_handle_t _server_fd = INVALID_SOCKET;
 
 static socket_handle_t
@@ -183,11 +188,18 @@ print_usage(FILE* output)
     fprintf(output, "  -v, --version            show version information\n");
     fprintf(output, "  -C <config profile>, --config-profile <config profile>\n");
     fprintf(output, "                           start with specified configuration profile\n");
+#ifndef _WIN32
+    fprintf(output, "  -s, --shared             let clients that load the same capture file with\n");
+    fprintf(output, "                           the same preferences share a session\n");
+#endif
 
     fprintf(output, "\n");
     fprintf(output, "  Examples:\n");
     fprintf(output, "    sharkd -C myprofile\n");
     fprintf(output, "    sharkd -a tcp:127.0.0.1:4446 -C myprofile\n");
+#ifndef _WIN32
+    fprintf(output, "    sharkd -a unix:/tmp/sharkd.sock -s\n");
+#endif
 
     fprintf(output, "\n");
     fprintf(output, "See the sharkd page of the Wireshark wiki for full details.\n");
@@ -217,7 +229,7 @@ sharkd_init(int argc, char **argv)
      * platform-dependent.
      */
 
-#define OPTSTRING "+" "a:hmvC:"
+#define OPTSTRING "+" "a:hmsvC:"
 
     static const char    optstring[] = OPTSTRING;
 
@@ -227,6 +239,7 @@ sharkd_init(int argc, char **argv)
         {"help", ws_no_argument, NULL, 'h'},
         {"version", ws_no_argument, NULL, 'v'},
         {"config-profile", ws_required_argument, NULL, 'C'},
+        {"shared", ws_no_argument, NULL, 's'},
         {0, 0, 0, 0 }
     };
 
@@ -322,6 +335,16 @@ sharkd_init(int argc, char **argv)
                     mode = SHARKD_MODE_GOLD_CONSOLE;
                     break;
 
+                case 's':
+#ifndef _WIN32
+                    // with -m, s is used internally for the sessions started by a shared daemon
+                    shared = true;
+#else
+                    fprintf(stderr, "Shared mode isn't supported on Windows\n");
+                    return -1;
+#endif
+                    break;
+
                 case 'v':         /* Show version and exit */
                     show_version();
                     exit(0);
@@ -356,6 +379,892 @@ sharkd_init(int argc, char **argv)
     return 0;
 }
 
+#ifndef _WIN32
+/*
+ * In shared mode, the daemon passes the requests of all connections to
+ * worker processes, each running a session ("sharkd -m -s") with its own
+ * dissection state.  There is one worker for each capture file and set
+ * of preferences set with "setconf": clients that loaded the same file
+ * with the same preferences share a worker, and with it the frames read
+ * from the file and the filter results kept for them, while the workers
+ * of other files handle requests at the same time.  A worker ends when no
+ * client uses it any more.
+ *
+ * A client moves to another worker when it loads a file or sets a
+ * preference.  If there's no worker with its new file and preferences,
+ * its worker is changed if no other client uses it, or else a new worker
+ * is started, given the preferences set by the client and told to load
+ * the client's file; the clients of the previous worker don't see the
+ * change.
+ */
+struct sharkd_worker
+{
+    char *key;      /* see sharkd_shared_key() */
+    GPid pid;
+    FILE *in;       /* requests to the worker */
+    FILE *out;      /* responses from the worker */
+    GMutex lock;    /* held while the worker handles a request */
+    unsigned refs;  /* clients using the worker, guarded by workers_lock */
+};
+
+struct sharkd_shared_pref
+{
+    char *name;
+    char *params;   /* "params" of the setconf request */
+};
+
+struct sharkd_shared_client
+{
+    FILE *out;
+    char *filename;     /* capture file loaded, or NULL */
+    char *load_params;  /* "params" of the load request */
+    GPtrArray *prefs;   /* struct sharkd_shared_pref, in the order set */
+    struct sharkd_worker *worker;
+};
+
+/* What the daemon needs to know about a request. */
+struct sharkd_shared_request
+{
+    char *method;
+    char *id;       /* "id" as in the request */
+    char *params;   /* "params" as in the request, or NULL */
+    char *file;     /* "file" parameter */
+    char *name;     /* "name" parameter */
+};
+
+static GMutex workers_lock;
+static GHashTable *workers; /* key -> struct sharkd_worker using it */
+static char *worker_argv[6];
+
+/*
+ * Get the key of the worker with a capture file, or none if filename is
+ * NULL, and preferences.
+ */
+static char *
+sharkd_shared_key(const char *filename, const GPtrArray *prefs)
+{
+    GString *key = g_string_new(filename ? "F" : "-");
+
+    if (filename)
+        g_string_append(key, filename);
+
+    for (unsigned i = 0; i < prefs->len; i++)
+    {
+        const struct sharkd_shared_pref *pref = (const struct sharkd_shared_pref *) prefs->pdata[i];
+
+        g_string_append_c(key, '\n');
+        g_string_append(key, pref->params);
+    }
+
+    return g_string_free(key, FALSE);
+}
+
+static void
+sharkd_shared_pref_free(void *data)
+{
+    struct sharkd_shared_pref *pref = (struct sharkd_shared_pref *) data;
+
+    g_free(pref->name);
+    g_free(pref->params);
+    g_free(pref);
+}
+
+/*
+ * Copy preferences, setting one of them.
+ */
+static GPtrArray *
+sharkd_shared_prefs_set(const GPtrArray *prefs, const char *name, const char *params)
+{
+    GPtrArray *copy = g_ptr_array_new_with_free_func(sharkd_shared_pref_free);
+    bool found = false;
+
+    for (unsigned i = 0; i < prefs->len; i++)
+    {
+        const struct sharkd_shared_pref *pref = (const struct sharkd_shared_pref *) prefs->pdata[i];
+        struct sharkd_shared_pref *pref_copy = g_new(struct sharkd_shared_pref, 1);
+
+        pref_copy->name = g_strdup(pref->name);
+        if (!strcmp(pref->name, name))
+        {
+            pref_copy->params = g_strdup(params);
+            found = true;
+        }
+        else
+            pref_copy->params = g_strdup(pref->params);
+        g_ptr_array_add(copy, pref_copy);
+    }
+
+    if (!found)
+    {
+        struct sharkd_shared_pref *pref = g_new(struct sharkd_shared_pref, 1);
+
+        pref->name = g_strdup(name);
+        pref->params = g_strdup(params);
+        g_ptr_array_add(copy, pref);
+    }
+
+    return copy;
+}
+
+/* Skip a token and the tokens it contains. */
+static const jsmntok_t *
+sharkd_shared_json_skip(const jsmntok_t *tok)
+{
+    int size = tok->size;
+
+    tok++;
+    while (size-- > 0)
+        tok = sharkd_shared_json_skip(tok);
+    return tok;
+}
+
+static const jsmntok_t *
+sharkd_shared_json_member(const char *buf, const jsmntok_t *object, const char *name)
+{
+    const jsmntok_t *cur = object + 1;
+
+    if (object->type != JSMN_OBJECT)
+        return NULL;
+
+    for (int i = 0; i < object->size; i++)
+    {
+        if (cur->type == JSMN_STRING && cur->size == 1 &&
+                (size_t) (cur->end - cur->start) == strlen(name) &&
+                !strncmp(&buf[cur->start], name, cur->end - cur->start))
+            return cur + 1;
+        cur = sharkd_shared_json_skip(cur);
+    }
+    return NULL;
+}
+
+/* Get the text of a value, with the quotes of a string. */
+static char *
+sharkd_shared_json_raw(const char *buf, const jsmntok_t *tok)
+{
+    if (tok->type == JSMN_STRING)
+        return g_strndup(&buf[tok->start - 1], tok->end - tok->start + 2);
+    return g_strndup(&buf[tok->start], tok->end - tok->start);
+}
+
+static char *
+sharkd_shared_json_string(const char *buf, const jsmntok_t *tok)
+{
+    char *str;
+
+    if (!tok || tok->type != JSMN_STRING)
+        return NULL;
+
+    str = g_strndup(&buf[tok->start], tok->end - tok->start);
+    if (!json_decode_string_inplace(str))
+    {
+        g_free(str);
+        return NULL;
+    }
+    return str;
+}
+
+static jsmntok_t *
+sharkd_shared_json_parse(const char *buf)
+{
+    jsmntok_t *tokens;
+    int count;
+
+    count = json_parse(buf, NULL, 0);
+    if (count <= 0)
+        return NULL;
+
+    tokens = g_new0(jsmntok_t, count);
+    if (json_parse(buf, tokens, count) <= 0 || tokens[0].type != JSMN_OBJECT)
+    {
+        g_free(tokens);
+        return NULL;
+    }
+    return tokens;
+}
+
+/*
+ * Get what the daemon needs to know about a request.  Returns false if
+ * it has no method; the worker will report what is wrong with it.
+ */
+static bool
+sharkd_shared_request_parse(const char *buf, struct sharkd_shared_request *req)
+{
+    jsmntok_t *tokens;
+    const jsmntok_t *tok;
+
+    memset(req, 0, sizeof(*req));
+
+    tokens = sharkd_shared_json_parse(buf);
+    if (!tokens)
+        return false;
+
+    req->method = sharkd_shared_json_string(buf, sharkd_shared_json_member(buf, &tokens[0], "method"));
+
+    tok = sharkd_shared_json_member(buf, &tokens[0], "id");
+    req->id = (tok && tok->type == JSMN_PRIMITIVE) ? sharkd_shared_json_raw(buf, tok) : g_strdup("0");
+
+    tok = sharkd_shared_json_member(buf, &tokens[0], "params");
+    if (tok && tok->type == JSMN_OBJECT)
+    {
+        req->params = sharkd_shared_json_raw(buf, tok);
+        req->file = sharkd_shared_json_string(buf, sharkd_shared_json_member(buf, tok, "file"));
+        req->name = sharkd_shared_json_string(buf, sharkd_shared_json_member(buf, tok, "name"));
+    }
+
+    g_free(tokens);
+    return req->method != NULL;
+}
+
+static void
+sharkd_shared_request_free(struct sharkd_shared_request *req)
+{
+    g_free(req->method);
+    g_free(req->id);
+    g_free(req->params);
+    g_free(req->file);
+    g_free(req->name);
+}
+
+/*
+ * Does a response have a "status":"OK" result, as successful "load" and
+ * "setconf" requests get?
+ */
+static bool
+sharkd_shared_response_ok(const char *buf)
+{
+    jsmntok_t *tokens;
+    const jsmntok_t *result;
+    char *status = NULL;
+
+    tokens = sharkd_shared_json_parse(buf);
+    if (!tokens)
+        return false;
+
+    result = sharkd_shared_json_member(buf, &tokens[0], "result");
+    if (result)
+        status = sharkd_shared_json_string(buf, sharkd_shared_json_member(buf, result, "status"));
+    g_free(tokens);
+
+    if (status && !strcmp(status, "OK"))
+    {
+        g_free(status);
+        return true;
+    }
+    g_free(status);
+    return false;
+}
+
+static struct sharkd_worker *
+sharkd_worker_start(const char *key)
+{
+    struct sharkd_worker *worker;
+    GError *error = NULL;
+    GPid pid;
+    int in_fd, out_fd;
+
+    if (!g_spawn_async_with_pipes(NULL, worker_argv, NULL, G_SPAWN_DO_NOT_REAP_CHILD,
+                NULL, NULL, &pid, &in_fd, &out_fd, NULL, &error))
+    {
+        fprintf(stderr, "cannot start worker: %s\n", error->message);
+        g_error_free(error);
+        return NULL;
+    }
+
+    worker = g_new0(struct sharkd_worker, 1);
+    worker->key = g_strdup(key);
+    worker->pid = pid;
+    worker->in = fdopen(in_fd, "w");
+    worker->out = fdopen(out_fd, "r");
+    g_mutex_init(&worker->lock);
+    worker->refs = 1;
+
+    if (!worker->in)
+        close(in_fd);
+    if (!worker->out)
+        close(out_fd);
+
+    return worker;
+}
+
+static void
+sharkd_worker_free(struct sharkd_worker *worker)
+{
+    /* The worker ends when its input does. */
+    if (worker->in)
+        fclose(worker->in);
+    if (worker->out)
+        fclose(worker->out);
+    waitpid(worker->pid, NULL, 0);
+    g_spawn_close_pid(worker->pid);
+    g_mutex_clear(&worker->lock);
+    g_free(worker->key);
+    g_free(worker);
+}
+
+/*
+ * Stop using a worker, ending it if no other client uses it.
+ */
+static void
+sharkd_worker_release(struct sharkd_worker *worker)
+{
+    bool unused;
+
+    if (!worker)
+        return;
+
+    g_mutex_lock(&workers_lock);
+    unused = (--worker->refs == 0);
+    if (unused && g_hash_table_lookup(workers, worker->key) == worker)
+        g_hash_table_remove(workers, worker->key);
+    g_mutex_unlock(&workers_lock);
+
+    if (unused)
+        sharkd_worker_free(worker);
+}
+
+/*
+ * Find the worker with a key and start using it.
+ */
+static struct sharkd_worker *
+sharkd_worker_lookup(const char *key)
+{
+    struct sharkd_worker *worker;
+
+    g_mutex_lock(&workers_lock);
+    worker = (struct sharkd_worker *) g_hash_table_lookup(workers, key);
+    if (worker)
+        worker->refs++;
+    g_mutex_unlock(&workers_lock);
+
+    return worker;
+}
+
+/*
+ * Let other clients find a worker used by one client.  If a worker with
+ * the same key was made available meanwhile, that one is used instead.
+ */
+static struct sharkd_worker *
+sharkd_worker_publish(struct sharkd_worker *worker)
+{
+    struct sharkd_worker *other;
+
+    g_mutex_lock(&workers_lock);
+    other = (struct sharkd_worker *) g_hash_table_lookup(workers, worker->key);
+    if (other)
+        other->refs++;
+    else
+        g_hash_table_insert(workers, worker->key, worker);
+    g_mutex_unlock(&workers_lock);
+
+    if (other)
+    {
+        sharkd_worker_release(worker);
+        return other;
+    }
+    return worker;
+}
+
+/*
+ * Keep other clients from finding a worker, if no other client uses it,
+ * so that its key can be changed.
+ */
+static bool
+sharkd_worker_withdraw(struct sharkd_worker *worker)
+{
+    bool withdrawn = false;
+
+    g_mutex_lock(&workers_lock);
+    if (worker->refs == 1)
+    {
+        if (g_hash_table_lookup(workers, worker->key) == worker)
+            g_hash_table_remove(workers, worker->key);
+        withdrawn = true;
+    }
+    g_mutex_unlock(&workers_lock);
+
+    return withdrawn;
+}
+
+static void
+sharkd_worker_set_key(struct sharkd_worker *worker, char *key)
+{
+    g_free(worker->key);
+    worker->key = key;
+}
+
+/*
+ * Have a worker handle a request, passing its response to out unless out
+ * is NULL, and setting *ok to sharkd_shared_response_ok() of it unless ok
+ * is NULL.  Returns false if the worker has gone away, in which case
+ * other clients can't find it any more.
+ */
+static bool
+sharkd_worker_request(struct sharkd_worker *worker, const char *request, FILE *out, bool *ok)
+{
+    char *line = NULL;
+    size_t line_size = 0;
+    ssize_t len = -1;
+    bool first = true;
+
+    if (ok)
+        *ok = false;
+
+    g_mutex_lock(&worker->lock);
+
+    if (worker->in && worker->out &&
+            fputs(request, worker->in) != EOF && fflush(worker->in) != EOF)
+    {
+        /* An empty line ends the response. */
+        while ((len = getline(&line, &line_size, worker->out)) > 0 && line[0] != '\n')
+        {
+            if (out)
+                fwrite(line, 1, len, out);
+            if (ok && first)
+                *ok = sharkd_shared_response_ok(line);
+            first = false;
+        }
+    }
+
+    g_mutex_unlock(&worker->lock);
+
+    free(line);
+    if (out)
+        fflush(out);
+
+    if (len <= 0)
+    {
+        fprintf(stderr, "worker %d has gone away\n", (int) worker->pid);
+        g_mutex_lock(&workers_lock);
+        if (g_hash_table_lookup(workers, worker->key) == worker)
+            g_hash_table_remove(workers, worker->key);
+        g_mutex_unlock(&workers_lock);
+        return false;
+    }
+    return true;
+}
+
+/*
+ * Have a worker handle a request made up by the daemon, with the id of
+ * the client's request it's made for.
+ */
+static bool
+sharkd_worker_request_made(struct sharkd_worker *worker, const char *id,
+        const char *method, const char *params, FILE *out, bool *ok)
+{
+    char *request;
+    bool ret;
+
+    request = ws_strdup_printf("{\"jsonrpc\":\"2.0\",\"id\":%s,\"method\":\"%s\",\"params\":%s}\n",
+            id, method, params);
+    ret = sharkd_worker_request(worker, request, out, ok);
+    g_free(request);
+
+    return ret;
+}
+
+/*
+ * Start a worker and give it the preferences set by a client.
+ */
+static struct sharkd_worker *
+sharkd_shared_start_worker(const struct sharkd_shared_client *client, const char *id)
+{
+    struct sharkd_worker *worker;
+    char *key;
+
+    key = sharkd_shared_key(NULL, client->prefs);
+    worker = sharkd_worker_start(key);
+    g_free(key);
+    if (!worker)
+        return NULL;
+
+    for (unsigned i = 0; i < client->prefs->len; i++)
+    {
+        const struct sharkd_shared_pref *pref = (const struct sharkd_shared_pref *) client->prefs->pdata[i];
+        bool ok;
+
+        if (!sharkd_worker_request_made(worker, id, "setconf", pref->params, NULL, &ok) || !ok)
+        {
+            sharkd_worker_release(worker);
+            return NULL;
+        }
+    }
+
+    return worker;
+}
+
+/*
+ * Give a client that has none a worker with its file and preferences.
+ */
+static bool
+sharkd_shared_attach(struct sharkd_shared_client *client, const char *id)
+{
+    struct sharkd_worker *worker;
+    char *key;
+
+    if (client->worker)
+        return true;
+
+    key = sharkd_shared_key(client->filename, client->prefs);
+    worker = sharkd_worker_lookup(key);
+    if (!worker && (worker = sharkd_shared_start_worker(client, id)) != NULL)
+    {
+        bool ok = true;
+
+        if (client->filename &&
+                (!sharkd_worker_request_made(worker, id, "load", client->load_params, NULL, &ok) || !ok))
+        {
+            sharkd_worker_release(worker);
+            worker = NULL;
+        }
+        else
+        {
+            sharkd_worker_set_key(worker, key);
+            key = NULL;
+            worker = sharkd_worker_publish(worker);
+        }
+    }
+    g_free(key);
+
+    client->worker = worker;
+    return worker != NULL;
+}
+
+/*
+ * Set the worker of a client, passing on a reference to it, and what it
+ * has loaded.
+ */
+static void
+sharkd_shared_switch(struct sharkd_shared_client *client, struct sharkd_worker *worker,
+        const char *filename, const char *load_params)
+{
+    if (client->worker != worker)
+    {
+        sharkd_worker_release(client->worker);
+        client->worker = worker;
+    }
+    else
+        sharkd_worker_release(worker);
+
+    if (filename != client->filename)
+    {
+        char *old_filename = client->filename;
+        char *old_load_params = client->load_params;
+
+        client->filename = g_strdup(filename);
+        client->load_params = g_strdup(load_params);
+        g_free(old_filename);
+        g_free(old_load_params);
+    }
+}
+
+/*
+ * Handle a "load" request.  The file is loaded by the worker with the
+ * client's preferences that loaded it already, if there is one.
+ */
+static bool
+sharkd_shared_load(struct sharkd_shared_client *client, const struct sharkd_shared_request *req, const char *request)
+{
+    struct sharkd_worker *worker;
+    bool found, ok;
+    char *key;
+
+    key = sharkd_shared_key(req->file, client->prefs);
+    worker = sharkd_worker_lookup(key);
+    found = (worker != NULL);
+
+    if (!worker && client->worker && sharkd_worker_withdraw(client->worker))
+    {
+        worker = client->worker;
+        client->worker = NULL;
+    }
+    else if (!worker && (worker = sharkd_shared_start_worker(client, req->id)) == NULL)
+    {
+        g_free(key);
+        return false;
+    }
+
+    if (!sharkd_worker_request(worker, request, client->out, &ok))
+    {
+        sharkd_worker_release(worker);
+        g_free(key);
+        return false;
+    }
+
+    if (!found)
+    {
+        /* If loading failed, the worker has no file any more. */
+        if (!ok)
+        {
+            g_free(key);
+            key = sharkd_shared_key(NULL, client->prefs);
+        }
+        sharkd_worker_set_key(worker, key);
+        key = NULL;
+        worker = sharkd_worker_publish(worker);
+    }
+    g_free(key);
+
+    if (ok)
+        sharkd_shared_switch(client, worker, req->file, req->params);
+    else
+        sharkd_shared_switch(client, worker, NULL, NULL);
+    return true;
+}
+
+/*
+ * Handle a "setconf" request.  The preference applies to the client
+ * only, so it moves to a worker with its file and its new preferences.
+ */
+static bool
+sharkd_shared_setconf(struct sharkd_shared_client *client, const struct sharkd_shared_request *req, const char *request)
+{
+    struct sharkd_worker *worker;
+    GPtrArray *prefs;
+    const char *filename = client->filename;
+    bool ok;
+    char *key;
+
+    prefs = sharkd_shared_prefs_set(client->prefs, req->name, req->params);
+    key = sharkd_shared_key(filename, prefs);
+
+    if ((worker = sharkd_worker_lookup(key)) != NULL)
+    {
+        g_free(key);
+
+        /* Setting the preference again doesn't change anything. */
+        if (!sharkd_worker_request(worker, request, client->out, &ok))
+        {
+            sharkd_worker_release(worker);
+            g_ptr_array_free(prefs, true);
+            return false;
+        }
+        if (ok)
+            sharkd_shared_switch(client, worker, client->filename, client->load_params);
+        else
+            sharkd_worker_release(worker);
+    }
+    else if (client->worker && sharkd_worker_withdraw(client->worker))
+    {
+        worker = client->worker;
+        if (!sharkd_worker_request(worker, request, client->out, &ok))
+        {
+            g_free(key);
+            g_ptr_array_free(prefs, true);
+            return false;
+        }
+        if (ok)
+            sharkd_worker_set_key(worker, key);
+        else
+            g_free(key);
+        client->worker = sharkd_worker_publish(worker);
+    }
+    else
+    {
+        worker = sharkd_shared_start_worker(client, req->id);
+        if (!worker)
+        {
+            g_free(key);
+            g_ptr_array_free(prefs, true);
+            return false;
+        }
+        if (!sharkd_worker_request(worker, request, client->out, &ok))
+        {
+            sharkd_worker_release(worker);
+            g_free(key);
+            g_ptr_array_free(prefs, true);
+            return false;
+        }
+        if (!ok)
+        {
+            /* The preference was refused; nothing changes. */
+            sharkd_worker_release(worker);
+            g_free(key);
+            g_ptr_array_free(prefs, true);
+            return true;
+        }
+
+        if (filename)
+        {
+            bool loaded;
+
+            if (!sharkd_worker_request_made(worker, req->id, "load", client->load_params, NULL, &loaded))
+            {
+                sharkd_worker_release(worker);
+                g_free(key);
+                g_ptr_array_free(prefs, true);
+                return false;
+            }
+            if (!loaded)
+            {
+                /* The file can't be loaded again; go on without it. */
+                filename = NULL;
+                g_free(key);
+                key = sharkd_shared_key(NULL, prefs);
+            }
+        }
+
+        sharkd_worker_set_key(worker, key);
+        worker = sharkd_worker_publish(worker);
+        if (filename)
+            sharkd_shared_switch(client, worker, client->filename, client->load_params);
+        else
+            sharkd_shared_switch(client, worker, NULL, NULL);
+    }
+
+    if (ok)
+    {
+        g_ptr_array_free(client->prefs, true);
+        client->prefs = prefs;
+    }
+    else
+        g_ptr_array_free(prefs, true);
+
+    return true;
+}
+
+/*
+ * Handle a request of a client.  Returns false if the connection must
+ * be closed.
+ */
+static bool
+sharkd_shared_process(struct sharkd_shared_client *client, const char *request)
+{
+    struct sharkd_shared_request req;
+    bool keep;
+
+    if (!sharkd_shared_request_parse(request, &req))
+        keep = sharkd_shared_attach(client, req.id ? req.id : "0") &&
+            sharkd_worker_request(client->worker, request, client->out, NULL);
+    else if (!strcmp(req.method, "load") && req.file)
+        keep = sharkd_shared_load(client, &req, request);
+    else if (!strcmp(req.method, "setconf") && req.name && req.params)
+        keep = sharkd_shared_setconf(client, &req, request);
+    else
+    {
+        keep = sharkd_shared_attach(client, req.id) &&
+            sharkd_worker_request(client->worker, request, client->out, NULL);
+
+        /* "bye" ends the connection, not the worker. */
+        if (!strcmp(req.method, "bye"))
+            keep = false;
+    }
+
+    sharkd_shared_request_free(&req);
+    return keep;
+}
+
+/*
+ * Serve the requests of one client in shared mode; called on a thread of
+ * its own for each connection.
+ */
+static void
+sharkd_shared_serve(FILE *in, FILE *out)
+{
+    struct sharkd_shared_client client;
+    char buf[8 * 1024];
+
+    memset(&client, 0, sizeof(client));
+    client.out = out;
+    client.prefs = g_ptr_array_new_with_free_func(sharkd_shared_pref_free);
+
+    /* Leave room for a line feed, as workers read a request per line. */
+    while (fgets(buf, sizeof(buf) - 1, in))
+    {
+        size_t len = strlen(buf);
+
+        if (len == 0 || buf[len - 1] != '\n')
+        {
+            buf[len] = '\n';
+            buf[len + 1] = '\0';
+        }
+
+        if (!sharkd_shared_process(&client, buf))
+            break;
+    }
+
+    sharkd_worker_release(client.worker);
+    g_ptr_array_free(client.prefs, true);
+    g_free(client.filename);
+    g_free(client.load_params);
+}
+
+static void *
+sharkd_shared_client_thread(void *data)
+{
+    int fd = GPOINTER_TO_INT(data);
+    int out_fd;
+    FILE *in, *out;
+
+    /* Reading and writing use separate streams, so give each a descriptor. */
+    out_fd = dup(fd);
+    in = fdopen(fd, "r");
+    out = (out_fd != -1) ? fdopen(out_fd, "w") : NULL;
+
+    if (in && out)
+        sharkd_shared_serve(in, out);
+    else
+        fprintf(stderr, "cannot fdopen(): %s\n", g_strerror(errno));
+
+    if (out)
+        fclose(out);
+    else if (out_fd != -1)
+        close(out_fd);
+
+    if (in)
+        fclose(in);
+    else
+        close(fd);
+
+    return NULL;
+}
+
+/*
+ * Serve all connections from this process, each on a thread of its own,
+ * with worker processes doing the dissection.
+ */
+static int
+sharkd_shared_loop(void)
+{
+    int argi = 0;
+
+    /* A client or worker going away mustn't take down the daemon. */
+    signal(SIGPIPE, SIG_IGN);
+
+    worker_argv[argi++] = get_executable_path("sharkd");
+    if (worker_argv[0] == NULL)
+    {
+        fprintf(stderr, "cannot find the sharkd executable\n");
+        return -1;
+    }
+    /* -m -s: a session serving the clients of a shared daemon */
+    worker_argv[argi++] = g_strdup("-m");
+    worker_argv[argi++] = g_strdup("-s");
+    if (!is_default_profile())
+    {
+        worker_argv[argi++] = g_strdup("-C");
+        worker_argv[argi++] = g_strdup(get_profile_name());
+    }
+    worker_argv[argi] = NULL;
+
+    workers = g_hash_table_new(g_str_hash, g_str_equal);
+
+    while (1)
+    {
+        socket_handle_t fd;
+
+        fd = accept(_server_fd, NULL, NULL);
+        if (fd == INVALID_SOCKET)
+        {
+            fprintf(stderr, "cannot accept(): %s\n", g_strerror(errno));
+            continue;
+        }
+
+        g_thread_unref(g_thread_new("sharkd client", sharkd_shared_client_thread, GINT_TO_POINTER(fd)));
+    }
+    return 0;
+}
+#endif
+
 int
 #ifndef _WIN32
 sharkd_loop(int argc _U_, char* argv[] _U_)
@@ -365,9 +1274,19 @@ sharkd_loop(int argc _U_, char* argv[])
 {
     if (mode == SHARKD_MODE_CLASSIC_CONSOLE || mode == SHARKD_MODE_GOLD_CONSOLE)
     {
+#ifndef _WIN32
+        /* A session started by a shared daemon. */
+        if (shared)
+            return sharkd_session_worker_main(mode);
+#endif
         return sharkd_session_main(mode);
     }
 
+#ifndef _WIN32
+    if (shared)
+        return sharkd_shared_loop();
+#endif
+
     while (1)
     {
 #ifndef _WIN32
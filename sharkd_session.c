@@ -18,6 +18,7 @@
 #include <string.h>
 #include <errno.h>
 #include <inttypes.h>
+#include <limits.h>
 
 #include <glib.h>
 
@@ -71,20 +72,87 @@
 
 #include <epan/maxmind_db.h>
 
+#include <wsutil/bits_count_ones.h>
+#include <wsutil/file_util.h>
+#include <wsutil/filesystem.h>
 #include <wsutil/pint.h>
 #include <wsutil/strnatcmp.h>
 #include <wsutil/strtoi.h>
 
 #include "globals.h"
+#include "frame_index.h"
 
 #include "sharkd.h"
 
+/*
+ * Results of display filters over the loaded capture file are kept in a
+ * store of at most SHARKD_FILTER_STORE_MAX_SIZE bytes, from which the
+ * least recently used results are dropped first.  Results are keyed by
+ * the filter's syntax tree, so that filters differing only in spacing or
+ * macro use share results, and by the configuration profile and the
+ * generation of the configuration, which is bumped by every request that
+ * can change how frames are dissected or what they hold.
+ *
+ * If the capture file was loaded with its frame index, results are also
+ * written to a directory next to the capture file and read back when the
+ * same filter is applied to the unmodified file in a later session.
+ * Only results obtained with the configuration read from the profile are
+ * written, and the files of the profile are part of their key.
+ */
+#define SHARKD_FILTER_STORE_MAX_SIZE  (64 * 1024 * 1024)
+
+/* Frames counted by each entry of the rank table of a filter result. */
+#define SHARKD_FILTER_RANK_FRAMES     512
+#define SHARKD_FILTER_RANK_BYTES      (SHARKD_FILTER_RANK_FRAMES / 8)
+
+#define SHARKD_FILTER_DIR_SUFFIX      ".wsfilters"
+#define SHARKD_FILTER_FILE_MAGIC      "WSFLTRS\n"
+#define SHARKD_FILTER_FILE_BYTE_ORDER 0x01020304
+#define SHARKD_FILTER_FILE_VERSION    2
+
 struct sharkd_filter_item
 {
+    char *key;
     uint8_t *filtered; /* can be NULL if all frames are matching for given filter. */
+    size_t filtered_len;
+    uint32_t *rank;    /* rank[i] - number of matching frames before frame i * SHARKD_FILTER_RANK_FRAMES */
+    size_t rank_len;
+    uint32_t matched;  /* number of matching frames */
+    size_t size;       /* memory accounted to this item in the store */
+    GList *lru_link;
 };
 
+/* Header of a filter result file, followed by the key and the bitmap. */
+typedef struct {
+    char     magic[8];
+    uint32_t byte_order;
+    uint32_t version;
+    uint64_t file_size;
+    int64_t  file_mtime;
+    uint8_t  file_digest[FRAME_INDEX_DIGEST_SIZE];
+    uint32_t frame_count;
+    uint32_t all_match;
+    uint32_t key_len;
+    uint32_t reserved;
+} sharkd_filter_file_header_t;
+
 static GHashTable *filter_table;
+static GQueue filter_lru = G_QUEUE_INIT; /* most recently used first */
+static size_t filter_store_size;
+static bool filter_store_persist;
+static unsigned config_generation; /* bumped when frames may be dissected differently */
+static char *config_digest; /* digest of the files of the configuration profile */
+
+/*
+ * A worker session serves the clients of a shared daemon that loaded the
+ * same capture file with the same preferences; see sharkd_daemon.c.  Its
+ * requests come from different clients, so "bye" doesn't end it, and
+ * loading the file that is loaded already doesn't read it again.  An empty
+ * line follows the response to each request.
+ */
+static bool worker;
+
+static char *loaded_file; /* capture file currently loaded, or NULL */
 
 static int mode;
 static uint32_t rpcid;
@@ -216,7 +284,7 @@ sharkd_json_response_close(void)
      * which is too inefficient, and full buffering,
      * which is what you get if you request line buffering.
      */
-    fflush(stdout);
+    fflush(dumper.output_file);
 }
 
 static void
@@ -378,6 +446,7 @@ json_prep(char* buf, const jsmntok_t* tokens, int count)
         {"method",     "complete",       1, JSMN_STRING,       SHARKD_JSON_STRING,   SHARKD_OPTIONAL},
         {"method",     "download",       1, JSMN_STRING,       SHARKD_JSON_STRING,   SHARKD_OPTIONAL},
         {"method",     "dumpconf",       1, JSMN_STRING,       SHARKD_JSON_STRING,   SHARKD_OPTIONAL},
+        {"method",     "filters",        1, JSMN_STRING,       SHARKD_JSON_STRING,   SHARKD_OPTIONAL},
         {"method",     "follow",         1, JSMN_STRING,       SHARKD_JSON_STRING,   SHARKD_OPTIONAL},
         {"method",     "frame",          1, JSMN_STRING,       SHARKD_JSON_STRING,   SHARKD_OPTIONAL},
         {"method",     "frames",         1, JSMN_STRING,       SHARKD_JSON_STRING,   SHARKD_OPTIONAL},
@@ -397,8 +466,19 @@ json_prep(char* buf, const jsmntok_t* tokens, int count)
         {"complete",   "pref",           2, JSMN_STRING,       SHARKD_JSON_STRING,   SHARKD_OPTIONAL},
         {"download",   "token",          2, JSMN_STRING,       SHARKD_JSON_STRING,   SHARKD_OPTIONAL},
         {"dumpconf",   "pref",           2, JSMN_STRING,       SHARKD_JSON_STRING,   SHARKD_OPTIONAL},
+        {"filters",    "filter0",        2, JSMN_STRING,       SHARKD_JSON_STRING,   SHARKD_MANDATORY},
+        {"filters",    "filter1",        2, JSMN_STRING,       SHARKD_JSON_STRING,   SHARKD_OPTIONAL},
+        {"filters",    "filter2",        2, JSMN_STRING,       SHARKD_JSON_STRING,   SHARKD_OPTIONAL},
+        {"filters",    "filter3",        2, JSMN_STRING,       SHARKD_JSON_STRING,   SHARKD_OPTIONAL},
+        {"filters",    "filter4",        2, JSMN_STRING,       SHARKD_JSON_STRING,   SHARKD_OPTIONAL},
+        {"filters",    "filter5",        2, JSMN_STRING,       SHARKD_JSON_STRING,   SHARKD_OPTIONAL},
+        {"filters",    "filter6",        2, JSMN_STRING,       SHARKD_JSON_STRING,   SHARKD_OPTIONAL},
+        {"filters",    "filter7",        2, JSMN_STRING,       SHARKD_JSON_STRING,   SHARKD_OPTIONAL},
+        {"filters",    "filter8",        2, JSMN_STRING,       SHARKD_JSON_STRING,   SHARKD_OPTIONAL},
+        {"filters",    "filter9",        2, JSMN_STRING,       SHARKD_JSON_STRING,   SHARKD_OPTIONAL},
         {"follow",     "follow",         2, JSMN_STRING,       SHARKD_JSON_STRING,   SHARKD_MANDATORY},
         {"follow",     "filter",         2, JSMN_STRING,       SHARKD_JSON_STRING,   SHARKD_MANDATORY},
+        {"follow",     "stream",         2, JSMN_PRIMITIVE,    SHARKD_JSON_UINTEGER, SHARKD_OPTIONAL},
         {"follow",     "sub_stream",     2, JSMN_PRIMITIVE,    SHARKD_JSON_UINTEGER, SHARKD_OPTIONAL},
         {"frame",      "frame",          2, JSMN_PRIMITIVE,    SHARKD_JSON_UINTEGER, SHARKD_MANDATORY},
         {"frame",      "proto",          2, JSMN_PRIMITIVE,    SHARKD_JSON_BOOLEAN,  SHARKD_OPTIONAL},
@@ -449,6 +529,7 @@ json_prep(char* buf, const jsmntok_t* tokens, int count)
         {"iograph",    "aot8",           2, JSMN_PRIMITIVE,    SHARKD_JSON_BOOLEAN,  SHARKD_OPTIONAL},
         {"iograph",    "aot9",           2, JSMN_PRIMITIVE,    SHARKD_JSON_BOOLEAN,  SHARKD_OPTIONAL},
         {"load",       "file",           2, JSMN_STRING,       SHARKD_JSON_STRING,   SHARKD_MANDATORY},
+        {"load",       "index",          2, JSMN_PRIMITIVE,    SHARKD_JSON_BOOLEAN,  SHARKD_OPTIONAL},
         {"setcomment", "frame",          2, JSMN_PRIMITIVE,    SHARKD_JSON_UINTEGER, SHARKD_MANDATORY},
         {"setcomment", "comment",        2, JSMN_STRING,       SHARKD_JSON_STRING,   SHARKD_OPTIONAL},
         {"setconf",    "name",           2, JSMN_STRING,       SHARKD_JSON_STRING,   SHARKD_MANDATORY},
@@ -736,31 +817,500 @@ sharkd_session_filter_free(void *data)
 {
     struct sharkd_filter_item *l = (struct sharkd_filter_item *) data;
 
+    g_free(l->key);
     g_free(l->filtered);
+    g_free(l->rank);
     g_free(l);
 }
 
-static const struct sharkd_filter_item *
-sharkd_session_filter_data(const char *filter)
+static struct sharkd_filter_item *
+sharkd_session_filter_item_new(char *key, uint8_t *filtered)
+{
+    struct sharkd_filter_item *l = g_new0(struct sharkd_filter_item, 1);
+
+    l->key = key;
+    l->filtered = filtered;
+
+    if (filtered)
+    {
+        l->filtered_len = 2 + (cfile.count / 8);
+        l->rank_len = (l->filtered_len + SHARKD_FILTER_RANK_BYTES - 1) / SHARKD_FILTER_RANK_BYTES;
+        l->rank = g_new(uint32_t, l->rank_len);
+
+        for (size_t i = 0; i < l->rank_len; i++)
+        {
+            size_t end = MIN((i + 1) * SHARKD_FILTER_RANK_BYTES, l->filtered_len);
+
+            l->rank[i] = l->matched;
+            for (size_t j = i * SHARKD_FILTER_RANK_BYTES; j < end; j += 8)
+            {
+                uint64_t word = 0;
+
+                memcpy(&word, &filtered[j], MIN(8, end - j));
+                l->matched += ws_count_ones(word);
+            }
+        }
+    }
+    else
+        l->matched = cfile.count;
+
+    l->size = sizeof(*l) + strlen(key) + 1 + l->filtered_len + l->rank_len * sizeof(uint32_t);
+
+    return l;
+}
+
+/*
+ * Get the number of the n-th (counting from 1) frame matching a filter,
+ * or 0 if fewer frames are matching.
+ */
+static uint32_t
+sharkd_session_filter_select(const struct sharkd_filter_item *l, uint32_t n)
 {
-    struct sharkd_filter_item *l;
+    size_t lo, hi;
 
-    l = (struct sharkd_filter_item *) g_hash_table_lookup(filter_table, filter);
-    if (!l)
+    if (n == 0 || n > l->matched)
+        return 0;
+
+    if (!l->filtered)
+        return n;
+
+    /* Find the last rank entry with fewer than n matching frames before it. */
+    lo = 0;
+    hi = l->rank_len - 1;
+    while (lo < hi)
     {
-        uint8_t *filtered = NULL;
+        size_t mid = (lo + hi + 1) / 2;
 
-        int ret = sharkd_filter(filter, &filtered);
+        if (l->rank[mid] < n)
+            lo = mid;
+        else
+            hi = mid - 1;
+    }
 
-        if (ret == -1)
-            return NULL;
+    n -= l->rank[lo];
+    for (size_t i = lo * SHARKD_FILTER_RANK_BYTES; i < l->filtered_len; i++)
+    {
+        uint32_t ones = ws_count_ones(l->filtered[i]);
 
-        l = g_new(struct sharkd_filter_item, 1);
-        l->filtered = filtered;
+        if (n > ones)
+        {
+            n -= ones;
+            continue;
+        }
 
-        g_hash_table_insert(filter_table, g_strdup(filter), l);
+        for (unsigned bit = 0; bit < 8; bit++)
+        {
+            if ((l->filtered[i] & (1 << bit)) && --n == 0)
+                return (uint32_t) (i * 8 + bit);
+        }
     }
 
+    return 0;
+}
+
+static void
+sharkd_session_filter_store_add(struct sharkd_filter_item *l)
+{
+    g_hash_table_insert(filter_table, l->key, l);
+    g_queue_push_head(&filter_lru, l);
+    l->lru_link = filter_lru.head;
+    filter_store_size += l->size;
+}
+
+static void
+sharkd_session_filter_store_touch(struct sharkd_filter_item *l)
+{
+    g_queue_unlink(&filter_lru, l->lru_link);
+    g_queue_push_head_link(&filter_lru, l->lru_link);
+}
+
+/*
+ * Drop the least recently used results until the store fits its budget.
+ * This is only done before looking up results, so that results handed
+ * out by the previous lookup stay valid while they're used.
+ */
+static void
+sharkd_session_filter_store_trim(void)
+{
+    while (filter_store_size > SHARKD_FILTER_STORE_MAX_SIZE && !g_queue_is_empty(&filter_lru))
+    {
+        struct sharkd_filter_item *l = (struct sharkd_filter_item *) g_queue_pop_tail(&filter_lru);
+
+        filter_store_size -= l->size;
+        g_hash_table_remove(filter_table, l->key);
+    }
+}
+
+static void
+sharkd_session_filter_store_clear(void)
+{
+    g_queue_clear(&filter_lru);
+    g_hash_table_remove_all(filter_table);
+    filter_store_size = 0;
+}
+
+/*
+ * Note that the configuration changed, so that filter results obtained
+ * before aren't used any more.
+ */
+static void
+sharkd_session_config_changed(void)
+{
+    config_generation++;
+}
+
+static int
+sharkd_session_strcmp_indirect(const void *a, const void *b)
+{
+    return strcmp(*(const char * const *) a, *(const char * const *) b);
+}
+
+/*
+ * Get the digest of the names, sizes and modification times of the files
+ * of the configuration profile, which tells whether results written by an
+ * earlier session were obtained with the same configuration.
+ */
+static const char *
+sharkd_session_config_digest(void)
+{
+    char *profile_dir;
+    GDir *dir;
+    GPtrArray *names;
+    GChecksum *checksum;
+    const char *name;
+
+    if (config_digest)
+        return config_digest;
+
+    names = g_ptr_array_new_with_free_func(g_free);
+    profile_dir = get_profile_dir(get_profile_name(), false);
+    if ((dir = g_dir_open(profile_dir, 0, NULL)) != NULL)
+    {
+        while ((name = g_dir_read_name(dir)) != NULL)
+        {
+            /* Written by Wireshark on exit; doesn't change dissection. */
+            if (g_str_has_prefix(name, "recent"))
+                continue;
+            g_ptr_array_add(names, g_strdup(name));
+        }
+        g_dir_close(dir);
+    }
+    g_ptr_array_sort(names, sharkd_session_strcmp_indirect);
+
+    checksum = g_checksum_new(G_CHECKSUM_SHA256);
+    for (unsigned i = 0; i < names->len; i++)
+    {
+        char *path = g_build_filename(profile_dir, (const char *) names->pdata[i], NULL);
+        ws_statb64 statb;
+
+        if (g_file_test(path, G_FILE_TEST_IS_REGULAR) && ws_stat64(path, &statb) == 0)
+        {
+            char *entry = ws_strdup_printf("%s\n%" PRIu64 "\n%" PRId64 "\n",
+                    (const char *) names->pdata[i], (uint64_t) statb.st_size, (int64_t) statb.st_mtime);
+
+            g_checksum_update(checksum, (const unsigned char *) entry, strlen(entry));
+            g_free(entry);
+        }
+        g_free(path);
+    }
+    config_digest = g_strdup(g_checksum_get_string(checksum));
+    g_checksum_free(checksum);
+
+    g_ptr_array_free(names, true);
+    g_free(profile_dir);
+
+    return config_digest;
+}
+
+/*
+ * Compile a filter the way needed to build the key of its results.
+ */
+static bool
+sharkd_session_filter_compile(const char *filter, dfilter_t **dfcode, df_error_t **df_err)
+{
+    return dfilter_compile_full(filter, dfcode, df_err, DF_SAVE_TREE | DF_EXPAND_MACROS | DF_OPTIMIZE, __func__);
+}
+
+/*
+ * Build the key of the results of a filter compiled with
+ * sharkd_session_filter_compile().
+ */
+static char *
+sharkd_session_filter_key(dfilter_t *dfcode)
+{
+    const char *tree;
+
+    /* if dfilter_compile() success, but (dfcode == NULL) all frames are matching */
+    if (dfcode == NULL)
+        tree = "";
+    else if ((tree = dfilter_syntax_tree(dfcode)) == NULL)
+        tree = dfilter_text(dfcode);
+
+    return ws_strdup_printf("%s\n%s\n%u\n%s", get_profile_name(),
+            sharkd_session_config_digest(), config_generation, tree);
+}
+
+static char *
+sharkd_session_filter_file_name(const char *key)
+{
+    char *dir_name = ws_strdup_printf("%s%s", cfile.filename, SHARKD_FILTER_DIR_SUFFIX);
+    char *digest = g_compute_checksum_for_string(G_CHECKSUM_SHA256, key, -1);
+    char *file_name = g_build_filename(dir_name, digest, NULL);
+
+    g_free(digest);
+    g_free(dir_name);
+    return file_name;
+}
+
+static bool
+sharkd_session_filter_file_header(sharkd_filter_file_header_t *hdr)
+{
+    ws_statb64 statb;
+
+    memset(hdr, 0, sizeof(*hdr));
+    memcpy(hdr->magic, SHARKD_FILTER_FILE_MAGIC, sizeof(hdr->magic));
+    hdr->byte_order = SHARKD_FILTER_FILE_BYTE_ORDER;
+    hdr->version = SHARKD_FILTER_FILE_VERSION;
+
+    if (ws_stat64(cfile.filename, &statb) != 0)
+        return false;
+    hdr->file_size = (uint64_t) statb.st_size;
+    hdr->file_mtime = (int64_t) statb.st_mtime;
+    if (!frame_index_file_digest(cfile.filename, hdr->file_digest))
+        return false;
+    hdr->frame_count = cfile.count;
+    return true;
+}
+
+/*
+ * Read the results of a filter written by an earlier session, if they are
+ * for the capture file as it is now.
+ */
+static struct sharkd_filter_item *
+sharkd_session_filter_read(const char *key)
+{
+    sharkd_filter_file_header_t hdr, cur;
+    char *file_name;
+    char *contents;
+    size_t length, key_len, filtered_len;
+    uint8_t *filtered = NULL;
+
+    /* Results obtained after changing the configuration aren't written. */
+    if (!filter_store_persist || config_generation != 0)
+        return NULL;
+
+    file_name = sharkd_session_filter_file_name(key);
+    if (!g_file_get_contents(file_name, &contents, &length, NULL))
+    {
+        g_free(file_name);
+        return NULL;
+    }
+    g_free(file_name);
+
+    key_len = strlen(key);
+    filtered_len = 2 + (cfile.count / 8);
+
+    if (length < sizeof(hdr) || !sharkd_session_filter_file_header(&cur))
+        goto unusable;
+    memcpy(&hdr, contents, sizeof(hdr));
+    if (memcmp(hdr.magic, cur.magic, sizeof(hdr.magic)) != 0 ||
+            hdr.byte_order != cur.byte_order || hdr.version != cur.version ||
+            hdr.file_size != cur.file_size || hdr.file_mtime != cur.file_mtime ||
+            memcmp(hdr.file_digest, cur.file_digest, sizeof(hdr.file_digest)) != 0 ||
+            hdr.frame_count != cur.frame_count || hdr.key_len != key_len)
+        goto unusable;
+    if (length != sizeof(hdr) + key_len + (hdr.all_match ? 0 : filtered_len) ||
+            memcmp(contents + sizeof(hdr), key, key_len) != 0)
+        goto unusable;
+
+    if (!hdr.all_match)
+        filtered = (uint8_t *) g_memdup2(contents + sizeof(hdr) + key_len, filtered_len);
+    g_free(contents);
+
+    return sharkd_session_filter_item_new(g_strdup(key), filtered);
+
+unusable:
+    g_free(contents);
+    return NULL;
+}
+
+/*
+ * Write the results of a filter next to the capture file.  Failing to do
+ * so only costs evaluating the filter again in a later session.
+ */
+static void
+sharkd_session_filter_write(const struct sharkd_filter_item *l)
+{
+    sharkd_filter_file_header_t hdr;
+    char *dir_name, *file_name, *tmp_name;
+    FILE *fh;
+    bool ok = true;
+
+    if (!filter_store_persist || config_generation != 0 ||
+            !sharkd_session_filter_file_header(&hdr))
+        return;
+
+    hdr.all_match = (l->filtered == NULL);
+    hdr.key_len = (uint32_t) strlen(l->key);
+
+    dir_name = ws_strdup_printf("%s%s", cfile.filename, SHARKD_FILTER_DIR_SUFFIX);
+    if (ws_mkdir(dir_name, 0755) != 0 && errno != EEXIST)
+    {
+        fprintf(stderr, "sharkd_session_filter_write() can't create %s: %s\n", dir_name, g_strerror(errno));
+        g_free(dir_name);
+        return;
+    }
+    g_free(dir_name);
+
+    file_name = sharkd_session_filter_file_name(l->key);
+    tmp_name = ws_strdup_printf("%s.tmp", file_name);
+    fh = ws_fopen(tmp_name, "wb");
+    if (!fh)
+    {
+        g_free(tmp_name);
+        g_free(file_name);
+        return;
+    }
+
+    if (fwrite(&hdr, sizeof(hdr), 1, fh) != 1 ||
+            fwrite(l->key, 1, hdr.key_len, fh) != hdr.key_len ||
+            (l->filtered && fwrite(l->filtered, 1, l->filtered_len, fh) != l->filtered_len))
+        ok = false;
+    if (fclose(fh) != 0)
+        ok = false;
+
+    if (ok)
+    {
+        /* On Windows, rename() fails if the target exists. */
+        ws_unlink(file_name);
+        ok = (ws_rename(tmp_name, file_name) == 0);
+    }
+    if (!ok)
+        ws_unlink(tmp_name);
+
+    g_free(tmp_name);
+    g_free(file_name);
+}
+
+/*
+ * Get the results of several filters compiled with
+ * sharkd_session_filter_compile(), which are freed.  Filters without
+ * results in the store are evaluated together, in a single pass over the
+ * frames.
+ *
+ * The items stay valid until the next call.
+ */
+static void
+sharkd_session_filter_data_batch(dfilter_t **dfcodes, unsigned count, const struct sharkd_filter_item **items)
+{
+    dfilter_t **pending_dfcodes = g_new(dfilter_t *, count);
+    char **pending_keys = g_new(char *, count);
+    unsigned *pending_of = g_new(unsigned, count);
+    unsigned pending = 0;
+
+    sharkd_session_filter_store_trim();
+
+    for (unsigned i = 0; i < count; i++)
+    {
+        struct sharkd_filter_item *l;
+        dfilter_t *dfcode = dfcodes[i];
+        char *key;
+        unsigned j;
+
+        items[i] = NULL;
+        pending_of[i] = UINT_MAX;
+
+        key = sharkd_session_filter_key(dfcode);
+
+        l = (struct sharkd_filter_item *) g_hash_table_lookup(filter_table, key);
+        if (l)
+        {
+            sharkd_session_filter_store_touch(l);
+        }
+        else if ((l = sharkd_session_filter_read(key)) != NULL)
+        {
+            sharkd_session_filter_store_add(l);
+        }
+        else if (dfcode == NULL)
+        {
+            l = sharkd_session_filter_item_new(key, NULL);
+            sharkd_session_filter_store_add(l);
+            key = NULL;
+        }
+
+        if (l)
+        {
+            items[i] = l;
+            g_free(key);
+            dfilter_free(dfcode);
+            continue;
+        }
+
+        /* The same filter may be asked for twice. */
+        for (j = 0; j < pending; j++)
+        {
+            if (!strcmp(pending_keys[j], key))
+                break;
+        }
+
+        if (j < pending)
+        {
+            g_free(key);
+            dfilter_free(dfcode);
+        }
+        else
+        {
+            pending_dfcodes[pending] = dfcode;
+            pending_keys[pending] = key;
+            pending++;
+        }
+        pending_of[i] = j;
+    }
+
+    if (pending)
+    {
+        uint8_t **results = g_new(uint8_t *, pending);
+        struct sharkd_filter_item **pending_items = g_new(struct sharkd_filter_item *, pending);
+
+        sharkd_filter_batch(pending_dfcodes, pending, results);
+
+        for (unsigned j = 0; j < pending; j++)
+        {
+            pending_items[j] = sharkd_session_filter_item_new(pending_keys[j], results[j]);
+            sharkd_session_filter_store_add(pending_items[j]);
+            sharkd_session_filter_write(pending_items[j]);
+            dfilter_free(pending_dfcodes[j]);
+        }
+
+        for (unsigned i = 0; i < count; i++)
+        {
+            if (pending_of[i] != UINT_MAX)
+                items[i] = pending_items[pending_of[i]];
+        }
+
+        g_free(pending_items);
+        g_free(results);
+    }
+
+    g_free(pending_of);
+    g_free(pending_keys);
+    g_free(pending_dfcodes);
+}
+
+/*
+ * Get the results of a filter, or NULL if the filter is invalid.
+ */
+static const struct sharkd_filter_item *
+sharkd_session_filter_data(const char *filter)
+{
+    const struct sharkd_filter_item *l;
+    dfilter_t *dfcode = NULL;
+
+    if (!sharkd_session_filter_compile(filter, &dfcode, NULL))
+        return NULL;
+
+    sharkd_session_filter_data_batch(&dfcode, 1, &l);
+
     return l;
 }
 
@@ -1166,6 +1716,19 @@ sharkd_session_process_info(void)
     sharkd_json_result_epilogue();
 }
 
+/*
+ * Close the loaded capture file, dropping the filter results kept for it.
+ */
+static void
+sharkd_session_close_file(void)
+{
+    sharkd_session_filter_store_clear();
+    filter_store_persist = false;
+    sharkd_cf_close();
+    g_free(loaded_file);
+    loaded_file = NULL;
+}
+
 /**
  * sharkd_session_process_load()
  *
@@ -1173,6 +1736,9 @@ sharkd_session_process_info(void)
  *
  * Input:
  *   (m) file - file to be loaded
+ *   (o) index - if true, use the frame index next to the file to skip
+ *               reading it, or write the index after reading it; filter
+ *               results are also kept next to the file
  *
  * Output object with attributes:
  *   (m) err - error code
@@ -1181,6 +1747,8 @@ static void
 sharkd_session_process_load(const char *buf, const jsmntok_t *tokens, int count)
 {
     const char *tok_file = json_find_attr(buf, tokens, count, "file");
+    const char *tok_index = json_find_attr(buf, tokens, count, "index");
+    bool use_index = (tok_index != NULL && !strcmp(tok_index, "true"));
     int err = 0;
 
     if (!tok_file)
@@ -1188,6 +1756,15 @@ sharkd_session_process_load(const char *buf, const jsmntok_t *tokens, int count)
 
     fprintf(stderr, "load: filename=%s\n", tok_file);
 
+    if (worker && loaded_file && !strcmp(tok_file, loaded_file))
+    {
+        /* Another client has loaded this file already. */
+        sharkd_json_simple_ok(rpcid);
+        return;
+    }
+
+    sharkd_session_close_file();
+
     if (sharkd_cf_open(tok_file, WTAP_TYPE_AUTO, false, &err) != CF_OK)
     {
         sharkd_json_error(
@@ -1199,7 +1776,7 @@ sharkd_session_process_load(const char *buf, const jsmntok_t *tokens, int count)
 
     TRY
     {
-        err = sharkd_load_cap_file();
+        err = sharkd_load_cap_file(use_index);
     }
     CATCH(OutOfMemoryError)
     {
@@ -1214,6 +1791,8 @@ sharkd_session_process_load(const char *buf, const jsmntok_t *tokens, int count)
 
     if (err == 0)
     {
+        filter_store_persist = use_index;
+        loaded_file = g_strdup(tok_file);
         sharkd_json_simple_ok(rpcid);
     }
     else
@@ -1575,10 +2154,12 @@ sharkd_session_process_frames(const char *buf, const jsmntok_t *tokens, int coun
     const char *tok_limit  = json_find_attr(buf, tokens, count, "limit");
     const char *tok_refs   = json_find_attr(buf, tokens, count, "refs");
 
+    const struct sharkd_filter_item *filter_item = NULL;
     const uint8_t *filter_data = NULL;
 
     uint32_t prev_dis_num = 0;
     uint32_t current_ref_frame = 0, next_ref_frame = UINT32_MAX;
+    uint32_t first_frame;
     uint32_t skip;
     uint32_t limit;
 
@@ -1603,8 +2184,6 @@ sharkd_session_process_frames(const char *buf, const jsmntok_t *tokens, int coun
 
     if (tok_filter)
     {
-        const struct sharkd_filter_item *filter_item;
-
         filter_item = sharkd_session_filter_data(tok_filter);
         if (!filter_item)
         {
@@ -1625,6 +2204,18 @@ sharkd_session_process_frames(const char *buf, const jsmntok_t *tokens, int coun
             return;
     }
 
+    /* Go straight to the frame after the last skipped one. */
+    first_frame = 1;
+    if (skip)
+    {
+        if (filter_item)
+            prev_dis_num = sharkd_session_filter_select(filter_item, skip);
+        else
+            prev_dis_num = (skip <= cfile.count) ? skip : 0;
+
+        first_frame = prev_dis_num ? prev_dis_num + 1 : cfile.count + 1;
+    }
+
     limit = 0;
     if (tok_limit)
     {
@@ -1643,7 +2234,7 @@ sharkd_session_process_frames(const char *buf, const jsmntok_t *tokens, int coun
     wtap_rec_init(&rec);
     ws_buffer_init(&rec_buf, 1514);
 
-    for (uint32_t framenum = 1; framenum <= cfile.count; framenum++)
+    for (uint32_t framenum = first_frame; framenum <= cfile.count; framenum++)
     {
         frame_data *fdata;
         uint32_t ref_frame = (framenum != 1) ? 1 : 0;
@@ -1654,13 +2245,6 @@ sharkd_session_process_frames(const char *buf, const jsmntok_t *tokens, int coun
         if (filter_data && !(filter_data[framenum / 8] & (1 << (framenum % 8))))
             continue;
 
-        if (skip)
-        {
-            skip--;
-            prev_dis_num = framenum;
-            continue;
-        }
-
         if (tok_refs)
         {
             if (framenum >= next_ref_frame)
@@ -3939,7 +4523,9 @@ sharkd_session_process_tap(char *buf, const jsmntok_t *tokens, int count)
  * Input:
  *   (m) follow     - follow protocol request (e.g. HTTP)
  *   (m) filter     - filter request (e.g. tcp.stream == 1)
- *   (m) stream     - stream index number
+ *   (o) stream     - stream index number that the filter matches; if given,
+ *                    only the frames in the stream are dissected, when the
+ *                    follower has recorded them
  *   (o) sub_stream - follow sub-stream index number (e.g. for HTTP/2 and QUIC streams)
  *
  * Output object with attributes:
@@ -3961,9 +4547,11 @@ sharkd_session_process_follow(char *buf, const jsmntok_t *tokens, int count)
 {
     const char *tok_follow = json_find_attr(buf, tokens, count, "follow");
     const char *tok_filter = json_find_attr(buf, tokens, count, "filter");
+    const char *tok_stream = json_find_attr(buf, tokens, count, "stream");
     const char *tok_sub_stream = json_find_attr(buf, tokens, count, "sub_stream");
 
     register_follow_t *follower;
+    wmem_array_t *stream_frames = NULL;
     GString *tap_error;
 
     follow_info_t *follow_info;
@@ -4003,7 +4591,18 @@ sharkd_session_process_follow(char *buf, const jsmntok_t *tokens, int count)
         return;
     }
 
-    sharkd_retap();
+    if (tok_stream)
+    {
+        uint32_t stream;
+
+        if (ws_strtou32(tok_stream, NULL, &stream))
+            stream_frames = follow_get_stream_frames(follower, stream);
+    }
+
+    if (stream_frames)
+        sharkd_retap_frames(stream_frames);
+    else
+        sharkd_retap();
 
     sharkd_json_result_prologue(rpcid);
 
@@ -4936,6 +5535,68 @@ sharkd_session_process_frame(char *buf, const jsmntok_t *tokens, int count)
     ws_buffer_free(&rec_buf);
 }
 
+/**
+ * sharkd_session_process_filters()
+ *
+ * Process filters request - apply several filters, in a single pass over
+ * the frames for those not applied before, so that later frames or
+ * intervals requests with any of them don't need to dissect the frames.
+ *
+ * Input:
+ *   (m) filter0 - first filter to be applied
+ *   (o) filter1...filter9 - other filters to be applied
+ *
+ * Output array of filters with attributes:
+ *   (m) filter  - filter text
+ *   (m) matched - number of frames matching the filter
+ */
+static void
+sharkd_session_process_filters(char *buf, const jsmntok_t *tokens, int count)
+{
+    const char *filters[10];
+    dfilter_t *dfcodes[10];
+    const struct sharkd_filter_item *items[10];
+    unsigned filter_count = 0;
+
+    for (unsigned i = 0; i < G_N_ELEMENTS(filters); i++)
+    {
+        char tok_name[32];
+        const char *tok_filter;
+
+        snprintf(tok_name, sizeof(tok_name), "filter%u", i);
+        tok_filter = json_find_attr(buf, tokens, count, tok_name);
+        if (!tok_filter)
+            break;
+
+        if (!sharkd_session_filter_compile(tok_filter, &dfcodes[filter_count], NULL))
+        {
+            sharkd_json_error(
+                    rpcid, -14001, NULL,
+                    "Filter expression invalid - %s", tok_name
+                    );
+            for (unsigned j = 0; j < filter_count; j++)
+                dfilter_free(dfcodes[j]);
+            return;
+        }
+
+        filters[filter_count++] = tok_filter;
+    }
+
+    sharkd_session_filter_data_batch(dfcodes, filter_count, items);
+
+    sharkd_json_result_array_prologue(rpcid);
+
+    for (unsigned i = 0; i < filter_count; i++)
+    {
+        json_dumper_begin_object(&dumper);
+        sharkd_json_value_string("filter", filters[i]);
+        sharkd_json_value_anyf("matched", "%u", items[i]->matched);
+        json_dumper_end_object(&dumper);
+    }
+
+    sharkd_json_result_array_epilogue();
+}
+
 /**
  * sharkd_session_process_check()
  *
@@ -5230,6 +5891,8 @@ sharkd_session_process_setcomment(char *buf, const jsmntok_t *tokens, int count)
     else
     {
         sharkd_set_modified_block(fdata, pkt_block);
+        /* Filters on frame.comment may match other frames now. */
+        sharkd_session_config_changed();
         sharkd_json_simple_ok(rpcid);
     }
 }
@@ -5281,6 +5944,8 @@ sharkd_session_process_setconf(char *buf, const jsmntok_t *tokens, int count)
     switch (ret)
     {
         case PREFS_SET_OK:
+            /* Dissection may change, so filter results must not be shared. */
+            sharkd_session_config_changed();
             sharkd_json_simple_ok(rpcid);
             break;
 
@@ -5954,6 +6619,8 @@ sharkd_session_process(char *buf, const jsmntok_t *tokens, int count)
             sharkd_session_process_frames(buf, tokens, count);
         else if (!strcmp(tok_method, "tap"))
             sharkd_session_process_tap(buf, tokens, count);
+        else if (!strcmp(tok_method, "filters"))
+            sharkd_session_process_filters(buf, tokens, count);
         else if (!strcmp(tok_method, "follow"))
             sharkd_session_process_follow(buf, tokens, count);
         else if (!strcmp(tok_method, "iograph"))
@@ -5973,7 +6640,9 @@ sharkd_session_process(char *buf, const jsmntok_t *tokens, int count)
         else if (!strcmp(tok_method, "bye"))
         {
             sharkd_json_simple_ok(rpcid);
-            exit(0);
+            /* The daemon ends the connection of the client. */
+            if (!worker)
+                exit(0);
         }
         else
         {
@@ -5985,20 +6654,57 @@ sharkd_session_process(char *buf, const jsmntok_t *tokens, int count)
     }
 }
 
-int
-sharkd_session_main(int mode_setting)
+/*
+ * Handle one line of input, which holds one request.
+ */
+static void
+sharkd_session_process_line(char *buf, jsmntok_t **tokens, int *tokens_max)
 {
-    char buf[8 * 1024];
-    jsmntok_t *tokens = NULL;
-    int tokens_max = -1;
+    /* every command is line separated JSON */
+    int ret;
 
-    mode = mode_setting;
+    ret = json_parse(buf, NULL, 0);
+    if (ret <= 0)
+    {
+        sharkd_json_error(
+                rpcid, -32600, NULL,
+                "Invalid JSON(1)"
+                );
+        return;
+    }
 
-    fprintf(stderr, "Hello in child.\n");
+    /* fprintf(stderr, "JSON: %d tokens\n", ret); */
+    ret += 1;
 
-    dumper.output_file = stdout;
+    if (*tokens == NULL || *tokens_max < ret)
+    {
+        *tokens_max = ret;
+        *tokens = (jsmntok_t *) g_realloc(*tokens, sizeof(jsmntok_t) * *tokens_max);
+    }
+
+    memset(*tokens, 0, ret * sizeof(jsmntok_t));
+
+    ret = json_parse(buf, *tokens, ret);
+    if (ret <= 0)
+    {
+        sharkd_json_error(
+                rpcid, -32600, NULL,
+                "Invalid JSON(2)"
+                );
+        return;
+    }
 
-    filter_table = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, sharkd_session_filter_free);
+    host_name_lookup_process();
+
+    sharkd_session_process(buf, *tokens, ret);
+}
+
+static void
+sharkd_session_init(int mode_setting)
+{
+    mode = mode_setting;
+
+    filter_table = g_hash_table_new_full(g_str_hash, g_str_equal, NULL, sharkd_session_filter_free);
 
 #ifdef HAVE_MAXMINDDB
     /* mmdbresolve was stopped before fork(), force starting it */
@@ -6006,50 +6712,48 @@ sharkd_session_main(int mode_setting)
 #endif
 
     set_resolution_synchrony(true);
+}
 
-    while (fgets(buf, sizeof(buf), stdin))
-    {
-        /* every command is line separated JSON */
-        int ret;
+int
+sharkd_session_main(int mode_setting)
+{
+    char buf[8 * 1024];
+    jsmntok_t *tokens = NULL;
+    int tokens_max = -1;
 
-        ret = json_parse(buf, NULL, 0);
-        if (ret <= 0)
-        {
-            sharkd_json_error(
-                    rpcid, -32600, NULL,
-                    "Invalid JSON(1)"
-                    );
-            continue;
-        }
+    fprintf(stderr, "Hello in child.\n");
 
-        /* fprintf(stderr, "JSON: %d tokens\n", ret); */
-        ret += 1;
+    dumper.output_file = stdout;
 
-        if (tokens == NULL || tokens_max < ret)
-        {
-            tokens_max = ret;
-            tokens = (jsmntok_t *) g_realloc(tokens, sizeof(jsmntok_t) * tokens_max);
-        }
+    sharkd_session_init(mode_setting);
 
-        memset(tokens, 0, ret * sizeof(jsmntok_t));
+    while (fgets(buf, sizeof(buf), stdin))
+    {
+        sharkd_session_process_line(buf, &tokens, &tokens_max);
 
-        ret = json_parse(buf, tokens, ret);
-        if (ret <= 0)
+        if (worker)
         {
-            sharkd_json_error(
-                    rpcid, -32600, NULL,
-                    "Invalid JSON(2)"
-                    );
-            continue;
+            /* Tell the daemon that the response is complete. */
+            fputs("\n", stdout);
+            fflush(stdout);
         }
-
-        host_name_lookup_process();
-
-        sharkd_session_process(buf, tokens, ret);
     }
 
+    sharkd_session_close_file();
     g_hash_table_destroy(filter_table);
+    g_free(config_digest);
     g_free(tokens);
 
     return 0;
 }
+
+/*
+ * Serve the clients of a shared daemon, which sends their requests to
+ * the standard input and reads the responses from the standard output.
+ */
+int
+sharkd_session_worker_main(int mode_setting)
+{
+    worker = true;
+    return sharkd_session_main(mode_setting);
+}
@@ -9,7 +9,9 @@
 
 from contextlib import contextmanager
 import os
+import random
 import re
+import struct
 import subprocess
 import sys
 import types
@@ -182,7 +184,9 @@ def features(cmd_tshark, make_env):
         have_gnutls='with GnuTLS' in tshark_v,
         have_pkcs11='and PKCS #11 support' in tshark_v,
         have_brotli='with brotli' in tshark_v,
+        have_lz4='with LZ4' in tshark_v,
         have_zstd='with Zstandard' in tshark_v,
+        have_maxminddb='with MaxMind' in tshark_v,
         have_plugins='binary plugins supported' in tshark_v,
     )
 
@@ -217,6 +221,36 @@ def result_file(tmp_path):
         return str(tmp_path / filename)
     return result_file_real
 
+@pytest.fixture
+def dhcp_copies(capture_file, result_file):
+    '''Returns a function that writes a pcap file of the given number of
+    copies of dhcp.pcap, for tests that need a large file. If seed is
+    given, each copy gets its own second, and the copies are written in
+    an order shuffled with it.'''
+    def dhcp_copies_real(copies, filename='large.pcap', seed=None):
+        with open(capture_file('dhcp.pcap'), 'rb') as f:
+            data = f.read()
+        records = []
+        offset = 24
+        while offset < len(data):
+            incl_len = struct.unpack('<I', data[offset + 8:offset + 12])[0]
+            records.append(data[offset:offset + 16 + incl_len])
+            offset += 16 + incl_len
+        order = list(range(copies))
+        if seed is not None:
+            random.Random(seed).shuffle(order)
+        out_file = result_file(filename)
+        with open(out_file, 'wb') as f:
+            f.write(data[:24])
+            for copy in order:
+                for usec, record in enumerate(records):
+                    if seed is not None:
+                        f.write(struct.pack('<II', 1000000000 + copy, usec))
+                        record = record[8:]
+                    f.write(record)
+        return out_file
+    return dhcp_copies_real
+
 @pytest.fixture
 def home_path(tmp_path):
     '''Per-test home directory.'''
@@ -598,3 +598,54 @@ class TestDumpcapPcapngSections:
         if sys.byteorder == 'big':
             pytest.skip('this test is supported on little endian only')
         check_dumpcap_pcapng_sections(self, multi_input=True, multi_output=True, env=base_env)
+
+
+class TestDumpcapCompress:
+    magic = {'gzip': b'\x1f\x8b', 'lz4': b'\x04\x22\x4d\x18', 'zstd': b'\x28\xb5\x2f\xfd'}
+    suffix = {'gzip': '.gz', 'lz4': '.lz4', 'zstd': '.zst'}
+
+    def capture(self, cmd_dumpcap, compression, args, env):
+        if sysconfig.get_platform().startswith('mingw'):
+            pytest.skip('FIXME Pipes are broken with the MSYS2 shell')
+        capture_cmd = ' '.join(['"{}"'.format(cmd_dumpcap), '-i', '-',
+            '--compress', compression, '--compress-threads', '2'] + args)
+        subprocesstest.check_run(cat_dhcp_command('cat100') + ' | ' + capture_cmd, shell=True, env=env)
+
+    def check_file(self, cmd_capinfos, compression, packets, cap_file):
+        with open(cap_file, 'rb') as f:
+            assert f.read(len(self.magic[compression])) == self.magic[compression]
+        check_packet_count(cmd_capinfos, packets, cap_file)
+
+    @pytest.mark.parametrize('compression', ('gzip', 'lz4', 'zstd'))
+    def test_dumpcap_compress_file(self, cmd_dumpcap, cmd_capinfos, result_file, compression, features, base_env):
+        '''Capture from stdin using Dumpcap into a file compressed as it's written'''
+        if compression == 'lz4' and not features.have_lz4:
+            pytest.skip('Requires lz4.')
+        if compression == 'zstd' and not features.have_zstd:
+            pytest.skip('Requires zstd.')
+        testout_file = result_file(testout_pcapng + self.suffix[compression])
+        self.capture(cmd_dumpcap, compression, ['-w', testout_file, '-a', 'packets:97'], base_env)
+        self.check_file(cmd_capinfos, compression, 97, testout_file)
+
+    def test_dumpcap_compress_ringbuffer(self, cmd_dumpcap, cmd_capinfos, result_file, features, base_env):
+        '''Capture from stdin using Dumpcap into ring buffer files compressed as they're written'''
+        if not features.have_zstd:
+            pytest.skip('Requires zstd.')
+        rb_unique = 'dhcp_rb_' + uuid.uuid4().hex[:6] # Random ID
+        testout_file = result_file('testout.{}.pcapng.zst'.format(rb_unique))
+        testout_glob = result_file('testout.{}_*.pcapng.zst'.format(rb_unique))
+        self.capture(cmd_dumpcap, 'zstd', ['-w', testout_file, '-a', 'files:2', '-b', 'packets:47'], base_env)
+
+        rb_files = glob.glob(testout_glob)
+        assert len(rb_files) == 2
+        for rbf in rb_files:
+            self.check_file(cmd_capinfos, 'zstd', 47, rbf)
+
+    def test_dumpcap_compress_with_compress_type(self, cmd_dumpcap, result_file, base_env):
+        '''--compress and --compress-type are rejected together'''
+        testout_file = result_file(testout_pcapng + '.gz')
+        proc = subprocess.run((cmd_dumpcap, '-i', '-', '-w', testout_file,
+                '--compress', 'gzip', '--compress-type', 'gzip'),
+                stdin=subprocess.DEVNULL, capture_output=True, encoding='utf-8', env=base_env)
+        assert proc.returncode != 0
+        assert "can't be used at the same time" in proc.stderr
@@ -314,6 +314,49 @@ class TestTsharkZExpert:
         assert not grep_output(proc.stdout, 'Chats')
 
 
+def io_stat_frames(output):
+    '''Returns the frame count of each column of a "-z io,stat,0,..." table.'''
+    for line in output.splitlines():
+        if '<>' in line:
+            cells = [cell.strip() for cell in line.split('|')[1:-1]]
+            return [int(cell) for cell in cells[1::2]]
+    pytest.fail('No io,stat interval row in output')
+
+
+class TestTsharkZFilters:
+    # Filters of several taps, sharing fields (with and without layers).
+    filters = (
+        'ip.addr#2 == 4.4.4.4',
+        'ip.addr == 4.4.4.4',
+        'ip.addr#5',
+        'ip.addr#6',
+        'ip.dst#[-1] == 9.9.9.9',
+        'any ip.addr > 1.1.1.1',
+        'all ip.addr > 1.1.1.1',
+        'ip.src == 7.7.7.7 xor ip.dst == 7.7.7.7',
+        'ip.addr#5',
+    )
+
+    def test_tshark_z_several_filters(self, cmd_tshark, capture_file, test_env):
+        '''Each filtered tap gets the same packets as when it is alone'''
+        expected = []
+        for dfilter in self.filters:
+            proc = subprocesstest.run((cmd_tshark, '-q', '-z', 'io,stat,0,' + dfilter,
+                '-r', capture_file('ipoipoip.pcap')), capture_output=True, env=test_env)
+            assert proc.returncode == 0
+            expected += io_stat_frames(proc.stdout)
+        # Same counts as in suite_dfilter.
+        assert expected[0] == 1 and expected[2:] == [1, 0, 1, 2, 1, 1, 1]
+
+        proc = subprocesstest.run((cmd_tshark, '-q',
+            '-z', 'io,stat,0,' + ','.join(self.filters),
+            # A filtered tap that doesn't get any packets.
+            '-z', 'expert,ip',
+            '-r', capture_file('ipoipoip.pcap')), capture_output=True, env=test_env)
+        assert proc.returncode == 0
+        assert io_stat_frames(proc.stdout) == expected
+
+
 class TestTsharkExtcap:
     # dumpcap dependency has been added to run this test only with capture support
     def test_tshark_extcap_interfaces(self, cmd_tshark, cmd_dumpcap, test_env, home_path):
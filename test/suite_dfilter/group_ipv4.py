@@ -105,6 +105,18 @@ class TestDfilterIpv4:
         dfilter = "ip.src != 200.0.0.0/8"
         checkDFilterCount(dfilter, 2)
 
+    def test_cidr_in_1(self, checkDFilterCount):
+        dfilter = "ip.src in {10.0.0.0/8, 172.25.0.0/16}"
+        checkDFilterCount(dfilter, 1)
+
+    def test_cidr_in_2(self, checkDFilterCount):
+        dfilter = "ip.src in {10.0.0.0/8, 192.168.0.0/16}"
+        checkDFilterCount(dfilter, 0)
+
+    def test_cidr_in_specialized(self, checkDFilterSucceed):
+        dfilter = "ip.src in {10.0.0.0/8, 172.25.0.0/16}"
+        checkDFilterSucceed(dfilter, "FIELD_IN_IPV4")
+
     def test_slice_1(self, checkDFilterCount):
          dfilter = "ip.src[0:2] == ac:19"
          checkDFilterCount(dfilter, 1)
@@ -128,3 +140,27 @@ class TestDfilterIpv4:
     def test_count_2(self, checkDFilterCount):
          dfilter = "count(ip.addr) == 2"
          checkDFilterCount(dfilter, 2)
+
+class TestDfilterIpv4Flags:
+    # The flags are added with proto_tree_add_bitmask_with_flags().
+    trace_file = "http.pcap"
+
+    def test_flags_df_1(self, checkDFilterCount):
+        dfilter = "ip.flags.df == 1"
+        checkDFilterCount(dfilter, 1)
+
+    def test_flags_mf_1(self, checkDFilterCount):
+        dfilter = "ip.flags.mf == 0"
+        checkDFilterCount(dfilter, 1)
+
+    def test_flags_mf_2(self, checkDFilterCount):
+        dfilter = "ip.flags.mf == 1"
+        checkDFilterCount(dfilter, 0)
+
+    def test_flags_exists_1(self, checkDFilterCount):
+        dfilter = "ip.flags.rb"
+        checkDFilterCount(dfilter, 1)
+
+    def test_flags_and_header_1(self, checkDFilterCount):
+        dfilter = "ip.flags == 0x2 && ip.flags.df && !ip.flags.mf"
+        checkDFilterCount(dfilter, 1)
@@ -45,6 +45,14 @@ class TestDfilterMembership:
         dfilter = 'all tcp.port in {70, 80, 90}'
         checkDFilterCount(dfilter, 0)
 
+    def test_membership_specialized_1(self, checkDFilterSucceed):
+        dfilter = 'tcp.port in {80, 3267}'
+        checkDFilterSucceed(dfilter, "FIELD_IN_UINT")
+
+    def test_membership_specialized_2(self, checkDFilterCount):
+        dfilter = 'tcp.port in {70, 80} or tcp.port == 3267'
+        checkDFilterCount(dfilter, 1)
+
     def test_membership_range_match_1(self, checkDFilterCount):
         dfilter = 'tcp.port in {80..81}'
         checkDFilterCount(dfilter, 1)
@@ -10,6 +10,8 @@
 
 import sys
 import os.path
+import re
+import struct
 import subprocess
 from subprocesstest import count_output, grep_output
 import pytest
@@ -934,3 +936,155 @@ class TestDecompressMongo:
         ), encoding='utf-8', env=test_env)
         # Check the element names of the decompressed body.
         assert 'drop,lsid,id,$db' == stdout.strip()
+
+
+def _ipv4_frame(src, dst, proto, payload):
+    ip = bytearray(struct.pack('>BBHHHBBH4s4s', 0x45, 0, 20 + len(payload),
+                               0, 0, 64, proto, 0, bytes(src), bytes(dst)))
+    checksum = sum(struct.unpack('>10H', ip))
+    checksum = (checksum & 0xffff) + (checksum >> 16)
+    checksum = (checksum & 0xffff) + (checksum >> 16)
+    ip[10:12] = struct.pack('>H', ~checksum & 0xffff)
+    return b'\x00\x00\x5e\x00\x53\x02\x00\x00\x5e\x00\x53\x01\x08\x00' + bytes(ip) + payload
+
+
+def _write_pcap(capture, records):
+    records.sort(key=lambda record: record[0])
+    with open(capture, 'wb') as f:
+        f.write(struct.pack('<IHHiIII', 0xa1b2c3d4, 2, 4, 0, 0, 65535, 1))
+        for ts, frame in records:
+            secs = int(ts)
+            f.write(struct.pack('<IIII', 1700000000 + secs, round((ts - secs) * 1000000), len(frame), len(frame)))
+            f.write(frame)
+    return capture
+
+
+def _dns_message(dns_id, name, response):
+    qname = b''.join(bytes((len(label),)) + label for label in name.encode().split(b'.')) + b'\x00'
+    message = struct.pack('>HHHHHH', dns_id, 0x8180 if response else 0x0100, 1, 1 if response else 0, 0, 0)
+    message += qname + struct.pack('>HH', 1, 1)
+    if response:
+        message += struct.pack('>HHHIH4s', 0xc00c, 1, 1, 60, 4, bytes((192, 0, 2, 1)))
+    return message
+
+
+@pytest.fixture
+def many_conversations_capture(result_file):
+    '''A pcap file of 120 DNS lookups and 40 HTTP connections, 5 s apart,
+    followed by a minute of lookups on a single conversation.'''
+    client, dns_server, web_server = (10, 0, 0, 1), (10, 0, 0, 53), (10, 0, 0, 80)
+    records = []
+
+    def udp(ts, src, sport, dst, dport, payload):
+        records.append((ts, _ipv4_frame(src, dst, 17,
+            struct.pack('>HHHH', sport, dport, 8 + len(payload), 0) + payload)))
+
+    def tcp(ts, src, sport, dst, dport, seq, ack, flags, payload=b''):
+        records.append((ts, _ipv4_frame(src, dst, 6,
+            struct.pack('>HHIIBBHHH', sport, dport, seq, ack, 5 << 4, flags, 65535, 0, 0) + payload)))
+
+    for i in range(120):
+        start = i * 5.0
+        name = 'host%d.example.com' % i
+        udp(start, client, 20000 + i, dns_server, 53, _dns_message(i, name, False))
+        udp(start + 0.02, dns_server, 53, client, 20000 + i, _dns_message(i, name, True))
+        if i % 3 == 0:
+            port = 30000 + i
+            request = b'GET /page%d HTTP/1.1\r\nHost: www.example.com\r\n\r\n' % i
+            response = b'HTTP/1.1 200 OK\r\nContent-Length: 5\r\n\r\nhello'
+            c, s = 1000, 5000
+            tcp(start + 1.00, client, port, web_server, 80, c, 0, 0x02)
+            tcp(start + 1.01, web_server, 80, client, port, s, c + 1, 0x12)
+            tcp(start + 1.02, client, port, web_server, 80, c + 1, s + 1, 0x10)
+            tcp(start + 1.03, client, port, web_server, 80, c + 1, s + 1, 0x18, request)
+            c += 1 + len(request)
+            tcp(start + 1.05, web_server, 80, client, port, s + 1, c, 0x18, response)
+            s += 1 + len(response)
+            tcp(start + 1.06, client, port, web_server, 80, c, s, 0x11)
+            tcp(start + 1.07, web_server, 80, client, port, s, c + 1, 0x11)
+            tcp(start + 1.08, client, port, web_server, 80, c + 1, s + 1, 0x10)
+    for i in range(8):
+        ts = 700.0 + i * 8
+        name = 'late%d.example.com' % i
+        udp(ts, client, 19999, dns_server, 53, _dns_message(1000 + i, name, False))
+        udp(ts + 0.02, dns_server, 53, client, 19999, _dns_message(1000 + i, name, True))
+
+    return _write_pcap(result_file('many-conversations.pcap'), records)
+
+
+@pytest.fixture
+def long_flows_capture(result_file):
+    '''Returns a function that writes a pcap file of a UDP flow and a TCP
+    connection, on ports nothing dissects, with the given number of steps
+    of one UDP datagram and one TCP segment and its ACK, 0.1 s apart.'''
+    def long_flows_capture_real(steps):
+        client, server = (10, 0, 0, 1), (10, 0, 0, 2)
+        records = []
+
+        def tcp(ts, src, sport, dst, dport, seq, ack, flags, payload=b''):
+            records.append((ts, _ipv4_frame(src, dst, 6,
+                struct.pack('>HHIIBBHHH', sport, dport, seq, ack, 5 << 4, flags, 65535, 0, 0) + payload)))
+
+        c, s = 1000, 5000
+        tcp(0.00, client, 40001, server, 40002, c, 0, 0x02)
+        tcp(0.01, server, 40002, client, 40001, s, c + 1, 0x12)
+        tcp(0.02, client, 40001, server, 40002, c + 1, s + 1, 0x10)
+        c += 1
+        s += 1
+        for i in range(steps):
+            ts = 1.0 + i * 0.1
+            payload = b'ping %06d' % i
+            records.append((ts, _ipv4_frame(client, server, 17,
+                struct.pack('>HHHH', 40003, 40004, 8 + len(payload), 0) + payload)))
+            tcp(ts + 0.01, client, 40001, server, 40002, c, s, 0x18, payload)
+            c += len(payload)
+            tcp(ts + 0.02, server, 40002, client, 40001, s, c, 0x10)
+        return _write_pcap(result_file('long-flows-%d.pcap' % steps), records)
+    return long_flows_capture_real
+
+
+class TestDissectExpireIdle:
+    fields = ('frame.number', 'udp.stream', 'tcp.stream', 'dns.qry.name',
+              'dns.response_to', 'dns.time', 'dns.retransmission',
+              'tcp.analysis.acks_frame', 'tcp.completeness',
+              'http.request.uri', 'http.response.code', 'http.request_in', 'http.time')
+
+    def run_tshark(self, cmd_tshark, capture, env, *args):
+        fields = [arg for field in self.fields for arg in ('-e', field)]
+        proc = subprocess.run((cmd_tshark, '-r', capture, *args, '-T', 'fields', *fields),
+            stdout=subprocess.PIPE, stderr=subprocess.PIPE, encoding='utf-8', check=True, env=env)
+        return proc.stdout, proc.stderr
+
+    def test_expire_idle_same_output(self, cmd_tshark, many_conversations_capture, test_env):
+        '''Expiring idle conversations doesn't change what is dissected'''
+        expected, _ = self.run_tshark(cmd_tshark, many_conversations_capture, test_env)
+        actual, stderr = self.run_tshark(cmd_tshark, many_conversations_capture, test_env,
+            '--expire-idle', '30')
+        assert actual == expected
+        # Every lookup and HTTP request was matched with its response.
+        assert count_output(expected, r'\t200\t') == 40
+        assert len([line for line in expected.splitlines() if line.split('\t')[4]]) == 128
+
+        counts = re.search(r'(\d+) idle conversations? and \d+ reassembl(?:y|ies) expired, '
+            r'(\d+) conversations? left \(at most (\d+)\)', stderr)
+        assert counts, stderr
+        expired, left, peak = (int(count) for count in counts.groups())
+        # 161 conversations were seen, but only the recent ones were held,
+        # and at the end only the last one is left.
+        assert expired >= 150
+        assert peak < 40
+        assert left < peak
+
+    def test_expire_idle_memory_flat(self, cmd_tshark, long_flows_capture, test_env):
+        '''Memory kept for the whole file doesn't grow with the packets in
+        long-lived flows'''
+        used = []
+        for steps in (1000, 4000):
+            _, stderr = self.run_tshark(cmd_tshark, long_flows_capture(steps), test_env,
+                '--expire-idle', '30')
+            in_use = re.search(r'(\d+) bytes of file scope memory in use', stderr)
+            assert in_use, stderr
+            used.append(int(in_use.group(1)))
+        # 9000 more packets, of which the per-packet data used to take
+        # dozens of bytes each, held until the end.
+        assert used[1] - used[0] < 16384, used
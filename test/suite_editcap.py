@@ -0,0 +1,114 @@
+#
+# Wireshark tests
+#
+# SPDX-License-Identifier: GPL-2.0-or-later
+#
+'''Editcap tests'''
+
+import hashlib
+import re
+import struct
+import subprocess
+import pytest
+
+
+def frame(tag):
+    '''An Ethernet frame whose contents, and so hash, depend on tag.'''
+    payload = tag.encode('ascii') * 8
+    return b'\xff' * 6 + b'\x00\x11\x22\x33\x44\x55' + b'\x88\xb5' + payload
+
+
+def write_pcap(path, frames):
+    '''Write (timestamp, tag) pairs to a microsecond pcap file.'''
+    with open(path, 'wb') as f:
+        f.write(struct.pack('<IHHiIII', 0xa1b2c3d4, 2, 4, 0, 0, 65535, 1))
+        for ts, tag in frames:
+            data = frame(tag)
+            sec = int(ts)
+            usec = round((ts - sec) * 1000000)
+            f.write(struct.pack('<IIII', 1000000000 + sec, usec, len(data), len(data)))
+            f.write(data)
+    return path
+
+
+def read_pcap(path):
+    '''Return the (timestamp, tag) pairs in a pcap file written by write_pcap.'''
+    frames = []
+    with open(path, 'rb') as f:
+        data = f.read()
+    offset = 24
+    while offset < len(data):
+        sec, usec, incl_len = struct.unpack('<III', data[offset:offset + 12])
+        offset += 16
+        tag = data[offset + 14:offset + 15].decode('ascii')
+        frames.append((sec - 1000000000 + usec / 1000000, tag))
+        offset += incl_len
+    return frames
+
+
+# The second B and the third A are seven frames after the previous B
+# and A, outside -d's window of 5 and inside a window of 10. Every frame
+# is 0.1 s after the previous one, apart from the third A, which is
+# 2.1 s after the previous A.
+dedup_frames = [
+    (0.0, 'A'), (0.1, 'B'), (0.2, 'A'), (0.3, 'C'), (0.4, 'D'),
+    (0.5, 'E'), (0.6, 'F'), (0.7, 'G'), (0.8, 'B'), (2.3, 'A'),
+]
+
+
+@pytest.fixture
+def dedup(cmd_editcap, result_file, base_env):
+    def dedup_real(frames, *args):
+        infile = write_pcap(result_file('dups.pcap'), frames)
+        outfile = result_file('deduped.pcap')
+        proc = subprocess.run((cmd_editcap, *args, infile, outfile),
+            check=True, capture_output=True, encoding='utf-8', env=base_env)
+        return read_pcap(outfile), proc.stderr
+    return dedup_real
+
+
+dup_hash_args = pytest.mark.parametrize('dup_hash', ((), ('--dup-hash', 'md5'), ('--dup-hash', 'murmur3')))
+
+
+class TestEditcapDedup:
+    @dup_hash_args
+    def test_editcap_dedup_default_window(self, dedup, dup_hash):
+        '''-d removes a duplicate within the last four frames only'''
+        frames, _ = dedup(dedup_frames, *dup_hash, '-d')
+        assert frames == dedup_frames[:2] + dedup_frames[3:]
+
+    @dup_hash_args
+    def test_editcap_dedup_window(self, dedup, dup_hash):
+        '''-D 10 removes duplicates within the last nine frames'''
+        frames, _ = dedup(dedup_frames, *dup_hash, '-D', '10')
+        assert frames == dedup_frames[:2] + dedup_frames[3:8]
+
+    @dup_hash_args
+    def test_editcap_dedup_time_window(self, dedup, dup_hash):
+        '''-w 1 removes duplicates at most a second after a matching frame'''
+        frames, _ = dedup(dedup_frames, *dup_hash, '-w', '1')
+        assert frames == dedup_frames[:2] + dedup_frames[3:8] + dedup_frames[9:]
+
+    @dup_hash_args
+    def test_editcap_dedup_time_window_out_of_order(self, dedup, dup_hash):
+        '''-w looks past frames out of order to earlier matching frames'''
+        # The Y frame is five seconds earlier than the X frames, which
+        # are half a second apart.
+        out_of_order = [(10.0, 'X'), (5.0, 'Y'), (10.5, 'X')]
+        frames, _ = dedup(out_of_order, *dup_hash, '-w', '1')
+        assert frames == out_of_order[:2]
+
+    def test_editcap_dedup_md5_verbose(self, dedup):
+        '''-V prints each frame's MD5 hash'''
+        _, stderr = dedup(dedup_frames[:3], '-V', '-D', '0', '--dup-hash', 'md5')
+        hashes = re.findall(r'Packet: \d+, Len: \d+, MD5 Hash: ([0-9a-f]{32})', stderr)
+        assert hashes == [hashlib.md5(frame(tag)).hexdigest() for _, tag in dedup_frames[:3]]
+
+    def test_editcap_dedup_murmur3_verbose(self, dedup):
+        '''-V prints each frame's MurmurHash3 hash'''
+        _, stderr = dedup(dedup_frames[:3], '-V', '-D', '0', '--dup-hash', 'murmur3')
+        hashes = re.findall(r'Packet: \d+, Len: \d+, Murmur3 Hash: ([0-9a-f]{32})', stderr)
+        assert len(hashes) == 3
+        assert hashes[0] == hashes[2]
+        assert hashes[0] != hashes[1]
+        assert hashes[0] != hashlib.md5(frame('A')).hexdigest()
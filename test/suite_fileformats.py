@@ -8,6 +8,7 @@
 #
 '''File format conversion tests'''
 
+import gzip
 import os.path
 from subprocesstest import count_output
 import subprocess
@@ -262,3 +263,76 @@ class TestFileFormatMime:
                 '-e', 'pcapng.block.length_trailer',
             ), encoding='utf-8', env=test_env)
         assert proc_stdout.strip() == '480\t128,88,132,132\t128,88,132,132'
+
+@pytest.fixture
+def large_capture(dhcp_copies):
+    '''A pcap file spanning several 1 MiB compressed frames or chunks.'''
+    return dhcp_copies(2400)
+
+class TestFileFormatZstd:
+    @pytest.mark.parametrize('dfilter', (None, 'frame.number in {2 4001 9600}'))
+    def test_zstd_round_trip(self, cmd_editcap, cmd_tshark, large_capture, result_file, dfilter, features, base_env, test_env):
+        '''Read a file written with editcap --compress zstd in two passes.'''
+        if not features.have_zstd:
+            pytest.skip('Requires zstd.')
+        compressed_file = result_file('large.pcap.zst')
+        subprocess.run((cmd_editcap,
+            '--compress', 'zstd',
+            large_capture, compressed_file
+        ), check=True, env=base_env)
+        assert os.path.getsize(compressed_file) < os.path.getsize(large_capture)
+
+        tshark_args = ('-2', '-o', 'frame.generate_md5_hash:TRUE',
+            '-Tfields', '-e', 'frame.number', '-e', 'frame.md5_hash', '-e', 'dhcp.type')
+        if dfilter:
+            tshark_args += ('-Y', dfilter)
+        expected = subprocess.check_output((cmd_tshark, '-r', large_capture) + tshark_args,
+            encoding='utf-8', env=test_env)
+        compressed = subprocess.check_output((cmd_tshark, '-r', compressed_file) + tshark_args,
+            encoding='utf-8', env=test_env)
+        assert count_output(expected) == (3 if dfilter else 9600)
+        assert compressed == expected
+
+class TestFileFormatCompressThreads:
+    def compress(self, cmd_editcap, infile, outfile, compression, threads, env):
+        args = [cmd_editcap, '--compress', compression]
+        if threads:
+            args += ['--compress-threads', str(threads)]
+        subprocess.run(args + [infile, outfile], check=True, env=env)
+
+    def test_compress_threads_gzip(self, cmd_editcap, large_capture, result_file, base_env):
+        '''A gzip file compressed in parallel decompresses to the same bytes.'''
+        serial_file = result_file('serial.pcap.gz')
+        parallel_file = result_file('parallel.pcap.gz')
+        self.compress(cmd_editcap, large_capture, serial_file, 'gzip', 0, base_env)
+        self.compress(cmd_editcap, large_capture, parallel_file, 'gzip', 4, base_env)
+        with gzip.open(serial_file, 'rb') as f:
+            serial = f.read()
+        with gzip.open(parallel_file, 'rb') as f:
+            parallel = f.read()
+        assert len(serial) > 2 * 1024 * 1024
+        assert parallel == serial
+
+    @pytest.mark.parametrize('compression', ('gzip', 'lz4', 'zstd'))
+    def test_compress_threads_read(self, cmd_editcap, large_capture, result_file, compression, features, base_env):
+        '''A file compressed in parallel reads back the same as one compressed serially.'''
+        if compression == 'lz4' and not features.have_lz4:
+            pytest.skip('Requires lz4.')
+        if compression == 'zstd' and not features.have_zstd:
+            pytest.skip('Requires zstd.')
+        suffix = {'gzip': '.gz', 'lz4': '.lz4', 'zstd': '.zst'}[compression]
+        serial_file = result_file('serial.pcap' + suffix)
+        parallel_file = result_file('parallel.pcap' + suffix)
+        self.compress(cmd_editcap, large_capture, serial_file, compression, 0, base_env)
+        self.compress(cmd_editcap, large_capture, parallel_file, compression, 4, base_env)
+
+        serial_out = result_file('serial.pcap')
+        parallel_out = result_file('parallel.pcap')
+        subprocess.run((cmd_editcap, serial_file, serial_out), check=True, env=base_env)
+        subprocess.run((cmd_editcap, parallel_file, parallel_out), check=True, env=base_env)
+        with open(serial_out, 'rb') as f:
+            serial = f.read()
+        with open(parallel_out, 'rb') as f:
+            parallel = f.read()
+        assert len(serial) > 2 * 1024 * 1024
+        assert parallel == serial
@@ -8,6 +8,7 @@
 #
 '''File I/O tests'''
 
+import gzip
 import io
 import os.path
 import subprocess
@@ -67,6 +68,92 @@ class TestTsharkIO:
         '''Read direct and write direct using TShark'''
         check_io_4_packets(capture_file, result_file, cmd_tshark, cmd_capinfos, env=test_env)
 
+    def test_tshark_io_read_thread(self, cmd_tshark, capture_file, test_env):
+        '''Reading records on a separate thread gives the same output'''
+        single_proc = subprocess.run((cmd_tshark,
+            '-r', capture_file('dhcp.pcapng'), '-V',
+        ), capture_output=True, encoding='utf-8', env=test_env)
+        threaded_proc = subprocess.run((cmd_tshark,
+            '-r', capture_file('dhcp.pcapng'), '-V',
+            '--threads', '2',
+        ), capture_output=True, encoding='utf-8', env=test_env)
+        assert threaded_proc.returncode == 0
+        assert threaded_proc.stdout == single_proc.stdout
+
+    def test_tshark_io_read_thread_two_pass(self, cmd_tshark, capture_file, test_env):
+        '''Reading records on a separate thread gives the same output in two passes'''
+        single_proc = subprocess.run((cmd_tshark,
+            '-r', capture_file('dhcp.pcapng'), '-V', '-2',
+        ), capture_output=True, encoding='utf-8', env=test_env)
+        threaded_proc = subprocess.run((cmd_tshark,
+            '-r', capture_file('dhcp.pcapng'), '-V', '-2',
+            '--threads', '2',
+        ), capture_output=True, encoding='utf-8', env=test_env)
+        assert threaded_proc.returncode == 0
+        assert threaded_proc.stdout == single_proc.stdout
+
+
+def tshark_output(cmd_tshark, source, env, *args):
+    '''Returns the output of TShark reading a file, or its standard input if source is a file object.'''
+    if isinstance(source, str):
+        proc = subprocess.run((cmd_tshark, '-r', source) + args,
+            capture_output=True, encoding='utf-8', env=env)
+    else:
+        proc = subprocess.run((cmd_tshark, '-r', '-') + args,
+            stdin=source, capture_output=True, encoding='utf-8', env=env)
+    return proc.stdout
+
+
+class TestTsharkMappedIO:
+    # Uncompressed regular files are read through a memory mapping, with
+    # the packet data handed out straight from it where possible; pipes
+    # and compressed files are read into buffers.
+
+    @pytest.fixture
+    def large_capture(self, dhcp_copies):
+        '''A pcap file larger than what is read between checks of the mapped file's size.'''
+        return dhcp_copies(1200)
+
+    @pytest.mark.parametrize('capture', ('dhcp.pcap', 'dhcp.pcapng'))
+    def test_tshark_io_mapped_stdin(self, cmd_tshark, capture_file, capture, test_env):
+        '''Reading a mapped file gives the same output as reading it from a pipe'''
+        mapped = tshark_output(cmd_tshark, capture_file(capture), test_env, '-V', '-x')
+        with open(capture_file(capture), 'rb') as f:
+            piped = tshark_output(cmd_tshark, f, test_env, '-V', '-x')
+        assert mapped
+        assert mapped == piped
+
+    @pytest.mark.parametrize('capture', ('dhcp.pcap', 'dhcp.pcapng'))
+    def test_tshark_io_mapped_compressed(self, cmd_tshark, capture_file, result_file, capture, test_env):
+        '''Reading a mapped file at random gives the same output as reading a compressed file'''
+        compressed_file = result_file(capture + '.gz')
+        with open(capture_file(capture), 'rb') as f, gzip.open(compressed_file, 'wb') as g:
+            g.write(f.read())
+        mapped = tshark_output(cmd_tshark, capture_file(capture), test_env, '-2', '-V', '-x')
+        compressed = tshark_output(cmd_tshark, compressed_file, test_env, '-2', '-V', '-x')
+        assert mapped
+        assert mapped == compressed
+
+    def test_tshark_io_mapped_large(self, cmd_tshark, large_capture, test_env):
+        '''Reading a large mapped file gives the same output as reading it from a pipe'''
+        mapped = tshark_output(cmd_tshark, large_capture, test_env, '-x')
+        with open(large_capture, 'rb') as f:
+            piped = tshark_output(cmd_tshark, f, test_env, '-x')
+        assert mapped.count('DHCP Discover') == 1200
+        assert mapped.count('DHCP ACK') == 1200
+        assert mapped == piped
+
+    def test_tshark_io_mapped_truncated(self, cmd_tshark, large_capture, test_env):
+        '''A mapped file that ends in the middle of a packet is read like a piped one'''
+        with open(large_capture, 'r+b') as f:
+            f.truncate(os.path.getsize(large_capture) - 100)
+        mapped = tshark_output(cmd_tshark, large_capture, test_env, '-x')
+        with open(large_capture, 'rb') as f:
+            piped = tshark_output(cmd_tshark, f, test_env, '-x')
+        assert mapped.count('DHCP Discover') == 1200
+        assert mapped.count('DHCP ACK') == 1199
+        assert mapped == piped
+
 
 class TestRawsharkIO:
     if sys.byteorder != 'little':
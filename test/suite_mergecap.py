@@ -8,6 +8,7 @@
 #
 '''Mergecap tests'''
 
+import pytest
 import re
 import subprocess
 from subprocesstest import grep_output
@@ -268,3 +269,42 @@ class TestMergecapPcapng:
         ), capture_output=True, encoding='utf-8', env=test_env)
         # check for 11 IDBs, 88*3=264 total pkts, 86*3=258 in first IDB
         check_mergecap(mergecap_proc, 'pcapng', 'Per packet', 264, 11, 258, cmd_capinfos, testout_file, test_env)
+
+
+class TestMergecapReadAhead:
+    read_ahead_inputs = (
+        'many_interfaces.pcapng.1',
+        'many_interfaces.pcapng.2',
+        'many_interfaces.pcapng.3',
+        'dns+icmp.pcapng.gz',
+        'icmp.pcapng.gz',
+        'dhcp.pcap',
+    )
+
+    def merge_outputs(self, cmd_mergecap, capture_file, result_file, test_env, args):
+        in_files = [capture_file(f) for f in self.read_ahead_inputs]
+        outputs = []
+        for read_ahead in ((), ('--read-ahead',)):
+            testout_file = result_file('testout{}.pcapng'.format(len(outputs)))
+            subprocess.check_call((cmd_mergecap, *read_ahead, *args,
+                '-w', testout_file, *in_files), env=test_env)
+            with open(testout_file, 'rb') as f:
+                outputs.append(f.read())
+        return outputs
+
+    @pytest.mark.parametrize('args', [(), ('-a',), ('-I', 'none'), ('-s', '64')])
+    def test_mergecap_read_ahead(self, cmd_mergecap, capture_file, result_file, test_env, args):
+        '''Merge files reading ahead from them, and compare with a merge on one thread'''
+        serial, read_ahead = self.merge_outputs(cmd_mergecap, capture_file, result_file, test_env, args)
+        assert len(serial) > 0
+        assert read_ahead == serial
+
+    def test_mergecap_read_ahead_stdout(self, cmd_mergecap, capture_file, test_env):
+        '''Merge files to the standard output reading ahead from them'''
+        in_files = [capture_file(f) for f in self.read_ahead_inputs]
+        serial = subprocess.run((cmd_mergecap, '-w', '-', *in_files),
+            capture_output=True, check=True, env=test_env).stdout
+        read_ahead = subprocess.run((cmd_mergecap, '--read-ahead', '-w', '-', *in_files),
+            capture_output=True, check=True, env=test_env).stdout
+        assert len(serial) > 0
+        assert read_ahead == serial
@@ -9,7 +9,9 @@
 '''Name resolution tests'''
 
 import os.path
+import re
 import shutil
+import struct
 import subprocess
 from subprocesstest import grep_output
 import pytest
@@ -104,3 +106,296 @@ class TestNameResolution:
                 ), encoding='utf-8')
         assert '174.137.42.65\twww.wireshark.org' not in stdout
         assert 'fe80::6233:4bff:fe13:c558\tCrunch.local' in stdout
+
+
+class MmdbPointer:
+    '''A pointer to the value at an offset in the same section.'''
+    def __init__(self, target):
+        self.target = target
+
+
+def mmdb_control(mmdb_type, size):
+    if size < 29:
+        size_bits, size_bytes = size, b''
+    elif size < 285:
+        size_bits, size_bytes = 29, struct.pack('>B', size - 29)
+    elif size < 65821:
+        size_bits, size_bytes = 30, struct.pack('>H', size - 285)
+    else:
+        size_bits, size_bytes = 31, struct.pack('>I', size - 65821)[1:]
+    if mmdb_type > 7:
+        return bytes((size_bits, mmdb_type - 7)) + size_bytes
+    return bytes(((mmdb_type << 5) | size_bits,)) + size_bytes
+
+
+def mmdb_encode(value):
+    '''Encode a value in the MaxMind DB data section format.'''
+    if isinstance(value, MmdbPointer):
+        target = value.target
+        if target < 2048:
+            return bytes((0x20 | (target >> 8), target & 0xff))
+        if target < 526336:
+            target -= 2048
+            return bytes((0x28 | (target >> 16),)) + struct.pack('>H', target & 0xffff)
+        if target < 526336 + (1 << 27):
+            target -= 526336
+            return bytes((0x30 | (target >> 24),)) + struct.pack('>I', target)[1:]
+        return b'\x38' + struct.pack('>I', target)
+    if isinstance(value, str):
+        data = value.encode('utf-8')
+        return mmdb_control(2, len(data)) + data
+    if isinstance(value, bytes):
+        return mmdb_control(4, len(value)) + value
+    if isinstance(value, float):
+        return mmdb_control(3, 8) + struct.pack('>d', value)
+    if isinstance(value, int):
+        data = value.to_bytes(8, 'big').lstrip(b'\x00')
+        return mmdb_control(5 if value < 0x10000 else 6, len(data)) + data
+    if isinstance(value, dict):
+        return mmdb_control(7, len(value)) + \
+            b''.join(mmdb_encode(key) + mmdb_encode(item) for key, item in value.items())
+    raise TypeError(value)
+
+
+def write_mmdb(path, networks, record_size, ip_version, pad=0, metadata=None):
+    '''Write a MaxMind DB file. networks is a list of (address, prefix
+    length, value) tuples, where the value is either data or the offset
+    of data written for an earlier network. The data section starts with
+    pad bytes of filler. metadata is a function of the node count that
+    returns the encoded metadata, if the default shouldn't be used.'''
+    data_section = mmdb_encode(bytes(pad)) if pad else b''
+    leaves = []
+    for address, prefix_len, value in networks:
+        if not isinstance(value, int):
+            offset = len(data_section)
+            data_section += mmdb_encode(value)
+            value = offset
+        if ip_version == 6 and len(address) == 4:
+            # IPv4 addresses are in the ::a.b.c.d subtree.
+            address = bytes(12) + address
+            prefix_len += 96
+        leaves.append((address, prefix_len, value))
+
+    # Each record is a node number, ('data', offset), or None if empty.
+    nodes = [[None, None]]
+    for address, prefix_len, offset in leaves:
+        node = 0
+        for i in range(prefix_len):
+            bit = (address[i // 8] >> (7 - i % 8)) & 1
+            if i == prefix_len - 1:
+                nodes[node][bit] = ('data', offset)
+            else:
+                if nodes[node][bit] is None:
+                    nodes.append([None, None])
+                    nodes[node][bit] = len(nodes) - 1
+                node = nodes[node][bit]
+    node_count = len(nodes)
+
+    def record(value):
+        if value is None:
+            return node_count
+        if isinstance(value, tuple):
+            return node_count + 16 + value[1]
+        return value
+
+    tree = b''
+    for left, right in nodes:
+        left, right = record(left), record(right)
+        if record_size == 24:
+            tree += left.to_bytes(3, 'big') + right.to_bytes(3, 'big')
+        elif record_size == 28:
+            tree += (left & 0xffffff).to_bytes(3, 'big') + \
+                bytes((((left >> 24) << 4) | (right >> 24),)) + \
+                (right & 0xffffff).to_bytes(3, 'big')
+        else:
+            tree += left.to_bytes(4, 'big') + right.to_bytes(4, 'big')
+
+    if metadata is None:
+        encoded_metadata = mmdb_encode({
+            'binary_format_major_version': 2,
+            'binary_format_minor_version': 0,
+            'database_type': 'Wireshark-Test',
+            'ip_version': ip_version,
+            'node_count': node_count,
+            'record_size': record_size,
+        })
+    else:
+        encoded_metadata = metadata(node_count)
+    with open(path, 'wb') as f:
+        f.write(tree + bytes(16) + data_section)
+        f.write(b'\xab\xcd\xefMaxMind.com' + encoded_metadata)
+
+
+mmdb_example_city = {
+    'city': {'names': {'en': 'Springfield'}},
+    'country': {'iso_code': 'XA', 'names': {'en': 'Exampleland'}},
+    'location': {'accuracy_radius': 100, 'latitude': 12.5, 'longitude': -45.25},
+}
+
+
+def mmdb_example_networks(pad, ip_version):
+    '''The networks of the test databases, after pad bytes of filler:
+    198.51.100.0/24 with a city, country and location, and 203.0.113.0/24
+    with an AS, whose "country" key and value are pointers to the
+    former's. IPv6 databases also have 2001:db8::/32, which shares the
+    latter's data.'''
+    start = len(mmdb_encode(bytes(pad))) if pad else 0
+    city = mmdb_encode(mmdb_example_city)
+    country_at = start + city.index(mmdb_encode('country') + mmdb_control(7, 2))
+    networks = [
+        (bytes((198, 51, 100, 0)), 24, mmdb_example_city),
+        (bytes((203, 0, 113, 0)), 24, {
+            'autonomous_system_number': 64500,
+            'autonomous_system_organization': 'Example AS',
+            MmdbPointer(country_at): MmdbPointer(country_at + len(mmdb_encode('country'))),
+        }),
+    ]
+    if ip_version == 6:
+        networks.append((bytes((0x20, 0x01, 0x0d, 0xb8)) + bytes(12), 32, start + len(city)))
+    return networks
+
+
+# country_iso, country, city, asnum, org, lat, lon
+mmdb_city_result = ('XA', 'Exampleland', 'Springfield', '', '', '12.5', '-45.25')
+mmdb_asn_result = ('XA', 'Exampleland', '', '64500', 'Example AS', '', '')
+mmdb_not_found_result = ('',) * 7
+
+
+@pytest.fixture
+def mmdb_capture(result_file):
+    '''A pcap file of raw IP packets from 198.51.100.7, 203.0.113.9,
+    192.0.2.1, 2001:db8::1 and 2001:db9::1.'''
+    payload = struct.pack('>HHHH', 1024, 9, 8, 0)
+    packets = []
+    for src in ((198, 51, 100, 7), (203, 0, 113, 9), (192, 0, 2, 1)):
+        packets.append(struct.pack('>BBHHHBBH4s4s', 0x45, 0, 20 + len(payload),
+            0, 0, 64, 17, 0, bytes(src), bytes((10, 0, 0, 1))) + payload)
+    for src in ((0x20, 0x01, 0x0d, 0xb8), (0x20, 0x01, 0x0d, 0xb9)):
+        packets.append(struct.pack('>IHBB16s16s', 0x60000000, len(payload), 17, 64,
+            bytes(src) + bytes(11) + b'\x01', bytes(15) + b'\x01') + payload)
+    pcap_file = result_file('mmdb.pcap')
+    with open(pcap_file, 'wb') as f:
+        # LINKTYPE_RAW
+        f.write(struct.pack('<IHHiIII', 0xa1b2c3d4, 2, 4, 0, 0, 65535, 101))
+        for i, packet in enumerate(packets):
+            f.write(struct.pack('<IIII', 1000000000 + i, 0, len(packet), len(packet)))
+            f.write(packet)
+    return pcap_file
+
+
+@pytest.fixture
+def check_mmdb(cmd_tshark, mmdb_capture, conf_path, result_file, test_env, features):
+    '''Write a database with the given function as the only one in a
+    MaxMind database directory, and return the GeoIP fields of the source
+    address of each packet in mmdb_capture, and what tshark logged about
+    reading the database.'''
+    if not features.have_maxminddb:
+        pytest.skip('Requires MaxMindDB support.')
+
+    def check_mmdb_real(write_db):
+        db_dir = result_file('mmdb')
+        os.makedirs(db_dir)
+        write_db(os.path.join(db_dir, 'test.mmdb'))
+        with open(os.path.join(conf_path, 'maxmind_db_paths'), 'w') as f:
+            # uat.c replaces backslashes...
+            f.write('"{}"\n'.format(db_dir.replace('\\', '\\x5c')))
+        fields = ()
+        for field in ('country_iso', 'country', 'city', 'asnum', 'org', 'lat', 'lon'):
+            fields += ('-e', 'ip.geoip.src_' + field, '-e', 'ipv6.geoip.src_' + field)
+        proc = subprocess.run((cmd_tshark,
+                '-r', mmdb_capture,
+                '-o', 'nameres.maxmind_geoip: TRUE',
+                '--log-level=info', '--log-domain=MaxMindDB',
+                '-T', 'fields', '-E', 'occurrence=f',
+                ) + fields, check=True, capture_output=True, encoding='utf-8', env=test_env)
+        # Each packet has either the ip or the ipv6 fields.
+        return ([tuple(ip or ipv6 for ip, ipv6 in zip(values[::2], values[1::2]))
+                 for values in (line.split('\t') for line in proc.stdout.splitlines())],
+                proc.stderr)
+    return check_mmdb_real
+
+
+def assert_mmdb_mapped(log):
+    '''The database was read in process, without mmdbresolve.'''
+    assert re.search(r'mapped .*test\.mmdb: ', log)
+    assert 'falling back to mmdbresolve' not in log
+
+
+class TestMaxMindDb:
+    @pytest.mark.parametrize('record_size', [24, 28, 32])
+    @pytest.mark.parametrize('ip_version', [4, 6])
+    def test_mmdb_lookup(self, check_mmdb, record_size, ip_version):
+        '''Each record size, with IPv4 addresses in IPv4 and IPv6 trees,
+        and two-byte pointers.'''
+        def write_db(path):
+            write_mmdb(path, mmdb_example_networks(4000, ip_version), record_size, ip_version, pad=4000)
+        results, log = check_mmdb(write_db)
+        assert results == [
+            mmdb_city_result,
+            mmdb_asn_result,
+            mmdb_not_found_result,
+            mmdb_asn_result if ip_version == 6 else mmdb_not_found_result,
+            mmdb_not_found_result,
+        ]
+        assert_mmdb_mapped(log)
+
+    @pytest.mark.parametrize('record_size', [28, 32])
+    def test_mmdb_lookup_large_records(self, check_mmdb, record_size):
+        '''Records of more than 24 bits and three-byte pointers, for data
+        past 16 MiB.'''
+        def write_db(path):
+            write_mmdb(path, mmdb_example_networks(1 << 24, 4), record_size, 4, pad=1 << 24)
+        results, log = check_mmdb(write_db)
+        assert results == [
+            mmdb_city_result,
+            mmdb_asn_result,
+        ] + [mmdb_not_found_result] * 3
+        assert_mmdb_mapped(log)
+
+    @pytest.mark.parametrize('corruption', [
+        'no_marker', 'truncated', 'node_count', 'record_size',
+        'pointer', 'string_length', 'size_bytes', 'depth',
+    ])
+    def test_mmdb_corrupt_metadata(self, check_mmdb, corruption):
+        '''Files with truncated or corrupt metadata are rejected. The
+        corrupt values are at the end of the file, where reading past
+        them would read past the mapping.'''
+        def metadata(node_count):
+            fields = {
+                'binary_format_major_version': 2,
+                'ip_version': 4,
+                'record_size': 20 if corruption == 'record_size' else 24,
+                # Leaves the tree running into the metadata.
+                'node_count': 1 << 30 if corruption == 'node_count' else node_count,
+            }
+            if corruption == 'pointer':
+                fields['node_count'] = MmdbPointer(1000)
+            encoded = mmdb_encode(fields)
+            if corruption == 'truncated':
+                return encoded[:-1]
+            # The first key's value runs past the end of the file.
+            first_value = {
+                'string_length': mmdb_control(2, 100) + b'short',
+                'size_bytes': mmdb_control(2, 65821)[:2],
+                'depth': mmdb_control(7, 1) * 1000,
+            }.get(corruption)
+            if first_value is not None:
+                return mmdb_control(7, 5) + mmdb_encode('description') + first_value
+            return encoded
+
+        def write_db(path):
+            write_mmdb(path, mmdb_example_networks(0, 4), 24, 4, metadata=metadata)
+            if corruption == 'no_marker':
+                with open(path, 'r+b') as f:
+                    f.truncate(f.read().rindex(b'MaxMind.com'))
+        results, log = check_mmdb(write_db)
+        assert results == [mmdb_not_found_result] * 5
+        # Rejected for the right reason, and left to mmdbresolve.
+        reason = {
+            'no_marker': 'has no metadata',
+            'node_count': 'has an unsupported format',
+            'record_size': 'has an unsupported format',
+        }.get(corruption, 'has invalid metadata')
+        assert re.search(r'test\.mmdb ' + reason, log)
+        assert 'falling back to mmdbresolve' in log
+        assert not re.search(r'mapped .*test\.mmdb: ', log)
@@ -0,0 +1,92 @@
+#
+# Wireshark tests
+#
+# SPDX-License-Identifier: GPL-2.0-or-later
+#
+'''Reordercap tests'''
+
+import os
+import struct
+import subprocess
+import pytest
+
+
+@pytest.fixture(scope='session')
+def cmd_reordercap(program):
+    return program('reordercap')
+
+
+@pytest.fixture
+def shuffled_capture(dhcp_copies):
+    '''A pcap file of 9600 frames, a few MiB, with their timestamps out of order.'''
+    return dhcp_copies(2400, 'shuffled.pcap', seed=16)
+
+
+def reorder(cmd_reordercap, infile, outfile, env, *args, stdin=None):
+    subprocess.run((cmd_reordercap, *args, infile, outfile),
+        stdin=stdin, stdout=subprocess.DEVNULL, check=True, env=env)
+    with open(outfile, 'rb') as f:
+        return f.read()
+
+
+class TestReordercapExternal:
+    def test_reordercap_memory_limit(self, cmd_reordercap, shuffled_capture, result_file, test_env):
+        '''Sorting through temporary files gives the same output as sorting in memory'''
+        in_memory = reorder(cmd_reordercap, shuffled_capture, result_file('memory.pcap'), test_env)
+        temp_dir = result_file('runs')
+        os.mkdir(temp_dir)
+        external = reorder(cmd_reordercap, shuffled_capture, result_file('external.pcap'), test_env,
+            '--memory-limit', '1', '--temp-dir', temp_dir)
+        assert len(in_memory) == os.path.getsize(shuffled_capture)
+        assert external == in_memory
+        assert os.listdir(temp_dir) == []
+
+    def test_reordercap_memory_limit_stdin(self, cmd_reordercap, shuffled_capture, result_file, test_env):
+        '''Sorting the standard input through temporary files'''
+        in_memory = reorder(cmd_reordercap, shuffled_capture, result_file('memory.pcap'), test_env)
+        with open(shuffled_capture, 'rb') as f:
+            external = reorder(cmd_reordercap, '-', result_file('external.pcap'), test_env,
+                '--memory-limit', '1', stdin=f)
+        assert external == in_memory
+
+    def test_reordercap_window_stdin(self, cmd_reordercap, shuffled_capture, result_file, test_env):
+        '''Sorting the standard input in a window holding all of it'''
+        in_memory = reorder(cmd_reordercap, shuffled_capture, result_file('memory.pcap'), test_env)
+        with open(shuffled_capture, 'rb') as f:
+            window = reorder(cmd_reordercap, '-', result_file('window.pcap'), test_env,
+                '--window', '10000', stdin=f)
+        assert window == in_memory
+
+    @pytest.mark.parametrize('memory_limit', (None, '1'))
+    def test_reordercap_window_late(self, cmd_reordercap, shuffled_capture, result_file, memory_limit, test_env):
+        '''Frames further out of place than the window are merged in at the end'''
+        in_memory = reorder(cmd_reordercap, shuffled_capture, result_file('memory.pcap'), test_env)
+        temp_dir = result_file('runs')
+        os.mkdir(temp_dir)
+        args = ('--window', '100', '--temp-dir', temp_dir)
+        if memory_limit:
+            # The late frames take up a few MiB, so they're spilled to runs.
+            args += ('--memory-limit', memory_limit)
+        window = reorder(cmd_reordercap, shuffled_capture, result_file('window.pcap'), test_env, *args)
+        timestamps = []
+        offset = 24
+        while offset < len(window):
+            ts_sec, ts_usec, incl_len = struct.unpack('<III', window[offset:offset + 12])
+            timestamps.append((ts_sec, ts_usec))
+            offset += 16 + incl_len
+        assert len(timestamps) == 9600
+        assert timestamps == sorted(timestamps)
+        assert window == in_memory
+        assert os.listdir(temp_dir) == []
+        assert not os.path.exists(result_file('window.pcap.unsorted'))
+
+    @pytest.mark.skipif(not os.path.exists('/dev/full'), reason='Requires /dev/full')
+    def test_reordercap_memory_limit_write_error(self, cmd_reordercap, shuffled_capture, result_file, test_env):
+        '''Temporary files are removed when writing the output file fails'''
+        temp_dir = result_file('runs')
+        os.mkdir(temp_dir)
+        proc = subprocess.run((cmd_reordercap, '--memory-limit', '1', '--temp-dir', temp_dir,
+            shuffled_capture, '/dev/full'),
+            stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL, env=test_env)
+        assert proc.returncode != 0
+        assert os.listdir(temp_dir) == []
@@ -8,8 +8,17 @@
 #
 '''sharkd tests'''
 
+import base64
 import json
+import os
+import os.path
+import shutil
+import signal
+import socket
 import subprocess
+import struct
+import sys
+import uuid
 import pytest
 from matchers import *
 
@@ -19,6 +28,43 @@ def cmd_sharkd(program):
     return program('sharkd')
 
 
+# The UDP payloads of interleaved_udp_capture; odd frames are in udp.stream
+# 0, even frames in udp.stream 1, and each stream alternates direction.
+INTERLEAVED_UDP_PAYLOADS = [
+    b'stream 0 request 1', b'stream 1 request 1',
+    b'stream 0 reply 1', b'stream 1 reply 1',
+    b'stream 0 request 2', b'stream 1 request 2',
+    b'stream 0 reply 2', b'stream 1 reply 2',
+]
+
+
+@pytest.fixture
+def interleaved_udp_capture(result_file):
+    '''A pcap file with two UDP streams whose frames are interleaved.'''
+    endpoints = (
+        ((bytes((10, 0, 0, 1)), 40000), (bytes((10, 0, 0, 2)), 50000)),
+        ((bytes((10, 0, 0, 3)), 40001), (bytes((10, 0, 0, 4)), 50001)),
+    )
+    capture = result_file('interleaved-udp.pcap')
+    with open(capture, 'wb') as f:
+        f.write(struct.pack('<IHHiIII', 0xa1b2c3d4, 2, 4, 0, 0, 65535, 1))
+        for i, payload in enumerate(INTERLEAVED_UDP_PAYLOADS):
+            (src, sport), (dst, dport) = endpoints[i % 2]
+            if (i // 2) % 2 == 1:
+                (src, sport), (dst, dport) = (dst, dport), (src, sport)
+            udp = struct.pack('>HHHH', sport, dport, 8 + len(payload), 0) + payload
+            ip = bytearray(struct.pack('>BBHHHBBH4s4s', 0x45, 0, 20 + len(udp),
+                                       i + 1, 0, 64, 17, 0, src, dst))
+            checksum = sum(struct.unpack('>10H', ip))
+            checksum = (checksum & 0xffff) + (checksum >> 16)
+            checksum = (checksum & 0xffff) + (checksum >> 16)
+            ip[10:12] = struct.pack('>H', ~checksum & 0xffff)
+            frame = b'\x00\x00\x5e\x00\x53\x02\x00\x00\x5e\x00\x53\x01\x08\x00' + bytes(ip) + udp
+            f.write(struct.pack('<IIII', 1700000000 + i, 0, len(frame), len(frame)))
+            f.write(frame)
+    return capture
+
+
 @pytest.fixture
 def run_sharkd_session(cmd_sharkd, base_env):
     def run_sharkd_session_real(sharkd_commands):
@@ -52,6 +98,113 @@ def check_sharkd_session(run_sharkd_session):
     return check_sharkd_session_real
 
 
+class SharkdClient:
+    '''A connection to a sharkd daemon.'''
+    def __init__(self, address):
+        self.sock = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+        self.sock.connect(address)
+        self.file = self.sock.makefile('rw', encoding='utf-8')
+        self.rpcid = 0
+
+    def request(self, method, params=None):
+        self.rpcid += 1
+        request = {"jsonrpc":"2.0", "id":self.rpcid, "method":method}
+        if params is not None:
+            request["params"] = params
+        self.file.write(json.dumps(request) + '\n')
+        self.file.flush()
+        return json.loads(self.file.readline())
+
+    def close(self):
+        self.file.close()
+        self.sock.close()
+
+
+@pytest.fixture
+def sharkd_shared_client(cmd_sharkd, base_env):
+    '''Start a daemon in shared mode, and return a function connecting to it.'''
+    if not sys.platform.startswith('linux'):
+        pytest.skip('Test requires abstract Unix sockets and /proc')
+    name = 'sharkd-test-%s' % uuid.uuid4().hex
+    # The daemon forks into the background, so it's found by its command line.
+    subprocess.run((cmd_sharkd, '-a', 'unix:@' + name, '-s'), env=base_env, check=True)
+    clients = []
+
+    def connect():
+        client = SharkdClient('\0' + name)
+        clients.append(client)
+        return client
+    yield connect
+
+    for client in clients:
+        client.close()
+    for pid in os.listdir('/proc'):
+        try:
+            with open(os.path.join('/proc', pid, 'cmdline'), 'rb') as f:
+                cmdline = f.read()
+        except (OSError, ValueError):
+            continue
+        if name.encode() in cmdline:
+            os.kill(int(pid), signal.SIGTERM)
+
+
+class TestSharkdShared:
+    def test_sharkd_shared_interleaved_clients(self, sharkd_shared_client, capture_file):
+        ok = {"status":"OK"}
+        a = sharkd_shared_client()
+        b = sharkd_shared_client()
+
+        # Clients with different files don't disturb each other.
+        assert a.request("load", {"file": capture_file('dhcp.pcap')})["result"] == ok
+        assert b.request("load", {"file": capture_file('http.pcap')})["result"] == ok
+        status_a = a.request("status")["result"]
+        assert (status_a["filename"], status_a["frames"]) == ("dhcp.pcap", 4)
+        assert b.request("status")["result"]["filename"] == "http.pcap"
+        assert [f["num"] for f in a.request("frames", {"filter": "dhcp"})["result"]] == [1, 2, 3, 4]
+
+        # The same file with the same preferences is shared.
+        assert b.request("load", {"file": capture_file('dhcp.pcap')})["result"] == ok
+        assert b.request("filters", {"filter0": "dhcp"})["result"] == [{"filter":"dhcp","matched":4}]
+
+        # Preferences apply to the client setting them only.
+        assert b.request("setconf", {"name": "dhcp.udp.port", "value": "1"})["result"] == ok
+        assert b.request("setconf", {"name": "tcp.check_checksum", "value": "true"})["result"] == ok
+        assert b.request("filters", {"filter0": "dhcp"})["result"] == [{"filter":"dhcp","matched":0}]
+        assert a.request("filters", {"filter0": "dhcp"})["result"] == [{"filter":"dhcp","matched":4}]
+        assert a.request("dumpconf", {"pref": "tcp.check_checksum"})["result"] == {"prefs":{"tcp.check_checksum":{"b":0}}}
+        assert b.request("dumpconf", {"pref": "tcp.check_checksum"})["result"] == {"prefs":{"tcp.check_checksum":{"b":1}}}
+        assert "error" in b.request("setconf", {"name": "no.such.pref", "value": "1"})
+        assert b.request("filters", {"filter0": "dhcp"})["result"] == [{"filter":"dhcp","matched":0}]
+
+        # Loading another file doesn't close the file of other clients.
+        assert a.request("load", {"file": capture_file('http.pcap')})["result"] == ok
+        status_b = b.request("status")["result"]
+        assert (status_b["filename"], status_b["frames"]) == ("dhcp.pcap", 4)
+        assert a.request("status")["result"]["filename"] == "http.pcap"
+
+        # A failed load leaves the client without a file.
+        assert "error" in a.request("load", {"file": capture_file('non-existant.pcap')})
+        assert a.request("status")["result"]["frames"] == 0
+        assert b.request("status")["result"]["frames"] == 4
+
+        # "bye" ends the connection of the client only.
+        assert a.request("bye")["result"] == ok
+        assert a.file.readline() == ''
+        assert b.request("status")["result"]["frames"] == 4
+
+    def test_sharkd_shared_same_file_clients(self, sharkd_shared_client, capture_file):
+        clients = [sharkd_shared_client() for _ in range(3)]
+        for client in clients:
+            assert client.request("load", {"file": capture_file('dhcp.pcap')})["result"] == {"status":"OK"}
+        # Requests of clients sharing a session are interleaved.
+        for skip in range(4):
+            for client in clients:
+                frames = client.request("frames", {"skip": skip, "limit": 1})["result"]
+                assert [f["num"] for f in frames] == [skip + 1]
+        clients[0].close()
+        assert clients[1].request("status")["result"]["frames"] == 4
+
+
 class TestSharkd:
     def test_sharkd_req_load_bad_pcap(self, check_sharkd_session, capture_file):
         check_sharkd_session((
@@ -221,6 +374,109 @@ class TestSharkd:
             },
         ))
 
+    def test_sharkd_req_load_index(self, run_sharkd_session, capture_file, result_file):
+        # The index is written next to the capture file, so use a copy.
+        pcap_file = result_file('dhcp.pcap')
+        shutil.copyfile(capture_file('dhcp.pcap'), pcap_file)
+        sharkd_commands = [json.dumps(x) for x in (
+            {"jsonrpc":"2.0", "id":1, "method":"load",
+            "params":{"file": pcap_file, "index": True}
+            },
+            {"jsonrpc":"2.0", "id":2, "method":"frames","params":{"skip":2}},
+            {"jsonrpc":"2.0", "id":3, "method":"frames"},
+            {"jsonrpc":"2.0", "id":4, "method":"frames","params":{"filter":"frame.number > 1","skip":1}},
+        )]
+        first_outputs = run_sharkd_session(sharkd_commands)
+        assert first_outputs[0] == {"jsonrpc":"2.0","id":1,"result":{"status":"OK"}}
+        assert os.path.isfile(pcap_file + '.wsidx')
+        # So are the results of filters.
+        assert len(os.listdir(pcap_file + '.wsfilters')) == 1
+        # The second load uses the index; frames must be the same.
+        second_outputs = run_sharkd_session(sharkd_commands)
+        assert second_outputs == first_outputs
+
+    def test_sharkd_req_filters(self, run_sharkd_session, capture_file):
+        sharkd_commands = [json.dumps(x) for x in (
+            {"jsonrpc":"2.0", "id":1, "method":"load",
+            "params":{"file": capture_file('dhcp.pcap')}
+            },
+            {"jsonrpc":"2.0", "id":2, "method":"filters",
+            "params":{"filter0": "dhcp", "filter1": "frame.number > 2", "filter2": "frame.number>2"}
+            },
+            {"jsonrpc":"2.0", "id":3, "method":"frames",
+            "params":{"filter": "frame.number  >  2", "skip": 1}
+            },
+            {"jsonrpc":"2.0", "id":4, "method":"frames","params":{"skip": 3}},
+            {"jsonrpc":"2.0", "id":5, "method":"filters","params":{"filter0": "invalid filter"}},
+        )]
+        outputs = run_sharkd_session(sharkd_commands)
+        assert outputs[1] == {"jsonrpc":"2.0","id":2,"result":[
+            {"filter":"dhcp","matched":4},
+            {"filter":"frame.number > 2","matched":2},
+            {"filter":"frame.number>2","matched":2},
+        ]}
+        assert [frame["num"] for frame in outputs[2]["result"]] == [4]
+        assert [frame["num"] for frame in outputs[3]["result"]] == [4]
+        assert outputs[4]["error"]["code"] == -14001
+
+    def test_sharkd_req_filters_config_change(self, run_sharkd_session, capture_file):
+        # Results obtained before a change of what frames hold or how
+        # they are dissected must not be reused.
+        sharkd_commands = [json.dumps(x) for x in (
+            {"jsonrpc":"2.0", "id":1, "method":"load",
+            "params":{"file": capture_file('dhcp.pcap')}
+            },
+            {"jsonrpc":"2.0", "id":2, "method":"filters",
+            "params":{"filter0": "dhcp", "filter1": "frame.comment"}
+            },
+            {"jsonrpc":"2.0", "id":3, "method":"setconf",
+            "params":{"name": "dhcp.udp.port", "value": "1"}
+            },
+            {"jsonrpc":"2.0", "id":4, "method":"setcomment",
+            "params":{"frame": 2, "comment": "foo"}
+            },
+            {"jsonrpc":"2.0", "id":5, "method":"filters",
+            "params":{"filter0": "dhcp", "filter1": "frame.comment"}
+            },
+            {"jsonrpc":"2.0", "id":6, "method":"frames","params":{"filter": "frame.comment"}},
+        )]
+        outputs = run_sharkd_session(sharkd_commands)
+        assert outputs[1] == {"jsonrpc":"2.0","id":2,"result":[
+            {"filter":"dhcp","matched":4},
+            {"filter":"frame.comment","matched":0},
+        ]}
+        assert outputs[2] == {"jsonrpc":"2.0","id":3,"result":{"status":"OK"}}
+        assert outputs[3] == {"jsonrpc":"2.0","id":4,"result":{"status":"OK"}}
+        assert outputs[4] == {"jsonrpc":"2.0","id":5,"result":[
+            {"filter":"dhcp","matched":0},
+            {"filter":"frame.comment","matched":1},
+        ]}
+        assert [frame["num"] for frame in outputs[5]["result"]] == [2]
+
+    def test_sharkd_req_filters_index_changed_file(self, run_sharkd_session, capture_file, result_file):
+        # Results written next to the capture file must not be used once
+        # its contents change, even if its size and time stamp don't.
+        pcap_file = result_file('dhcp.pcap')
+        shutil.copyfile(capture_file('dhcp.pcap'), pcap_file)
+        sharkd_commands = [json.dumps(x) for x in (
+            {"jsonrpc":"2.0", "id":1, "method":"load",
+            "params":{"file": pcap_file, "index": True}
+            },
+            {"jsonrpc":"2.0", "id":2, "method":"filters","params":{"filter0": "dhcp"}},
+        )]
+        outputs = run_sharkd_session(sharkd_commands)
+        assert outputs[1] == {"jsonrpc":"2.0","id":2,"result":[{"filter":"dhcp","matched":4}]}
+
+        # Move the UDP ports of the first frame away from DHCP's.
+        statb = os.stat(pcap_file)
+        with open(pcap_file, 'r+b') as f:
+            f.seek(24 + 16 + 14 + 20)
+            f.write(b'\x00\x01\x00\x01')
+        os.utime(pcap_file, ns=(statb.st_atime_ns, statb.st_mtime_ns))
+
+        outputs = run_sharkd_session(sharkd_commands)
+        assert outputs[1] == {"jsonrpc":"2.0","id":2,"result":[{"filter":"dhcp","matched":3}]}
+
     def test_sharkd_req_frames_delta_times(self, check_sharkd_session, capture_file):
         check_sharkd_session((
             {"jsonrpc":"2.0", "id":1, "method":"load",
@@ -1174,6 +1430,35 @@ class TestSharkd:
             },
         ))
 
+    def test_sharkd_req_follow_udp_stream(self, run_sharkd_session, interleaved_udp_capture):
+        def follow(rpcid, params):
+            return {"jsonrpc":"2.0", "id":rpcid, "method":"follow", "params":params}
+
+        def followed(output):
+            return [(p["n"], base64.b64decode(p["d"])) for p in output["result"]["payloads"]]
+
+        load = {"jsonrpc":"2.0", "id":1, "method":"load",
+                "params":{"file": interleaved_udp_capture}}
+        outputs = run_sharkd_session([json.dumps(x) for x in (
+            load,
+            follow(2, {"follow": "UDP", "filter": "udp.stream eq 1", "stream": 1}),
+            follow(3, {"follow": "UDP", "filter": "udp.stream eq 1"}),
+            # A filter matching the frames of every stream shows which
+            # frames were retapped.
+            follow(4, {"follow": "UDP", "filter": "udp", "stream": 1}),
+            follow(5, {"follow": "UDP", "filter": "udp"}),
+        )])
+        assert outputs[0] == {"jsonrpc":"2.0","id":1,"result":{"status":"OK"}}
+        stream_1 = [(n, payload) for n, payload in enumerate(INTERLEAVED_UDP_PAYLOADS, 1) if n % 2 == 0]
+        # Following the stream gives its payloads, as retapping every frame does.
+        assert followed(outputs[1]) == stream_1
+        assert outputs[1]["result"] == outputs[2]["result"]
+        assert outputs[1]["result"]["sbytes"] + outputs[1]["result"]["cbytes"] == \
+            sum(len(payload) for _, payload in stream_1)
+        # Only the frames in the stream were retapped.
+        assert followed(outputs[3]) == stream_1
+        assert followed(outputs[4]) == list(enumerate(INTERLEAVED_UDP_PAYLOADS, 1))
+
     def test_sharkd_req_follow_http2(self, check_sharkd_session, capture_file, features):
         # If we don't have nghttp2, we output the compressed headers.
         # We could test against the expected output in that case, but
@@ -92,7 +92,9 @@
 #include <epan/epan_dissect.h>
 #include <epan/tap.h>
 #include <epan/stat_tap_ui.h>
+#include <epan/conversation.h>
 #include <epan/conversation_table.h>
+#include <epan/reassemble.h>
 #include <epan/srt_table.h>
 #include <epan/rtd_table.h>
 #include <epan/ex-opt.h>
@@ -145,6 +147,8 @@
 #define LONGOPT_PRINT_TIMERS            LONGOPT_BASE_APPLICATION+9
 #define LONGOPT_GLOBAL_PROFILE          LONGOPT_BASE_APPLICATION+10
 #define LONGOPT_COMPRESS                LONGOPT_BASE_APPLICATION+11
+#define LONGOPT_THREADS                 LONGOPT_BASE_APPLICATION+12
+#define LONGOPT_EXPIRE_IDLE             LONGOPT_BASE_APPLICATION+13
 
 capture_file cfile;
 
@@ -159,6 +163,31 @@ static bool epan_auto_reset;
 
 static uint32_t selected_frame_number;
 
+/*
+ * Number of threads to use when reading a capture file in one pass;
+ * with more than one, records are read on a separate thread.
+ */
+static int read_threads = 1;
+
+/*
+ * Expiry of idle conversations and reassemblies (--expire-idle).
+ *
+ * Every quarter of the idle time, in packet time, the frame count is
+ * noted; anything not seen since the note taken EXPIRE_CHECKPOINTS
+ * sweeps ago has been idle for at least the idle time, and closed
+ * conversations not seen since the previous sweep can go as well.
+ */
+#define EXPIRE_CHECKPOINTS  4
+
+static unsigned expire_idle_secs;
+static struct {
+    time_t   next_sweep;    /* 0 until the first packet with a time stamp */
+    uint32_t frames[EXPIRE_CHECKPOINTS];    /* most recent first */
+    uint64_t conversations;
+    uint64_t reassemblies;
+    unsigned peak_conversations;    /* most conversations held at a sweep */
+} expire_state;
+
 /*
  * The way the packet decode is to be written.
  */
@@ -247,6 +276,8 @@ static void report_counts_siginfo(int);
 #endif /* HAVE_LIBPCAP */
 
 static void reset_epan_mem(capture_file *cf, epan_dissect_t *edt, bool tree, bool visual);
+static void expire_idle_state(capture_file *cf, const wtap_rec *rec);
+static void report_expired_counts(void);
 
 typedef enum {
     PROCESS_FILE_SUCCEEDED,
@@ -270,10 +301,20 @@ static void tshark_cmdarg_err_cont(const char *msg_format, va_list ap);
 static GHashTable *output_only_tables;
 
 static bool opt_print_timers;
+/* Per-stage counters for reading records on a separate thread. */
+struct elapsed_reader_s {
+    uint64_t records;
+    uint64_t bytes;
+    int64_t  read;          /* time spent in wtap_read() or wtap_seek_read() */
+    int64_t  read_blocked;  /* reader waiting for the dissector to catch up */
+    int64_t  dissect_wait;  /* dissector waiting for the reader */
+};
 struct elapsed_pass_s {
     int64_t dissect;
     int64_t dfilter_read;
     int64_t dfilter_filter;
+    int64_t print;
+    struct elapsed_reader_s reader;
 };
 static struct {
     int64_t                dfilter_expand;
@@ -285,6 +326,29 @@ static struct {
 }
 tshark_elapsed;
 
+static void
+print_elapsed_reader_json(json_dumper *dumper, const struct elapsed_reader_s *reader)
+{
+    if (reader->records == 0)
+        return;
+
+    /* Records were read on a separate thread; show how busy each
+     * side of the queue was, so it's clear which stage saturates. */
+    json_dumper_set_member_name(dumper, "read_thread");
+    json_dumper_begin_object(dumper);
+    json_dumper_set_member_name(dumper, "records");
+    json_dumper_value_anyf(dumper, "%"PRIu64, reader->records);
+    json_dumper_set_member_name(dumper, "bytes");
+    json_dumper_value_anyf(dumper, "%"PRIu64, reader->bytes);
+    json_dumper_set_member_name(dumper, "read");
+    json_dumper_value_anyf(dumper, "%"PRId64, reader->read);
+    json_dumper_set_member_name(dumper, "read_blocked");
+    json_dumper_value_anyf(dumper, "%"PRId64, reader->read_blocked);
+    json_dumper_set_member_name(dumper, "dissect_wait");
+    json_dumper_value_anyf(dumper, "%"PRId64, reader->dissect_wait);
+    json_dumper_end_object(dumper);
+}
+
 static void
 print_elapsed_json(const char *cf_name, const char *dfilter)
 {
@@ -326,6 +390,8 @@ print_elapsed_json(const char *cf_name, const char *dfilter)
     DUMP("dissect", tshark_elapsed.first_pass.dissect);
     DUMP("display_filter", tshark_elapsed.first_pass.dfilter_filter);
     DUMP("read_filter", tshark_elapsed.first_pass.dfilter_read);
+    DUMP("print", tshark_elapsed.first_pass.print);
+    print_elapsed_reader_json(&dumper, &tshark_elapsed.first_pass.reader);
     json_dumper_end_object(&dumper);
     if (tshark_elapsed.elapsed_second_pass) {
         json_dumper_begin_object(&dumper);
@@ -333,6 +399,8 @@ print_elapsed_json(const char *cf_name, const char *dfilter)
         DUMP("dissect", tshark_elapsed.second_pass.dissect);
         DUMP("display_filter", tshark_elapsed.second_pass.dfilter_filter);
         DUMP("read_filter", tshark_elapsed.second_pass.dfilter_read);
+        DUMP("print", tshark_elapsed.second_pass.print);
+        print_elapsed_reader_json(&dumper, &tshark_elapsed.second_pass.reader);
         json_dumper_end_object(&dumper);
     }
     json_dumper_end_array(&dumper);
@@ -495,6 +563,10 @@ print_usage(FILE *output)
     fprintf(output, "Processing:\n");
     fprintf(output, "  -2                       perform a two-pass analysis\n");
     fprintf(output, "  -M <packet count>        perform session auto reset\n");
+    fprintf(output, "  --threads <n>            read records on a separate thread when n > 1\n");
+    fprintf(output, "                           (capture files only)\n");
+    fprintf(output, "  --expire-idle <seconds>  forget conversations and reassemblies idle for\n");
+    fprintf(output, "                           this long (single-pass analysis only)\n");
     fprintf(output, "  -R <read filter>, --read-filter <read filter>\n");
     fprintf(output, "                           packet Read filter in Wireshark display filter syntax\n");
     fprintf(output, "                           (requires -2)\n");
@@ -981,6 +1053,8 @@ main(int argc, char *argv[])
         {"print-timers", ws_no_argument, NULL, LONGOPT_PRINT_TIMERS},
         {"global-profile", ws_no_argument, NULL, LONGOPT_GLOBAL_PROFILE},
         {"compress", ws_required_argument, NULL, LONGOPT_COMPRESS},
+        {"threads", ws_required_argument, NULL, LONGOPT_THREADS},
+        {"expire-idle", ws_required_argument, NULL, LONGOPT_EXPIRE_IDLE},
         {0, 0, 0, 0}
     };
     bool                 arg_error = false;
@@ -1926,6 +2000,12 @@ main(int argc, char *argv[])
             case LONGOPT_PRINT_TIMERS:
                 opt_print_timers = true;
                 break;
+            case LONGOPT_THREADS:
+                read_threads = get_positive_int(ws_optarg, "thread count");
+                break;
+            case LONGOPT_EXPIRE_IDLE:
+                expire_idle_secs = get_positive_int(ws_optarg, "idle time");
+                break;
             case LONGOPT_GLOBAL_PROFILE:
                 /* already processed; just ignore it now */
                 break;
@@ -2144,6 +2224,14 @@ main(int argc, char *argv[])
         goto clean_exit;
     }
 
+    if (expire_idle_secs != 0 && perform_two_pass_analysis) {
+        cmdarg_err("--expire-idle does not support two-pass analysis.");
+        exit_status = WS_EXIT_INVALID_OPTION;
+        goto clean_exit;
+    }
+    if (expire_idle_secs != 0)
+        conversation_set_expire_enabled(true);
+
 #ifdef HAVE_LIBPCAP
     if (caps_queries) {
         /* We're supposed to list the link-layer/timestamp types for an interface;
@@ -2864,6 +2952,9 @@ main(int argc, char *argv[])
         }
     }
 
+    if (cf_name != NULL && !really_quiet)
+        report_expired_counts();
+
     /* Memory cleanup */
     reset_tap_listeners();
     funnel_dump_all_text_windows();
@@ -2896,13 +2987,356 @@ clean_exit:
 bool loop_running;
 uint32_t packet_count;
 
+/*
+ * Reading records on a separate thread (--threads).
+ *
+ * Dissection isn't thread-safe, so only wiretap's share of the work -
+ * file I/O, decompression and parsing of the file format - is moved off
+ * the dissection thread.  Records are handed over through a bounded queue
+ * of preallocated slots; the dissection thread swaps a slot's record and
+ * buffer with its own and returns the slot through a second queue, so
+ * nothing is allocated or copied per record.
+ *
+ * Name resolution and decryption secrets blocks would normally be handed
+ * to epan from within wtap_read().  The reader thread instead attaches
+ * them to the next record, and the dissection thread applies them before
+ * dissecting that record, so they're still seen in file order.
+ *
+ * The wtap_t's interface list can grow while reading, so the dissection
+ * thread takes wth_mutex when looking at it.
+ *
+ * For the second pass of a two-pass analysis, the reader is given the
+ * frame_data_sequence built by the first pass and reads the frames with
+ * wtap_seek_read(), in frame order, rather than reading the file
+ * sequentially.  The second pass depends on state left by the first one,
+ * and dissecting with more than one epan_dissect_t at a time would need
+ * epan to be reentrant, so here too only reading is done ahead.
+ */
+#define READER_QUEUE_DEPTH  512
+
+typedef enum {
+    READER_EVENT_IPV4,
+    READER_EVENT_IPV6,
+    READER_EVENT_SECRETS
+} reader_event_type_e;
+
+typedef struct {
+    reader_event_type_e type;
+    unsigned    ipv4_addr;
+    ws_in6_addr ipv6_addr;
+    char       *name;
+    bool        static_entry;
+    uint32_t    secrets_type;
+    void       *secrets;
+    unsigned    secrets_len;
+} reader_event_t;
+
+typedef struct {
+    wtap_rec    rec;
+    Buffer      buf;
+    int64_t     data_offset;
+    GSList     *events;         /* reader_event_t's, most recent first */
+    bool        eof;            /* no record; err and err_info are set */
+    int         err;
+    char       *err_info;
+} reader_slot_t;
+
+typedef struct {
+    wtap          *wth;
+    GThread       *thread;
+    GAsyncQueue   *free_slots;
+    GAsyncQueue   *full_slots;
+    reader_slot_t *slots;
+    frame_data_sequence *frames;    /* if non-NULL, seek to these frames */
+    uint32_t       frame_count;
+    uint32_t       next_framenum;   /* only touched by the reader thread */
+    struct elapsed_reader_s *elapsed;
+    GSList        *pending_events;  /* only touched by the reader thread */
+    int            stop;            /* accessed with g_atomic_int_*() */
+} record_reader_t;
+
+/* Non-NULL while a reader thread is running. */
+static record_reader_t *active_reader;
+static GMutex wth_mutex;
+
+static void
+reader_event_free(void *data)
+{
+    reader_event_t *event = (reader_event_t *)data;
+
+    g_free(event->name);
+    g_free(event->secrets);
+    g_free(event);
+}
+
+static void
+reader_event_apply(void *data, void *user_data _U_)
+{
+    reader_event_t *event = (reader_event_t *)data;
+
+    switch (event->type) {
+
+    case READER_EVENT_IPV4:
+        add_ipv4_name(event->ipv4_addr, event->name, event->static_entry);
+        break;
+
+    case READER_EVENT_IPV6:
+        add_ipv6_name(&event->ipv6_addr, event->name, event->static_entry);
+        break;
+
+    case READER_EVENT_SECRETS:
+        secrets_wtap_callback(event->secrets_type, event->secrets, event->secrets_len);
+        break;
+    }
+}
+
+/*
+ * Callbacks handed to wiretap; they are called from whichever thread
+ * is calling wtap_read().
+ */
+static void
+tshark_wtap_new_ipv4(const unsigned addr, const char *name, const bool static_entry)
+{
+    reader_event_t *event;
+
+    if (active_reader == NULL) {
+        add_ipv4_name(addr, name, static_entry);
+        return;
+    }
+    event = g_new0(reader_event_t, 1);
+    event->type = READER_EVENT_IPV4;
+    event->ipv4_addr = addr;
+    event->name = g_strdup(name);
+    event->static_entry = static_entry;
+    active_reader->pending_events = g_slist_prepend(active_reader->pending_events, event);
+}
+
+static void
+tshark_wtap_new_ipv6(const void *addrp, const char *name, const bool static_entry)
+{
+    reader_event_t *event;
+
+    if (active_reader == NULL) {
+        add_ipv6_name((const ws_in6_addr *)addrp, name, static_entry);
+        return;
+    }
+    event = g_new0(reader_event_t, 1);
+    event->type = READER_EVENT_IPV6;
+    memcpy(&event->ipv6_addr, addrp, sizeof event->ipv6_addr);
+    event->name = g_strdup(name);
+    event->static_entry = static_entry;
+    active_reader->pending_events = g_slist_prepend(active_reader->pending_events, event);
+}
+
+static void
+tshark_wtap_new_secrets(uint32_t secrets_type, const void *secrets, unsigned size)
+{
+    reader_event_t *event;
+
+    if (active_reader == NULL) {
+        secrets_wtap_callback(secrets_type, secrets, size);
+        return;
+    }
+    event = g_new0(reader_event_t, 1);
+    event->type = READER_EVENT_SECRETS;
+    event->secrets_type = secrets_type;
+    event->secrets = g_memdup2(secrets, size);
+    event->secrets_len = size;
+    active_reader->pending_events = g_slist_prepend(active_reader->pending_events, event);
+}
+
+static const char *
+tshark_get_interface_name(struct packet_provider_data *prov, uint32_t interface_id, unsigned section_number)
+{
+    const char *name;
+
+    if (active_reader == NULL)
+        return cap_file_provider_get_interface_name(prov, interface_id, section_number);
+
+    g_mutex_lock(&wth_mutex);
+    name = cap_file_provider_get_interface_name(prov, interface_id, section_number);
+    g_mutex_unlock(&wth_mutex);
+    return name;
+}
+
+static const char *
+tshark_get_interface_description(struct packet_provider_data *prov, uint32_t interface_id, unsigned section_number)
+{
+    const char *description;
+
+    if (active_reader == NULL)
+        return cap_file_provider_get_interface_description(prov, interface_id, section_number);
+
+    g_mutex_lock(&wth_mutex);
+    description = cap_file_provider_get_interface_description(prov, interface_id, section_number);
+    g_mutex_unlock(&wth_mutex);
+    return description;
+}
+
+static void *
+record_reader_thread(void *data)
+{
+    record_reader_t *reader = (record_reader_t *)data;
+    reader_slot_t   *slot;
+    frame_data      *fdata;
+    int64_t          elapsed_start;
+    bool             ok;
+
+    for (;;) {
+        elapsed_start = g_get_monotonic_time();
+        slot = (reader_slot_t *)g_async_queue_pop(reader->free_slots);
+        reader->elapsed->read_blocked += g_get_monotonic_time() - elapsed_start;
+        if (g_atomic_int_get(&reader->stop)) {
+            g_async_queue_push(reader->free_slots, slot);
+            break;
+        }
+
+        elapsed_start = g_get_monotonic_time();
+        g_mutex_lock(&wth_mutex);
+        if (reader->frames == NULL) {
+            ok = wtap_read(reader->wth, &slot->rec, &slot->buf, &slot->err,
+                    &slot->err_info, &slot->data_offset);
+        } else if (reader->next_framenum <= reader->frame_count) {
+            fdata = frame_data_sequence_find(reader->frames, reader->next_framenum++);
+            slot->data_offset = fdata->file_off;
+            ok = wtap_seek_read(reader->wth, fdata->file_off, &slot->rec,
+                    &slot->buf, &slot->err, &slot->err_info);
+        } else {
+            /* We've read all the frames. */
+            slot->err = 0;
+            ok = false;
+        }
+        g_mutex_unlock(&wth_mutex);
+        reader->elapsed->read += g_get_monotonic_time() - elapsed_start;
+
+        slot->events = reader->pending_events;
+        reader->pending_events = NULL;
+        if (!ok) {
+            slot->eof = true;
+            g_async_queue_push(reader->full_slots, slot);
+            break;
+        }
+        reader->elapsed->records++;
+        if (slot->rec.rec_type == REC_TYPE_PACKET)
+            reader->elapsed->bytes += slot->rec.rec_header.packet_header.caplen;
+        g_async_queue_push(reader->full_slots, slot);
+    }
+    return NULL;
+}
+
+/*
+ * Start reading records on a separate thread.  If frames is NULL, the
+ * records are read sequentially with wtap_read(); otherwise, the first
+ * frame_count frames in it are read with wtap_seek_read().  Timings are
+ * added to elapsed.
+ */
+static record_reader_t *
+record_reader_start(wtap *wth, frame_data_sequence *frames, uint32_t frame_count,
+        struct elapsed_reader_s *elapsed)
+{
+    record_reader_t *reader;
+
+    reader = g_new0(record_reader_t, 1);
+    reader->wth = wth;
+    reader->frames = frames;
+    reader->frame_count = frame_count;
+    reader->next_framenum = 1;
+    reader->elapsed = elapsed;
+    reader->free_slots = g_async_queue_new();
+    reader->full_slots = g_async_queue_new();
+    reader->slots = g_new0(reader_slot_t, READER_QUEUE_DEPTH);
+    for (unsigned i = 0; i < READER_QUEUE_DEPTH; i++) {
+        wtap_rec_init(&reader->slots[i].rec);
+        ws_buffer_init(&reader->slots[i].buf, 1514);
+        g_async_queue_push(reader->free_slots, &reader->slots[i]);
+    }
+
+    active_reader = reader;
+    reader->thread = g_thread_new("tshark reader", record_reader_thread, reader);
+    return reader;
+}
+
+/*
+ * Get the next record from the reader thread; the arguments and return
+ * value are the same as for wtap_read().
+ */
+static bool
+record_reader_read(record_reader_t *reader, wtap_rec *rec, Buffer *buf,
+        int *err, char **err_info, int64_t *data_offset)
+{
+    reader_slot_t *slot;
+    wtap_rec       tmp_rec;
+    Buffer         tmp_buf;
+    int64_t        elapsed_start;
+
+    elapsed_start = g_get_monotonic_time();
+    slot = (reader_slot_t *)g_async_queue_pop(reader->full_slots);
+    reader->elapsed->dissect_wait += g_get_monotonic_time() - elapsed_start;
+
+    /* Apply whatever wiretap reported before this record, in order. */
+    slot->events = g_slist_reverse(slot->events);
+    g_slist_foreach(slot->events, reader_event_apply, NULL);
+    g_slist_free_full(slot->events, reader_event_free);
+    slot->events = NULL;
+
+    if (slot->eof) {
+        *err = slot->err;
+        *err_info = slot->err_info;
+        slot->err_info = NULL;
+        /* Leave it queued, so that further reads get the same answer. */
+        g_async_queue_push_front(reader->full_slots, slot);
+        return false;
+    }
+
+    /* Hand the caller the record, and give the slot the caller's storage. */
+    tmp_rec = *rec;
+    *rec = slot->rec;
+    slot->rec = tmp_rec;
+    tmp_buf = *buf;
+    *buf = slot->buf;
+    slot->buf = tmp_buf;
+    *data_offset = slot->data_offset;
+    wtap_rec_reset(&slot->rec);
+
+    g_async_queue_push(reader->free_slots, slot);
+    return true;
+}
+
+static void
+record_reader_stop(record_reader_t *reader)
+{
+    reader_slot_t *slot;
+
+    /*
+     * Make sure the reader isn't left waiting for a free slot, so that
+     * it notices it's being told to stop.
+     */
+    g_atomic_int_set(&reader->stop, 1);
+    while ((slot = (reader_slot_t *)g_async_queue_try_pop(reader->full_slots)) != NULL)
+        g_async_queue_push(reader->free_slots, slot);
+    g_thread_join(reader->thread);
+    active_reader = NULL;
+
+    g_slist_free_full(reader->pending_events, reader_event_free);
+    for (unsigned i = 0; i < READER_QUEUE_DEPTH; i++) {
+        g_slist_free_full(reader->slots[i].events, reader_event_free);
+        g_free(reader->slots[i].err_info);
+        wtap_rec_cleanup(&reader->slots[i].rec);
+        ws_buffer_free(&reader->slots[i].buf);
+    }
+    g_free(reader->slots);
+    g_async_queue_unref(reader->free_slots);
+    g_async_queue_unref(reader->full_slots);
+    g_free(reader);
+}
+
 static epan_t *
 tshark_epan_new(capture_file *cf)
 {
     static const struct packet_provider_funcs funcs = {
         cap_file_provider_get_frame_ts,
-        cap_file_provider_get_interface_name,
-        cap_file_provider_get_interface_description,
+        tshark_get_interface_name,
+        tshark_get_interface_description,
         NULL,
     };
 
@@ -3259,6 +3693,8 @@ report_counts(void)
         fprintf(stderr, "%u packet%s captured\n", packet_count,
                 plurality(packet_count, "", "s"));
     }
+    if (really_quiet == false)
+        report_expired_counts();
 #ifdef SIGINFO
     infoprint = false; /* we just reported it */
 #endif /* SIGINFO */
@@ -3550,6 +3986,8 @@ process_cap_file_first_pass(capture_file *cf, int max_packet_count,
     int64_t         data_offset;
     pass_status_t   status = PASS_SUCCEEDED;
     int             framenum = 0;
+    record_reader_t *reader = NULL;
+    bool            read_ok;
 
     wtap_rec_init(&rec);
     ws_buffer_init(&buf, 1514);
@@ -3582,8 +4020,20 @@ process_cap_file_first_pass(capture_file *cf, int max_packet_count,
     }
 
     ws_debug("tshark: reading records for first pass");
+    if (read_threads > 1) {
+        ws_debug("tshark: reading records on a separate thread");
+        reader = record_reader_start(cf->provider.wth, NULL, 0,
+                &tshark_elapsed.first_pass.reader);
+    }
+
     *err = 0;
-    while (wtap_read(cf->provider.wth, &rec, &buf, err, err_info, &data_offset)) {
+    for (;;) {
+        if (reader != NULL)
+            read_ok = record_reader_read(reader, &rec, &buf, err, err_info, &data_offset);
+        else
+            read_ok = wtap_read(cf->provider.wth, &rec, &buf, err, err_info, &data_offset);
+        if (!read_ok)
+            break;
         if (read_interrupted) {
             status = PASS_INTERRUPTED;
             break;
@@ -3609,6 +4059,9 @@ process_cap_file_first_pass(capture_file *cf, int max_packet_count,
     if (*err != 0)
         status = PASS_READ_ERROR;
 
+    if (reader != NULL)
+        record_reader_stop(reader);
+
     if (edt)
         epan_dissect_free(edt);
 
@@ -3713,7 +4166,9 @@ process_packet_second_pass(capture_file *cf, epan_dissect_t *edt,
         if (print_packet_info) {
             /* We're printing packet information; print the information for
                this packet. */
+            elapsed_start = g_get_monotonic_time();
             print_packet(cf, edt);
+            tshark_elapsed.second_pass.print += g_get_monotonic_time() - elapsed_start;
 
             /* If we're doing "line-buffering", flush the standard output
                after every packet.  See the comment above, for the "-l"
@@ -3741,7 +4196,11 @@ static bool
 process_new_idbs(wtap *wth, wtap_dumper *pdh, int *err, char **err_info)
 {
     wtap_block_t if_data;
+    bool ret = true;
 
+    /* The reader thread, if any, might be adding interfaces. */
+    if (active_reader != NULL)
+        g_mutex_lock(&wth_mutex);
     while ((if_data = wtap_get_next_interface_description(wth)) != NULL) {
         /*
          * Only add interface blocks if the output file supports (meaning
@@ -3752,12 +4211,16 @@ process_new_idbs(wtap *wth, wtap_dumper *pdh, int *err, char **err_info)
          */
         if (pdh != NULL) {
             if (wtap_file_type_subtype_supports_block(wtap_dump_file_type_subtype(pdh), WTAP_BLOCK_IF_ID_AND_INFO) != BLOCK_NOT_SUPPORTED) {
-                if (!wtap_dump_add_idb(pdh, if_data, err, err_info))
-                    return false;
+                if (!wtap_dump_add_idb(pdh, if_data, err, err_info)) {
+                    ret = false;
+                    break;
+                }
             }
         }
     }
-    return true;
+    if (active_reader != NULL)
+        g_mutex_unlock(&wth_mutex);
+    return ret;
 }
 
 static pass_status_t
@@ -3775,6 +4238,9 @@ process_cap_file_second_pass(capture_file *cf, wtap_dumper *pdh,
     unsigned        tap_flags;
     epan_dissect_t *edt = NULL;
     pass_status_t   status = PASS_SUCCEEDED;
+    record_reader_t *reader = NULL;
+    int64_t         data_offset;
+    bool            read_ok;
 
     /*
      * Process whatever IDBs we haven't seen yet.  This will be all
@@ -3832,14 +4298,24 @@ process_cap_file_second_pass(capture_file *cf, wtap_dumper *pdh,
      */
     set_resolution_synchrony(true);
 
+    if (read_threads > 1) {
+        ws_debug("tshark: reading records on a separate thread");
+        reader = record_reader_start(cf->provider.wth, cf->provider.frames, cf->count,
+                &tshark_elapsed.second_pass.reader);
+    }
+
     for (framenum = 1; framenum <= (int)cf->count; framenum++) {
         if (read_interrupted) {
             status = PASS_INTERRUPTED;
             break;
         }
         fdata = frame_data_sequence_find(cf->provider.frames, framenum);
-        if (!wtap_seek_read(cf->provider.wth, fdata->file_off, &rec, &buf, err,
-                    err_info)) {
+        if (reader != NULL)
+            read_ok = record_reader_read(reader, &rec, &buf, err, err_info, &data_offset);
+        else
+            read_ok = wtap_seek_read(cf->provider.wth, fdata->file_off, &rec, &buf, err,
+                    err_info);
+        if (!read_ok) {
             /* Error reading from the input file. */
             status = PASS_READ_ERROR;
             break;
@@ -3870,6 +4346,9 @@ process_cap_file_second_pass(capture_file *cf, wtap_dumper *pdh,
         wtap_rec_reset(&rec);
     }
 
+    if (reader != NULL)
+        record_reader_stop(reader);
+
     if (edt)
         epan_dissect_free(edt);
 
@@ -3896,6 +4375,8 @@ process_cap_file_single_pass(capture_file *cf, wtap_dumper *pdh,
     epan_dissect_t *edt = NULL;
     int64_t         data_offset;
     pass_status_t   status = PASS_SUCCEEDED;
+    record_reader_t *reader = NULL;
+    bool            read_ok;
 
     wtap_rec_init(&rec);
     ws_buffer_init(&buf, 1514);
@@ -3950,8 +4431,20 @@ process_cap_file_single_pass(capture_file *cf, wtap_dumper *pdh,
      */
     set_resolution_synchrony(true);
 
+    if (read_threads > 1) {
+        ws_debug("tshark: reading records on a separate thread");
+        reader = record_reader_start(cf->provider.wth, NULL, 0,
+                &tshark_elapsed.first_pass.reader);
+    }
+
     *err = 0;
-    while (wtap_read(cf->provider.wth, &rec, &buf, err, err_info, &data_offset)) {
+    for (;;) {
+        if (reader != NULL)
+            read_ok = record_reader_read(reader, &rec, &buf, err, err_info, &data_offset);
+        else
+            read_ok = wtap_read(cf->provider.wth, &rec, &buf, err, err_info, &data_offset);
+        if (!read_ok)
+            break;
         if (read_interrupted) {
             status = PASS_INTERRUPTED;
             break;
@@ -4007,6 +4500,8 @@ process_cap_file_single_pass(capture_file *cf, wtap_dumper *pdh,
         }
         wtap_rec_reset(&rec);
     }
+    if (reader != NULL)
+        record_reader_stop(reader);
     if (status == PASS_SUCCEEDED) {
         if (*err != 0) {
             /* Error reading from the input file. */
@@ -4316,6 +4811,66 @@ out:
     return status;
 }
 
+/*
+ * Called after each packet of a single-pass analysis; with --expire-idle,
+ * notes the frame count every quarter of the idle time, and forgets the
+ * conversations and reassemblies that haven't been seen since.
+ */
+static void
+expire_idle_state(capture_file *cf, const wtap_rec *rec)
+{
+    time_t now;
+    unsigned interval;
+    uint32_t idle_frame, closed_frame;
+
+    if (expire_idle_secs == 0 || !(rec->presence_flags & WTAP_HAS_TS))
+        return;
+
+    now = rec->ts.secs;
+    interval = MAX(1, expire_idle_secs / EXPIRE_CHECKPOINTS);
+
+    if (expire_state.next_sweep == 0 || cf->count < expire_state.frames[0]) {
+        /* First packet, or the frame count was reset by -M. */
+        memset(expire_state.frames, 0, sizeof expire_state.frames);
+        expire_state.next_sweep = now + interval;
+        return;
+    }
+    if (now < expire_state.next_sweep)
+        return;
+
+    /*
+     * Anything last seen before the oldest checkpoint has been idle for
+     * at least the idle time; closed conversations only need to have
+     * been quiet since the latest one.
+     */
+    idle_frame = expire_state.frames[EXPIRE_CHECKPOINTS - 1] + 1;
+    closed_frame = expire_state.frames[0] + 1;
+    expire_state.peak_conversations = MAX(expire_state.peak_conversations, conversation_count());
+    expire_state.conversations += conversation_expire(idle_frame, closed_frame);
+    expire_state.reassemblies += reassembly_tables_expire(idle_frame);
+
+    memmove(&expire_state.frames[1], &expire_state.frames[0],
+            (EXPIRE_CHECKPOINTS - 1) * sizeof expire_state.frames[0]);
+    expire_state.frames[0] = cf->count;
+    expire_state.next_sweep = now + interval;
+}
+
+static void
+report_expired_counts(void)
+{
+    if (expire_idle_secs == 0)
+        return;
+    fprintf(stderr, "%" PRIu64 " idle conversation%s and %" PRIu64 " reassembl%s expired, "
+            "%u conversation%s left (at most %u)\n",
+            expire_state.conversations, plurality(expire_state.conversations, "", "s"),
+            expire_state.reassemblies, plurality(expire_state.reassemblies, "y", "ies"),
+            conversation_count(), plurality(conversation_count(), "", "s"),
+            MAX(expire_state.peak_conversations, conversation_count()));
+    /* What's left in file scope should stay flat however long the capture. */
+    fprintf(stderr, "%zu bytes of file scope memory in use\n",
+            wmem_allocator_used_bytes(wmem_file_scope()));
+}
+
 static bool
 process_packet_single_pass(capture_file *cf, epan_dissect_t *edt, int64_t offset,
         wtap_rec *rec, Buffer *buf, unsigned tap_flags _U_)
@@ -4411,7 +4966,9 @@ process_packet_single_pass(capture_file *cf, epan_dissect_t *edt, int64_t offset
             /* We're printing packet information; print the information for
                this packet. */
             ws_assert(edt);
+            elapsed_start = g_get_monotonic_time();
             print_packet(cf, edt);
+            tshark_elapsed.first_pass.print += g_get_monotonic_time() - elapsed_start;
 
             /* If we're doing "line-buffering", flush the standard output
                after every packet.  See the comment above, for the "-l"
@@ -4438,6 +4995,8 @@ process_packet_single_pass(capture_file *cf, epan_dissect_t *edt, int64_t offset
         frame_data_destroy(&fdata);
         rec->block = block;
     }
+
+    expire_idle_state(cf, rec);
     return passed;
 }
 
@@ -4955,9 +5514,9 @@ cf_open(capture_file *cf, const char *fname, unsigned int type, bool is_tempfile
     epan_free(cf->epan);
     cf->epan = tshark_epan_new(cf);
 
-    wtap_set_cb_new_ipv4(cf->provider.wth, add_ipv4_name);
-    wtap_set_cb_new_ipv6(cf->provider.wth, (wtap_new_ipv6_callback_t) add_ipv6_name);
-    wtap_set_cb_new_secrets(cf->provider.wth, secrets_wtap_callback);
+    wtap_set_cb_new_ipv4(cf->provider.wth, tshark_wtap_new_ipv4);
+    wtap_set_cb_new_ipv6(cf->provider.wth, tshark_wtap_new_ipv6);
+    wtap_set_cb_new_secrets(cf->provider.wth, tshark_wtap_new_secrets);
 
     return CF_OK;
 
@@ -310,3 +310,98 @@ double get_io_graph_item(const io_graph_item_t *items_, io_graph_item_unit_t val
     }
     return value;
 }
+
+void merge_io_graph_items(io_graph_item_t *dst, const io_graph_item_t *src, size_t count, int hf_index)
+{
+    int adv_type = (hf_index >= 0) ? proto_registrar_get_ftype(hf_index) : FT_NONE;
+    size_t i;
+
+    for (i = 0; i < count; i++) {
+        const io_graph_item_t *item = &src[i];
+
+        /* LOAD adds to earlier items than the packet's own, so an
+         * item can have fields without having frames. */
+        if (item->first_frame_in_invl != 0) {
+            if (dst->first_frame_in_invl == 0) {
+                dst->first_frame_in_invl = item->first_frame_in_invl;
+            }
+            dst->last_frame_in_invl = item->last_frame_in_invl;
+            dst->frames += item->frames;
+            dst->bytes += item->bytes;
+        }
+
+        if (item->fields == 0) {
+            continue;
+        }
+
+        /* If dst->fields == 0, these are the first values seen, so set
+         * the min/max values accordingly, as update_io_graph_item does. */
+        switch (adv_type) {
+        case FT_UINT8:
+        case FT_UINT16:
+        case FT_UINT24:
+        case FT_UINT32:
+        case FT_UINT40:
+        case FT_UINT48:
+        case FT_UINT56:
+        case FT_UINT64:
+            if ((item->uint_max > dst->uint_max) || (dst->fields == 0)) {
+                dst->uint_max = item->uint_max;
+                dst->max_frame_in_invl = item->max_frame_in_invl;
+            }
+            if ((item->uint_min < dst->uint_min) || (dst->fields == 0)) {
+                dst->uint_min = item->uint_min;
+                dst->min_frame_in_invl = item->min_frame_in_invl;
+            }
+            dst->double_tot += item->double_tot;
+            break;
+        case FT_INT8:
+        case FT_INT16:
+        case FT_INT24:
+        case FT_INT32:
+        case FT_INT40:
+        case FT_INT48:
+        case FT_INT56:
+        case FT_INT64:
+            if ((item->int_max > dst->int_max) || (dst->fields == 0)) {
+                dst->int_max = item->int_max;
+                dst->max_frame_in_invl = item->max_frame_in_invl;
+            }
+            if ((item->int_min < dst->int_min) || (dst->fields == 0)) {
+                dst->int_min = item->int_min;
+                dst->min_frame_in_invl = item->min_frame_in_invl;
+            }
+            dst->double_tot += item->double_tot;
+            break;
+        case FT_FLOAT:
+        case FT_DOUBLE:
+            if ((item->double_max > dst->double_max) || (dst->fields == 0)) {
+                dst->double_max = item->double_max;
+                dst->max_frame_in_invl = item->max_frame_in_invl;
+            }
+            if ((item->double_min < dst->double_min) || (dst->fields == 0)) {
+                dst->double_min = item->double_min;
+                dst->min_frame_in_invl = item->min_frame_in_invl;
+            }
+            dst->double_tot += item->double_tot;
+            break;
+        case FT_RELATIVE_TIME:
+            /* For LOAD only time_tot is used, and the time each call
+             * spanned was already split across the items. */
+            if ((nstime_cmp(&item->time_max, &dst->time_max) > 0) || (dst->fields == 0)) {
+                dst->time_max = item->time_max;
+                dst->max_frame_in_invl = item->max_frame_in_invl;
+            }
+            if ((nstime_cmp(&item->time_min, &dst->time_min) < 0) || (dst->fields == 0)) {
+                dst->time_min = item->time_min;
+                dst->min_frame_in_invl = item->min_frame_in_invl;
+            }
+            nstime_add(&dst->time_tot, &item->time_tot);
+            break;
+        default:
+            /* Only counted. */
+            break;
+        }
+        dst->fields += item->fields;
+    }
+}
@@ -193,6 +193,20 @@ GString *check_field_unit(const char *field_name, int *hf_index, io_graph_item_u
  */
 double get_io_graph_item(const io_graph_item_t *items, io_graph_item_unit_t val_units, int idx, int hf_index, const capture_file *cap_file, int interval, int cur_idx, bool asAOT);
 
+/** Merge consecutive io_graph_item_t's into one.
+ *
+ * Combines the items as if the packets in them had been added to a
+ * single item covering all of their intervals, so that items tapped at
+ * one interval can be regrouped into items at a multiple of it.
+ *
+ * @param dst [in,out] The item to merge into, normally reset beforehand.
+ * @param src [in] Array of items to merge, in time order and after any
+ *                 already merged into dst.
+ * @param count [in] The number of items in the array.
+ * @param hf_index [in] Header field index for advanced statistics.
+ */
+void merge_io_graph_items(io_graph_item_t *dst, const io_graph_item_t *src, size_t count, int hf_index);
+
 /** Update the values of an io_graph_item_t.
  *
  * Frame and byte counts are always calculated. If edt is non-NULL advanced
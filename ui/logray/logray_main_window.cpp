@@ -562,6 +562,7 @@ main_ui_->goToLineEdit->setValidator(goToLineQiv);
     connect(mainApp, &MainApplication::recentPreferencesRead, this, &LograyMainWindow::applyRecentPaneGeometry);
     connect(mainApp, &MainApplication::recentPreferencesRead, this, &LograyMainWindow::updateRecentActions);
     connect(mainApp, &MainApplication::packetDissectionChanged, this, &LograyMainWindow::redissectPackets, Qt::QueuedConnection);
+    connect(mainApp, &MainApplication::packetDissectionPrefsChanged, this, &LograyMainWindow::redissectPacketsForPrefs, Qt::QueuedConnection);
 
     connect(mainApp, &MainApplication::checkDisplayFilter, this, &LograyMainWindow::checkDisplayFilter);
     connect(mainApp, &MainApplication::fieldsChanged, this, &LograyMainWindow::fieldsChanged);
@@ -323,6 +323,7 @@ private slots:
     void interfaceSelectionChanged();
     void captureFilterSyntaxChanged(bool valid);
     void redissectPackets();
+    void redissectPacketsForPrefs();
     void checkDisplayFilter();
     void fieldsChanged();
     void reloadLuaPlugins();
@@ -1456,6 +1456,18 @@ void LograyMainWindow::redissectPackets()
     proto_free_deregistered_fields();
 }
 
+// Only preferences changed, so packets might not need to be redissected
+// from scratch.
+void LograyMainWindow::redissectPacketsForPrefs()
+{
+    if (capture_file_.capFile()) {
+        cf_redissect_packets_for_prefs(capture_file_.capFile());
+        main_ui_->statusBar->expertUpdate();
+    }
+
+    proto_free_deregistered_fields();
+}
+
 void LograyMainWindow::checkDisplayFilter()
 {
     if (!df_combo_box_->checkDisplayFilter()) {
@@ -59,7 +59,8 @@
 // - Regular (non-stacked) bar graphs are drawn on top of each other on the Z axis.
 //   The QCP forum suggests drawing them side by side:
 //   https://www.qcustomplot.com/index.php/support/forum/62
-// - We retap and redraw more than we should.
+// - We retap and redraw more than we should. (Changing the interval
+//   regroups the pre-aggregated buckets instead, when it can.)
 // - Smoothing doesn't seem to match GTK+
 // - Closing the color picker on macOS sends the dialog to the background.
 // - X-axis time buckets are based on the file relative time, even in
@@ -1605,7 +1606,10 @@ void IOGraphDialog::on_intervalComboBox_currentIndexChanged(int)
         for (int row = 0; row < uat_model_->rowCount(); row++) {
             IOGraph *iog = ioGraphs_.value(row, NULL);
             if (iog) {
-                iog->setInterval(interval);
+                // Usually the buckets already tapped can be regrouped.
+                if (iog->setInterval(interval)) {
+                    continue;
+                }
                 if (iog->visible()) {
                     need_retap = true;
                 } else {
@@ -1617,6 +1621,8 @@ void IOGraphDialog::on_intervalComboBox_currentIndexChanged(int)
 
     if (need_retap) {
         scheduleRetap(true);
+    } else {
+        scheduleRecalc(true);
     }
 }
 
@@ -2635,6 +2641,7 @@ void IOGraph::clearAllData()
     if (items_.size()) {
         reset_io_graph_items(&items_[0], items_.size(), hf_index_);
     }
+    resetLevels();
     if (graph_) {
         graph_->data()->clear();
     }
@@ -2876,12 +2883,134 @@ bool IOGraph::hasItemToShow(int idx, double value) const
     return result;
 }
 
-void IOGraph::setInterval(int interval)
+// Returns true if the items for the new interval were regrouped from the
+// pre-aggregated buckets, so that the graph doesn't need to be retapped.
+bool IOGraph::setInterval(int interval)
 {
-    interval_ = interval;
+    bool regrouped = false;
+
+    if (interval != interval_) {
+        interval_ = interval;
+        if (!need_retap_ && regroupItems()) {
+            regrouped = true;
+            emit requestRecalc();
+        }
+    }
     if (bars_) {
         bars_->setWidth(interval_ / SCALE_F);
     }
+    return regrouped;
+}
+
+// Set up the levels of buckets for a tap at the current interval: one for
+// each power of ten microseconds from 1 μs to 100 s, which between them
+// divide every interval in the interval combo box. Levels finer than the
+// one the current interval would be regrouped from are kept only while
+// they're small, which is enough for short captures.
+void IOGraph::resetLevels()
+{
+    levels_.clear();
+    if (interval_ <= 0) {
+        return;
+    }
+
+    for (int64_t interval = 1; interval <= (int64_t)SCALE * 100; interval *= 10) {
+        BucketLevel level;
+
+        level.interval = (int)interval;
+        level.cur_idx = -1;
+        if (interval * 10 > interval_) {
+            level.max_items = max_io_items_;
+        } else if (val_units_ == IOG_ITEM_UNIT_CALC_LOAD) {
+            // update_io_graph_item spreads each call over every bucket
+            // it spans, which is too slow for fine intervals.
+            continue;
+        } else {
+            level.max_items = max_io_level_items_;
+        }
+        levels_.push_back(std::move(level));
+    }
+}
+
+// Add a packet to every level. packet_item holds the packet's own counts
+// and field values, extracted once by the caller; it's NULL for LOAD,
+// which spreads each call over earlier buckets according to the interval
+// and so has to be updated level by level.
+void IOGraph::updateLevels(packet_info *pinfo, epan_dissect_t *edt, const io_graph_item_t *packet_item)
+{
+    std::vector<BucketLevel>::iterator it = levels_.begin();
+
+    while (it != levels_.end()) {
+        int64_t idx = get_io_graph_index(pinfo, it->interval);
+
+        if ((idx < 0) || (idx >= it->max_items)) {
+            it = levels_.erase(it);
+            continue;
+        }
+
+        if ((size_t)idx >= it->items.size()) {
+            const size_t old_size = it->items.size();
+            size_t new_size;
+            if (old_size == 0) {
+                new_size = 1024;
+            } else {
+                new_size = MIN((old_size * 3) / 2, (size_t)it->max_items);
+            }
+            new_size = MAX(new_size, (size_t)idx + 1);
+            try {
+                it->items.resize(new_size);
+            } catch (std::bad_alloc&) {
+                it = levels_.erase(it);
+                continue;
+            }
+        }
+
+        if (idx > it->cur_idx) {
+            it->cur_idx = (int)idx;
+        }
+        if (packet_item) {
+            merge_io_graph_items(&it->items[idx], packet_item, 1, hf_index_);
+        } else {
+            update_io_graph_item(&it->items[0], (int)idx, pinfo, edt, hf_index_, val_units_, it->interval);
+        }
+        ++it;
+    }
+}
+
+// Rebuild items_ for the current interval from the coarsest level of
+// buckets whose interval divides it.
+bool IOGraph::regroupItems()
+{
+    const BucketLevel *level = NULL;
+
+    for (std::vector<BucketLevel>::const_reverse_iterator it = levels_.rbegin(); it != levels_.rend(); ++it) {
+        if (interval_ % it->interval == 0) {
+            level = &*it;
+            break;
+        }
+    }
+    if (!level) {
+        return false;
+    }
+
+    const int per_item = interval_ / level->interval;
+    const int cur_idx = (level->cur_idx < 0) ? -1 : level->cur_idx / per_item;
+
+    try {
+        items_.assign((size_t)cur_idx + 1, io_graph_item_t());
+    } catch (std::bad_alloc&) {
+        ws_warning("Failed memory allocation!");
+        items_.clear();
+        cur_idx_ = -1;
+        return false;
+    }
+    for (int i = 0; i <= level->cur_idx; i += per_item) {
+        merge_io_graph_items(&items_[i / per_item], &level->items[i],
+                             MIN(per_item, level->cur_idx + 1 - i), hf_index_);
+    }
+    cur_idx_ = cur_idx;
+
+    return true;
 }
 
 // Get the value at the given interval (idx) for the current value unit.
@@ -2916,6 +3045,10 @@ tap_packet_status IOGraph::tapPacket(void *iog_ptr, packet_info *pinfo, epan_dis
     /* some sanity checks */
     if ((tmp_idx < 0) || (tmp_idx >= max_io_items_)) {
         iog->cur_idx_ = (int)iog->items_.size() - 1;
+        if (tmp_idx >= 0) {
+            // The levels don't have the packets items_ is missing either.
+            iog->levels_.clear();
+        }
         return TAP_PACKET_DONT_REDRAW;
     }
 
@@ -2972,7 +3105,19 @@ tap_packet_status IOGraph::tapPacket(void *iog_ptr, packet_info *pinfo, epan_dis
         adv_edt = edt;
     }
 
-    if (!update_io_graph_item(&iog->items_[0], idx, pinfo, adv_edt, iog->hf_index_, iog->val_units_, iog->interval_)) {
+    bool updated;
+    if (iog->val_units_ == IOG_ITEM_UNIT_CALC_LOAD) {
+        iog->updateLevels(pinfo, adv_edt, NULL);
+        updated = update_io_graph_item(&iog->items_[0], idx, pinfo, adv_edt, iog->hf_index_, iog->val_units_, iog->interval_);
+    } else {
+        // Look up and convert the field values once, then add the result
+        // to items_ and to each level.
+        io_graph_item_t packet_item = io_graph_item_t();
+        updated = update_io_graph_item(&packet_item, 0, pinfo, adv_edt, iog->hf_index_, iog->val_units_, iog->interval_);
+        iog->updateLevels(pinfo, adv_edt, &packet_item);
+        merge_io_graph_items(&iog->items_[idx], &packet_item, 1, iog->hf_index_);
+    }
+    if (!updated) {
         return TAP_PACKET_DONT_REDRAW;
     }
 
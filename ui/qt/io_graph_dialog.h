@@ -56,6 +56,14 @@ class QCPAxisTickerDateTime;
 // 2^25 = 16777216
 const int max_io_items_ = 1 << 25;
 
+// The maximum number of items in each of the power-of-ten levels of
+// pre-aggregated buckets finer than the current interval needs. A level
+// that would need more is dropped during the tap, and changing to an
+// interval that would be regrouped from it retaps instead. At 88 bytes
+// per item, this is 5.5 MiB per level, and at most 33 MiB for the six
+// levels finer than a 1 s interval.
+const int max_io_level_items_ = 1 << 16;
+
 /* define I/O Graph specific UAT columns */
 enum UatColumnsIOG {colEnabled = 0, colAOT, colName, colDFilter, colColor, colStyle, colYAxis, colYField, colSMAPeriod, colYAxisFactor, colMaxNum};
 
@@ -90,7 +98,7 @@ public:
     QString valueUnitField() const { return vu_field_; }
     void setValueUnitField(const QString &vu_field);
     unsigned int movingAveragePeriod() const { return moving_avg_period_; }
-    void setInterval(int interval);
+    bool setInterval(int interval);
     bool addToLegend();
     bool removeFromLegend();
     QCPGraph *graph() const { return graph_; }
@@ -124,6 +132,9 @@ private:
     static void tapDraw(void *iog_ptr);
 
     void removeTapListener();
+    void resetLevels();
+    void updateLevels(packet_info *pinfo, epan_dissect_t *edt, const io_graph_item_t *packet_item);
+    bool regroupItems();
 
     bool showsZero() const;
 
@@ -152,6 +163,17 @@ private:
     // much as is feasible.
     std::vector<io_graph_item_t> items_;
     int cur_idx_;
+
+    // Buckets at power-of-ten intervals, filled in by the tap along with
+    // items_, from which items_ is regrouped when only the interval
+    // changes. Ordered from the finest interval to the coarsest.
+    struct BucketLevel {
+        int interval;
+        int max_items;
+        int cur_idx;
+        std::vector<io_graph_item_t> items;
+    };
+    std::vector<BucketLevel> levels_;
 };
 
 namespace Ui {
@@ -858,6 +858,9 @@ void MainApplication::emitAppSignal(AppSignal signal)
     case PacketDissectionChanged:
         emit packetDissectionChanged();
         break;
+    case PacketDissectionPrefsChanged:
+        emit packetDissectionPrefsChanged();
+        break;
     case ProfileChanging:
         emit profileChanging();
         break;
@@ -62,6 +62,7 @@ public:
         LocalInterfacesChanged,
         NameResolutionChanged,
         PacketDissectionChanged,
+        PacketDissectionPrefsChanged,
         PreferencesChanged,
         ProfileChanging,
         RecentCapturesChanged,
@@ -213,6 +214,7 @@ signals:
     void displayFilterListChanged();
     void filterExpressionsChanged();
     void packetDissectionChanged();
+    void packetDissectionPrefsChanged();
     void colorsChanged();
     void preferencesChanged();
     void addressResolutionChanged();
@@ -284,7 +284,7 @@ void PreferenceEditorFrame::on_buttonBox_accepted()
         if (changed_flags & PREF_EFFECT_FIELDS) {
             mainApp->emitAppSignal(MainApplication::FieldsChanged);
         }
-        mainApp->emitAppSignal(MainApplication::PacketDissectionChanged);
+        mainApp->emitAppSignal(MainApplication::PacketDissectionPrefsChanged);
         mainApp->emitAppSignal(MainApplication::PreferencesChanged);
     }
 }
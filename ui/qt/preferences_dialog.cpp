@@ -334,7 +334,7 @@ void PreferencesDialog::apply()
         mainApp->emitAppSignal(MainApplication::FreezePacketList);
 
         /* Redissect all the packets, and re-evaluate the display filter. */
-        mainApp->emitAppSignal(MainApplication::PacketDissectionChanged);
+        mainApp->emitAppSignal(MainApplication::PacketDissectionPrefsChanged);
     }
 
     if (redissect_flags) {
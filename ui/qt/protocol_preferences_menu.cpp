@@ -374,7 +374,7 @@ void ProtocolPreferencesMenu::boolPreferenceTriggered()
     }
     /* Protocol preference changes almost always affect dissection,
        so don't bother checking flags */
-    mainApp->emitAppSignal(MainApplication::PacketDissectionChanged);
+    mainApp->emitAppSignal(MainApplication::PacketDissectionPrefsChanged);
 }
 
 void ProtocolPreferencesMenu::enumPreferenceTriggered()
@@ -394,7 +394,7 @@ void ProtocolPreferencesMenu::enumPreferenceTriggered()
         }
         /* Protocol preference changes almost always affect dissection,
            so don't bother checking flags */
-        mainApp->emitAppSignal(MainApplication::PacketDissectionChanged);
+        mainApp->emitAppSignal(MainApplication::PacketDissectionPrefsChanged);
     }
 }
 
@@ -37,6 +37,11 @@ CompressionGroupBox::CompressionGroupBox(QWidget *parent) :
     bg_->addButton(radio3, WTAP_LZ4_COMPRESSED);
     vbox->addWidget(radio3);
 #endif
+#ifdef HAVE_ZSTD
+    QRadioButton *radio4 = new QRadioButton(tr("Compress with Z&standard"));
+    bg_->addButton(radio4, WTAP_ZSTD_COMPRESSED);
+    vbox->addWidget(radio4);
+#endif
 
     radio1->setChecked(true);
 
@@ -593,6 +593,7 @@ main_ui_->goToLineEdit->setValidator(goToLineQiv);
     connect(mainApp, &MainApplication::recentPreferencesRead, this, &WiresharkMainWindow::applyRecentPaneGeometry);
     connect(mainApp, &MainApplication::recentPreferencesRead, this, &WiresharkMainWindow::updateRecentActions);
     connect(mainApp, &MainApplication::packetDissectionChanged, this, &WiresharkMainWindow::redissectPackets, Qt::QueuedConnection);
+    connect(mainApp, &MainApplication::packetDissectionPrefsChanged, this, &WiresharkMainWindow::redissectPacketsForPrefs, Qt::QueuedConnection);
 
     connect(mainApp, &MainApplication::checkDisplayFilter, this, &WiresharkMainWindow::checkDisplayFilter);
     connect(mainApp, &MainApplication::fieldsChanged, this, &WiresharkMainWindow::fieldsChanged);
@@ -1568,6 +1568,18 @@ void WiresharkMainWindow::redissectPackets()
     proto_free_deregistered_fields();
 }
 
+// Only preferences changed, so packets might not need to be redissected
+// from scratch.
+void WiresharkMainWindow::redissectPacketsForPrefs()
+{
+    if (capture_file_.capFile()) {
+        cf_redissect_packets_for_prefs(capture_file_.capFile());
+        main_ui_->statusBar->expertUpdate();
+    }
+
+    proto_free_deregistered_fields();
+}
+
 void WiresharkMainWindow::checkDisplayFilter()
 {
     if (!df_combo_box_->checkDisplayFilter()) {
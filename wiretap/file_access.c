@@ -2124,7 +2124,7 @@ wtap_dump_can_open(int file_type_subtype)
  * Return whether we know how to write a compressed file of the specified
  * file type.
  */
-#if defined (HAVE_ZLIB) || defined (HAVE_ZLIBNG) || defined (HAVE_LZ4FRAME_H)
+#if defined (HAVE_ZLIB) || defined (HAVE_ZLIBNG) || defined (HAVE_LZ4FRAME_H) || defined (HAVE_ZSTD)
 bool
 wtap_dump_can_compress(int file_type_subtype)
 {
@@ -2223,6 +2223,8 @@ wtap_dump_init_dumper(int file_type_subtype, wtap_compression_type compression_t
 	wdh->snaplen = params->snaplen;
 	wdh->file_encap = params->encap;
 	wdh->compression_type = compression_type;
+	if (compression_type != WTAP_UNCOMPRESSED)
+		wdh->compression_threads = params->compression_threads;
 	wdh->wslua_data = NULL;
 	wdh->shb_iface_to_global = params->shb_iface_to_global;
 	wdh->interface_data = g_array_new(false, false, sizeof(wtap_block_t));
@@ -2522,6 +2524,13 @@ wtap_dump(wtap_dumper *wdh, const wtap_rec *rec,
 bool
 wtap_dump_flush(wtap_dumper *wdh, int *err)
 {
+	if (wdh->compression_threads != 0) {
+		if (pwfile_flush((PWFILE_T)wdh->fh) == -1) {
+			*err = pwfile_geterr((PWFILE_T)wdh->fh);
+			return false;
+		}
+		return true;
+	}
 	switch (wdh->compression_type) {
 #if defined (HAVE_ZLIB) || defined (HAVE_ZLIBNG)
 	case WTAP_GZIP_COMPRESSED:
@@ -2539,6 +2548,14 @@ wtap_dump_flush(wtap_dumper *wdh, int *err)
 		}
 		break;
 #endif /* HAVE_LZ4FRAME_H */
+#ifdef HAVE_ZSTD
+	case WTAP_ZSTD_COMPRESSED:
+		if (zstdwfile_flush((ZSTDWFILE_T)wdh->fh) == -1) {
+			*err = zstdwfile_geterr((ZSTDWFILE_T)wdh->fh);
+			return false;
+		}
+		break;
+#endif /* HAVE_ZSTD */
 	default:
 		if (fflush((FILE *)wdh->fh) == EOF) {
 			*err = errno;
@@ -2668,6 +2685,9 @@ wtap_dump_discard_sysdig_meta_events(wtap_dumper *wdh)
 static WFILE_T
 wtap_dump_file_open(wtap_dumper *wdh, const char *filename)
 {
+	if (wdh->compression_threads != 0)
+		return pwfile_open(filename, wdh->compression_type,
+		    wdh->compression_threads);
 	switch (wdh->compression_type) {
 #if defined (HAVE_ZLIB) || defined (HAVE_ZLIBNG)
 	case WTAP_GZIP_COMPRESSED:
@@ -2677,6 +2697,10 @@ wtap_dump_file_open(wtap_dumper *wdh, const char *filename)
 	case WTAP_LZ4_COMPRESSED:
 		return lz4wfile_open(filename);
 #endif /* HAVE_LZ4FRAME_H */
+#ifdef HAVE_ZSTD
+	case WTAP_ZSTD_COMPRESSED:
+		return zstdwfile_open(filename);
+#endif /* HAVE_ZSTD */
 	default:
 		return ws_fopen(filename, "wb");
 	}
@@ -2686,6 +2710,9 @@ wtap_dump_file_open(wtap_dumper *wdh, const char *filename)
 static WFILE_T
 wtap_dump_file_fdopen(wtap_dumper *wdh, int fd)
 {
+	if (wdh->compression_threads != 0)
+		return pwfile_fdopen(fd, wdh->compression_type,
+		    wdh->compression_threads);
 	switch (wdh->compression_type) {
 #if defined (HAVE_ZLIB) || defined (HAVE_ZLIBNG)
 	case WTAP_GZIP_COMPRESSED:
@@ -2695,6 +2722,10 @@ wtap_dump_file_fdopen(wtap_dumper *wdh, int fd)
 	case WTAP_LZ4_COMPRESSED:
 		return lz4wfile_fdopen(fd);
 #endif /* HAVE_LZ4FRAME_H */
+#ifdef HAVE_ZSTD
+	case WTAP_ZSTD_COMPRESSED:
+		return zstdwfile_fdopen(fd);
+#endif /* HAVE_ZSTD */
 	default:
 		return ws_fdopen(fd, "wb");
 	}
@@ -2706,6 +2737,18 @@ wtap_dump_file_write(wtap_dumper *wdh, const void *buf, size_t bufsize, int *err
 {
 	size_t nwritten;
 
+	if (wdh->compression_threads != 0) {
+		nwritten = pwfile_write((PWFILE_T)wdh->fh, buf, bufsize);
+		/*
+		 * pwfile_write() returns 0 on error.
+		 */
+		if (nwritten == 0) {
+			*err = pwfile_geterr((PWFILE_T)wdh->fh);
+			return false;
+		}
+		wdh->bytes_dumped += bufsize;
+		return true;
+	}
 	switch (wdh->compression_type) {
 #if defined (HAVE_ZLIB) || defined (HAVE_ZLIBNG)
 	case WTAP_GZIP_COMPRESSED:
@@ -2731,6 +2774,18 @@ wtap_dump_file_write(wtap_dumper *wdh, const void *buf, size_t bufsize, int *err
 		}
 		break;
 #endif /* HAVE_LZ4FRAME_H */
+#ifdef HAVE_ZSTD
+	case WTAP_ZSTD_COMPRESSED:
+		nwritten = zstdwfile_write((ZSTDWFILE_T)wdh->fh, buf, bufsize);
+		/*
+		 * zstdwfile_write() returns 0 on error.
+		 */
+		if (nwritten == 0) {
+			*err = zstdwfile_geterr((ZSTDWFILE_T)wdh->fh);
+			return false;
+		}
+		break;
+#endif /* HAVE_ZSTD */
 	default:
 		errno = WTAP_ERR_CANT_WRITE;
 		nwritten = fwrite(buf, 1, bufsize, (FILE *)wdh->fh);
@@ -2754,6 +2809,8 @@ wtap_dump_file_write(wtap_dumper *wdh, const void *buf, size_t bufsize, int *err
 static int
 wtap_dump_file_close(wtap_dumper *wdh)
 {
+	if (wdh->compression_threads != 0)
+		return pwfile_close((PWFILE_T)wdh->fh);
 	switch (wdh->compression_type) {
 #if defined (HAVE_ZLIB) || defined (HAVE_ZLIBNG)
 	case WTAP_GZIP_COMPRESSED:
@@ -2763,6 +2820,10 @@ wtap_dump_file_close(wtap_dumper *wdh)
 	case WTAP_LZ4_COMPRESSED:
 		return lz4wfile_close((LZ4WFILE_T)wdh->fh);
 #endif /* HAVE_LZ4FRAME_H */
+#ifdef HAVE_ZSTD
+	case WTAP_ZSTD_COMPRESSED:
+		return zstdwfile_close((ZSTDWFILE_T)wdh->fh);
+#endif /* HAVE_ZSTD */
 	default:
 		return fclose((FILE *)wdh->fh);
 	}
@@ -2771,7 +2832,7 @@ wtap_dump_file_close(wtap_dumper *wdh)
 int64_t
 wtap_dump_file_seek(wtap_dumper *wdh, int64_t offset, int whence, int *err)
 {
-#if defined (HAVE_ZLIB) || defined (HAVE_ZLIBNG) || defined (HAVE_LZ4FRAME_H)
+#if defined (HAVE_ZLIB) || defined (HAVE_ZLIBNG) || defined (HAVE_LZ4FRAME_H) || defined (HAVE_ZSTD)
 	if (wdh->compression_type != WTAP_UNCOMPRESSED) {
 		*err = WTAP_ERR_CANT_SEEK_COMPRESSED;
 		return -1;
@@ -2792,7 +2853,7 @@ int64_t
 wtap_dump_file_tell(wtap_dumper *wdh, int *err)
 {
 	int64_t rval;
-#if defined (HAVE_ZLIB) || defined (HAVE_ZLIBNG) || defined (HAVE_LZ4FRAME_H)
+#if defined (HAVE_ZLIB) || defined (HAVE_ZLIBNG) || defined (HAVE_LZ4FRAME_H) || defined (HAVE_ZSTD)
 	if (wdh->compression_type != WTAP_UNCOMPRESSED) {
 		*err = WTAP_ERR_CANT_SEEK_COMPRESSED;
 		return -1;
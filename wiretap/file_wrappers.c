@@ -59,6 +59,13 @@ typedef zng_stream zlib_stream;
 #endif /* LZ4_VERSION_NUMBER >= 10703 */
 #endif /* HAVE_LZ4 */
 
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#define USE_MMAP
+#define MAP_CHECK_INTERVAL (1024 * 1024)
+#endif /* _WIN32 */
+
 /*
  * List of compression types supported.
  */
@@ -73,7 +80,7 @@ static struct compression_type {
     { WTAP_GZIP_COMPRESSED, "gz", "gzip compressed", "gzip", true },
 #endif /* USE_ZLIB_OR_ZLIBNG */
 #ifdef HAVE_ZSTD
-    { WTAP_ZSTD_COMPRESSED, "zst", "zstd compressed", "zstd", false },
+    { WTAP_ZSTD_COMPRESSED, "zst", "zstd compressed", "zstd", true },
 #endif /* HAVE_ZSTD */
 #ifdef USE_LZ4
     { WTAP_LZ4_COMPRESSED, "lz4", "lz4 compressed", "lz4", true },
@@ -265,6 +272,29 @@ struct wtap_reader {
     /* fast seeking */
     GPtrArray *fast_seek;
     void *fast_seek_cur;
+
+    /*
+     * Memory-mapped reading.
+     *
+     * An uncompressed regular file opened with file_open() is mapped
+     * (privately, so that callers may modify what they're handed) and,
+     * while "mapped" is set, read straight from the mapping, bypassing
+     * the input and output buffers; pos is then the offset in the file.
+     * The file may grow after it's mapped, so reading past the end of
+     * the mapping switches back to reading from the file descriptor,
+     * and seeking back into it switches back to the mapping.
+     *
+     * If another process truncates the file, touching a page of the
+     * mapping past the new end of the file raises SIGBUS, so the size
+     * of the file is checked again after every MAP_CHECK_INTERVAL bytes
+     * read from the mapping, and only what's still in the file is read
+     * from it from then on.
+     */
+    uint8_t *map;               /* the mapping, or NULL */
+    int64_t map_len;            /* length of the mapping */
+    int64_t map_size;           /* how much of the mapping can be read */
+    int64_t map_unchecked;      /* bytes read since the size was checked */
+    bool mapped;                /* true if reading from the mapping */
 };
 
 /* Current read offset within a buffer. */
@@ -417,6 +447,19 @@ fast_seek_find(FILE_T file, int64_t pos)
     return smallest;
 }
 
+/*
+ * Allocates a fast seek point.  Only zlib and LZ4 seek points have
+ * compression-specific data; the others don't get room for it, as
+ * the zlib window makes that many times the size of the rest.
+ */
+static struct fast_seek_point *
+fast_seek_point_new(compression_t compression)
+{
+    if (compression == ZLIB || compression == LZ4)
+        return g_new(struct fast_seek_point, 1);
+    return (struct fast_seek_point *)g_malloc(offsetof(struct fast_seek_point, data));
+}
+
 static void
 fast_seek_header(FILE_T file, int64_t in_pos, int64_t out_pos,
                  compression_t compression)
@@ -436,7 +479,7 @@ fast_seek_header(FILE_T file, int64_t in_pos, int64_t out_pos,
      * or, for LZ4, compression options, may change.
      */
     if (!item || item->out < out_pos) {
-        struct fast_seek_point *val = g_new(struct fast_seek_point,1);
+        struct fast_seek_point *val = fast_seek_point_new(compression);
         val->in = in_pos;
         val->out = out_pos;
         val->compression = compression;
@@ -1011,7 +1054,38 @@ check_for_zlib_compression(FILE_T state)
  * Zstandard compression.
  *
  * https://github.com/facebook/zstd/blob/dev/doc/zstd_compression_format.md
+ *
+ * A zstd file can contain skippable frames as well as compressed frames;
+ * the decompressor skips them, but we have to recognize them as zstd.
+ * The seekable format uses one, at the end of the file, for its seek
+ * table (see below).
+ */
+#define ZSTD_IS_SKIPPABLE_FRAME(p) \
+    (((p)[0] & 0xf0) == 0x50 && (p)[1] == 0x2a && (p)[2] == 0x4d && (p)[3] == 0x18)
+
+/*
+ * The Zstandard seekable format:
+ *
+ * https://github.com/facebook/zstd/blob/dev/contrib/seekable_format/zstd_seekable_compression_format.md
+ *
+ * is a sequence of independently compressed frames, followed by a
+ * skippable frame containing a seek table that gives the compressed and
+ * decompressed size of each frame, followed by a footer with the number
+ * of frames.  Any zstd decompressor can read it; we can also load the
+ * seek table up front and get a fast seek point for every frame without
+ * first reading the file through.  We write zstd files in this format.
  */
+#define ZSTD_SKIPPABLE_SEEK_TABLE_MAGIC 0x184D2A5EU
+#define ZSTD_SEEKABLE_MAGIC             0x8F92EAB1U
+#define ZSTD_SKIPPABLE_HEADER_SIZE      8
+#define ZSTD_SEEK_TABLE_FOOTER_SIZE     9
+#define ZSTD_SEEK_TABLE_CHECKSUM_FLAG   0x80
+#define ZSTD_SEEK_TABLE_RESERVED_BITS   0x7C
+#define ZSTD_SEEKABLE_MAX_FRAMES        0x8000000U
+
+/* Uncompressed size of the frames we write; the same as SPAN */
+#define ZSTD_SEEKABLE_FRAME_SIZE        1048576
+
 #ifdef HAVE_ZSTD
 static bool
 zstd_fill_out_buffer(FILE_T state)
@@ -1055,8 +1129,9 @@ check_for_zstd_compression(FILE_T state)
      * success if we support Zstandard and an error if we don't.
      */
     if (state->in.avail >= 4
-        && state->in.next[0] == 0x28 && state->in.next[1] == 0xb5
-        && state->in.next[2] == 0x2f && state->in.next[3] == 0xfd) {
+        && ((state->in.next[0] == 0x28 && state->in.next[1] == 0xb5
+             && state->in.next[2] == 0x2f && state->in.next[3] == 0xfd)
+            || ZSTD_IS_SKIPPABLE_FRAME(state->in.next))) {
 #ifdef HAVE_ZSTD
         const size_t ret = ZSTD_initDStream(state->zstd_dctx);
         if (ZSTD_isError(ret)) {
@@ -1078,6 +1153,113 @@ check_for_zstd_compression(FILE_T state)
     return 0;
 }
 
+#ifdef HAVE_ZSTD
+/*
+ * Reads len bytes at offset off in the file into buf.  Returns false if
+ * they can't all be read; doesn't set state->err, as the caller can just
+ * do without them.  The file offset is left wherever; the caller has to
+ * seek back to state->raw_pos.
+ */
+static bool
+raw_read_at(FILE_T state, int64_t off, void *buf, unsigned len)
+{
+    unsigned got = 0;
+    ssize_t ret;
+
+    if (ws_lseek64(state->fd, off, SEEK_SET) == -1)
+        return false;
+    while (got < len) {
+        ret = ws_read(state->fd, (char *)buf + got, len - got);
+        if (ret <= 0)
+            return false;
+        got += (unsigned)ret;
+    }
+    return true;
+}
+
+/*
+ * If the file is a seekable zstd file (see above), adds fast seek points
+ * for all of its frames from its seek table.  This must be done before
+ * anything else is added to the fast seek data.
+ */
+static void
+zstd_seek_table_load(FILE_T state)
+{
+    static const uint8_t zstd_magic[4] = { 0x28, 0xb5, 0x2f, 0xfd };
+    uint8_t magic[4];
+    uint8_t footer[ZSTD_SEEK_TABLE_FOOTER_SIZE];
+    uint8_t *table = NULL;
+    int64_t file_size, table_size, in_pos, out_pos;
+    uint32_t num_frames, i;
+    unsigned entry_size;
+    uint8_t *entry;
+
+    if (state->start != 0)
+        return;
+    file_size = ws_lseek64(state->fd, 0, SEEK_END);
+    if (file_size < ZSTD_SKIPPABLE_HEADER_SIZE + ZSTD_SEEK_TABLE_FOOTER_SIZE)
+        goto done;
+    if (!raw_read_at(state, 0, magic, sizeof magic) ||
+        memcmp(magic, zstd_magic, sizeof magic) != 0)
+        goto done;
+    if (!raw_read_at(state, file_size - ZSTD_SEEK_TABLE_FOOTER_SIZE,
+                     footer, sizeof footer))
+        goto done;
+    if (pletoh32(&footer[5]) != ZSTD_SEEKABLE_MAGIC ||
+        (footer[4] & ZSTD_SEEK_TABLE_RESERVED_BITS) != 0)
+        goto done;
+
+    num_frames = pletoh32(&footer[0]);
+    entry_size = (footer[4] & ZSTD_SEEK_TABLE_CHECKSUM_FLAG) ? 12 : 8;
+    if (num_frames == 0 || num_frames > ZSTD_SEEKABLE_MAX_FRAMES)
+        goto done;
+    table_size = ZSTD_SKIPPABLE_HEADER_SIZE + (int64_t)num_frames * entry_size +
+                 ZSTD_SEEK_TABLE_FOOTER_SIZE;
+    if (table_size > file_size)
+        goto done;
+
+    table = (uint8_t *)g_try_malloc((size_t)table_size);
+    if (table == NULL ||
+        !raw_read_at(state, file_size - table_size, table, (unsigned)table_size))
+        goto done;
+    if (pletoh32(&table[0]) != ZSTD_SKIPPABLE_SEEK_TABLE_MAGIC ||
+        pletoh32(&table[4]) != table_size - ZSTD_SKIPPABLE_HEADER_SIZE)
+        goto done;
+
+    /*
+     * The frames have to account for everything before the seek
+     * table, or it doesn't describe this file.
+     */
+    in_pos = 0;
+    entry = table + ZSTD_SKIPPABLE_HEADER_SIZE;
+    for (i = 0; i < num_frames; i++, entry += entry_size)
+        in_pos += pletoh32(&entry[0]);
+    if (in_pos != file_size - table_size)
+        goto done;
+
+    in_pos = 0;
+    out_pos = 0;
+    entry = table + ZSTD_SKIPPABLE_HEADER_SIZE;
+    for (i = 0; i < num_frames; i++, entry += entry_size) {
+        struct fast_seek_point *val = fast_seek_point_new(ZSTD);
+
+        val->in = in_pos;
+        val->out = out_pos;
+        val->compression = ZSTD;
+        g_ptr_array_add(state->fast_seek, val);
+        in_pos += pletoh32(&entry[0]);
+        out_pos += pletoh32(&entry[4]);
+    }
+
+done:
+    g_free(table);
+    if (ws_lseek64(state->fd, state->raw_pos, SEEK_SET) == -1) {
+        state->err = errno;
+        state->err_info = NULL;
+    }
+}
+#endif /* HAVE_ZSTD */
+
 /*
  * lz4 compression.
  *
@@ -1822,6 +2004,103 @@ err:
     return NULL;
 }
 
+#ifdef USE_MMAP
+/*
+ * Maps the file, if it's a regular file that's not compressed at all, and
+ * starts reading from the mapping.
+ */
+static void
+file_map(FILE_T state)
+{
+    ws_statb64 st;
+    void *map;
+
+    if (state->start != 0)
+        return;
+    if (ws_fstat64(state->fd, &st) == -1 || !S_ISREG(st.st_mode) ||
+        st.st_size <= 0 || (uint64_t)st.st_size > SIZE_MAX)
+        return;
+
+    /*
+     * Look at the beginning of the file for a compression header.
+     * If there is none, offsets in the data are offsets in the file.
+     */
+    if (file_peekc(state) != -1 && state->compression == UNCOMPRESSED &&
+        state->raw == 0 && state->pos == 0)
+        map = mmap(NULL, (size_t)st.st_size, PROT_READ|PROT_WRITE,
+            MAP_PRIVATE, state->fd, 0);
+    else
+        map = MAP_FAILED;
+    if (map == MAP_FAILED) {
+        /*
+         * Start over, so that the compression header is looked at
+         * again once file_set_random_access() has been called, and
+         * gets its fast seek point.
+         */
+        gz_reset(state);
+        state->is_compressed = false;
+        state->raw_pos = 0;
+        if (ws_lseek64(state->fd, 0, SEEK_SET) == -1) {
+            state->err = errno;
+            state->err_info = NULL;
+        }
+        return;
+    }
+
+    state->map = (uint8_t *)map;
+    state->map_len = st.st_size;
+    state->map_size = st.st_size;
+    state->map_unchecked = 0;
+    state->mapped = true;
+    state->raw_pos = 0;
+    state->eof = false;
+    buf_reset(&state->in);
+    buf_reset(&state->out);
+}
+
+/*
+ * Called before reading len bytes from the mapping; every
+ * MAP_CHECK_INTERVAL bytes, makes sure the file hasn't been truncated
+ * since it was mapped, and if it has, stops reading past its new end
+ * from the mapping.
+ */
+static void
+map_check(FILE_T state, unsigned len)
+{
+    ws_statb64 st;
+
+    state->map_unchecked += len;
+    if (state->map_unchecked < MAP_CHECK_INTERVAL)
+        return;
+    state->map_unchecked = 0;
+
+    if (ws_fstat64(state->fd, &st) == -1)
+        st.st_size = 0;
+    if (st.st_size < state->map_size)
+        state->map_size = st.st_size;
+}
+
+/*
+ * Switches from reading from the mapping to reading from the file
+ * descriptor, at the same position.
+ */
+static int
+map_leave(FILE_T state)
+{
+    state->mapped = false;
+    state->eof = false;
+    buf_reset(&state->in);
+    buf_reset(&state->out);
+    if (ws_lseek64(state->fd, state->pos, SEEK_SET) == -1) {
+        state->err = errno;
+        state->err_info = NULL;
+        return -1;
+    }
+    state->raw_pos = state->pos;
+    return 0;
+}
+#endif /* USE_MMAP */
+
 FILE_T
 file_open(const char *path)
 {
@@ -1871,6 +2150,10 @@ file_open(const char *path)
     }
 #endif /* USE_ZLIB_OR_ZLIBNG */
 
+#ifdef USE_MMAP
+    file_map(ft);
+#endif /* USE_MMAP */
+
     return ft;
 }
 
@@ -1878,6 +2161,16 @@ void
 file_set_random_access(FILE_T stream, bool random_flag _U_, GPtrArray *seek)
 {
     stream->fast_seek = seek;
+
+#ifdef HAVE_ZSTD
+    /*
+     * The same fast seek data is shared by the sequential and random
+     * streams; load the seek table of a seekable zstd file, if this is
+     * one, into it only once.
+     */
+    if (seek != NULL && seek->len == 0 && !stream->mapped)
+        zstd_seek_table_load(stream);
+#endif /* HAVE_ZSTD */
 }
 
 int64_t
@@ -1894,6 +2187,46 @@ file_seek(FILE_T file, int64_t offset, int whence, int *err)
 */
     }
 
+#ifdef USE_MMAP
+    if (file->map != NULL && whence != SEEK_END) {
+        int64_t target = (whence == SEEK_SET) ? offset : file_tell(file) + offset;
+
+        if (target < 0) {
+            *err = EINVAL;
+            return -1;
+        }
+        if (target <= file->map_size) {
+            /*
+             * Within the mapping; just read from there.
+             */
+            file->mapped = true;
+            file->pos = target;
+            file->raw_pos = target;
+            file->seek_pending = false;
+            file->eof = false;
+            file->err = 0;
+            file->err_info = NULL;
+            buf_reset(&file->in);
+            buf_reset(&file->out);
+            return file->pos;
+        }
+        if (file->mapped) {
+            /*
+             * Past the end of the mapping, in what the file has
+             * grown by since; go back to reading it, and seek
+             * from the end of the mapping.
+             */
+            file->pos = file->map_size;
+            if (map_leave(file) == -1) {
+                *err = file->err;
+                return -1;
+            }
+            whence = SEEK_SET;
+            offset = target;
+        }
+    }
+#endif /* USE_MMAP */
+
     /* Normalize offset to a SEEK_CUR specification */
     if (whence == SEEK_END) {
         /* Seek relative to the end of the file; given that we might be
@@ -2320,6 +2653,36 @@ file_read(void *buf, unsigned int len, FILE_T file)
     if (len == 0)
         return 0;
 
+    got = 0;
+#ifdef USE_MMAP
+    if (file->mapped) {
+        if (file->err != 0)
+            return -1;
+
+        /* copy what the mapping has */
+        map_check(file, len);
+        if (file->pos >= file->map_size)
+            n = 0;
+        else
+            n = (int64_t)len > file->map_size - file->pos ?
+                (unsigned)(file->map_size - file->pos) : len;
+        if (buf != NULL && n != 0) {
+            memcpy(buf, file->map + file->pos, n);
+            buf = (char *)buf + n;
+        }
+        file->pos += n;
+        file->raw_pos = file->pos;
+        len -= n;
+        got = n;
+        if (len == 0)
+            return (int)got;
+
+        /* the rest, if any, is past the end of the mapping */
+        if (map_leave(file) == -1)
+            return -1;
+    }
+#endif /* USE_MMAP */
+
     /* process a skip request */
     if (file->seek_pending) {
         file->seek_pending = false;
@@ -2331,7 +2694,6 @@ file_read(void *buf, unsigned int len, FILE_T file)
      * Get len bytes to buf, or less than len if at the end;
      * if buf is null, just throw the bytes away.
      */
-    got = 0;
     do {
         if (file->out.avail != 0) {
             /* We have stuff in the output buffer; copy
@@ -2384,6 +2746,16 @@ file_peekc(FILE_T file)
     if (file->err != 0)
         return -1;
 
+#ifdef USE_MMAP
+    if (file->mapped) {
+        map_check(file, 1);
+        if (file->pos < file->map_size)
+            return file->map[file->pos];
+        if (map_leave(file) == -1)
+            return -1;
+    }
+#endif /* USE_MMAP */
+
     /* try output buffer (no need to check for skip request) */
     if (file->out.avail != 0) {
         return *(file->out.next);
@@ -2432,6 +2804,15 @@ file_getc(FILE_T file)
     if (file->err != 0)
         return -1;
 
+#ifdef USE_MMAP
+    if (file->mapped)
+        map_check(file, 1);
+    if (file->mapped && file->pos < file->map_size) {
+        file->raw_pos = file->pos + 1;
+        return file->map[file->pos++];
+    }
+#endif /* USE_MMAP */
+
     /* try output buffer (no need to check for skip request) */
     if (file->out.avail != 0) {
         file->out.avail--;
@@ -2443,6 +2824,37 @@ file_getc(FILE_T file)
     return ret < 1 ? -1 : buf[0];
 }
 
+/*
+ * If the next len bytes can be handed out without copying them, i.e.
+ * the file is being read from a mapping that has all of them, skips over
+ * them and returns a pointer to them; otherwise returns NULL, and the
+ * caller should read them with file_read().
+ *
+ * The bytes remain valid until the file is closed, and may be modified.
+ */
+uint8_t *
+file_borrow(FILE_T file, unsigned len)
+{
+#ifdef USE_MMAP
+    uint8_t *data;
+
+    if (!file->mapped || file->err != 0)
+        return NULL;
+    map_check(file, len);
+    if ((int64_t)len > file->map_size - file->pos)
+        return NULL;
+
+    data = file->map + file->pos;
+    file->pos += len;
+    file->raw_pos = file->pos;
+    return data;
+#else
+    (void)file;
+    (void)len;
+    return NULL;
+#endif /* USE_MMAP */
+}
+
 /*
  * Like file_gets, but returns a pointer to the terminating NUL
  * on success and NULL on failure.
@@ -2462,6 +2874,36 @@ file_getsp(char *buf, int len, FILE_T file)
     if (file->err != 0)
         return NULL;
 
+    curp = buf;
+    left = (unsigned)len - 1;
+#ifdef USE_MMAP
+    if (file->mapped && left) {
+        /* the same as below, but straight from the mapping */
+        map_check(file, left);
+        if (file->pos >= file->map_size)
+            n = 0;
+        else
+            n = (int64_t)left > file->map_size - file->pos ?
+                (unsigned)(file->map_size - file->pos) : left;
+        eol = (unsigned char *)memchr(file->map + file->pos, '\n', n);
+        if (eol != NULL)
+            n = (unsigned)(eol - (file->map + file->pos)) + 1;
+        memcpy(curp, file->map + file->pos, n);
+        file->pos += n;
+        file->raw_pos = file->pos;
+        left -= n;
+        curp += n;
+        if (eol != NULL || left == 0) {
+            *curp = '\0';
+            return curp;
+        }
+
+        /* the rest of the line, if any, is past the end of the mapping */
+        if (map_leave(file) == -1)
+            return NULL;
+    }
+#endif /* USE_MMAP */
+
     /* process a skip request */
     if (file->seek_pending) {
         file->seek_pending = false;
@@ -2472,8 +2914,6 @@ file_getsp(char *buf, int len, FILE_T file)
     /* copy output bytes up to new line or len - 1, whichever comes first --
        append a terminating zero to the string (we don't check for a zero in
        the contents, let the user worry about that) */
-    curp = buf;
-    left = (unsigned)len - 1;
     if (left) do {
             /* assure that something is in the output buffer */
             if (file->out.avail == 0) {
@@ -2597,6 +3037,10 @@ file_close(FILE_T file)
         g_free(file->in.buf);
     }
     g_free(file->fast_seek_cur);
+#ifdef USE_MMAP
+    if (file->map != NULL)
+        munmap(file->map, (size_t)file->map_len);
+#endif /* USE_MMAP */
     file->err = 0;
     file->err_info = NULL;
     g_free(file);
@@ -3143,6 +3587,410 @@ lz4wfile_geterr(LZ4WFILE_T state)
     return state->err;
 }
 #endif /* USE_LZ4 */
+
+#ifdef HAVE_ZSTD
+/* internal zstd file state data structure for writing */
+struct zstd_writer {
+    int fd;                 /* file descriptor */
+    int64_t pos;            /* current position in uncompressed data */
+    size_t size_out;        /* buffer size, zero if not allocated yet */
+    unsigned char *out;     /* output buffer, containing compressed data */
+    int err;                /* error code */
+    const char *err_info;   /* additional error information string for some errors */
+    ZSTD_CStream *zstd_cstream;
+    int compression_level;
+    uint32_t frame_in;      /* uncompressed bytes in the current frame */
+    uint32_t frame_out;     /* compressed bytes of the current frame so far */
+    GByteArray *seek_table; /* seek table entries for the frames written so far */
+};
+
+ZSTDWFILE_T
+zstdwfile_open(const char *path)
+{
+    int fd;
+    ZSTDWFILE_T state;
+    int save_errno;
+
+    fd = ws_open(path, O_BINARY|O_WRONLY|O_CREAT|O_TRUNC, 0666);
+    if (fd == -1)
+        return NULL;
+    state = zstdwfile_fdopen(fd);
+    if (state == NULL) {
+        save_errno = errno;
+        ws_close(fd);
+        errno = save_errno;
+    }
+    return state;
+}
+
+ZSTDWFILE_T
+zstdwfile_fdopen(int fd)
+{
+    ZSTDWFILE_T state;
+
+    /* allocate zstd_writer structure to return */
+    state = (ZSTDWFILE_T)g_try_malloc(sizeof *state);
+    if (state == NULL)
+        return NULL;
+    state->fd = fd;
+    state->size_out = 0;         /* no buffer allocated yet */
+    state->out = NULL;
+    state->zstd_cstream = NULL;
+    /* XXX - As with lz4, we could let the caller pick the level. */
+    state->compression_level = 3; /* the zstd command line utility default */
+
+    /* initialize stream */
+    state->err = 0;              /* clear error */
+    state->err_info = NULL;      /* clear additional error information */
+    state->pos = 0;              /* no uncompressed data yet */
+    state->frame_in = 0;
+    state->frame_out = 0;
+    state->seek_table = g_byte_array_new();
+
+    /* return stream */
+    return state;
+}
+
+/* Writes len bytes from buf to the file.
+ * Return true on success; returns false and sets state->err on failure.
+ */
+static bool
+zstd_write_out(ZSTDWFILE_T state, const void *buf, size_t len)
+{
+    if (len > 0) {
+        ssize_t got = ws_write(state->fd, buf, (unsigned)len);
+        if (got < 0) {
+            state->err = errno;
+            return false;
+        }
+        if ((size_t)got != len) {
+            state->err = WTAP_ERR_SHORT_WRITE;
+            return false;
+        }
+    }
+    return true;
+}
+
+/* Initialize state for writing a zstd file.  Mark initialization by setting
+   state->size_out to non-zero.  Return -1, and set state->err and possibly
+   state->err_info, on failure; return 0 on success. */
+static int
+zstd_init(ZSTDWFILE_T state)
+{
+    size_t ret;
+
+    state->zstd_cstream = ZSTD_createCStream();
+    if (state->zstd_cstream == NULL) {
+        state->err = ENOMEM;
+        return -1;
+    }
+    ret = ZSTD_initCStream(state->zstd_cstream, state->compression_level);
+    if (ZSTD_isError(ret)) {
+        state->err = WTAP_ERR_CANT_WRITE; // XXX - WTAP_ERR_COMPRESS?
+        state->err_info = ZSTD_getErrorName(ret);
+        return -1;
+    }
+
+    /* allocate buffer */
+    state->out = (unsigned char *)g_try_malloc(ZSTD_CStreamOutSize());
+    if (state->out == NULL) {
+        state->err = ENOMEM;
+        return -1;
+    }
+
+    /* mark state as initialized */
+    state->size_out = ZSTD_CStreamOutSize();
+
+    return 0;
+}
+
+/* Compresses len bytes from buf into the current frame, writing out
+ * whatever the compressor hands back.  Returns true on success; returns
+ * false and sets state->err on failure.
+ */
+static bool
+zstd_compress(ZSTDWFILE_T state, const void *buf, size_t len)
+{
+    ZSTD_inBuffer input = {buf, len, 0};
+
+    while (input.pos < input.size) {
+        ZSTD_outBuffer output = {state->out, state->size_out, 0};
+        const size_t ret = ZSTD_compressStream(state->zstd_cstream, &output, &input);
+        if (ZSTD_isError(ret)) {
+            state->err = WTAP_ERR_CANT_WRITE; // XXX - WTAP_ERR_COMPRESS?
+            state->err_info = ZSTD_getErrorName(ret);
+            return false;
+        }
+        if (!zstd_write_out(state, output.dst, output.pos))
+            return false;
+        state->frame_out += (uint32_t)output.pos;
+    }
+    return true;
+}
+
+/* Flushes the compressor, ending the current frame if end_frame is true.
+ * Returns true on success; returns false and sets state->err on failure.
+ */
+static bool
+zstd_flush_frame(ZSTDWFILE_T state, bool end_frame)
+{
+    size_t remaining;
+    uint8_t entry[8];
+
+    do {
+        ZSTD_outBuffer output = {state->out, state->size_out, 0};
+        remaining = end_frame ?
+            ZSTD_endStream(state->zstd_cstream, &output) :
+            ZSTD_flushStream(state->zstd_cstream, &output);
+        if (ZSTD_isError(remaining)) {
+            state->err = WTAP_ERR_CANT_WRITE; // XXX - WTAP_ERR_COMPRESS?
+            state->err_info = ZSTD_getErrorName(remaining);
+            return false;
+        }
+        if (!zstd_write_out(state, output.dst, output.pos))
+            return false;
+        state->frame_out += (uint32_t)output.pos;
+    } while (remaining != 0);
+
+    if (end_frame) {
+        /* Add the frame to the seek table and start a new one. */
+        phtole32(&entry[0], state->frame_out);
+        phtole32(&entry[4], state->frame_in);
+        g_byte_array_append(state->seek_table, entry, sizeof entry);
+        state->frame_in = 0;
+        state->frame_out = 0;
+
+        remaining = ZSTD_initCStream(state->zstd_cstream, state->compression_level);
+        if (ZSTD_isError(remaining)) {
+            state->err = WTAP_ERR_CANT_WRITE; // XXX - WTAP_ERR_COMPRESS?
+            state->err_info = ZSTD_getErrorName(remaining);
+            return false;
+        }
+    }
+    return true;
+}
+
+/* Write out len bytes from buf.  Return 0, and set state->err, on
+   failure or on an attempt to write 0 bytes (in which case state->err
+   is 0); return the number of bytes written on success. */
+size_t
+zstdwfile_write(ZSTDWFILE_T state, const void *buf, size_t len)
+{
+    size_t to_write;
+    size_t put = len;
+
+    /* check that there's no error */
+    if (state->err != 0)
+        return 0;
+
+    /* if len is zero, avoid unnecessary operations */
+    if (len == 0)
+        return 0;
+
+    /* allocate memory if this is the first time through */
+    if (state->size_out == 0 && zstd_init(state) == -1)
+        return 0;
+
+    /* Split the data into independent frames, for seeking. */
+    do {
+        to_write = MIN(len, ZSTD_SEEKABLE_FRAME_SIZE - state->frame_in);
+        if (!zstd_compress(state, buf, to_write))
+            return 0;
+        state->frame_in += (uint32_t)to_write;
+        state->pos += to_write;
+        buf = (const char *)buf + to_write;
+        len -= to_write;
+        if (state->frame_in == ZSTD_SEEKABLE_FRAME_SIZE &&
+            !zstd_flush_frame(state, true))
+            return 0;
+    } while (len);
+
+    /* input was all compressed */
+    return put;
+}
+
+/* Flush out what we've written so far.  Returns -1, and sets state->err,
+   on failure; returns 0 on success. */
+int
+zstdwfile_flush(ZSTDWFILE_T state)
+{
+    /* check that there's no error */
+    if (state->err != 0)
+        return -1;
+
+    /* nothing to flush if nothing has been written to this frame */
+    if (state->size_out == 0 || state->frame_in == 0)
+        return 0;
+
+    if (!zstd_flush_frame(state, false))
+        return -1;
+    return 0;
+}
+
+/* Turns an array of seek table entries into the skippable frame holding
+   the seek table, by adding the frame header and the seek table footer. */
+static void
+zstd_seek_table_finish(GByteArray *seek_table)
+{
+    uint8_t header[ZSTD_SKIPPABLE_HEADER_SIZE];
+    uint8_t footer[ZSTD_SEEK_TABLE_FOOTER_SIZE];
+    unsigned num_frames = seek_table->len / 8;
+
+    phtole32(&header[0], ZSTD_SKIPPABLE_SEEK_TABLE_MAGIC);
+    phtole32(&header[4], seek_table->len + ZSTD_SEEK_TABLE_FOOTER_SIZE);
+    phtole32(&footer[0], num_frames);
+    footer[4] = 0;  /* no checksums */
+    phtole32(&footer[5], ZSTD_SEEKABLE_MAGIC);
+    g_byte_array_prepend(seek_table, header, sizeof header);
+    g_byte_array_append(seek_table, footer, sizeof footer);
+}
+
+/* Ends the last frame and writes the seek table.  Returns true on success;
+   returns false and sets state->err on failure. */
+static bool
+zstd_finish(ZSTDWFILE_T state)
+{
+
+    if (state->size_out == 0) {
+        /*
+         * Nothing was written; write an empty frame, so that the file
+         * is still recognized as zstd.
+         */
+        if (zstd_init(state) == -1)
+            return false;
+    }
+    if ((state->frame_in != 0 || state->frame_out != 0 ||
+         state->seek_table->len == 0) &&
+        !zstd_flush_frame(state, true))
+        return false;
+
+    zstd_seek_table_finish(state->seek_table);
+    return zstd_write_out(state, state->seek_table->data, state->seek_table->len);
+}
+
+/* Flush out all data written, and close the file.  Returns a Wiretap
+   error on failure; returns 0 on success. */
+int
+zstdwfile_close(ZSTDWFILE_T state)
+{
+    int ret = 0;
+
+    /* flush, free memory, and close file */
+    if (state->err != 0 || !zstd_finish(state))
+        ret = state->err;
+    g_free(state->out);
+    ZSTD_freeCStream(state->zstd_cstream);
+    g_byte_array_free(state->seek_table, true);
+    if (ws_close(state->fd) == -1 && ret == 0)
+        ret = errno;
+    g_free(state);
+    return ret;
+}
+
+int
+zstdwfile_geterr(ZSTDWFILE_T state)
+{
+    return state->err;
+}
+#endif /* HAVE_ZSTD */
+
+/*
+ * Parallel compressed writing, with the writer in wsutil, which dumpcap
+ * also uses.  These translate its types and errors.
+ */
+static int
+pwfile_wtap_err(int err)
+{
+    switch (err) {
+
+    case WS_PARALLEL_ERR_SHORT_WRITE:
+        return WTAP_ERR_SHORT_WRITE;
+
+    case WS_PARALLEL_ERR_COMPRESS:
+        return WTAP_ERR_CANT_WRITE; // XXX - WTAP_ERR_COMPRESS?
+
+    case WS_PARALLEL_ERR_NOT_SUPPORTED:
+        return WTAP_ERR_COMPRESSION_NOT_SUPPORTED;
+
+    default:
+        return err;
+    }
+}
+
+PWFILE_T
+pwfile_open(const char *path, wtap_compression_type compression_type,
+            unsigned threads)
+{
+    int fd;
+    PWFILE_T state;
+    int save_errno;
+
+    fd = ws_open(path, O_BINARY|O_WRONLY|O_CREAT|O_TRUNC, 0666);
+    if (fd == -1)
+        return NULL;
+    state = pwfile_fdopen(fd, compression_type, threads);
+    if (state == NULL) {
+        save_errno = errno;
+        ws_close(fd);
+        errno = save_errno;
+    }
+    return state;
+}
+
+PWFILE_T
+pwfile_fdopen(int fd, wtap_compression_type compression_type, unsigned threads)
+{
+    ws_parallel_compression_t type;
+    PWFILE_T state;
+    int err;
+
+    switch (compression_type) {
+
+    case WTAP_GZIP_COMPRESSED:
+        type = WS_PARALLEL_GZIP;
+        break;
+
+    case WTAP_LZ4_COMPRESSED:
+        type = WS_PARALLEL_LZ4;
+        break;
+
+    case WTAP_ZSTD_COMPRESSED:
+        type = WS_PARALLEL_ZSTD;
+        break;
+
+    default:
+        errno = WTAP_ERR_COMPRESSION_NOT_SUPPORTED;
+        return NULL;
+    }
+    state = ws_parallel_writer_fdopen(fd, type, threads, &err);
+    if (state == NULL)
+        errno = pwfile_wtap_err(err);
+    return state;
+}
+
+size_t
+pwfile_write(PWFILE_T state, const void *buf, size_t len)
+{
+    return ws_parallel_writer_write(state, buf, len);
+}
+
+int
+pwfile_flush(PWFILE_T state)
+{
+    return ws_parallel_writer_flush(state);
+}
+
+int
+pwfile_close(PWFILE_T state)
+{
+    return pwfile_wtap_err(ws_parallel_writer_close(state, NULL));
+}
+
+int
+pwfile_geterr(PWFILE_T state)
+{
+    return pwfile_wtap_err(ws_parallel_writer_geterr(state, NULL));
+}
 /*
  * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
  *
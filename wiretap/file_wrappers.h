@@ -12,6 +12,7 @@
 #include <wireshark.h>
 #include "wtap.h"
 #include <wsutil/file_util.h>
+#include <wsutil/parallel_writer.h>
 
 extern FILE_T file_open(const char *path);
 extern FILE_T file_fdopen(int fildes);
@@ -24,6 +25,7 @@ WS_DLL_PUBLIC bool file_iscompressed(FILE_T stream);
 WS_DLL_PUBLIC int file_read(void *buf, unsigned int count, FILE_T file);
 WS_DLL_PUBLIC int file_peekc(FILE_T stream);
 WS_DLL_PUBLIC int file_getc(FILE_T stream);
+extern uint8_t *file_borrow(FILE_T stream, unsigned int count);
 WS_DLL_PUBLIC char *file_gets(char *buf, int len, FILE_T stream);
 WS_DLL_PUBLIC char *file_getsp(char *buf, int len, FILE_T stream);
 WS_DLL_PUBLIC int file_eof(FILE_T stream);
@@ -55,4 +57,24 @@ extern int lz4wfile_close(LZ4WFILE_T state);
 extern int lz4wfile_geterr(LZ4WFILE_T state);
 #endif
 
+#ifdef HAVE_ZSTD
+typedef struct zstd_writer *ZSTDWFILE_T;
+
+extern ZSTDWFILE_T zstdwfile_open(const char *path);
+extern ZSTDWFILE_T zstdwfile_fdopen(int fd);
+extern size_t zstdwfile_write(ZSTDWFILE_T state, const void *buf, size_t len);
+extern int zstdwfile_flush(ZSTDWFILE_T state);
+extern int zstdwfile_close(ZSTDWFILE_T state);
+extern int zstdwfile_geterr(ZSTDWFILE_T state);
+#endif /* HAVE_ZSTD */
+
+typedef ws_parallel_writer_t *PWFILE_T;
+
+extern PWFILE_T pwfile_open(const char *path, wtap_compression_type compression_type, unsigned threads);
+extern PWFILE_T pwfile_fdopen(int fd, wtap_compression_type compression_type, unsigned threads);
+extern size_t pwfile_write(PWFILE_T state, const void *buf, size_t len);
+extern int pwfile_flush(PWFILE_T state);
+extern int pwfile_close(PWFILE_T state);
+extern int pwfile_geterr(PWFILE_T state);
+
 #endif /* __FILE_H__ */
@@ -1392,10 +1392,16 @@ libpcap_read_packet(wtap *wth, FILE_T fh, wtap_rec *rec,
 	rec->rec_header.packet_header.len = orig_size;
 
 	/*
-	 * Read the packet data.
+	 * Read the packet data.  If post-processing won't byte-swap
+	 * pseudo-headers in it, it can be left in a memory-mapped file.
 	 */
-	if (!wtap_read_packet_bytes(fh, buf, packet_size, err, err_info))
-		return false;	/* failed */
+	if (libpcap->byte_swapped) {
+		if (!wtap_read_packet_bytes(fh, buf, packet_size, err, err_info))
+			return false;	/* failed */
+	} else {
+		if (!wtap_read_packet_bytes_nocopy(fh, buf, packet_size, err, err_info))
+			return false;	/* failed */
+	}
 
 	pcap_read_post_process(is_nokia, wth->file_encap, rec,
 	    ws_buffer_start_ptr(buf), libpcap->byte_swapped, libpcap->fcs_len);
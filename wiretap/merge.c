@@ -305,22 +305,432 @@ merge_select_frame_type(const int file_type, int in_file_count, merge_in_file_t
 }
 
 /*
- * returns true if first argument is earlier than second
+ * Number of records the read-ahead thread reads from an input file before
+ * it waits for the merge to catch up, and the number of free slots at
+ * which the merge hands the file back to the read-ahead thread.
+ *
+ * There is a single read-ahead thread for all the input files: some file
+ * readers keep state in static variables, so wtap_read() can't be called
+ * on several files at once.
+ */
+#define MERGE_READ_AHEAD_DEPTH  32
+#define MERGE_READ_AHEAD_REFILL (MERGE_READ_AHEAD_DEPTH / 2)
+
+/* A record read ahead from an input file, with what was read along with it. */
+typedef struct merge_read_ahead_rec_s {
+    wtap_rec        rec;
+    Buffer          frame_buffer;
+    bool            got_rec;        /* false on EOF or a read error */
+    int             err;
+    char           *err_info;
+    unsigned        interface_id;   /* global interface ID of the record */
+    GArray         *idbs;           /* IDBs, NRBs and DSBs read before the record, or NULL */
+    GArray         *nrbs;
+    GArray         *dsbs;
+} merge_read_ahead_rec_t;
+
+/*
+ * Read-ahead state of one input file.
+ *
+ * While the read-ahead thread may be reading from the file, the merge
+ * must not look at the wtap's IDB, NRB, DSB or SHB arrays, as
+ * wtap_read() appends to them; it uses the copies in idbs, nrbs and dsbs,
+ * which are built up from the records it has taken out of the queue.
+ */
+typedef struct merge_read_ahead_s {
+    wtap           *wth;
+    GMutex          wth_lock;       /* held while reading; see process_new_idbs() */
+    GMutex          lock;           /* protects the fields up to stop */
+    GCond           cond;
+    merge_read_ahead_rec_t slots[MERGE_READ_AHEAD_DEPTH];
+    unsigned        head;           /* next slot the merge takes a record from */
+    unsigned        count;          /* number of slots holding a record */
+    bool            scheduled;      /* the read-ahead thread is, or will be, reading */
+    bool            done;           /* EOF or a read error was reached */
+    bool            stop;           /* the merge is finished */
+    /* Used by the read-ahead thread only */
+    unsigned        idbs_copied;
+    unsigned        nrbs_copied;
+    unsigned        dsbs_copied;
+    /* Used by the merge only */
+    unsigned        interface_id;   /* global interface ID of the current record */
+    GArray         *idbs;
+    GArray         *nrbs;
+    GArray         *dsbs;
+} merge_read_ahead_t;
+
+/* State for reading the records to merge from the input files. */
+typedef struct merge_reader_s {
+    merge_in_file_t    *in_files;
+    unsigned            in_file_count;
+    /*
+     * Binary min-heap of the files that have a record present, ordered
+     * by merge_in_file_before().
+     */
+    merge_in_file_t   **heap;
+    unsigned            heap_len;
+    unsigned            next_first_read;    /* next file to read its first record from */
+    bool                top_returned;       /* the record of heap[0] was returned */
+    /* Files read from since their new IDBs were last processed */
+    GPtrArray          *files_read;
+    /* Per-file read-ahead state, or NULL if reading on this thread */
+    merge_read_ahead_t *read_ahead;
+    GThreadPool        *pool;
+} merge_reader_t;
+
+static unsigned
+rec_global_interface_id(wtap *wth, const wtap_rec *rec)
+{
+    if (rec->presence_flags & WTAP_HAS_INTERFACE_ID) {
+        unsigned section_num = (rec->presence_flags & WTAP_HAS_SECTION_NUMBER) ? rec->section_number : 0;
+        return wtap_file_get_shb_global_interface_id(wth, section_num, rec->rec_header.packet_header.interface_id);
+    }
+    return 0;
+}
+
+/* Append the blocks in from that haven't been copied yet to *to. */
+static void
+copy_new_blocks(const GArray *from, unsigned *copied, GArray **to)
+{
+    if (from == NULL || *copied >= from->len)
+        return;
+    if (*to == NULL)
+        *to = g_array_new(false, false, sizeof(wtap_block_t));
+    g_array_append_vals(*to, &g_array_index(from, wtap_block_t, *copied),
+                        from->len - *copied);
+    *copied = from->len;
+}
+
+/*
+ * Thread pool function; read records from an input file until its
+ * queue is full, or EOF or an error is reached.
+ */
+static void
+merge_read_ahead_fill(void *data, void *user_data _U_)
+{
+    merge_read_ahead_t *ra = (merge_read_ahead_t *)data;
+    merge_read_ahead_rec_t *slot;
+    int64_t data_offset;
+
+    g_mutex_lock(&ra->lock);
+    while (!ra->stop && ra->count < MERGE_READ_AHEAD_DEPTH) {
+        slot = &ra->slots[(ra->head + ra->count) % MERGE_READ_AHEAD_DEPTH];
+        g_mutex_unlock(&ra->lock);
+
+        /* The merge doesn't touch this slot until count includes it. */
+        g_mutex_lock(&ra->wth_lock);
+        slot->got_rec = wtap_read(ra->wth, &slot->rec, &slot->frame_buffer,
+                                  &slot->err, &slot->err_info, &data_offset);
+        if (slot->got_rec && slot->rec.rec_type == REC_TYPE_PACKET)
+            slot->interface_id = rec_global_interface_id(ra->wth, &slot->rec);
+        copy_new_blocks(ra->wth->interface_data, &ra->idbs_copied, &slot->idbs);
+        copy_new_blocks(ra->wth->nrbs, &ra->nrbs_copied, &slot->nrbs);
+        copy_new_blocks(ra->wth->dsbs, &ra->dsbs_copied, &slot->dsbs);
+        g_mutex_unlock(&ra->wth_lock);
+
+        g_mutex_lock(&ra->lock);
+        ra->count++;
+        g_cond_signal(&ra->cond);
+        if (!slot->got_rec) {
+            ra->done = true;
+            break;
+        }
+    }
+    ra->scheduled = false;
+    g_mutex_unlock(&ra->lock);
+}
+
+/* Append the blocks in the slot to the copies the merge uses, and empty it. */
+static void
+move_blocks(GArray *from, GArray **to)
+{
+    if (from == NULL || from->len == 0)
+        return;
+    if (*to == NULL)
+        *to = g_array_new(false, false, sizeof(wtap_block_t));
+    g_array_append_vals(*to, from->data, from->len);
+    g_array_set_size(from, 0);
+}
+
+/*
+ * Take the next record of an input file out of its read-ahead queue,
+ * waiting for it to be read if necessary.
  */
 static bool
-is_earlier(nstime_t *l, nstime_t *r) /* XXX, move to nstime.c */
+merge_read_ahead_next(merge_reader_t *reader, merge_read_ahead_t *ra,
+                      merge_in_file_t *in_file, int *err, char **err_info)
 {
-    if (l->secs > r->secs) {  /* left is later */
-        return false;
-    } else if (l->secs < r->secs) { /* left is earlier */
-        return true;
-    } else if (l->nsecs > r->nsecs) { /* tv_sec equal, l.usec later */
+    merge_read_ahead_rec_t *slot;
+    wtap_rec tmp_rec;
+    Buffer tmp_buffer;
+    bool got_rec;
+
+    g_mutex_lock(&ra->lock);
+    while (ra->count == 0 && !ra->done)
+        g_cond_wait(&ra->cond, &ra->lock);
+    if (ra->count == 0) {
+        /*
+         * The EOF or read error has already been taken; like wtap_read()
+         * after a short read, report EOF.
+         */
+        g_mutex_unlock(&ra->lock);
+        *err = 0;
+        *err_info = NULL;
         return false;
     }
-    /* either one < two or one == two
-     * either way, return one
+    slot = &ra->slots[ra->head];
+    g_mutex_unlock(&ra->lock);
+
+    /*
+     * Swap the record into the merge_in_file_t; the slot gets the
+     * previous record's storage to read into.
      */
-    return true;
+    tmp_rec = in_file->rec;
+    in_file->rec = slot->rec;
+    slot->rec = tmp_rec;
+    tmp_buffer = in_file->frame_buffer;
+    in_file->frame_buffer = slot->frame_buffer;
+    slot->frame_buffer = tmp_buffer;
+
+    got_rec = slot->got_rec;
+    *err = slot->err;
+    *err_info = slot->err_info;
+    slot->err_info = NULL;
+    ra->interface_id = slot->interface_id;
+    move_blocks(slot->idbs, &ra->idbs);
+    move_blocks(slot->nrbs, &ra->nrbs);
+    move_blocks(slot->dsbs, &ra->dsbs);
+
+    g_mutex_lock(&ra->lock);
+    ra->head = (ra->head + 1) % MERGE_READ_AHEAD_DEPTH;
+    ra->count--;
+    if (!ra->done && !ra->scheduled && ra->count <= MERGE_READ_AHEAD_REFILL) {
+        ra->scheduled = true;
+        g_thread_pool_push(reader->pool, ra, NULL);
+    }
+    g_mutex_unlock(&ra->lock);
+
+    return got_rec;
+}
+
+/** Set up reading the records to merge.
+ *
+ * @param reader reader state to initialize
+ * @param in_files input file array
+ * @param in_file_count number of entries in in_files
+ * @param read_ahead true to read ahead from the input files on another
+ * thread, false to read them on the merging thread
+ */
+static void
+merge_reader_init(merge_reader_t *reader, merge_in_file_t *in_files,
+                  unsigned in_file_count, bool read_ahead)
+{
+    unsigned i, j;
+
+    reader->in_files = in_files;
+    reader->in_file_count = in_file_count;
+    reader->heap = g_new(merge_in_file_t *, in_file_count);
+    reader->heap_len = 0;
+    reader->next_first_read = 0;
+    reader->top_returned = false;
+    reader->files_read = g_ptr_array_new();
+    reader->read_ahead = NULL;
+    reader->pool = NULL;
+
+    if (!read_ahead)
+        return;
+
+    reader->pool = g_thread_pool_new(merge_read_ahead_fill, NULL, 1, false, NULL);
+    if (reader->pool == NULL)
+        return;
+
+    reader->read_ahead = g_new0(merge_read_ahead_t, in_file_count);
+    for (i = 0; i < in_file_count; i++) {
+        merge_read_ahead_t *ra = &reader->read_ahead[i];
+        wtap *wth = in_files[i].wth;
+
+        ra->wth = wth;
+        g_mutex_init(&ra->wth_lock);
+        g_mutex_init(&ra->lock);
+        g_cond_init(&ra->cond);
+        for (j = 0; j < MERGE_READ_AHEAD_DEPTH; j++) {
+            wtap_rec_init(&ra->slots[j].rec);
+            ws_buffer_init(&ra->slots[j].frame_buffer, 1514);
+        }
+        /* Start with the blocks read when the file was opened. */
+        copy_new_blocks(wth->interface_data, &ra->idbs_copied, &ra->idbs);
+        copy_new_blocks(wth->nrbs, &ra->nrbs_copied, &ra->nrbs);
+        copy_new_blocks(wth->dsbs, &ra->dsbs_copied, &ra->dsbs);
+    }
+    for (i = 0; i < in_file_count; i++) {
+        reader->read_ahead[i].scheduled = true;
+        g_thread_pool_push(reader->pool, &reader->read_ahead[i], NULL);
+    }
+}
+
+/** Stop reading the records to merge.
+ *
+ * Afterwards, the wtaps of the input files can be looked at again.
+ *
+ * @param reader reader state to clean up
+ */
+static void
+merge_reader_cleanup(merge_reader_t *reader)
+{
+    unsigned i, j;
+
+    if (reader->read_ahead != NULL) {
+        for (i = 0; i < reader->in_file_count; i++) {
+            g_mutex_lock(&reader->read_ahead[i].lock);
+            reader->read_ahead[i].stop = true;
+            g_mutex_unlock(&reader->read_ahead[i].lock);
+        }
+        g_thread_pool_free(reader->pool, true, true);
+
+        for (i = 0; i < reader->in_file_count; i++) {
+            merge_read_ahead_t *ra = &reader->read_ahead[i];
+
+            /*
+             * Every IDB the merge has seen has an entry in the index
+             * map; let wtap_get_next_interface_description() carry on
+             * from there.
+             */
+            ra->wth->next_interface_data = reader->in_files[i].idb_index_map->len;
+
+            for (j = 0; j < MERGE_READ_AHEAD_DEPTH; j++) {
+                merge_read_ahead_rec_t *slot = &ra->slots[j];
+
+                wtap_rec_cleanup(&slot->rec);
+                ws_buffer_free(&slot->frame_buffer);
+                g_free(slot->err_info);
+                if (slot->idbs)
+                    g_array_free(slot->idbs, true);
+                if (slot->nrbs)
+                    g_array_free(slot->nrbs, true);
+                if (slot->dsbs)
+                    g_array_free(slot->dsbs, true);
+            }
+            if (ra->idbs)
+                g_array_free(ra->idbs, true);
+            if (ra->nrbs)
+                g_array_free(ra->nrbs, true);
+            if (ra->dsbs)
+                g_array_free(ra->dsbs, true);
+            g_mutex_clear(&ra->wth_lock);
+            g_mutex_clear(&ra->lock);
+            g_cond_clear(&ra->cond);
+        }
+        g_free(reader->read_ahead);
+        reader->read_ahead = NULL;
+        reader->pool = NULL;
+    }
+
+    g_free(reader->heap);
+    reader->heap = NULL;
+    g_ptr_array_free(reader->files_read, true);
+    reader->files_read = NULL;
+}
+
+static merge_read_ahead_t *
+merge_file_read_ahead(const merge_reader_t *reader, const merge_in_file_t *in_file)
+{
+    if (reader->read_ahead == NULL)
+        return NULL;
+    return &reader->read_ahead[in_file - reader->in_files];
+}
+
+/** Read the next record of an input file into its merge_in_file_t.
+ *
+ * @return true if a record was read, false on EOF or a read error
+ */
+static bool
+merge_next_record(merge_reader_t *reader, merge_in_file_t *in_file,
+                  int *err, char **err_info)
+{
+    merge_read_ahead_t *ra = merge_file_read_ahead(reader, in_file);
+    int64_t data_offset;
+    bool got_rec;
+
+    if (ra != NULL) {
+        got_rec = merge_read_ahead_next(reader, ra, in_file, err, err_info);
+    } else {
+        got_rec = wtap_read(in_file->wth, &in_file->rec,
+                            &in_file->frame_buffer, err, err_info,
+                            &data_offset);
+    }
+    g_ptr_array_add(reader->files_read, in_file);
+
+    if (got_rec) {
+        in_file->state = RECORD_PRESENT;
+    } else if (*err != 0) {
+        in_file->state = GOT_ERROR;
+    } else {
+        in_file->state = AT_EOF;
+    }
+    return got_rec;
+}
+
+/*
+ * Returns true if the record of the first file should be written before
+ * that of the second.
+ *
+ * Records without a time stamp go first, in file order.  Yes, this means
+ * you won't get a chronological merge of those records, but you obviously
+ * *can't* get that.  Records with the same time stamp go in reverse file
+ * order.
+ */
+static bool
+merge_in_file_before(const merge_in_file_t *l, const merge_in_file_t *r)
+{
+    bool l_has_ts = (l->rec.presence_flags & WTAP_HAS_TS) != 0;
+    bool r_has_ts = (r->rec.presence_flags & WTAP_HAS_TS) != 0;
+
+    if (!l_has_ts || !r_has_ts) {
+        if (!l_has_ts && !r_has_ts)
+            return l < r;
+        return !l_has_ts;
+    }
+    if (l->rec.ts.secs != r->rec.ts.secs)
+        return l->rec.ts.secs < r->rec.ts.secs;
+    if (l->rec.ts.nsecs != r->rec.ts.nsecs)
+        return l->rec.ts.nsecs < r->rec.ts.nsecs;
+    return l > r;
+}
+
+static void
+merge_heap_sift_up(merge_reader_t *reader, unsigned i)
+{
+    merge_in_file_t **heap = reader->heap;
+    merge_in_file_t *in_file = heap[i];
+
+    while (i > 0) {
+        unsigned parent = (i - 1) / 2;
+
+        if (!merge_in_file_before(in_file, heap[parent]))
+            break;
+        heap[i] = heap[parent];
+        i = parent;
+    }
+    heap[i] = in_file;
+}
+
+static void
+merge_heap_sift_down(merge_reader_t *reader, unsigned i)
+{
+    merge_in_file_t **heap = reader->heap;
+    merge_in_file_t *in_file = heap[i];
+    unsigned child;
+
+    while ((child = 2 * i + 1) < reader->heap_len) {
+        if (child + 1 < reader->heap_len &&
+            merge_in_file_before(heap[child + 1], heap[child]))
+            child++;
+        if (!merge_in_file_before(heap[child], in_file))
+            break;
+        heap[i] = heap[child];
+        i = child;
+    }
+    heap[i] = in_file;
 }
 
 /** Read the next packet, in chronological order, from the set of files to
@@ -335,8 +745,7 @@ is_earlier(nstime_t *l, nstime_t *r) /* XXX, move to nstime.c */
  * On an EOF (meaning all the files are at EOF), set *err to 0 and return
  * NULL.
  *
- * @param in_file_count number of entries in in_files
- * @param in_files input file array
+ * @param reader reader state
  * @param err wiretap error, if failed
  * @param err_info wiretap error string, if failed
  * @return pointer to merge_in_file_t for file from which that packet
@@ -344,80 +753,66 @@ is_earlier(nstime_t *l, nstime_t *r) /* XXX, move to nstime.c */
  * all files
  */
 static merge_in_file_t *
-merge_read_packet(int in_file_count, merge_in_file_t in_files[],
-                  int *err, char **err_info)
+merge_read_packet(merge_reader_t *reader, int *err, char **err_info)
 {
-    int i;
-    int ei = -1;
-    nstime_t tv = NSTIME_INIT_MAX;
-    wtap_rec *rec;
+    merge_in_file_t *in_file;
 
     /*
-     * Make sure we have a record available from each file that's not at
-     * EOF, and search for the record with the earliest time stamp or
-     * with no time stamp (those records are treated as earlier than
-     * all other records).  Yes, this means you won't get a chronological
-     * merge of those records, but you obviously *can't* get that.
+     * The file whose record we returned last time is at the top of
+     * the heap; replace that record with the file's next one.
      */
-    for (i = 0; i < in_file_count; i++) {
-        int64_t data_offset;
-
-        if (in_files[i].state == RECORD_NOT_PRESENT) {
-            /*
-             * No packet available, and we haven't seen an error or EOF yet,
-             * so try to read the next packet.
-             */
-            if (!wtap_read(in_files[i].wth, &in_files[i].rec,
-                           &in_files[i].frame_buffer, err, err_info,
-                           &data_offset)) {
-                if (*err != 0) {
-                    in_files[i].state = GOT_ERROR;
-                    return &in_files[i];
-                }
-                in_files[i].state = AT_EOF;
-            } else
-                in_files[i].state = RECORD_PRESENT;
+    if (reader->top_returned) {
+        reader->top_returned = false;
+        in_file = reader->heap[0];
+        if (!merge_next_record(reader, in_file, err, err_info)) {
+            reader->heap[0] = reader->heap[--reader->heap_len];
+            if (reader->heap_len != 0)
+                merge_heap_sift_down(reader, 0);
+            if (*err != 0)
+                return in_file;
+        } else {
+            merge_heap_sift_down(reader, 0);
         }
+    }
 
-        if (in_files[i].state == RECORD_PRESENT) {
-            rec = &in_files[i].rec;
-            if (!(rec->presence_flags & WTAP_HAS_TS)) {
-                /*
-                 * No time stamp.  Pick this record, and stop looking.
-                 */
-                ei = i;
-                break;
-            }
-            if (is_earlier(&rec->ts, &tv)) {
-                /*
-                 * This record's time stamp is earlier than any of the
-                 * records we've seen so far.  Pick it, for now, but
-                 * keep looking.
-                 */
-                tv = rec->ts;
-                ei = i;
-            }
+    /*
+     * Make sure we've read the first record from each file; a record
+     * without a time stamp goes out before the files after it are read.
+     */
+    while (reader->next_first_read < reader->in_file_count &&
+           (reader->heap_len == 0 ||
+            (reader->heap[0]->rec.presence_flags & WTAP_HAS_TS))) {
+        in_file = &reader->in_files[reader->next_first_read++];
+        if (!merge_next_record(reader, in_file, err, err_info)) {
+            if (*err != 0)
+                return in_file;
+            continue;
         }
+        reader->heap[reader->heap_len] = in_file;
+        merge_heap_sift_up(reader, reader->heap_len++);
     }
 
-    if (ei == -1) {
+    if (reader->heap_len == 0) {
         /* All the streams are at EOF.  Return an EOF indication. */
         *err = 0;
         return NULL;
     }
 
+    in_file = reader->heap[0];
+    reader->top_returned = true;
+
     /* We'll need to read another packet from this file. */
-    in_files[ei].state = RECORD_NOT_PRESENT;
+    in_file->state = RECORD_NOT_PRESENT;
 
     /* Count this packet. */
-    in_files[ei].packet_num++;
+    in_file->packet_num++;
 
     /*
      * Return a pointer to the merge_in_file_t of the file from which the
      * packet was read.
      */
     *err = 0;
-    return &in_files[ei];
+    return in_file;
 }
 
 /** Read the next packet, in file sequence order, from the set of files
@@ -432,8 +827,7 @@ merge_read_packet(int in_file_count, merge_in_file_t in_files[],
  * On an EOF (meaning all the files are at EOF), set *err to 0 and return
  * NULL.
  *
- * @param in_file_count number of entries in in_files
- * @param in_files input file array
+ * @param reader reader state
  * @param err wiretap error, if failed
  * @param err_info wiretap error string, if failed
  * @return pointer to merge_in_file_t for file from which that packet
@@ -441,31 +835,27 @@ merge_read_packet(int in_file_count, merge_in_file_t in_files[],
  * all files
  */
 static merge_in_file_t *
-merge_append_read_packet(int in_file_count, merge_in_file_t in_files[],
-                         int *err, char **err_info)
+merge_append_read_packet(merge_reader_t *reader, int *err, char **err_info)
 {
-    int i;
-    int64_t data_offset;
+    merge_in_file_t *in_file = NULL;
+    unsigned i;
 
     /*
      * Find the first file not at EOF, and read the next packet from it.
      */
-    for (i = 0; i < in_file_count; i++) {
-        if (in_files[i].state == AT_EOF)
+    for (i = 0; i < reader->in_file_count; i++) {
+        in_file = &reader->in_files[i];
+        if (in_file->state == AT_EOF)
             continue; /* This file is already at EOF */
-        if (wtap_read(in_files[i].wth, &in_files[i].rec,
-                      &in_files[i].frame_buffer, err, err_info,
-                      &data_offset))
+        if (merge_next_record(reader, in_file, err, err_info))
             break; /* We have a packet */
         if (*err != 0) {
             /* Read error - quit immediately. */
-            in_files[i].state = GOT_ERROR;
-            return &in_files[i];
+            return in_file;
         }
-        /* EOF - flag this file as being at EOF, and try the next one. */
-        in_files[i].state = AT_EOF;
+        /* EOF - try the next one. */
     }
-    if (i == in_file_count) {
+    if (i == reader->in_file_count) {
         /* All the streams are at EOF.  Return an EOF indication. */
         *err = 0;
         return NULL;
@@ -476,7 +866,49 @@ merge_append_read_packet(int in_file_count, merge_in_file_t in_files[],
      * packet was read.
      */
     *err = 0;
-    return &in_files[i];
+    return in_file;
+}
+
+/*
+ * The IDBs, NRBs and DSBs of an input file the merge may look at.
+ */
+static wtap_block_t
+merge_next_idb(const merge_reader_t *reader, merge_in_file_t *in_file)
+{
+    merge_read_ahead_t *ra = merge_file_read_ahead(reader, in_file);
+
+    if (ra == NULL)
+        return wtap_get_next_interface_description(in_file->wth);
+    /* Every IDB seen so far has an entry in the index map. */
+    if (ra->idbs == NULL || in_file->idb_index_map->len >= ra->idbs->len)
+        return NULL;
+    return g_array_index(ra->idbs, wtap_block_t, in_file->idb_index_map->len);
+}
+
+static GArray *
+merge_file_nrbs(const merge_reader_t *reader, const merge_in_file_t *in_file)
+{
+    merge_read_ahead_t *ra = merge_file_read_ahead(reader, in_file);
+
+    return ra != NULL ? ra->nrbs : in_file->wth->nrbs;
+}
+
+static GArray *
+merge_file_dsbs(const merge_reader_t *reader, const merge_in_file_t *in_file)
+{
+    merge_read_ahead_t *ra = merge_file_read_ahead(reader, in_file);
+
+    return ra != NULL ? ra->dsbs : in_file->wth->dsbs;
+}
+
+static unsigned
+merge_rec_interface_id(const merge_reader_t *reader, merge_in_file_t *in_file)
+{
+    merge_read_ahead_t *ra = merge_file_read_ahead(reader, in_file);
+
+    if (ra != NULL)
+        return ra->interface_id;
+    return rec_global_interface_id(in_file->wth, &in_file->rec);
 }
 
 
@@ -839,66 +1271,74 @@ add_idb_to_merged_file(wtapng_iface_descriptions_t *merged_idb_list,
 
 /*
  * Create clone IDBs for the merge file for IDBs found in the middle of
- * input files while processing.
+ * an input file while processing.
  */
 static bool
-process_new_idbs(wtap_dumper *pdh, merge_in_file_t *in_files, const unsigned in_file_count, const idb_merge_mode mode, wtapng_iface_descriptions_t *merged_idb_list, int *err, char **err_info)
+process_new_idbs(wtap_dumper *pdh, const merge_reader_t *reader, merge_in_file_t *in_file, const idb_merge_mode mode, wtapng_iface_descriptions_t *merged_idb_list, int *err, char **err_info)
 {
+    merge_read_ahead_t          *ra = merge_file_read_ahead(reader, in_file);
     wtap_block_t                 input_file_idb;
     unsigned                     itf_count, merged_index;
-    unsigned                     i;
+    bool                         ret = true;
 
-    for (i = 0; i < in_file_count; i++) {
+    /*
+     * The number below is the global interface number within wth,
+     * not the number within the section. We will do both mappings
+     * in map_rec_interface_id().
+     */
+    itf_count = in_file->idb_index_map->len;
+    while (ret && (input_file_idb = merge_next_idb(reader, in_file)) != NULL) {
 
         /*
-         * The number below is the global interface number within wth,
-         * not the number within the section. We will do both mappings
-         * in map_rec_interface_id().
+         * The read-ahead thread may add ISBs to the IDB while reading;
+         * don't let it while we compare and copy it.
+         */
+        if (ra != NULL)
+            g_mutex_lock(&ra->wth_lock);
+
+        /* If we were initially in ALL mode and all the interfaces
+         * did match, then we set the mode to ANY (merge duplicates).
+         * If the interfaces didn't match, then we are still in ALL
+         * mode, but treat that as NONE (write out all IDBs.)
+         * XXX: Should there be separate modes for "match ALL at the start
+         * and ANY later" vs "match ALL at the beginning and NONE later"?
+         * Should there be a two-pass mode for people who want ALL mode to
+         * work for IDBs in the middle of the file? (See #16542)
          */
-        itf_count = in_files[i].wth->next_interface_data;
-        while ((input_file_idb = wtap_get_next_interface_description(in_files[i].wth)) != NULL) {
-
-            /* If we were initially in ALL mode and all the interfaces
-             * did match, then we set the mode to ANY (merge duplicates).
-             * If the interfaces didn't match, then we are still in ALL
-             * mode, but treat that as NONE (write out all IDBs.)
-             * XXX: Should there be separate modes for "match ALL at the start
-             * and ANY later" vs "match ALL at the beginning and NONE later"?
-             * Should there be a two-pass mode for people who want ALL mode to
-             * work for IDBs in the middle of the file? (See #16542)
-             */
 
-            if (mode == IDB_MERGE_MODE_ANY_SAME &&
-                find_duplicate_idb(input_file_idb, merged_idb_list, &merged_index))
-            {
-                ws_debug("mode ANY set and found a duplicate");
-                /*
-                 * It's the same as a previous IDB, so we're going to "merge"
-                 * them into one by adding a map from its old IDB index to the
-                 * new one. This will be used later to change the rec
-                 * interface_id.
-                 */
-                add_idb_index_map(&in_files[i], itf_count, merged_index);
-            }
-            else {
-                ws_debug("mode NONE or ALL set or did not find a duplicate");
-                /*
-                 * This IDB does not match a previous (or we want to save all
-                 * IDBs), so add the IDB to the merge file, and add a map of
-                 * the indices.
-                 */
-                if (add_idb_to_merged_file(merged_idb_list, input_file_idb, pdh, err, err_info)) {
-                    merged_index = merged_idb_list->interface_data->len - 1;
-                    add_idb_index_map(&in_files[i], itf_count, merged_index);
-                } else {
-                    return false;
-                }
+        if (mode == IDB_MERGE_MODE_ANY_SAME &&
+            find_duplicate_idb(input_file_idb, merged_idb_list, &merged_index))
+        {
+            ws_debug("mode ANY set and found a duplicate");
+            /*
+             * It's the same as a previous IDB, so we're going to "merge"
+             * them into one by adding a map from its old IDB index to the
+             * new one. This will be used later to change the rec
+             * interface_id.
+             */
+            add_idb_index_map(in_file, itf_count, merged_index);
+        }
+        else {
+            ws_debug("mode NONE or ALL set or did not find a duplicate");
+            /*
+             * This IDB does not match a previous (or we want to save all
+             * IDBs), so add the IDB to the merge file, and add a map of
+             * the indices.
+             */
+            if (add_idb_to_merged_file(merged_idb_list, input_file_idb, pdh, err, err_info)) {
+                merged_index = merged_idb_list->interface_data->len - 1;
+                add_idb_index_map(in_file, itf_count, merged_index);
+            } else {
+                ret = false;
             }
-            itf_count = in_files[i].wth->next_interface_data;
         }
+
+        if (ra != NULL)
+            g_mutex_unlock(&ra->wth_lock);
+        itf_count = in_file->idb_index_map->len;
     }
 
-    return true;
+    return ret;
 }
 
 /*
@@ -981,17 +1421,14 @@ generate_merged_idbs(merge_in_file_t *in_files, const unsigned in_file_count, id
 }
 
 static bool
-map_rec_interface_id(wtap_rec *rec, const merge_in_file_t *in_file)
+map_rec_interface_id(wtap_rec *rec, const merge_reader_t *reader, merge_in_file_t *in_file)
 {
-    unsigned current_interface_id = 0;
+    unsigned current_interface_id;
     ws_assert(rec != NULL);
     ws_assert(in_file != NULL);
     ws_assert(in_file->idb_index_map != NULL);
 
-    if (rec->presence_flags & WTAP_HAS_INTERFACE_ID) {
-        unsigned section_num = (rec->presence_flags & WTAP_HAS_SECTION_NUMBER) ? rec->section_number : 0;
-        current_interface_id = wtap_file_get_shb_global_interface_id(in_file->wth, section_num, rec->rec_header.packet_header.interface_id);
-    }
+    current_interface_id = merge_rec_interface_id(reader, in_file);
 
     if (current_interface_id >= in_file->idb_index_map->len) {
         /* this shouldn't happen, but in a malformed input file it could */
@@ -1024,6 +1461,7 @@ merge_process_packets(wtap_dumper *pdh, const int file_type,
                       merge_in_file_t *in_files, const unsigned in_file_count,
                       const bool do_append,
                       const idb_merge_mode mode, unsigned snaplen,
+                      bool read_ahead,
                       merge_progress_callback_t* cb,
                       wtapng_iface_descriptions_t *idb_inf,
                       GArray *nrb_combined, GArray *dsb_combined,
@@ -1031,21 +1469,23 @@ merge_process_packets(wtap_dumper *pdh, const int file_type,
                       uint32_t *err_framenum)
 {
     merge_result        status = MERGE_OK;
+    merge_reader_t      reader;
     merge_in_file_t    *in_file;
     int                 count = 0;
     bool                stop_flag = false;
     wtap_rec *rec,      snap_rec;
+    GArray             *in_nrb, *in_dsb;
+
+    merge_reader_init(&reader, in_files, in_file_count, read_ahead);
 
     for (;;) {
         *err = 0;
 
         if (do_append) {
-            in_file = merge_append_read_packet(in_file_count, in_files, err,
-                                               err_info);
+            in_file = merge_append_read_packet(&reader, err, err_info);
         }
         else {
-            in_file = merge_read_packet(in_file_count, in_files, err,
-                                        err_info);
+            in_file = merge_read_packet(&reader, err, err_info);
         }
 
         if (in_file == NULL) {
@@ -1087,13 +1527,22 @@ merge_process_packets(wtap_dumper *pdh, const int file_type,
 
         rec = &in_file->rec;
 
+        /*
+         * Only the files we've read from since the last record can have
+         * new IDBs.
+         */
         if (wtap_file_type_subtype_supports_block(file_type,
                                                   WTAP_BLOCK_IF_ID_AND_INFO) != BLOCK_NOT_SUPPORTED) {
-            if (!process_new_idbs(pdh, in_files, in_file_count, mode, idb_inf, err, err_info)) {
-                status = MERGE_ERR_CANT_WRITE_OUTFILE;
-                break;
+            for (unsigned i = 0; i < reader.files_read->len; i++) {
+                if (!process_new_idbs(pdh, &reader, (merge_in_file_t *)g_ptr_array_index(reader.files_read, i), mode, idb_inf, err, err_info)) {
+                    status = MERGE_ERR_CANT_WRITE_OUTFILE;
+                    break;
+                }
             }
+            if (status != MERGE_OK)
+                break;
         }
+        g_ptr_array_set_size(reader.files_read, 0);
 
         switch (rec->rec_type) {
 
@@ -1132,7 +1581,7 @@ merge_process_packets(wtap_dumper *pdh, const int file_type,
              * out a more general way to handle this.
              */
             if (rec->rec_type == REC_TYPE_PACKET) {
-                if (!map_rec_interface_id(rec, in_file)) {
+                if (!map_rec_interface_id(rec, &reader, in_file)) {
                     status = MERGE_ERR_BAD_PHDR_INTERFACE_ID;
                     break;
                 }
@@ -1142,16 +1591,16 @@ merge_process_packets(wtap_dumper *pdh, const int file_type,
          * If any DSBs were read before this record, be sure to pass those now
          * such that wtap_dump can pick it up.
          */
-        if (nrb_combined && in_file->wth->nrbs) {
-            GArray *in_nrb = in_file->wth->nrbs;
+        in_nrb = merge_file_nrbs(&reader, in_file);
+        if (nrb_combined && in_nrb) {
             for (unsigned i = in_file->nrbs_seen; i < in_nrb->len; i++) {
                 wtap_block_t wblock = g_array_index(in_nrb, wtap_block_t, i);
                 g_array_append_val(nrb_combined, wblock);
                 in_file->nrbs_seen++;
             }
         }
-        if (dsb_combined && in_file->wth->dsbs) {
-            GArray *in_dsb = in_file->wth->dsbs;
+        in_dsb = merge_file_dsbs(&reader, in_file);
+        if (dsb_combined && in_dsb) {
             for (unsigned i = in_file->dsbs_seen; i < in_dsb->len; i++) {
                 wtap_block_t wblock = g_array_index(in_dsb, wtap_block_t, i);
                 g_array_append_val(dsb_combined, wblock);
@@ -1167,6 +1616,9 @@ merge_process_packets(wtap_dumper *pdh, const int file_type,
         wtap_rec_reset(rec);
     }
 
+    /* Stop any read-ahead before looking at the input files' wtaps. */
+    merge_reader_cleanup(&reader);
+
     if (cb)
         cb->callback_func(MERGE_EVENT_DONE, count, in_files, in_file_count, cb->data);
 
@@ -1174,14 +1626,17 @@ merge_process_packets(wtap_dumper *pdh, const int file_type,
         /* Check for IDBs, NRBs, or DSBs read after the last packet records. */
         if (wtap_file_type_subtype_supports_block(file_type,
                                                   WTAP_BLOCK_IF_ID_AND_INFO) != BLOCK_NOT_SUPPORTED) {
-            if (!process_new_idbs(pdh, in_files, in_file_count, mode, idb_inf, err, err_info)) {
-                status = MERGE_ERR_CANT_WRITE_OUTFILE;
+            for (unsigned j = 0; j < in_file_count; j++) {
+                if (!process_new_idbs(pdh, &reader, &in_files[j], mode, idb_inf, err, err_info)) {
+                    status = MERGE_ERR_CANT_WRITE_OUTFILE;
+                    break;
+                }
             }
         }
         if (nrb_combined) {
             for (unsigned j = 0; j < in_file_count; j++) {
                 in_file = &in_files[j];
-                GArray *in_nrb = in_file->wth->nrbs;
+                in_nrb = in_file->wth->nrbs;
                 if (in_nrb) {
                     for (unsigned i = in_file->nrbs_seen; i < in_nrb->len; i++) {
                         wtap_block_t wblock = g_array_index(in_nrb, wtap_block_t, i);
@@ -1194,7 +1649,7 @@ merge_process_packets(wtap_dumper *pdh, const int file_type,
         if (dsb_combined) {
             for (unsigned j = 0; j < in_file_count; j++) {
                 in_file = &in_files[j];
-                GArray *in_dsb = in_file->wth->dsbs;
+                in_dsb = in_file->wth->dsbs;
                 if (in_dsb) {
                     for (unsigned i = in_file->dsbs_seen; i < in_dsb->len; i++) {
                         wtap_block_t wblock = g_array_index(in_dsb, wtap_block_t, i);
@@ -1254,7 +1709,8 @@ merge_files_common(const char* out_filename, /* filename in normal output mode,
                    const int file_type, const char *const *in_filenames,
                    const unsigned in_file_count, const bool do_append,
                    idb_merge_mode mode, unsigned snaplen,
-                   const char *app_name, merge_progress_callback_t* cb, wtap_compression_type compression_type)
+                   const char *app_name, merge_progress_callback_t* cb, wtap_compression_type compression_type,
+                   bool read_ahead)
 {
     merge_in_file_t    *in_files = NULL;
     int                 frame_type = WTAP_ENCAP_PER_PACKET;
@@ -1409,7 +1865,8 @@ merge_files_common(const char* out_filename, /* filename in normal output mode,
             cb->callback_func(MERGE_EVENT_READY_TO_MERGE, 0, in_files, open_file_count, cb->data);
 
         status = merge_process_packets(pdh, file_type, in_files, open_file_count,
-                                       do_append, mode, snaplen, cb,
+                                       do_append, mode, snaplen,
+                                       read_ahead, cb,
                                        idb_inf, nrb_combined, dsb_combined,
                                        &err, &err_info,
                                        &err_fileno, &err_framenum);
@@ -1476,7 +1933,8 @@ merge_files_common(const char* out_filename, /* filename in normal output mode,
         // We recurse here, but we're limited by MAX_MERGE_FILES
         status = merge_files_common(out_filename, out_filenamep, pfx,
                     file_type, (const char**)temp_files->pdata,
-                    temp_files->len, do_append, mode, snaplen, app_name, cb, compression_type);
+                    temp_files->len, do_append, mode, snaplen, app_name, cb, compression_type,
+                    read_ahead);
         /* If that failed, it has already reported an error */
         g_ptr_array_free(temp_files, true);
     }
@@ -1496,11 +1954,30 @@ merge_files(const char* out_filename, const int file_type,
             unsigned snaplen, const char *app_name, merge_progress_callback_t* cb, const  wtap_compression_type compression_type)
 {
     ws_assert(out_filename != NULL);
+
+    return merge_files_read_ahead(out_filename, file_type, in_filenames,
+                                  in_file_count, do_append, mode, snaplen,
+                                  app_name, cb, compression_type, false);
+}
+
+/*
+ * Merges the files to an output file whose name is supplied as an argument,
+ * or to the standard output if it's NULL, optionally reading ahead from
+ * the input files on another thread, and invokes callback during
+ * execution. Returns MERGE_OK on success, or a MERGE_ERR_XXX on failure.
+ */
+bool
+merge_files_read_ahead(const char* out_filename, const int file_type,
+                       const char *const *in_filenames, const unsigned in_file_count,
+                       const bool do_append, const idb_merge_mode mode,
+                       unsigned snaplen, const char *app_name, merge_progress_callback_t* cb,
+                       const wtap_compression_type compression_type, bool read_ahead)
+{
     ws_assert(in_file_count > 0);
     ws_assert(in_filenames != NULL);
 
     /* #19402: ensure we aren't appending to one of our inputs */
-    if (do_append) {
+    if (do_append && out_filename != NULL) {
         unsigned int i;
         for (i = 0; i < in_file_count; i++) {
             if (files_identical(out_filename, in_filenames[i])) {
@@ -1514,7 +1991,8 @@ merge_files(const char* out_filename, const int file_type,
 
     return merge_files_common(out_filename, NULL, NULL,
                               file_type, in_filenames, in_file_count,
-                              do_append, mode, snaplen, app_name, cb, compression_type);
+                              do_append, mode, snaplen, app_name, cb, compression_type,
+                              read_ahead);
 }
 
 /*
@@ -1536,7 +2014,7 @@ merge_files_to_tempfile(const char *tmpdir, char **out_filenamep, const char *pf
 
     return merge_files_common(tmpdir, out_filenamep, pfx,
                               file_type, in_filenames, in_file_count,
-                              do_append, mode, snaplen, app_name, cb, WTAP_UNCOMPRESSED);
+                              do_append, mode, snaplen, app_name, cb, WTAP_UNCOMPRESSED, false);
 }
 
 /*
@@ -1553,7 +2031,8 @@ merge_files_to_stdout(const int file_type, const char *const *in_filenames,
 {
     return merge_files_common(NULL, NULL, NULL,
                               file_type, in_filenames, in_file_count,
-                              do_append, mode, snaplen, app_name, cb, compression_type);
+                              do_append, mode, snaplen, app_name, cb, compression_type,
+                              false);
 }
 
 /*
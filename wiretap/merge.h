@@ -120,6 +120,33 @@ merge_files(const char* out_filename, const int file_type,
             unsigned snaplen, const char *app_name, merge_progress_callback_t* cb,
             wtap_compression_type compression_type);
 
+/** Merge the given input files to a file with the given filename, or to
+ * the standard output, optionally reading ahead from the input files
+ *
+ * With read_ahead, records are read from the input files on a separate
+ * thread while the merge writes the output; the output is the same as
+ * with merge_files() or merge_files_to_stdout().
+ *
+ * @param out_filename The output filename, or NULL for the standard output
+ * @param file_type The WTAP_FILE_TYPE_SUBTYPE_XXX output file type
+ * @param in_filenames An array of input filenames to merge from
+ * @param in_file_count The number of entries in in_filenames
+ * @param do_append Whether to append by file order instead of chronological order
+ * @param mode The IDB_MERGE_MODE_XXX merge mode for interface data
+ * @param snaplen The snaplen to limit it to, or 0 to leave as it is in the files
+ * @param app_name The application name performing the merge, used in SHB info
+ * @param cb The callback information to use during execution
+ * @param compression_type The compresion type to use for the output
+ * @param read_ahead Whether to read ahead from the input files on another thread
+ * @return true on success, false on failure
+ */
+WS_DLL_PUBLIC bool
+merge_files_read_ahead(const char* out_filename, const int file_type,
+                       const char *const *in_filenames, const unsigned in_file_count,
+                       const bool do_append, const idb_merge_mode mode,
+                       unsigned snaplen, const char *app_name, merge_progress_callback_t* cb,
+                       wtap_compression_type compression_type, bool read_ahead);
+
 /** Merge the given input files to a temporary file
  *
  * @param tmpdir Points to the directory in which to write the temporary file
@@ -2312,10 +2312,18 @@ pcapng_read_packet_block(FILE_T fh, pcapng_block_header_t *bh,
     /* Add the time stamp offset. */
     wblock->rec->ts.secs = (time_t)(wblock->rec->ts.secs + iface_info.tsoffset);
 
-    /* "(Enhanced) Packet Block" read capture data */
-    if (!wtap_read_packet_bytes(fh, wblock->frame_buffer,
-                                packet.cap_len - pseudo_header_len, err, err_info))
-        return false;
+    /* "(Enhanced) Packet Block" read capture data; unless
+       pcap_read_post_process() will byte-swap pseudo-headers in it,
+       it can be left in a memory-mapped file */
+    if (section_info->byte_swapped) {
+        if (!wtap_read_packet_bytes(fh, wblock->frame_buffer,
+                                    packet.cap_len - pseudo_header_len, err, err_info))
+            return false;
+    } else {
+        if (!wtap_read_packet_bytes_nocopy(fh, wblock->frame_buffer,
+                                           packet.cap_len - pseudo_header_len, err, err_info))
+            return false;
+    }
     block_read += packet.cap_len - pseudo_header_len;
 
     /* jump over potential padding bytes at end of the packet data */
@@ -2496,10 +2504,16 @@ pcapng_read_simple_packet_block(FILE_T fh, pcapng_block_header_t *bh,
 
     memset((void *)&wblock->rec->rec_header.packet_header.pseudo_header, 0, sizeof(union wtap_pseudo_header));
 
-    /* "Simple Packet Block" read capture data */
-    if (!wtap_read_packet_bytes(fh, wblock->frame_buffer,
-                                simple_packet.cap_len, err, err_info))
-        return false;
+    /* "Simple Packet Block" read capture data (see above) */
+    if (section_info->byte_swapped) {
+        if (!wtap_read_packet_bytes(fh, wblock->frame_buffer,
+                                    simple_packet.cap_len, err, err_info))
+            return false;
+    } else {
+        if (!wtap_read_packet_bytes_nocopy(fh, wblock->frame_buffer,
+                                           simple_packet.cap_len, err, err_info))
+            return false;
+    }
 
     /* jump over potential padding bytes at end of the packet data */
     if ((simple_packet.cap_len % 4) != 0) {
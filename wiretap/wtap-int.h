@@ -106,6 +106,7 @@ struct wtap_dumper {
                                               * encapsulation types
                                               */
     wtap_compression_type   compression_type;
+    unsigned                compression_threads; /* if non-zero, fh is a PWFILE_T compressing on that many threads */
     bool                    needs_reload;    /* true if the file requires re-loading after saving with wtap */
     int64_t                 bytes_dumped;
 
@@ -327,6 +328,20 @@ bool
 wtap_read_packet_bytes(FILE_T fh, Buffer *buf, unsigned length, int *err,
     char **err_info);
 
+/*
+ * Like wtap_read_packet_bytes(), but if the buffer is empty and the
+ * file is memory-mapped, the buffer is pointed at the data in the
+ * mapping instead of having it copied in.
+ *
+ * The mapping is private, so the data may be modified, but a reader
+ * that modifies the data in place should not use this: the modified
+ * data would be what's read if the same record were read again.
+ */
+WS_DLL_PUBLIC
+bool
+wtap_read_packet_bytes_nocopy(FILE_T fh, Buffer *buf, unsigned length,
+    int *err, char **err_info);
+
 /*
  * Implementation of wth->subtype_read that reads the full file contents
  * as a single packet.
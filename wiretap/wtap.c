@@ -1860,6 +1860,25 @@ wtap_read_packet_bytes(FILE_T fh, Buffer *buf, unsigned length, int *err,
 	return rv;
 }
 
+/*
+ * Like wtap_read_packet_bytes(), but if the buffer is empty and the
+ * file is memory-mapped, just point the buffer at the packet data in
+ * the mapping rather than copying it.
+ */
+bool
+wtap_read_packet_bytes_nocopy(FILE_T fh, Buffer *buf, unsigned length,
+    int *err, char **err_info)
+{
+	uint8_t *data;
+
+	if (length != 0 && ws_buffer_length(buf) == 0 &&
+	    (data = file_borrow(fh, length)) != NULL) {
+		ws_buffer_borrow(buf, data, length);
+		return true;
+	}
+	return wtap_read_packet_bytes(fh, buf, length, err, err_info);
+}
+
 /*
  * Return an approximation of the amount of data we've read sequentially
  * from the file so far.  (int64_t, in case that's 64 bits.)
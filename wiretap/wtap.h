@@ -1545,6 +1545,8 @@ typedef struct wtap_dump_params {
                                                  This array may grow since the dumper was opened and will subsequently
                                                  be written before newer packets are written in wtap_dump. */
     bool        dont_copy_idbs;             /**< XXX - don't copy IDBs; this should eventually always be the case. */
+    unsigned    compression_threads;        /**< If the file is compressed, the number of worker threads to compress
+                                                 it with in parallel, or 0 to compress it on the writing thread. */
 } wtap_dump_params;
 
 /* Zero-initializer for wtap_dump_params. */
@@ -44,6 +44,7 @@
 #include <glib.h>
 
 #include <wsutil/epochs.h>
+#include <wsutil/file_util.h>
 
 #include "pcapio.h"
 
@@ -169,16 +170,151 @@ struct ws_option {
 #define ISB_USRDELIV      8
 #define ADD_PADDING(x) ((((x) + 3) >> 2) << 2)
 
+/* A file being written: through stdio, or, if it's being compressed,
+   through a writer that compresses on worker threads. */
+struct pcapio_stream {
+        FILE *fh;
+        char *io_buffer;
+        ws_parallel_writer_t *pw;
+};
+
+/* Turn an error from the parallel writer into an errno value, or 0
+   for a short write */
+static int
+parallel_writer_err(int err)
+{
+        switch (err) {
+
+        case WS_PARALLEL_ERR_SHORT_WRITE:
+                return 0;
+
+        case WS_PARALLEL_ERR_COMPRESS:
+                return EIO;
+
+        case WS_PARALLEL_ERR_NOT_SUPPORTED:
+                return ENOTSUP;
+
+        default:
+                return err;
+        }
+}
+
+pcapio_stream *
+pcapio_stdio_stream(FILE *fh)
+{
+        pcapio_stream *pfile;
+
+        pfile = g_new0(pcapio_stream, 1);
+        pfile->fh = fh;
+        return pfile;
+}
+
+pcapio_stream *
+pcapio_fdopen(int fd, int *err)
+{
+        pcapio_stream *pfile;
+        FILE *fh;
+        size_t buffsize = IO_BUF_SIZE;
+#ifdef HAVE_STRUCT_STAT_ST_BLKSIZE
+        ws_statb64 statb;
+#endif
+
+        fh = ws_fdopen(fd, "wb");
+        if (fh == NULL) {
+                *err = errno;
+                return NULL;
+        }
+#ifdef HAVE_STRUCT_STAT_ST_BLKSIZE
+        if (ws_fstat64(fd, &statb) == 0) {
+                if (statb.st_blksize > IO_BUF_SIZE) {
+                        buffsize = statb.st_blksize;
+                }
+        }
+#endif
+        pfile = pcapio_stdio_stream(fh);
+        /* Increase the size of the IO buffer */
+        pfile->io_buffer = (char *)g_malloc(buffsize);
+        setvbuf(fh, pfile->io_buffer, _IOFBF, buffsize);
+        return pfile;
+}
+
+pcapio_stream *
+pcapio_fdopen_compressed(int fd, ws_parallel_compression_t compression_type,
+                         unsigned threads, int *err)
+{
+        pcapio_stream *pfile;
+        ws_parallel_writer_t *pw;
+
+        pw = ws_parallel_writer_fdopen(fd, compression_type, threads, err);
+        if (pw == NULL) {
+                *err = parallel_writer_err(*err);
+                return NULL;
+        }
+        pfile = g_new0(pcapio_stream, 1);
+        pfile->pw = pw;
+        return pfile;
+}
+
+void
+pcapio_flush(pcapio_stream *pfile)
+{
+        /* Compressed data only goes out a chunk at a time, and flushing
+           a partial chunk on every packet would wreck the compression,
+           so leave that to the writer. */
+        if (pfile->fh != NULL) {
+                fflush(pfile->fh);
+        }
+}
+
+bool
+pcapio_close(pcapio_stream *pfile, int *err)
+{
+        bool successful = true;
+        int close_err;
+
+        if (pfile->pw != NULL) {
+                close_err = ws_parallel_writer_close(pfile->pw, NULL);
+                if (close_err != 0) {
+                        if (err != NULL) {
+                                *err = parallel_writer_err(close_err);
+                        }
+                        successful = false;
+                }
+        } else {
+                if (fclose(pfile->fh) == EOF) {
+                        if (err != NULL) {
+                                *err = errno;
+                        }
+                        successful = false;
+                }
+                g_free(pfile->io_buffer);
+        }
+        g_free(pfile);
+        return successful;
+}
+
 /* Write to capture file */
 static bool
-write_to_file(FILE* pfile, const uint8_t* data, size_t data_length,
+write_to_file(pcapio_stream* pfile, const uint8_t* data, size_t data_length,
               uint64_t *bytes_written, int *err)
 {
         size_t nwritten;
 
-        nwritten = fwrite(data, data_length, 1, pfile);
+        if (pfile->pw != NULL) {
+                if (data_length == 0) {
+                        return true;
+                }
+                if (ws_parallel_writer_write(pfile->pw, data, data_length) != data_length) {
+                        *err = parallel_writer_err(ws_parallel_writer_geterr(pfile->pw, NULL));
+                        return false;
+                }
+                (*bytes_written) += data_length;
+                return true;
+        }
+
+        nwritten = fwrite(data, data_length, 1, pfile->fh);
         if (nwritten != 1) {
-                if (ferror(pfile)) {
+                if (ferror(pfile->fh)) {
                         *err = errno;
                 } else {
                         *err = 0;
@@ -196,7 +332,7 @@ write_to_file(FILE* pfile, const uint8_t* data, size_t data_length,
    Returns true on success, false on failure.
    Sets "*err" to an error code, or 0 for a short write, on failure*/
 bool
-libpcap_write_file_header(FILE* pfile, int linktype, int snaplen, bool ts_nsecs, uint64_t *bytes_written, int *err)
+libpcap_write_file_header(pcapio_stream* pfile, int linktype, int snaplen, bool ts_nsecs, uint64_t *bytes_written, int *err)
 {
         struct pcap_hdr file_hdr;
 
@@ -215,7 +351,7 @@ libpcap_write_file_header(FILE* pfile, int linktype, int snaplen, bool ts_nsecs,
 /* Write a record for a packet to a dump file.
    Returns true on success, false on failure. */
 bool
-libpcap_write_packet(FILE* pfile,
+libpcap_write_packet(pcapio_stream* pfile,
                      time_t sec, uint32_t usec,
                      uint32_t caplen, uint32_t len,
                      const uint8_t *pd,
@@ -247,7 +383,7 @@ pcapng_count_string_option(const char *option_value)
 }
 
 static bool
-pcapng_write_string_option(FILE* pfile,
+pcapng_write_string_option(pcapio_stream* pfile,
                            uint16_t option_type, const char *option_value,
                            uint64_t *bytes_written, int *err)
 {
@@ -279,7 +415,7 @@ pcapng_write_string_option(FILE* pfile,
 
 /* Write a pre-formatted pcapng block directly to the output file */
 bool
-pcapng_write_block(FILE* pfile,
+pcapng_write_block(pcapio_stream* pfile,
                    const uint8_t *data,
                    uint32_t length,
                    uint64_t *bytes_written,
@@ -308,7 +444,7 @@ pcapng_write_block(FILE* pfile,
 }
 
 bool
-pcapng_write_section_header_block(FILE* pfile,
+pcapng_write_section_header_block(pcapio_stream* pfile,
                                   GPtrArray *comments,
                                   const char *hw,
                                   const char *os,
@@ -381,7 +517,7 @@ pcapng_write_section_header_block(FILE* pfile,
 }
 
 bool
-pcapng_write_interface_description_block(FILE* pfile,
+pcapng_write_interface_description_block(pcapio_stream* pfile,
                                          const char *comment,  /* OPT_COMMENT        1 */
                                          const char *name,     /* IDB_NAME           2 */
                                          const char *descr,    /* IDB_DESCRIPTION    3 */
@@ -541,7 +677,7 @@ pcapng_write_interface_description_block(FILE* pfile,
 /* Write a record for a packet to a dump file.
    Returns true on success, false on failure. */
 bool
-pcapng_write_enhanced_packet_block(FILE* pfile,
+pcapng_write_enhanced_packet_block(pcapio_stream* pfile,
                                    const char *comment,
                                    time_t sec, uint32_t usec,
                                    uint32_t caplen, uint32_t len,
@@ -633,7 +769,7 @@ pcapng_write_enhanced_packet_block(FILE* pfile,
 }
 
 bool
-pcapng_write_interface_statistics_block(FILE* pfile,
+pcapng_write_interface_statistics_block(pcapio_stream* pfile,
                                         uint32_t interface_id,
                                         uint64_t *bytes_written,
                                         const char *comment,    /* OPT_COMMENT           1 */
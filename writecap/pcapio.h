@@ -12,19 +12,59 @@
  * SPDX-License-Identifier: GPL-2.0-or-later
  */
 
+#ifndef __PCAPIO_H__
+#define __PCAPIO_H__
+
+#include <wsutil/parallel_writer.h>
+
+/** A file being written, through stdio or, if it's compressed, through
+   a writer that compresses on worker threads. */
+typedef struct pcapio_stream pcapio_stream;
+
+/** Write to a stdio stream that's already open, which pcapio_close()
+   closes. */
+extern pcapio_stream *
+pcapio_stdio_stream(FILE *fh);
+
+/** Start writing to a file descriptor, which pcapio_close() closes.
+   Returns NULL, and sets "*err" to an error code, on failure. */
+extern pcapio_stream *
+pcapio_fdopen(int fd, int *err);
+
+/** Start writing to a file descriptor, compressing what's written on
+   "threads" worker threads.  The file descriptor is closed by
+   pcapio_close().
+   Returns NULL, and sets "*err" to an error code, on failure. */
+extern pcapio_stream *
+pcapio_fdopen_compressed(int fd, ws_parallel_compression_t compression_type,
+                         unsigned threads, int *err);
+
+/** Write out what's been buffered so that readers of the file see it.
+   Compressed data is written out a chunk at a time as the chunks fill,
+   so this does nothing for a compressed file. */
+extern void
+pcapio_flush(pcapio_stream *pfile);
+
+/** Finish writing, close the file descriptor, and free the stream.
+   Returns true on success, false on failure.
+   Sets "*err", if "err" isn't NULL, to an error code, or 0 for a short
+   write, on failure. */
+extern bool
+pcapio_close(pcapio_stream *pfile, int *err);
+
 /* Writing pcap files */
 
 /** Write the file header to a dump file.
    Returns true on success, false on failure.
    Sets "*err" to an error code, or 0 for a short write, on failure*/
 extern bool
-libpcap_write_file_header(FILE* pfile, int linktype, int snaplen,
+libpcap_write_file_header(pcapio_stream* pfile, int linktype, int snaplen,
                           bool ts_nsecs, uint64_t *bytes_written, int *err);
 
 /** Write a record for a packet to a dump file.
    Returns true on success, false on failure. */
 extern bool
-libpcap_write_packet(FILE* pfile,
+libpcap_write_packet(pcapio_stream* pfile,
                      time_t sec, uint32_t usec,
                      uint32_t caplen, uint32_t len,
                      const uint8_t *pd,
@@ -34,7 +74,7 @@ libpcap_write_packet(FILE* pfile,
 
 /* Write a pre-formatted pcapng block */
 extern bool
-pcapng_write_block(FILE* pfile,
+pcapng_write_block(pcapio_stream* pfile,
                   const uint8_t *data,
                   uint32_t block_total_length,
                   uint64_t *bytes_written,
@@ -44,7 +84,7 @@ pcapng_write_block(FILE* pfile,
  *
  */
 extern bool
-pcapng_write_section_header_block(FILE* pfile,  /**< Write information */
+pcapng_write_section_header_block(pcapio_stream* pfile,  /**< Write information */
                                   GPtrArray *comments,  /**< Comments on the section, Optinon 1 opt_comment
                                                          * UTF-8 strings containing comments that areassociated to the current block.
                                                          */
@@ -63,7 +103,7 @@ pcapng_write_section_header_block(FILE* pfile,  /**< Write information */
                                   );
 
 extern bool
-pcapng_write_interface_description_block(FILE* pfile,
+pcapng_write_interface_description_block(pcapio_stream* pfile,
                                          const char *comment,  /* OPT_COMMENT           1 */
                                          const char *name,     /* IDB_NAME              2 */
                                          const char *descr,    /* IDB_DESCRIPTION       3 */
@@ -78,7 +118,7 @@ pcapng_write_interface_description_block(FILE* pfile,
                                          int *err);
 
 extern bool
-pcapng_write_interface_statistics_block(FILE* pfile,
+pcapng_write_interface_statistics_block(pcapio_stream* pfile,
                                         uint32_t interface_id,
                                         uint64_t *bytes_written,
                                         const char *comment,   /* OPT_COMMENT           1 */
@@ -89,7 +129,7 @@ pcapng_write_interface_statistics_block(FILE* pfile,
                                         int *err);
 
 extern bool
-pcapng_write_enhanced_packet_block(FILE* pfile,
+pcapng_write_enhanced_packet_block(pcapio_stream* pfile,
                                    const char *comment,
                                    time_t sec, uint32_t usec,
                                    uint32_t caplen, uint32_t len,
@@ -100,6 +140,8 @@ pcapng_write_enhanced_packet_block(FILE* pfile,
                                    uint64_t *bytes_written,
                                    int *err);
 
+#endif /* __PCAPIO_H__ */
+
 /*
  * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
  *
@@ -17,6 +17,7 @@
 
 #define SMALL_BUFFER_SIZE (2 * 1024) /* Everyone still uses 1500 byte frames, right? */
 static GPtrArray *small_buffers; /* Guaranteed to be at least SMALL_BUFFER_SIZE */
+static GMutex small_buffers_mtx; /* Buffers may be used on several threads */
 /* XXX - Add medium and large buffers? */
 
 /* Initializes a buffer with a certain amount of allocated space */
@@ -24,13 +25,17 @@ void
 ws_buffer_init(Buffer* buffer, size_t space)
 {
 	ws_assert(buffer);
-	if (G_UNLIKELY(!small_buffers)) small_buffers = g_ptr_array_sized_new(1024);
 
 	if (space <= SMALL_BUFFER_SIZE) {
+		buffer->data = NULL;
+		g_mutex_lock(&small_buffers_mtx);
+		if (G_UNLIKELY(!small_buffers)) small_buffers = g_ptr_array_sized_new(1024);
 		if (small_buffers->len > 0) {
 			buffer->data = (uint8_t*) g_ptr_array_remove_index(small_buffers, small_buffers->len - 1);
 			ws_assert(buffer->data);
-		} else {
+		}
+		g_mutex_unlock(&small_buffers_mtx);
+		if (!buffer->data) {
 			buffer->data = (uint8_t*)g_malloc(SMALL_BUFFER_SIZE);
 		}
 		buffer->allocated = SMALL_BUFFER_SIZE;
@@ -40,6 +45,21 @@ ws_buffer_init(Buffer* buffer, size_t space)
 	}
 	buffer->start = 0;
 	buffer->first_free = 0;
+	buffer->own_data = NULL;
+	buffer->own_allocated = 0;
+}
+
+/* Stops borrowing, going back to the buffer's own memory, which is
+	left empty */
+static void
+buffer_return_borrowed(Buffer* buffer)
+{
+	buffer->data = buffer->own_data;
+	buffer->allocated = buffer->own_allocated;
+	buffer->start = 0;
+	buffer->first_free = 0;
+	buffer->own_data = NULL;
+	buffer->own_allocated = 0;
 }
 
 /* Frees the memory used by a buffer */
@@ -47,9 +67,15 @@ void
 ws_buffer_free(Buffer* buffer)
 {
 	ws_assert(buffer);
+	if (buffer->own_data) {
+		buffer_return_borrowed(buffer);
+	}
 	if (buffer->allocated == SMALL_BUFFER_SIZE) {
 		ws_assert(buffer->data);
+		g_mutex_lock(&small_buffers_mtx);
+		if (G_UNLIKELY(!small_buffers)) small_buffers = g_ptr_array_sized_new(1024);
 		g_ptr_array_add(small_buffers, buffer->data);
+		g_mutex_unlock(&small_buffers_mtx);
 	} else {
 		g_free(buffer->data);
 	}
@@ -65,10 +91,22 @@ void
 ws_buffer_assure_space(Buffer* buffer, size_t space)
 {
 	ws_assert(buffer);
-	size_t available_at_end = buffer->allocated - buffer->first_free;
+	size_t available_at_end;
 	size_t space_used;
 	bool space_at_beginning;
 
+	/* A borrowed buffer can't grow; copy what it has into our own
+		memory first. */
+	if (buffer->own_data) {
+		uint8_t *borrowed = buffer->data + buffer->start;
+		size_t borrowed_len = buffer->first_free - buffer->start;
+
+		buffer_return_borrowed(buffer);
+		ws_buffer_append(buffer, borrowed, borrowed_len);
+	}
+
+	available_at_end = buffer->allocated - buffer->first_free;
+
 	/* If we've got the space already, good! */
 	if (space <= available_at_end) {
 		return;
@@ -122,11 +160,33 @@ ws_buffer_remove_start(Buffer* buffer, size_t bytes)
 	buffer->start += bytes;
 
 	if (buffer->start == buffer->first_free) {
+		if (buffer->own_data) {
+			buffer_return_borrowed(buffer);
+		}
 		buffer->start = 0;
 		buffer->first_free = 0;
 	}
 }
 
+/* Makes an empty buffer refer to 'bytes' bytes of data owned by somebody
+	else, such as a memory-mapped file, instead of copying them in. The
+	data must stay valid until the buffer is emptied or freed. Growing
+	the buffer copies the data into the buffer's own memory. */
+void
+ws_buffer_borrow(Buffer* buffer, uint8_t *data, size_t bytes)
+{
+	ws_assert(buffer);
+	ws_assert(buffer->first_free == buffer->start);
+	if (!buffer->own_data) {
+		buffer->own_data = buffer->data;
+		buffer->own_allocated = buffer->allocated;
+	}
+	buffer->data = data;
+	buffer->allocated = bytes;
+	buffer->start = 0;
+	buffer->first_free = bytes;
+}
+
 
 #ifndef SOME_FUNCTIONS_ARE_DEFINES
 void
@@ -185,11 +245,13 @@ ws_buffer_append_buffer(Buffer* buffer, Buffer* src_buffer)
 void
 ws_buffer_cleanup(void)
 {
+	g_mutex_lock(&small_buffers_mtx);
 	if (small_buffers) {
 		g_ptr_array_set_free_func(small_buffers, g_free);
 		g_ptr_array_free(small_buffers, true);
 		small_buffers = NULL;
 	}
+	g_mutex_unlock(&small_buffers_mtx);
 }
 
 /*
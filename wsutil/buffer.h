@@ -24,6 +24,10 @@ typedef struct Buffer {
 	size_t	allocated;
 	size_t	start;
 	size_t	first_free;
+	/* While the buffer is borrowing its data (see ws_buffer_borrow()),
+	   its own memory, otherwise NULL */
+	uint8_t	*own_data;
+	size_t	own_allocated;
 } Buffer;
 
 WS_DLL_PUBLIC
@@ -37,6 +41,8 @@ void ws_buffer_append(Buffer* buffer, uint8_t *from, size_t bytes);
 WS_DLL_PUBLIC
 void ws_buffer_remove_start(Buffer* buffer, size_t bytes);
 WS_DLL_PUBLIC
+void ws_buffer_borrow(Buffer* buffer, uint8_t *data, size_t bytes);
+WS_DLL_PUBLIC
 void ws_buffer_cleanup(void);
 
 #ifdef SOME_FUNCTIONS_ARE_DEFINES
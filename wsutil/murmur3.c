@@ -0,0 +1,111 @@
+/* murmur3.c
+ * MurmurHash3, a fast non-cryptographic hash function
+ * Based on the public domain reference implementation by Austin Appleby
+ * (https://github.com/aappleby/smhasher)
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include <wsutil/murmur3.h>
+
+#include <wsutil/pint.h>
+
+#define C1 UINT64_C(0x87c37b91114253d5)
+#define C2 UINT64_C(0x4cf5ad432745937f)
+
+static inline uint64_t
+rotl64(uint64_t x, int r)
+{
+    return (x << r) | (x >> (64 - r));
+}
+
+static inline uint64_t
+fmix64(uint64_t k)
+{
+    k ^= k >> 33;
+    k *= UINT64_C(0xff51afd7ed558ccd);
+    k ^= k >> 33;
+    k *= UINT64_C(0xc4ceb9fe1a85ec53);
+    k ^= k >> 33;
+    return k;
+}
+
+void
+murmur3_128(const uint8_t *buf, size_t len, uint32_t seed, uint8_t digest[16])
+{
+    const size_t nblocks = len / 16;
+    const uint8_t *tail = buf + nblocks * 16;
+    uint64_t h1 = seed;
+    uint64_t h2 = seed;
+    uint64_t k1, k2;
+    size_t i;
+
+    /* body */
+    for (i = 0; i < nblocks; i++) {
+        k1 = pletoh64(buf + i * 16);
+        k2 = pletoh64(buf + i * 16 + 8);
+
+        k1 *= C1; k1 = rotl64(k1, 31); k1 *= C2; h1 ^= k1;
+        h1 = rotl64(h1, 27); h1 += h2; h1 = h1 * 5 + 0x52dce729;
+
+        k2 *= C2; k2 = rotl64(k2, 33); k2 *= C1; h2 ^= k2;
+        h2 = rotl64(h2, 31); h2 += h1; h2 = h2 * 5 + 0x38495ab5;
+    }
+
+    /* tail */
+    k1 = 0;
+    k2 = 0;
+    switch (len & 15) {
+    case 15: k2 ^= (uint64_t)tail[14] << 48; /* FALL THROUGH */
+    case 14: k2 ^= (uint64_t)tail[13] << 40; /* FALL THROUGH */
+    case 13: k2 ^= (uint64_t)tail[12] << 32; /* FALL THROUGH */
+    case 12: k2 ^= (uint64_t)tail[11] << 24; /* FALL THROUGH */
+    case 11: k2 ^= (uint64_t)tail[10] << 16; /* FALL THROUGH */
+    case 10: k2 ^= (uint64_t)tail[9] << 8;   /* FALL THROUGH */
+    case 9:  k2 ^= (uint64_t)tail[8];
+             k2 *= C2; k2 = rotl64(k2, 33); k2 *= C1; h2 ^= k2;
+             /* FALL THROUGH */
+    case 8:  k1 ^= (uint64_t)tail[7] << 56;  /* FALL THROUGH */
+    case 7:  k1 ^= (uint64_t)tail[6] << 48;  /* FALL THROUGH */
+    case 6:  k1 ^= (uint64_t)tail[5] << 40;  /* FALL THROUGH */
+    case 5:  k1 ^= (uint64_t)tail[4] << 32;  /* FALL THROUGH */
+    case 4:  k1 ^= (uint64_t)tail[3] << 24;  /* FALL THROUGH */
+    case 3:  k1 ^= (uint64_t)tail[2] << 16;  /* FALL THROUGH */
+    case 2:  k1 ^= (uint64_t)tail[1] << 8;   /* FALL THROUGH */
+    case 1:  k1 ^= (uint64_t)tail[0];
+             k1 *= C1; k1 = rotl64(k1, 31); k1 *= C2; h1 ^= k1;
+    }
+
+    /* finalization */
+    h1 ^= (uint64_t)len;
+    h2 ^= (uint64_t)len;
+
+    h1 += h2;
+    h2 += h1;
+
+    h1 = fmix64(h1);
+    h2 = fmix64(h2);
+
+    h1 += h2;
+    h2 += h1;
+
+    phtole64(digest, h1);
+    phtole64(digest + 8, h2);
+}
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
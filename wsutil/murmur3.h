@@ -0,0 +1,41 @@
+/** @file
+ * MurmurHash3, a fast non-cryptographic hash function
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef MURMUR3_H
+#define MURMUR3_H
+
+#include <wireshark.h>
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+/**
+ * Compute the 128-bit x64 variant of MurmurHash3 of a buffer.
+ *
+ * MurmurHash3 is much faster than cryptographic hashes such as MD5, but
+ * it's easy to construct inputs with the same hash on purpose; don't use
+ * it where that matters.
+ *
+ * @param buf The data to hash
+ * @param len The length of the data
+ * @param seed The seed, usually 0
+ * @param digest Receives the 16 bytes of the hash; the two 64-bit halves
+ * in little-endian byte order, the same as the reference implementation
+ * on little-endian machines
+ */
+WS_DLL_PUBLIC void murmur3_128(const uint8_t *buf, size_t len, uint32_t seed,
+                               uint8_t digest[16]);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* MURMUR3_H */
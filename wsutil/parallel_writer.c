@@ -0,0 +1,544 @@
+/* parallel_writer.c
+ * Routines for writing compressed files on several threads
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+#include "parallel_writer.h"
+
+#include <errno.h>
+#include <string.h>
+
+#include "file_util.h"
+#include "pint.h"
+#include "ws_assert.h"
+
+#if defined(HAVE_ZLIB) && !defined(HAVE_ZLIBNG)
+#define USE_ZLIB_OR_ZLIBNG
+#define ZLIB_CONST
+#define ZLIB_PREFIX(x) x
+#include <zlib.h>
+typedef z_stream zlib_stream;
+#endif /* defined(HAVE_ZLIB) && !defined(HAVE_ZLIBNG) */
+
+#ifdef HAVE_ZLIBNG
+#define USE_ZLIB_OR_ZLIBNG
+#define ZLIB_PREFIX(x) zng_ ## x
+#include <zlib-ng.h>
+typedef zng_stream zlib_stream;
+#endif /* HAVE_ZLIBNG */
+
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif /* HAVE_ZSTD */
+
+#ifdef HAVE_LZ4
+#include <lz4.h>
+
+#if LZ4_VERSION_NUMBER >= 10703
+#define USE_LZ4
+#include <lz4frame.h>
+#endif /* LZ4_VERSION_NUMBER >= 10703 */
+#endif /* HAVE_LZ4 */
+
+#define PW_CHUNK_SIZE 1048576   /* the same as wiretap's SPAN and ZSTD_SEEKABLE_FRAME_SIZE */
+
+/* The seekable zstd format, as wiretap reads it */
+#define ZSTD_SKIPPABLE_SEEK_TABLE_MAGIC 0x184D2A5EU
+#define ZSTD_SEEKABLE_MAGIC             0x8F92EAB1U
+#define ZSTD_SKIPPABLE_HEADER_SIZE      8
+#define ZSTD_SEEK_TABLE_FOOTER_SIZE     9
+
+struct pw_chunk {
+    unsigned char *in;      /* uncompressed data */
+    size_t in_len;
+    unsigned char *out;     /* compressed data */
+    size_t out_len;
+    int err;                /* error code */
+    const char *err_info;   /* additional error information string for some errors */
+    bool done;              /* set, under the writer's mutex, once compressed */
+};
+
+struct ws_parallel_writer {
+    int fd;                 /* file descriptor */
+    ws_parallel_compression_t compression_type;
+    int err;                /* error code */
+    const char *err_info;   /* additional error information string for some errors */
+    struct pw_chunk *cur;   /* chunk being filled, or NULL */
+    GQueue pending;         /* chunks handed to the pool, oldest first */
+    unsigned max_pending;
+    GThreadPool *pool;
+    GMutex mutex;
+    GCond chunk_done;
+    GByteArray *seek_table; /* for zstd, seek table entries for the frames written so far */
+};
+
+#ifdef USE_ZLIB_OR_ZLIBNG
+static void
+pw_compress_gzip(struct pw_chunk *chunk)
+{
+    zlib_stream strm;
+    int ret;
+
+    memset(&strm, 0, sizeof strm);
+    ret = ZLIB_PREFIX(deflateInit2)(&strm, Z_DEFAULT_COMPRESSION, Z_DEFLATED,
+                       15 + 16, 8, Z_DEFAULT_STRATEGY);
+    if (ret != Z_OK) {
+        chunk->err = (ret == Z_MEM_ERROR) ? ENOMEM : WS_PARALLEL_ERR_COMPRESS;
+        chunk->err_info = "Unknown error from deflateInit2()";
+        return;
+    }
+    chunk->out_len = ZLIB_PREFIX(deflateBound)(&strm, (unsigned long)chunk->in_len);
+    chunk->out = (unsigned char *)g_try_malloc(chunk->out_len);
+    if (chunk->out == NULL) {
+        ZLIB_PREFIX(deflateEnd)(&strm);
+        chunk->err = ENOMEM;
+        return;
+    }
+    strm.next_in = chunk->in;
+    strm.avail_in = (unsigned)chunk->in_len;
+    strm.next_out = chunk->out;
+    strm.avail_out = (unsigned)chunk->out_len;
+    ret = ZLIB_PREFIX(deflate)(&strm, Z_FINISH);
+    if (ret != Z_STREAM_END) {
+        /* This "shouldn't happen", given deflateBound(). */
+        chunk->err = WS_PARALLEL_ERR_COMPRESS;
+        chunk->err_info = "Unexpected result from deflate()";
+    }
+    chunk->out_len = (size_t)strm.total_out;
+    ZLIB_PREFIX(deflateEnd)(&strm);
+}
+#endif /* USE_ZLIB_OR_ZLIBNG */
+
+#ifdef USE_LZ4
+static void
+pw_compress_lz4(struct pw_chunk *chunk)
+{
+    LZ4F_preferences_t prefs;
+    size_t ret;
+
+    /* The same preferences as wiretap's lz4wfile_fdopen(). */
+    memset(&prefs, 0, sizeof prefs);
+    prefs.frameInfo.blockMode = LZ4F_blockIndependent;
+    prefs.frameInfo.contentChecksumFlag = 1;
+    prefs.frameInfo.blockSizeID = LZ4F_max4MB;
+    prefs.compressionLevel = 1;
+
+    chunk->out_len = LZ4F_compressFrameBound(chunk->in_len, &prefs);
+    chunk->out = (unsigned char *)g_try_malloc(chunk->out_len);
+    if (chunk->out == NULL) {
+        chunk->err = ENOMEM;
+        return;
+    }
+    ret = LZ4F_compressFrame(chunk->out, chunk->out_len, chunk->in, chunk->in_len, &prefs);
+    if (LZ4F_isError(ret)) {
+        chunk->err = WS_PARALLEL_ERR_COMPRESS;
+        chunk->err_info = LZ4F_getErrorName(ret);
+        return;
+    }
+    chunk->out_len = ret;
+}
+#endif /* USE_LZ4 */
+
+#ifdef HAVE_ZSTD
+static void
+pw_zstd_cctx_free(void *cctx)
+{
+    ZSTD_freeCCtx((ZSTD_CCtx *)cctx);
+}
+
+/* Each worker thread keeps its own compression context. */
+static GPrivate pw_zstd_cctx = G_PRIVATE_INIT(pw_zstd_cctx_free);
+
+static void
+pw_compress_zstd(struct pw_chunk *chunk)
+{
+    ZSTD_CCtx *cctx;
+    size_t ret;
+
+    cctx = (ZSTD_CCtx *)g_private_get(&pw_zstd_cctx);
+    if (cctx == NULL) {
+        cctx = ZSTD_createCCtx();
+        if (cctx == NULL) {
+            chunk->err = ENOMEM;
+            return;
+        }
+        g_private_set(&pw_zstd_cctx, cctx);
+    }
+    chunk->out_len = ZSTD_compressBound(chunk->in_len);
+    chunk->out = (unsigned char *)g_try_malloc(chunk->out_len);
+    if (chunk->out == NULL) {
+        chunk->err = ENOMEM;
+        return;
+    }
+    /* The same level as wiretap's zstdwfile_fdopen(). */
+    ret = ZSTD_compressCCtx(cctx, chunk->out, chunk->out_len, chunk->in, chunk->in_len, 3);
+    if (ZSTD_isError(ret)) {
+        chunk->err = WS_PARALLEL_ERR_COMPRESS;
+        chunk->err_info = ZSTD_getErrorName(ret);
+        return;
+    }
+    chunk->out_len = ret;
+}
+
+/* Turns an array of seek table entries into the skippable frame holding
+   the seek table, by adding the frame header and the seek table footer. */
+static void
+pw_zstd_seek_table_finish(GByteArray *seek_table)
+{
+    uint8_t header[ZSTD_SKIPPABLE_HEADER_SIZE];
+    uint8_t footer[ZSTD_SEEK_TABLE_FOOTER_SIZE];
+    unsigned num_frames = seek_table->len / 8;
+
+    phtole32(&header[0], ZSTD_SKIPPABLE_SEEK_TABLE_MAGIC);
+    phtole32(&header[4], seek_table->len + ZSTD_SEEK_TABLE_FOOTER_SIZE);
+    phtole32(&footer[0], num_frames);
+    footer[4] = 0;  /* no checksums */
+    phtole32(&footer[5], ZSTD_SEEKABLE_MAGIC);
+    g_byte_array_prepend(seek_table, header, sizeof header);
+    g_byte_array_append(seek_table, footer, sizeof footer);
+}
+#endif /* HAVE_ZSTD */
+
+/* Compresses a chunk; runs in a worker thread. */
+static void
+pw_compress(void *data, void *user_data)
+{
+    struct pw_chunk *chunk = (struct pw_chunk *)data;
+    ws_parallel_writer_t *state = (ws_parallel_writer_t *)user_data;
+
+    switch (state->compression_type) {
+
+#ifdef USE_ZLIB_OR_ZLIBNG
+    case WS_PARALLEL_GZIP:
+        pw_compress_gzip(chunk);
+        break;
+#endif /* USE_ZLIB_OR_ZLIBNG */
+
+#ifdef USE_LZ4
+    case WS_PARALLEL_LZ4:
+        pw_compress_lz4(chunk);
+        break;
+#endif /* USE_LZ4 */
+
+#ifdef HAVE_ZSTD
+    case WS_PARALLEL_ZSTD:
+        pw_compress_zstd(chunk);
+        break;
+#endif /* HAVE_ZSTD */
+
+    default:
+        /* This "cannot happen"; ws_parallel_writer_fdopen() checks the type */
+        ws_assert_not_reached();
+        break;
+    }
+
+    g_mutex_lock(&state->mutex);
+    chunk->done = true;
+    g_cond_broadcast(&state->chunk_done);
+    g_mutex_unlock(&state->mutex);
+}
+
+static void
+pw_chunk_free(struct pw_chunk *chunk)
+{
+    g_free(chunk->in);
+    g_free(chunk->out);
+    g_free(chunk);
+}
+
+static const struct {
+    const char *name;
+    const char *extension;
+    ws_parallel_compression_t type;
+} pw_compression_types[] = {
+    { "gzip", "gz",  WS_PARALLEL_GZIP },
+    { "lz4",  "lz4", WS_PARALLEL_LZ4 },
+    { "zstd", "zst", WS_PARALLEL_ZSTD },
+};
+
+bool
+ws_parallel_writer_compression_type(const char *name,
+                                    ws_parallel_compression_t *compression_type)
+{
+    for (size_t i = 0; i < G_N_ELEMENTS(pw_compression_types); i++) {
+        if (strcmp(name, pw_compression_types[i].name) == 0) {
+            *compression_type = pw_compression_types[i].type;
+            return true;
+        }
+    }
+    return false;
+}
+
+const char *
+ws_parallel_writer_extension(ws_parallel_compression_t compression_type)
+{
+    for (size_t i = 0; i < G_N_ELEMENTS(pw_compression_types); i++) {
+        if (pw_compression_types[i].type == compression_type)
+            return pw_compression_types[i].extension;
+    }
+    return NULL;
+}
+
+bool
+ws_parallel_writer_can_compress(ws_parallel_compression_t compression_type)
+{
+    switch (compression_type) {
+
+#ifdef USE_ZLIB_OR_ZLIBNG
+    case WS_PARALLEL_GZIP:
+        return true;
+#endif /* USE_ZLIB_OR_ZLIBNG */
+
+#ifdef USE_LZ4
+    case WS_PARALLEL_LZ4:
+        return true;
+#endif /* USE_LZ4 */
+
+#ifdef HAVE_ZSTD
+    case WS_PARALLEL_ZSTD:
+        return true;
+#endif /* HAVE_ZSTD */
+
+    default:
+        return false;
+    }
+}
+
+ws_parallel_writer_t *
+ws_parallel_writer_fdopen(int fd, ws_parallel_compression_t compression_type,
+                          unsigned threads, int *err)
+{
+    ws_parallel_writer_t *state;
+
+    if (!ws_parallel_writer_can_compress(compression_type)) {
+        *err = WS_PARALLEL_ERR_NOT_SUPPORTED;
+        return NULL;
+    }
+    if (threads == 0)
+        threads = 1;
+
+    state = (ws_parallel_writer_t *)g_try_malloc(sizeof *state);
+    if (state == NULL) {
+        *err = ENOMEM;
+        return NULL;
+    }
+    state->fd = fd;
+    state->compression_type = compression_type;
+    state->err = 0;
+    state->err_info = NULL;
+    state->cur = NULL;
+    g_queue_init(&state->pending);
+    state->max_pending = 2 * threads;
+    g_mutex_init(&state->mutex);
+    g_cond_init(&state->chunk_done);
+    state->seek_table = g_byte_array_new();
+    state->pool = g_thread_pool_new(pw_compress, state, (int)threads, false, NULL);
+
+    return state;
+}
+
+/* Writes out the oldest chunk in flight, first waiting for it to be
+ * compressed if wait is true.  Returns 1 if a chunk was written, 0 if
+ * there is none or it's not done yet, and -1, setting state->err, on
+ * failure.
+ */
+static int
+pw_write_oldest(ws_parallel_writer_t *state, bool wait)
+{
+    struct pw_chunk *chunk;
+    bool done;
+    uint8_t entry[8];
+    ssize_t got;
+
+    chunk = (struct pw_chunk *)g_queue_peek_head(&state->pending);
+    if (chunk == NULL)
+        return 0;
+    g_mutex_lock(&state->mutex);
+    while (wait && !chunk->done)
+        g_cond_wait(&state->chunk_done, &state->mutex);
+    done = chunk->done;
+    g_mutex_unlock(&state->mutex);
+    if (!done)
+        return 0;
+    g_queue_pop_head(&state->pending);
+
+    if (chunk->err != 0) {
+        state->err = chunk->err;
+        state->err_info = chunk->err_info;
+        pw_chunk_free(chunk);
+        return -1;
+    }
+    got = ws_write(state->fd, chunk->out, (unsigned)chunk->out_len);
+    if (got < 0 || (size_t)got != chunk->out_len) {
+        state->err = (got < 0) ? errno : WS_PARALLEL_ERR_SHORT_WRITE;
+        pw_chunk_free(chunk);
+        return -1;
+    }
+    if (state->compression_type == WS_PARALLEL_ZSTD) {
+        phtole32(&entry[0], (uint32_t)chunk->out_len);
+        phtole32(&entry[4], (uint32_t)chunk->in_len);
+        g_byte_array_append(state->seek_table, entry, sizeof entry);
+    }
+    pw_chunk_free(chunk);
+    return 1;
+}
+
+/* Hands the chunk being filled to the pool.  Returns false, and sets
+ * state->err, on failure.
+ */
+static bool
+pw_submit(ws_parallel_writer_t *state)
+{
+    struct pw_chunk *chunk = state->cur;
+    GError *gerr = NULL;
+    int ret;
+
+    state->cur = NULL;
+
+    /* keep memory use bounded */
+    while (g_queue_get_length(&state->pending) >= state->max_pending) {
+        if (pw_write_oldest(state, true) == -1) {
+            pw_chunk_free(chunk);
+            return false;
+        }
+    }
+
+    g_queue_push_tail(&state->pending, chunk);
+    if (!g_thread_pool_push(state->pool, chunk, &gerr)) {
+        /* Compress it here, then. */
+        g_error_free(gerr);
+        pw_compress(chunk, state);
+    }
+
+    /* write out whatever is done already */
+    while ((ret = pw_write_oldest(state, false)) == 1)
+        ;
+    return ret != -1;
+}
+
+size_t
+ws_parallel_writer_write(ws_parallel_writer_t *state, const void *buf, size_t len)
+{
+    size_t to_copy;
+    size_t put = len;
+
+    /* check that there's no error */
+    if (state->err != 0)
+        return 0;
+
+    /* if len is zero, avoid unnecessary operations */
+    if (len == 0)
+        return 0;
+
+    do {
+        if (state->cur == NULL) {
+            state->cur = g_new0(struct pw_chunk, 1);
+            state->cur->in = (unsigned char *)g_try_malloc(PW_CHUNK_SIZE);
+            if (state->cur->in == NULL) {
+                pw_chunk_free(state->cur);
+                state->cur = NULL;
+                state->err = ENOMEM;
+                return 0;
+            }
+        }
+        to_copy = MIN(len, PW_CHUNK_SIZE - state->cur->in_len);
+        memcpy(state->cur->in + state->cur->in_len, buf, to_copy);
+        state->cur->in_len += to_copy;
+        buf = (const char *)buf + to_copy;
+        len -= to_copy;
+        if (state->cur->in_len == PW_CHUNK_SIZE && !pw_submit(state))
+            return 0;
+    } while (len);
+
+    return put;
+}
+
+int
+ws_parallel_writer_flush(ws_parallel_writer_t *state)
+{
+    int ret;
+
+    /* check that there's no error */
+    if (state->err != 0)
+        return -1;
+
+    if (state->cur != NULL && !pw_submit(state))
+        return -1;
+    while ((ret = pw_write_oldest(state, true)) == 1)
+        ;
+    return ret;
+}
+
+int
+ws_parallel_writer_close(ws_parallel_writer_t *state, const char **err_info)
+{
+    int ret = 0;
+    struct pw_chunk *chunk;
+
+    /*
+     * A zstd file needs at least one frame to be recognized as one;
+     * give it an empty one if nothing was written.
+     */
+    if (state->compression_type == WS_PARALLEL_ZSTD &&
+        state->cur == NULL && g_queue_is_empty(&state->pending) &&
+        state->seek_table->len == 0)
+        state->cur = g_new0(struct pw_chunk, 1);
+
+    if (ws_parallel_writer_flush(state) == -1) {
+        ret = state->err;
+        if (err_info != NULL)
+            *err_info = state->err_info;
+    } else if (state->compression_type == WS_PARALLEL_ZSTD) {
+#ifdef HAVE_ZSTD
+        ssize_t got;
+
+        pw_zstd_seek_table_finish(state->seek_table);
+        got = ws_write(state->fd, state->seek_table->data, state->seek_table->len);
+        if (got < 0)
+            ret = errno;
+        else if ((unsigned)got != state->seek_table->len)
+            ret = WS_PARALLEL_ERR_SHORT_WRITE;
+#endif /* HAVE_ZSTD */
+    }
+
+    /* wait for the workers, and free everything */
+    g_thread_pool_free(state->pool, false, true);
+    while ((chunk = (struct pw_chunk *)g_queue_pop_head(&state->pending)) != NULL)
+        pw_chunk_free(chunk);
+    if (state->cur != NULL)
+        pw_chunk_free(state->cur);
+    g_byte_array_free(state->seek_table, true);
+    g_cond_clear(&state->chunk_done);
+    g_mutex_clear(&state->mutex);
+    if (ws_close(state->fd) == -1 && ret == 0)
+        ret = errno;
+    g_free(state);
+    return ret;
+}
+
+int
+ws_parallel_writer_geterr(ws_parallel_writer_t *state, const char **err_info)
+{
+    if (err_info != NULL)
+        *err_info = state->err_info;
+    return state->err;
+}
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
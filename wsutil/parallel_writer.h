@@ -0,0 +1,135 @@
+/* parallel_writer.h
+ * Declarations of routines for writing compressed files on several threads
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef __PARALLEL_WRITER_H__
+#define __PARALLEL_WRITER_H__
+
+#include <wireshark.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/** @file
+ * A compressed file writer that compresses on a pool of worker threads
+ * while the caller keeps writing.
+ *
+ * The data is cut into chunks that are compressed independently of each
+ * other and written out in order.  Each chunk becomes a gzip member, an
+ * lz4 frame, or a frame of a seekable zstd file, and readers handle any
+ * sequence of those.  It's here rather than in wiretap so that dumpcap,
+ * which writes its files with writecap, can use it too.
+ */
+
+typedef enum {
+    WS_PARALLEL_GZIP,
+    WS_PARALLEL_LZ4,
+    WS_PARALLEL_ZSTD
+} ws_parallel_compression_t;
+
+typedef struct ws_parallel_writer ws_parallel_writer_t;
+
+/** Errors other than errno values */
+#define WS_PARALLEL_ERR_SHORT_WRITE     -1  /**< A write wrote less than it was asked to */
+#define WS_PARALLEL_ERR_COMPRESS        -2  /**< The compression library failed; see the error info */
+#define WS_PARALLEL_ERR_NOT_SUPPORTED   -3  /**< This build can't compress with that type */
+
+/**
+ * Look up a type of compression by the name used on command lines:
+ * "gzip", "lz4" or "zstd".
+ *
+ * @param name [in] The name.
+ * @param compression_type [out] The type of compression.
+ * @return true if the name is known, whether or not this build can
+ * compress with it.
+ */
+WS_DLL_PUBLIC bool ws_parallel_writer_compression_type(const char *name,
+        ws_parallel_compression_t *compression_type);
+
+/**
+ * Get the usual file name extension, without the ".", for a type of
+ * compression.
+ *
+ * @param compression_type [in] The type of compression.
+ * @return The extension.
+ */
+WS_DLL_PUBLIC const char *ws_parallel_writer_extension(ws_parallel_compression_t compression_type);
+
+/**
+ * Whether this build can compress with a given type.
+ *
+ * @param compression_type [in] The type of compression.
+ * @return true if it can.
+ */
+WS_DLL_PUBLIC bool ws_parallel_writer_can_compress(ws_parallel_compression_t compression_type);
+
+/**
+ * Start writing compressed data to a file descriptor, which is closed
+ * by ws_parallel_writer_close().
+ *
+ * @param fd [in] The file descriptor to write to.
+ * @param compression_type [in] The type of compression.
+ * @param threads [in] The number of worker threads; 0 means 1.
+ * @param err [out] An errno value, or WS_PARALLEL_ERR_NOT_SUPPORTED, on failure.
+ * @return The writer, or NULL on failure.
+ */
+WS_DLL_PUBLIC ws_parallel_writer_t *ws_parallel_writer_fdopen(int fd,
+        ws_parallel_compression_t compression_type, unsigned threads, int *err);
+
+/**
+ * Write data.  It's compressed once a chunk has been filled, or when
+ * the writer is flushed or closed.
+ *
+ * @param state [in] The writer.
+ * @param buf [in] The data.
+ * @param len [in] The length of the data.
+ * @return len on success, or 0 on failure, or if len is 0.
+ */
+WS_DLL_PUBLIC size_t ws_parallel_writer_write(ws_parallel_writer_t *state,
+        const void *buf, size_t len);
+
+/**
+ * Compress and write out everything written so far, waiting for it.
+ *
+ * @param state [in] The writer.
+ * @return 0 on success, or -1 on failure.
+ */
+WS_DLL_PUBLIC int ws_parallel_writer_flush(ws_parallel_writer_t *state);
+
+/**
+ * Compress and write out everything written, close the file descriptor
+ * and free the writer.
+ *
+ * @param state [in] The writer.
+ * @param err_info [out] If not NULL, set to a description of a
+ * WS_PARALLEL_ERR_COMPRESS error, which must not be freed.
+ * @return 0 on success, or an errno value or one of the WS_PARALLEL_ERR_
+ * errors on failure.
+ */
+WS_DLL_PUBLIC int ws_parallel_writer_close(ws_parallel_writer_t *state,
+        const char **err_info);
+
+/**
+ * Get the error that made a write or a flush fail.
+ *
+ * @param state [in] The writer.
+ * @param err_info [out] If not NULL, set to a description of a
+ * WS_PARALLEL_ERR_COMPRESS error, which must not be freed.
+ * @return An errno value, one of the WS_PARALLEL_ERR_ errors, or 0 if
+ * there wasn't one.
+ */
+WS_DLL_PUBLIC int ws_parallel_writer_geterr(ws_parallel_writer_t *state,
+        const char **err_info);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __PARALLEL_WRITER_H__ */
@@ -663,6 +663,27 @@ void test_nstime_from_iso8601(void)
     g_assert_cmpint(result.nsecs, ==, expect.nsecs);
 }
 
+#include "murmur3.h"
+
+static void test_murmur3_128(void)
+{
+    const char *str;
+    uint8_t digest[16];
+    char *hex;
+
+    str = "";
+    murmur3_128((const uint8_t *)str, strlen(str), 0, digest);
+    hex = bytes_to_str(NULL, digest, sizeof(digest));
+    g_assert_cmpstr(hex, ==, "00000000000000000000000000000000");
+    wmem_free(NULL, hex);
+
+    str = "The quick brown fox jumps over the lazy dog";
+    murmur3_128((const uint8_t *)str, strlen(str), 0, digest);
+    hex = bytes_to_str(NULL, digest, sizeof(digest));
+    g_assert_cmpstr(hex, ==, "6c1b07bc7bbc4be347939ac4a93c437a");
+    wmem_free(NULL, hex);
+}
+
 #include "ws_getopt.h"
 
 #define ARGV_MAX 31
@@ -881,6 +902,8 @@ int main(int argc, char **argv)
 
     g_test_add_func("/nstime/from_iso8601", test_nstime_from_iso8601);
 
+    g_test_add_func("/murmur3/hash128", test_murmur3_128);
+
     g_test_add_func("/ws_getopt/basic1", test_getopt_long_basic1);
     g_test_add_func("/ws_getopt/basic2", test_getopt_long_basic2);
     g_test_add_func("/ws_getopt/optional1", test_getopt_optional_argument1);
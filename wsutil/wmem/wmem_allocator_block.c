@@ -351,6 +351,33 @@ wmem_block_verify(wmem_allocator_t *allocator)
     g_assert_true(chunk_free == master_free + recycler_free);
 }
 
+size_t
+wmem_block_used_bytes(wmem_allocator_t *allocator)
+{
+    wmem_block_hdr_t       *cur;
+    wmem_block_chunk_t     *chunk;
+    wmem_block_allocator_t *private_allocator;
+    size_t                  used = 0;
+
+    private_allocator = (wmem_block_allocator_t*) allocator->private_data;
+
+    for (cur = private_allocator->block_list; cur; cur = cur->next) {
+        chunk = WMEM_BLOCK_TO_CHUNK(cur);
+        if (chunk->jumbo) {
+            /* Its size isn't recorded. */
+            continue;
+        }
+        do {
+            if (chunk->used) {
+                used += chunk->len;
+            }
+            chunk = WMEM_CHUNK_NEXT(chunk);
+        } while (chunk);
+    }
+
+    return used;
+}
+
 /* MASTER/RECYCLER HELPERS */
 
 /* Cycles the recycler. See the design notes at the top of this file for more
@@ -26,6 +26,9 @@ wmem_block_allocator_init(wmem_allocator_t *allocator);
 void
 wmem_block_verify(wmem_allocator_t *allocator);
 
+size_t
+wmem_block_used_bytes(wmem_allocator_t *allocator);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
@@ -19,84 +19,112 @@
 #include "wmem_allocator.h"
 #include "wmem_allocator_simple.h"
 
-#define DEFAULT_ALLOCS 8192
+/* Each allocation is preceded by a header linking it into a doubly-linked
+ * list of all the allocator's live chunks, so that freeing (or reallocating)
+ * a single chunk is constant time and an empty allocator costs next to
+ * nothing. The header is padded so that the memory handed out keeps the
+ * alignment of the underlying malloc. */
+typedef struct _wmem_simple_chunk_t {
+    struct _wmem_simple_chunk_t *prev;
+    struct _wmem_simple_chunk_t *next;
+} wmem_simple_chunk_t;
+
+#define WMEM_ALIGN_AMOUNT (2 * sizeof (size_t))
+#define WMEM_ALIGN_SIZE(SIZE) ((~(WMEM_ALIGN_AMOUNT-1)) & \
+        ((SIZE) + (WMEM_ALIGN_AMOUNT-1)))
+
+#define WMEM_CHUNK_HEADER_SIZE WMEM_ALIGN_SIZE(sizeof(wmem_simple_chunk_t))
+
+#define WMEM_CHUNK_TO_DATA(CHUNK) ((void*)((uint8_t*)(CHUNK) + WMEM_CHUNK_HEADER_SIZE))
+#define WMEM_DATA_TO_CHUNK(DATA) ((wmem_simple_chunk_t*)((uint8_t*)(DATA) - WMEM_CHUNK_HEADER_SIZE))
 
 typedef struct _wmem_simple_allocator_t {
-    int size;
-    int count;
-    void **ptrs;
+    wmem_simple_chunk_t *head;
 } wmem_simple_allocator_t;
 
+static void
+wmem_simple_link(wmem_simple_allocator_t *allocator, wmem_simple_chunk_t *chunk)
+{
+    chunk->prev = NULL;
+    chunk->next = allocator->head;
+    if (allocator->head) {
+        allocator->head->prev = chunk;
+    }
+    allocator->head = chunk;
+}
+
+static void
+wmem_simple_unlink(wmem_simple_allocator_t *allocator, wmem_simple_chunk_t *chunk)
+{
+    if (chunk->prev) {
+        chunk->prev->next = chunk->next;
+    }
+    else {
+        g_assert(allocator->head == chunk);
+        allocator->head = chunk->next;
+    }
+    if (chunk->next) {
+        chunk->next->prev = chunk->prev;
+    }
+}
+
 static void *
 wmem_simple_alloc(void *private_data, const size_t size)
 {
     wmem_simple_allocator_t *allocator;
+    wmem_simple_chunk_t     *chunk;
 
     allocator = (wmem_simple_allocator_t*) private_data;
 
-    if (G_UNLIKELY(allocator->count == allocator->size)) {
-        allocator->size *= 2;
-        allocator->ptrs = (void**)wmem_realloc(NULL, allocator->ptrs,
-                sizeof(void*) * allocator->size);
-    }
+    chunk = (wmem_simple_chunk_t*)wmem_alloc(NULL, WMEM_CHUNK_HEADER_SIZE + size);
+    wmem_simple_link(allocator, chunk);
 
-    return allocator->ptrs[allocator->count++] = wmem_alloc(NULL, size);
+    return WMEM_CHUNK_TO_DATA(chunk);
 }
 
 static void
 wmem_simple_free(void *private_data, void *ptr)
 {
-    int                      i;
     wmem_simple_allocator_t *allocator;
+    wmem_simple_chunk_t     *chunk;
 
     allocator = (wmem_simple_allocator_t*) private_data;
+    chunk = WMEM_DATA_TO_CHUNK(ptr);
 
-    wmem_free(NULL, ptr);
-    allocator->count--;
-
-    for (i=allocator->count; i>=0; i--) {
-        if (ptr == allocator->ptrs[i]) {
-            if (i < allocator->count) {
-                allocator->ptrs[i] = allocator->ptrs[allocator->count];
-            }
-            return;
-        }
-    }
-
-    g_assert_not_reached();
+    wmem_simple_unlink(allocator, chunk);
+    wmem_free(NULL, chunk);
 }
 
 static void *
 wmem_simple_realloc(void *private_data, void *ptr, const size_t size)
 {
-    int                      i;
     wmem_simple_allocator_t *allocator;
+    wmem_simple_chunk_t     *chunk;
 
     allocator = (wmem_simple_allocator_t*) private_data;
+    chunk = WMEM_DATA_TO_CHUNK(ptr);
 
-    for (i=allocator->count-1; i>=0; i--) {
-        if (ptr == allocator->ptrs[i]) {
-            return allocator->ptrs[i] = wmem_realloc(NULL, allocator->ptrs[i], size);
-        }
-    }
+    /* The chunk may move, so take it out of the list and put it back. */
+    wmem_simple_unlink(allocator, chunk);
+    chunk = (wmem_simple_chunk_t*)wmem_realloc(NULL, chunk, WMEM_CHUNK_HEADER_SIZE + size);
+    wmem_simple_link(allocator, chunk);
 
-    g_assert_not_reached();
-    /* not reached */
-    return NULL;
+    return WMEM_CHUNK_TO_DATA(chunk);
 }
 
 static void
 wmem_simple_free_all(void *private_data)
 {
     wmem_simple_allocator_t *allocator;
-    int i;
+    wmem_simple_chunk_t     *chunk, *next;
 
     allocator = (wmem_simple_allocator_t*) private_data;
 
-    for (i = 0; i<allocator->count; i++) {
-        wmem_free(NULL, allocator->ptrs[i]);
+    for (chunk = allocator->head; chunk; chunk = next) {
+        next = chunk->next;
+        wmem_free(NULL, chunk);
     }
-    allocator->count = 0;
+    allocator->head = NULL;
 }
 
 static void
@@ -112,7 +140,6 @@ wmem_simple_allocator_cleanup(void *private_data)
 
     allocator = (wmem_simple_allocator_t*) private_data;
 
-    wmem_free(NULL, allocator->ptrs);
     wmem_free(NULL, allocator);
 }
 
@@ -133,9 +160,7 @@ wmem_simple_allocator_init(wmem_allocator_t *allocator)
 
     allocator->private_data = (void*) simple_allocator;
 
-    simple_allocator->count = 0;
-    simple_allocator->size = DEFAULT_ALLOCS;
-    simple_allocator->ptrs = wmem_alloc_array(NULL, void*, DEFAULT_ALLOCS);
+    simple_allocator->head = NULL;
 }
 
 /*
@@ -0,0 +1,378 @@
+/* wmem_allocator_slab.c
+ * Wireshark Memory Manager Size-Class Slab Allocator
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include <glib.h>
+
+#include <wsutil/bits_ctz.h>
+
+#include "wmem_core.h"
+#include "wmem_allocator.h"
+#include "wmem_allocator_slab.h"
+
+/* This allocator is meant for pools that are emptied often and that mostly
+ * hold small objects of a handful of sizes, like the protocol tree nodes,
+ * field_infos and labels of the packet scope.
+ *
+ * Small allocations are rounded up to one of a few size classes, and each
+ * size class is carved out of its own list of blocks, so objects of the same
+ * kind end up next to each other. Freed chunks go on a per-class free list
+ * and are handed out again before any new space is used.
+ *
+ * free_all doesn't give any memory back: it only rewinds each size class to
+ * its first block, so it takes the same time however much was allocated, and
+ * the next scope reuses the same (already mapped and cached) blocks. gc gives
+ * back the blocks that weren't needed since the last free_all.
+ *
+ * Allocations bigger than the largest size class are "jumbo" allocations
+ * made directly from the system, as in the fast block allocator.
+ */
+
+/* See the fast block allocator for the choice of alignment. */
+#define WMEM_ALIGN_AMOUNT (2 * sizeof (size_t))
+#define WMEM_ALIGN_SIZE(SIZE) ((~(WMEM_ALIGN_AMOUNT-1)) & \
+        ((SIZE) + (WMEM_ALIGN_AMOUNT-1)))
+
+#define WMEM_CHUNK_TO_DATA(CHUNK) ((void*)((uint8_t*)(CHUNK) + WMEM_CHUNK_HEADER_SIZE))
+#define WMEM_DATA_TO_CHUNK(DATA) ((wmem_slab_chunk_t*)((uint8_t*)(DATA) - WMEM_CHUNK_HEADER_SIZE))
+
+/* Each size class gets blocks of this size. It's small enough that a size
+ * class that is only used for a few objects doesn't waste much, and big
+ * enough to hold about sixty chunks of the largest class. */
+#define WMEM_SLAB_BLOCK_SIZE (128 * 1024)
+
+/* Sizes up to 128 bytes are rounded up to a multiple of 16, bigger ones to
+ * one of four steps per power of two, up to 2048 bytes. All the sizes are
+ * multiples of WMEM_ALIGN_AMOUNT, so the chunks stay aligned. */
+#define WMEM_SLAB_NUM_CLASSES 24
+#define WMEM_SLAB_MAX_SIZE    2048
+
+static const uint32_t wmem_slab_class_size[WMEM_SLAB_NUM_CLASSES] = {
+      16,   32,   48,   64,   80,   96,  112,  128,
+     160,  192,  224,  256,  320,  384,  448,  512,
+     640,  768,  896, 1024, 1280, 1536, 1792, 2048
+};
+
+/* The header of each OS-level block of a size class */
+typedef struct _wmem_slab_block {
+    struct _wmem_slab_block *next;
+} wmem_slab_block_t;
+#define WMEM_BLOCK_HEADER_SIZE WMEM_ALIGN_SIZE(sizeof(wmem_slab_block_t))
+
+typedef struct {
+    uint32_t size_class;
+} wmem_slab_chunk_t;
+#define WMEM_CHUNK_HEADER_SIZE WMEM_ALIGN_SIZE(sizeof(wmem_slab_chunk_t))
+
+#define JUMBO_MAGIC 0xFFFFFFFF
+typedef struct _wmem_slab_jumbo {
+    struct _wmem_slab_jumbo *prev, *next;
+} wmem_slab_jumbo_t;
+#define WMEM_JUMBO_HEADER_SIZE WMEM_ALIGN_SIZE(sizeof(wmem_slab_jumbo_t))
+
+/* A freed chunk; the link is kept in the (unused) data of the chunk. */
+typedef struct _wmem_slab_free {
+    struct _wmem_slab_free *next;
+} wmem_slab_free_t;
+
+typedef struct {
+    /* All the blocks of this class, and the one being carved up. The blocks
+     * before 'cur' are full, the ones after it are unused. */
+    wmem_slab_block_t *block_list;
+    wmem_slab_block_t *cur;
+    uint8_t           *pos;
+    uint8_t           *end;
+
+    wmem_slab_free_t  *free_list;
+} wmem_slab_class_t;
+
+typedef struct {
+    wmem_slab_class_t  classes[WMEM_SLAB_NUM_CLASSES];
+    wmem_slab_jumbo_t *jumbo_list;
+} wmem_slab_allocator_t;
+
+static inline unsigned
+wmem_slab_size_class(size_t size)
+{
+    size_t n;
+    int    msb;
+
+    if (size <= 128) {
+        return size ? (unsigned)((size - 1) >> 4) : 0;
+    }
+
+    /* Four classes for every power of two; pick by the two bits below the
+     * most significant one. */
+    n   = size - 1;
+    msb = ws_ilog2(n);
+    return 8 + (msb - 7) * 4 + (unsigned)((n >> (msb - 2)) & 3);
+}
+
+/* Makes the next block of the class current, adding one if necessary. */
+static void
+wmem_slab_next_block(wmem_slab_class_t *cls)
+{
+    wmem_slab_block_t *block;
+
+    if (cls->cur && cls->cur->next) {
+        block = cls->cur->next;
+    }
+    else {
+        block = (wmem_slab_block_t *)wmem_alloc(NULL, WMEM_SLAB_BLOCK_SIZE);
+        block->next = NULL;
+        if (cls->cur) {
+            cls->cur->next = block;
+        }
+        else {
+            cls->block_list = block;
+        }
+    }
+
+    cls->cur = block;
+    cls->pos = (uint8_t *)block + WMEM_BLOCK_HEADER_SIZE;
+    cls->end = (uint8_t *)block + WMEM_SLAB_BLOCK_SIZE;
+}
+
+/* API */
+
+static void *
+wmem_slab_alloc(void *private_data, const size_t size)
+{
+    wmem_slab_allocator_t *allocator = (wmem_slab_allocator_t*) private_data;
+    wmem_slab_class_t     *cls;
+    wmem_slab_chunk_t     *chunk;
+    unsigned               size_class;
+    size_t                 real_size;
+
+    if (size > WMEM_SLAB_MAX_SIZE) {
+        wmem_slab_jumbo_t *block;
+
+        block = (wmem_slab_jumbo_t *)wmem_alloc(NULL,
+                size + WMEM_JUMBO_HEADER_SIZE + WMEM_CHUNK_HEADER_SIZE);
+
+        block->next = allocator->jumbo_list;
+        if (block->next) {
+            block->next->prev = block;
+        }
+        block->prev = NULL;
+        allocator->jumbo_list = block;
+
+        chunk = ((wmem_slab_chunk_t*)((uint8_t*)(block) + WMEM_JUMBO_HEADER_SIZE));
+        chunk->size_class = JUMBO_MAGIC;
+
+        return WMEM_CHUNK_TO_DATA(chunk);
+    }
+
+    size_class = wmem_slab_size_class(size);
+    cls = &allocator->classes[size_class];
+
+    if (cls->free_list) {
+        void *ptr = cls->free_list;
+
+        cls->free_list = cls->free_list->next;
+        return ptr;
+    }
+
+    real_size = WMEM_CHUNK_HEADER_SIZE + wmem_slab_class_size[size_class];
+    if ((size_t)(cls->end - cls->pos) < real_size) {
+        wmem_slab_next_block(cls);
+    }
+
+    chunk = (wmem_slab_chunk_t *)cls->pos;
+    chunk->size_class = size_class;
+    cls->pos += real_size;
+
+    return WMEM_CHUNK_TO_DATA(chunk);
+}
+
+static void
+wmem_slab_free(void *private_data, void *ptr)
+{
+    wmem_slab_allocator_t *allocator = (wmem_slab_allocator_t*) private_data;
+    wmem_slab_chunk_t     *chunk;
+    wmem_slab_free_t      *free_chunk;
+
+    chunk = WMEM_DATA_TO_CHUNK(ptr);
+
+    if (chunk->size_class == JUMBO_MAGIC) {
+        wmem_slab_jumbo_t *block;
+
+        block = ((wmem_slab_jumbo_t*)((uint8_t*)(chunk) - WMEM_JUMBO_HEADER_SIZE));
+        if (block->next) {
+            block->next->prev = block->prev;
+        }
+        if (block->prev) {
+            block->prev->next = block->next;
+        }
+        else {
+            allocator->jumbo_list = block->next;
+        }
+        wmem_free(NULL, block);
+        return;
+    }
+
+    free_chunk = (wmem_slab_free_t *)ptr;
+    free_chunk->next = allocator->classes[chunk->size_class].free_list;
+    allocator->classes[chunk->size_class].free_list = free_chunk;
+}
+
+static void *
+wmem_slab_realloc(void *private_data, void *ptr, const size_t size)
+{
+    wmem_slab_chunk_t *chunk;
+    uint32_t           old_size;
+    void              *newptr;
+
+    chunk = WMEM_DATA_TO_CHUNK(ptr);
+
+    if (chunk->size_class == JUMBO_MAGIC) {
+        wmem_slab_jumbo_t *block;
+
+        block = ((wmem_slab_jumbo_t*)((uint8_t*)(chunk) - WMEM_JUMBO_HEADER_SIZE));
+        block =  (wmem_slab_jumbo_t*)wmem_realloc(NULL, block,
+                size + WMEM_JUMBO_HEADER_SIZE + WMEM_CHUNK_HEADER_SIZE);
+        if (block->prev) {
+            block->prev->next = block;
+        }
+        else {
+            wmem_slab_allocator_t *allocator = (wmem_slab_allocator_t*) private_data;
+            allocator->jumbo_list = block;
+        }
+        if (block->next) {
+            block->next->prev = block;
+        }
+        return ((void*)((uint8_t*)(block) + WMEM_JUMBO_HEADER_SIZE + WMEM_CHUNK_HEADER_SIZE));
+    }
+
+    /* Shrinking, or growing within the size class: nothing to do. */
+    old_size = wmem_slab_class_size[chunk->size_class];
+    if (size <= old_size) {
+        return ptr;
+    }
+
+    newptr = wmem_slab_alloc(private_data, size);
+    memcpy(newptr, ptr, old_size);
+    wmem_slab_free(private_data, ptr);
+
+    return newptr;
+}
+
+static void
+wmem_slab_free_all(void *private_data)
+{
+    wmem_slab_allocator_t *allocator = (wmem_slab_allocator_t*) private_data;
+    wmem_slab_jumbo_t     *cur_jum, *nxt_jum;
+    unsigned               i;
+
+    /* rewind every size class to its first block, keeping the others for
+     * reuse */
+    for (i = 0; i < WMEM_SLAB_NUM_CLASSES; i++) {
+        wmem_slab_class_t *cls = &allocator->classes[i];
+
+        cls->free_list = NULL;
+        cls->cur = cls->block_list;
+        if (cls->cur) {
+            cls->pos = (uint8_t *)cls->cur + WMEM_BLOCK_HEADER_SIZE;
+            cls->end = (uint8_t *)cls->cur + WMEM_SLAB_BLOCK_SIZE;
+        }
+        else {
+            cls->pos = cls->end = NULL;
+        }
+    }
+
+    /* free all the jumbo blocks */
+    cur_jum = allocator->jumbo_list;
+    while (cur_jum) {
+        nxt_jum  = cur_jum->next;
+        wmem_free(NULL, cur_jum);
+        cur_jum = nxt_jum;
+    }
+    allocator->jumbo_list = NULL;
+}
+
+static void
+wmem_slab_gc(void *private_data)
+{
+    wmem_slab_allocator_t *allocator = (wmem_slab_allocator_t*) private_data;
+    wmem_slab_block_t     *cur, *nxt;
+    unsigned               i;
+
+    /* give back the blocks after the current one of each class, as they
+     * haven't been used since the last free_all */
+    for (i = 0; i < WMEM_SLAB_NUM_CLASSES; i++) {
+        wmem_slab_class_t *cls = &allocator->classes[i];
+
+        if (!cls->cur) {
+            continue;
+        }
+        cur = cls->cur->next;
+        cls->cur->next = NULL;
+        while (cur) {
+            nxt = cur->next;
+            wmem_free(NULL, cur);
+            cur = nxt;
+        }
+    }
+}
+
+static void
+wmem_slab_allocator_cleanup(void *private_data)
+{
+    wmem_slab_allocator_t *allocator = (wmem_slab_allocator_t*) private_data;
+    wmem_slab_block_t     *cur, *nxt;
+    unsigned               i;
+
+    /* wmem guarantees that free_all() is called directly before this, so
+     * only the blocks themselves are left */
+    for (i = 0; i < WMEM_SLAB_NUM_CLASSES; i++) {
+        cur = allocator->classes[i].block_list;
+        while (cur) {
+            nxt = cur->next;
+            wmem_free(NULL, cur);
+            cur = nxt;
+        }
+    }
+
+    wmem_free(NULL, private_data);
+}
+
+void
+wmem_slab_allocator_init(wmem_allocator_t *allocator)
+{
+    wmem_slab_allocator_t *slab_allocator;
+
+    slab_allocator = wmem_new0(NULL, wmem_slab_allocator_t);
+
+    allocator->walloc   = &wmem_slab_alloc;
+    allocator->wrealloc = &wmem_slab_realloc;
+    allocator->wfree    = &wmem_slab_free;
+
+    allocator->free_all = &wmem_slab_free_all;
+    allocator->gc       = &wmem_slab_gc;
+    allocator->cleanup  = &wmem_slab_allocator_cleanup;
+
+    allocator->private_data = (void*) slab_allocator;
+}
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
@@ -21,6 +21,7 @@
 #include "wmem_allocator_simple.h"
 #include "wmem_allocator_block.h"
 #include "wmem_allocator_block_fast.h"
+#include "wmem_allocator_slab.h"
 #include "wmem_allocator_strict.h"
 
 /* Set according to the WIRESHARK_DEBUG_WMEM_OVERRIDE environment variable in
@@ -116,6 +117,14 @@ wmem_gc(wmem_allocator_t *allocator)
     allocator->gc(allocator->private_data);
 }
 
+size_t
+wmem_allocator_used_bytes(wmem_allocator_t *allocator)
+{
+    if (allocator->type == WMEM_ALLOCATOR_BLOCK)
+        return wmem_block_used_bytes(allocator);
+    return 0;
+}
+
 void
 wmem_destroy_allocator(wmem_allocator_t *allocator)
 {
@@ -156,6 +165,9 @@ wmem_allocator_new(const wmem_allocator_type_t type)
         case WMEM_ALLOCATOR_STRICT:
             wmem_strict_allocator_init(allocator);
             break;
+        case WMEM_ALLOCATOR_SLAB:
+            wmem_slab_allocator_init(allocator);
+            break;
         default:
             g_assert_not_reached();
             break;
@@ -192,6 +204,9 @@ wmem_init(void)
         else if (strncmp(override_env, "block_fast", strlen("block_fast")) == 0) {
             override_type = WMEM_ALLOCATOR_BLOCK_FAST;
         }
+        else if (strncmp(override_env, "slab", strlen("slab")) == 0) {
+            override_type = WMEM_ALLOCATOR_SLAB;
+        }
         else {
             g_warning("Unrecognized wmem override");
             do_override = false;
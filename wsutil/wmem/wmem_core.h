@@ -46,9 +46,10 @@ typedef struct _wmem_allocator_t wmem_allocator_t;
 /** An enumeration of the different types of available allocators. */
 typedef enum _wmem_allocator_type_t {
     WMEM_ALLOCATOR_SIMPLE, /**< A trivial allocator that mallocs requested
-                memory and tracks allocations via a hash table. As simple as
-                possible, intended more as a demo than for practical usage. Also
-                has the benefit of being friendly to tools like valgrind. */
+                memory and tracks allocations in a list. As simple as possible,
+                and cheap enough when empty to create one per conversation or
+                other short-lived object. Also has the benefit of being
+                friendly to tools like valgrind. */
     WMEM_ALLOCATOR_BLOCK, /**< A block allocator that grabs large chunks of
                 memory at a time (8 MB currently) and serves allocations out of
                 those chunks. Designed for efficiency, especially in the
@@ -57,11 +58,16 @@ typedef enum _wmem_allocator_type_t {
                 memory usage via things like canaries and scrubbing freed
                 memory. Valgrind is the better choice on platforms that support
                 it. */
-    WMEM_ALLOCATOR_BLOCK_FAST /**< A block allocator like WMEM_ALLOCATOR_BLOCK
+    WMEM_ALLOCATOR_BLOCK_FAST, /**< A block allocator like WMEM_ALLOCATOR_BLOCK
                 but even faster by tracking absolutely minimal metadata and
                 making 'free' a no-op. Useful only for very short-lived scopes
                 where there's no reason to free individual allocations because
                 the next free_all is always just around the corner. */
+    WMEM_ALLOCATOR_SLAB /**< An allocator that serves small allocations from
+                per-size-class slabs with free lists, and keeps its blocks
+                across free_all, which just rewinds them. Intended for short
+                scopes with many small objects of a few sizes, such as the
+                nodes and fields of a protocol tree. */
 } wmem_allocator_type_t;
 
 /** Allocate the requested amount of memory in the given pool.
@@ -186,6 +192,19 @@ WS_DLL_PUBLIC
 void
 wmem_gc(wmem_allocator_t *allocator);
 
+/** Get how much memory allocated in a block allocator hasn't been freed,
+ * including the allocator's own overhead for each allocation, for statistics
+ * and tests. Allocations too big to fit in a block aren't counted, and
+ * allocators of other types always return 0. This walks every allocation,
+ * so don't call it often.
+ *
+ * @param allocator The allocator to look at.
+ * @return The number of bytes in use.
+ */
+WS_DLL_PUBLIC
+size_t
+wmem_allocator_used_bytes(wmem_allocator_t *allocator);
+
 /** Destroy the given allocator, freeing all memory allocated in it. Once this
  * function has been called, no memory allocated with the allocator is valid.
  *
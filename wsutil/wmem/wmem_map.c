@@ -10,8 +10,21 @@
  */
 #include "config.h"
 
+#include <stdlib.h>
+#include <string.h>
+
 #include <glib.h>
 
+#include <wsutil/bits_ctz.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define WMEM_MAP_SSE2
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define WMEM_MAP_NEON
+#endif
+
 #include "wmem_core.h"
 #include "wmem_list.h"
 #include "wmem_map.h"
@@ -20,19 +33,48 @@
 
 static uint32_t x; /* Used for universal integer hashing (see the HASH macro) */
 
+static uint64_t x64; /* The same, for the open addressing tables */
+
 /* Used for the wmem_strong_hash() function */
 static uint32_t preseed;
 static uint32_t postseed;
 
+/* Whether new maps use open addressing by default, and whether maps may
+ * opt into it (see wmem_map_set_open_addressing()) */
+static bool open_addressing_default;
+static bool open_addressing_allowed;
+
 void
 wmem_init_hashing(void)
 {
+    const char *override_env;
+
     x = g_random_int();
     if (G_UNLIKELY(x == 0))
         x = 1;
 
+    x64 = ((uint64_t)g_random_int() << 32 | g_random_int()) | 1;
+
     preseed  = g_random_int();
     postseed = g_random_int();
+
+    /* Lets the whole program be run with one or the other map
+     * implementation, to compare them or to track down a bug. */
+    override_env = getenv("WIRESHARK_WMEM_MAP_OVERRIDE");
+    open_addressing_default = false;
+    open_addressing_allowed = true;
+    if (override_env == NULL) {
+        /* nothing to do */
+    }
+    else if (strcmp(override_env, "open") == 0) {
+        open_addressing_default = true;
+    }
+    else if (strcmp(override_env, "chained") == 0) {
+        open_addressing_allowed = false;
+    }
+    else {
+        g_warning("Unrecognized wmem map override");
+    }
 }
 
 typedef struct _wmem_map_item_t {
@@ -41,6 +83,25 @@ typedef struct _wmem_map_item_t {
     struct _wmem_map_item_t *next;
 } wmem_map_item_t;
 
+/* A table of an open addressing map. The slots are split into groups of
+ * WMEM_MAP_GROUP_SIZE, each with a control byte per slot telling whether the
+ * slot is empty, deleted, or full, and in that last case holding 7 bits of the
+ * hash of its key. A whole group of control bytes is matched against a hash at
+ * once (with SSE2 or NEON where available), so the keys themselves are only
+ * compared for the few slots whose control bytes match. Keys and values are
+ * stored in the slots, so inserting doesn't allocate anything. */
+typedef struct {
+    const void *key;
+    void *value;
+} wmem_map_slot_t;
+
+typedef struct {
+    uint8_t         *ctrl;
+    wmem_map_slot_t *slots;
+    /* The base-2 logarithm of the number of groups */
+    unsigned         group_bits;
+} wmem_map_otable_t;
+
 struct _wmem_map_t {
     unsigned count; /* number of items stored */
 
@@ -52,6 +113,17 @@ struct _wmem_map_t {
 
     wmem_map_item_t **table;
 
+    /* Open addressing, see wmem_map_set_open_addressing(). When the table
+     * grows, the items are moved from the old table to the new one a group at
+     * a time, one group on every insertion, so that no insertion has to
+     * rehash the whole map. Until that's done both tables are searched. */
+    bool              open;
+    bool              direct;      /* g_direct_hash and g_direct_equal, done inline */
+    wmem_map_otable_t otable;
+    wmem_map_otable_t old_otable;
+    size_t            migrate_group;
+    size_t            growth_left; /* empty slots that can still be filled */
+
     GHashFunc  hash_func;
     GEqualFunc eql_func;
 
@@ -99,6 +171,11 @@ wmem_map_new(wmem_allocator_t *allocator,
     map->count = 0;
     map->table = NULL;
 
+    map->open = open_addressing_default;
+    map->direct = (hash_func == g_direct_hash && eql_func == g_direct_equal);
+    memset(&map->otable, 0, sizeof map->otable);
+    memset(&map->old_otable, 0, sizeof map->old_otable);
+
     return map;
 }
 
@@ -110,6 +187,8 @@ wmem_map_reset_cb(wmem_allocator_t *allocator _U_, wmem_cb_event_t event,
 
     map->count = 0;
     map->table = NULL;
+    memset(&map->otable, 0, sizeof map->otable);
+    memset(&map->old_otable, 0, sizeof map->old_otable);
 
     if (event == WMEM_CB_DESTROY_EVENT) {
         wmem_unregister_callback(map->metadata_allocator, map->metadata_scope_cb_id);
@@ -145,12 +224,391 @@ wmem_map_new_autoreset(wmem_allocator_t *metadata_scope, wmem_allocator_t *data_
     map->count = 0;
     map->table = NULL;
 
+    map->open = open_addressing_default;
+    map->direct = (hash_func == g_direct_hash && eql_func == g_direct_equal);
+    memset(&map->otable, 0, sizeof map->otable);
+    memset(&map->old_otable, 0, sizeof map->old_otable);
+
     map->metadata_scope_cb_id = wmem_register_callback(metadata_scope, wmem_map_destroy_cb, map);
     map->data_scope_cb_id  = wmem_register_callback(data_scope, wmem_map_reset_cb, map);
 
     return map;
 }
 
+void
+wmem_map_set_open_addressing(wmem_map_t *map)
+{
+    g_return_if_fail(map->count == 0);
+
+    if (!open_addressing_allowed) {
+        return;
+    }
+
+    /* Any (empty) chained table is left to the data scope. */
+    map->table = NULL;
+    map->open  = true;
+}
+
+/* OPEN ADDRESSING */
+
+#define WMEM_MAP_GROUP_SIZE   16
+#define WMEM_MAP_CTRL_EMPTY   0x80
+#define WMEM_MAP_CTRL_DELETED 0xFE
+#define WMEM_MAP_CTRL_FULL(C) (((C) & 0x80) == 0)
+
+/* Two groups, the same 32 slots as the chained map starts with */
+#define WMEM_MAP_DEFAULT_GROUP_BITS 1
+
+#define OCAPACITY(TBL) (((size_t)WMEM_MAP_GROUP_SIZE) << (TBL)->group_bits)
+
+/* The tables are filled up to 7/8 of their slots, so every probe sequence
+ * ends at an empty slot before long. */
+#define OMAX_LOAD(CAP) ((CAP) - (CAP) / 8)
+
+/* Multiplicative hashing as for the chained map, but to 64 bits: the top bits
+ * pick the first group to probe, the 7 bits below them go in the control
+ * byte. */
+#define OGROUP(TBL, H) ((size_t)((H) >> (64 - (TBL)->group_bits)))
+#define OH2(TBL, H)    ((uint8_t)(((H) >> (57 - (TBL)->group_bits)) & 0x7F))
+
+#define OKEY_EQUAL(MAP, A, B) \
+    ((MAP)->direct ? (A) == (B) : (MAP)->eql_func((A), (B)))
+
+#if defined(WMEM_MAP_NEON)
+/* NEON has no movemask; weight each lane by its bit and add the halves. */
+static inline uint32_t
+wmem_map_neon_mask(uint8x16_t lanes)
+{
+    static const uint8_t lane_bits[WMEM_MAP_GROUP_SIZE] = {
+        1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128
+    };
+    uint8x16_t bits = vandq_u8(lanes, vld1q_u8(lane_bits));
+
+    return (uint32_t)vaddv_u8(vget_low_u8(bits)) |
+        ((uint32_t)vaddv_u8(vget_high_u8(bits)) << 8);
+}
+#endif
+
+/* Returns a mask with bit i set if control byte i of the group is c */
+static inline uint32_t
+wmem_map_group_match(const uint8_t *ctrl, uint8_t c)
+{
+#if defined(WMEM_MAP_SSE2)
+    __m128i group = _mm_loadu_si128((const __m128i *)ctrl);
+
+    return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8((char)c)));
+#elif defined(WMEM_MAP_NEON)
+    return wmem_map_neon_mask(vceqq_u8(vld1q_u8(ctrl), vdupq_n_u8(c)));
+#else
+    uint32_t mask = 0;
+    unsigned i;
+
+    for (i = 0; i < WMEM_MAP_GROUP_SIZE; i++) {
+        if (ctrl[i] == c)
+            mask |= 1U << i;
+    }
+    return mask;
+#endif
+}
+
+/* Returns a mask of the slots of the group that are empty or deleted, whose
+ * control bytes are the ones with the high bit set */
+static inline uint32_t
+wmem_map_group_match_free(const uint8_t *ctrl)
+{
+#if defined(WMEM_MAP_SSE2)
+    return (uint32_t)_mm_movemask_epi8(_mm_loadu_si128((const __m128i *)ctrl));
+#elif defined(WMEM_MAP_NEON)
+    return wmem_map_neon_mask(vcgeq_u8(vld1q_u8(ctrl), vdupq_n_u8(0x80)));
+#else
+    uint32_t mask = 0;
+    unsigned i;
+
+    for (i = 0; i < WMEM_MAP_GROUP_SIZE; i++) {
+        if (!WMEM_MAP_CTRL_FULL(ctrl[i]))
+            mask |= 1U << i;
+    }
+    return mask;
+#endif
+}
+
+static inline uint64_t
+wmem_map_ohash(const wmem_map_t *map, const void *key)
+{
+    if (map->direct) {
+        return (uint64_t)(uintptr_t)key * x64;
+    }
+    return (uint64_t)map->hash_func(key) * x64;
+}
+
+static void
+wmem_map_otable_alloc(wmem_map_t *map, wmem_map_otable_t *tbl, unsigned group_bits)
+{
+    tbl->group_bits = group_bits;
+    tbl->ctrl       = (uint8_t *)wmem_alloc(map->data_allocator, OCAPACITY(tbl));
+    tbl->slots      = wmem_alloc_array(map->data_allocator, wmem_map_slot_t, OCAPACITY(tbl));
+    memset(tbl->ctrl, WMEM_MAP_CTRL_EMPTY, OCAPACITY(tbl));
+}
+
+static void
+wmem_map_otable_free(wmem_map_t *map, wmem_map_otable_t *tbl)
+{
+    wmem_free(map->data_allocator, tbl->ctrl);
+    wmem_free(map->data_allocator, tbl->slots);
+    memset(tbl, 0, sizeof *tbl);
+}
+
+/* Returns the slot of the table holding the key, or NULL */
+static wmem_map_slot_t *
+wmem_map_otable_find(const wmem_map_t *map, const wmem_map_otable_t *tbl,
+        const void *key, uint64_t h)
+{
+    size_t         group_mask = (((size_t)1) << tbl->group_bits) - 1;
+    size_t         group      = OGROUP(tbl, h);
+    size_t         step       = 0;
+    uint8_t        h2         = OH2(tbl, h);
+    const uint8_t *ctrl;
+    uint32_t       match;
+    size_t         idx;
+
+    for (;;) {
+        ctrl  = tbl->ctrl + group * WMEM_MAP_GROUP_SIZE;
+        match = wmem_map_group_match(ctrl, h2);
+        while (match) {
+            idx = group * WMEM_MAP_GROUP_SIZE + ws_ctz(match);
+            if (OKEY_EQUAL(map, key, tbl->slots[idx].key)) {
+                return &tbl->slots[idx];
+            }
+            match &= match - 1;
+        }
+
+        /* the key would have been put in the empty slot */
+        if (wmem_map_group_match(ctrl, WMEM_MAP_CTRL_EMPTY)) {
+            return NULL;
+        }
+
+        /* triangular probing, which visits every group of a power-of-two
+         * table */
+        step++;
+        group = (group + step) & group_mask;
+    }
+}
+
+/* Puts a key that isn't in the table in the first free slot of its probe
+ * sequence. Returns true if that slot was empty rather than deleted. */
+static bool
+wmem_map_otable_put(wmem_map_otable_t *tbl, const void *key, void *value, uint64_t h)
+{
+    size_t   group_mask = (((size_t)1) << tbl->group_bits) - 1;
+    size_t   group      = OGROUP(tbl, h);
+    size_t   step       = 0;
+    uint32_t match;
+    size_t   idx;
+    bool     was_empty;
+
+    for (;;) {
+        match = wmem_map_group_match_free(tbl->ctrl + group * WMEM_MAP_GROUP_SIZE);
+        if (match) {
+            idx = group * WMEM_MAP_GROUP_SIZE + ws_ctz(match);
+            was_empty = (tbl->ctrl[idx] == WMEM_MAP_CTRL_EMPTY);
+            tbl->ctrl[idx]        = OH2(tbl, h);
+            tbl->slots[idx].key   = key;
+            tbl->slots[idx].value = value;
+            return was_empty;
+        }
+        step++;
+        group = (group + step) & group_mask;
+    }
+}
+
+/* Frees a slot. Returns true if it became empty rather than deleted. */
+static bool
+wmem_map_otable_erase(wmem_map_otable_t *tbl, wmem_map_slot_t *slot)
+{
+    size_t idx = (size_t)(slot - tbl->slots);
+
+    /* A probe only goes on past groups without an empty slot, so if this
+     * group already has one, no probe needs this slot to look occupied. */
+    if (wmem_map_group_match(tbl->ctrl + (idx & ~(size_t)(WMEM_MAP_GROUP_SIZE - 1)),
+                WMEM_MAP_CTRL_EMPTY)) {
+        tbl->ctrl[idx] = WMEM_MAP_CTRL_EMPTY;
+        return true;
+    }
+    tbl->ctrl[idx] = WMEM_MAP_CTRL_DELETED;
+    return false;
+}
+
+/* Moves the items of the next group of the old table to the current one */
+static void
+wmem_map_omigrate_step(wmem_map_t *map)
+{
+    wmem_map_otable_t *old  = &map->old_otable;
+    size_t             base = map->migrate_group * WMEM_MAP_GROUP_SIZE;
+    uint32_t           full;
+    size_t             idx;
+
+    full = ~wmem_map_group_match_free(old->ctrl + base) & 0xFFFF;
+    while (full) {
+        idx = base + ws_ctz(full);
+        /* The room for these was set aside when the table was allocated, so
+         * growth_left isn't touched. Migrated slots are marked deleted, not
+         * empty, so that probes for the items still to be moved go past
+         * them. */
+        wmem_map_otable_put(&map->otable, old->slots[idx].key, old->slots[idx].value,
+                wmem_map_ohash(map, old->slots[idx].key));
+        old->ctrl[idx] = WMEM_MAP_CTRL_DELETED;
+        full &= full - 1;
+    }
+
+    map->migrate_group++;
+    if (map->migrate_group == (((size_t)1) << old->group_bits)) {
+        wmem_map_otable_free(map, old);
+    }
+}
+
+static void
+wmem_map_oresize(wmem_map_t *map)
+{
+    unsigned group_bits;
+
+    /* Normally long done by the time the new table fills up */
+    while (map->old_otable.ctrl) {
+        wmem_map_omigrate_step(map);
+    }
+
+    /* If few of the used slots hold items, most of them are deleted ones:
+     * start over with a table of the same size to get rid of them.
+     * Otherwise double the size. Either way, moving one group per insertion
+     * empties the old table well before the new one is full. */
+    group_bits = map->otable.group_bits;
+    if (map->count > OMAX_LOAD(OCAPACITY(&map->otable)) / 2) {
+        group_bits++;
+    }
+
+    map->old_otable    = map->otable;
+    map->migrate_group = 0;
+    wmem_map_otable_alloc(map, &map->otable, group_bits);
+    map->growth_left   = OMAX_LOAD(OCAPACITY(&map->otable)) - map->count;
+}
+
+/* Returns the slot holding the key in either table, or NULL, and the table
+ * it was found in */
+static wmem_map_slot_t *
+wmem_map_ofind(wmem_map_t *map, const void *key, wmem_map_otable_t **tbl)
+{
+    wmem_map_slot_t *slot;
+    uint64_t         h;
+
+    if (map->otable.ctrl == NULL) {
+        return NULL;
+    }
+
+    h = wmem_map_ohash(map, key);
+
+    slot = wmem_map_otable_find(map, &map->otable, key, h);
+    if (slot) {
+        if (tbl) {
+            *tbl = &map->otable;
+        }
+        return slot;
+    }
+
+    if (map->old_otable.ctrl) {
+        slot = wmem_map_otable_find(map, &map->old_otable, key, h);
+        if (slot && tbl) {
+            *tbl = &map->old_otable;
+        }
+    }
+
+    return slot;
+}
+
+static void *
+wmem_map_oinsert(wmem_map_t *map, const void *key, void *value)
+{
+    wmem_map_slot_t *slot;
+    void            *old_val;
+    uint64_t         h;
+
+    /* Make sure we have a table */
+    if (map->otable.ctrl == NULL) {
+        map->count = 0;
+        wmem_map_otable_alloc(map, &map->otable, WMEM_MAP_DEFAULT_GROUP_BITS);
+        map->growth_left = OMAX_LOAD(OCAPACITY(&map->otable));
+    }
+
+    if (map->old_otable.ctrl) {
+        wmem_map_omigrate_step(map);
+    }
+
+    h = wmem_map_ohash(map, key);
+
+    slot = wmem_map_otable_find(map, &map->otable, key, h);
+    if (slot == NULL && map->old_otable.ctrl) {
+        slot = wmem_map_otable_find(map, &map->old_otable, key, h);
+    }
+    if (slot) {
+        /* replace and return old value for this key */
+        old_val     = slot->value;
+        slot->value = value;
+        return old_val;
+    }
+
+    if (map->growth_left == 0) {
+        wmem_map_oresize(map);
+    }
+
+    if (wmem_map_otable_put(&map->otable, key, value, h)) {
+        map->growth_left--;
+    }
+    map->count++;
+
+    return NULL;
+}
+
+static bool
+wmem_map_oremove(wmem_map_t *map, const void *key, void **value)
+{
+    wmem_map_otable_t *tbl = NULL;
+    wmem_map_slot_t   *slot;
+
+    slot = wmem_map_ofind(map, key, &tbl);
+    if (slot == NULL) {
+        return false;
+    }
+
+    if (value) {
+        *value = slot->value;
+    }
+    if (wmem_map_otable_erase(tbl, slot) && tbl == &map->otable) {
+        map->growth_left++;
+    }
+    map->count--;
+
+    return true;
+}
+
+static unsigned
+wmem_map_otable_foreach_remove(wmem_map_t *map, wmem_map_otable_t *tbl,
+        GHRFunc foreach_func, void * user_data)
+{
+    size_t   i;
+    unsigned deleted = 0;
+
+    for (i = 0; tbl->ctrl && i < OCAPACITY(tbl); i++) {
+        if (WMEM_MAP_CTRL_FULL(tbl->ctrl[i]) &&
+                foreach_func((void *)tbl->slots[i].key, tbl->slots[i].value, user_data)) {
+            if (wmem_map_otable_erase(tbl, &tbl->slots[i]) && tbl == &map->otable) {
+                map->growth_left++;
+            }
+            map->count--;
+            deleted++;
+        }
+    }
+
+    return deleted;
+}
+
 static inline void
 wmem_map_grow(wmem_map_t *map)
 {
@@ -189,6 +647,10 @@ wmem_map_insert(wmem_map_t *map, const void *key, void *value)
     wmem_map_item_t **item;
     void *old_val;
 
+    if (map->open) {
+        return wmem_map_oinsert(map, key, value);
+    }
+
     /* Make sure we have a table */
     if (map->table == NULL) {
         wmem_map_init_table(map);
@@ -231,6 +693,10 @@ wmem_map_contains(wmem_map_t *map, const void *key)
 {
     wmem_map_item_t *item;
 
+    if (map != NULL && map->open) {
+        return wmem_map_ofind(map, key, NULL) != NULL;
+    }
+
     /* Make sure we have map and a table */
     if (map == NULL || map->table == NULL) {
         return false;
@@ -255,6 +721,11 @@ wmem_map_lookup(wmem_map_t *map, const void *key)
 {
     wmem_map_item_t *item;
 
+    if (map != NULL && map->open) {
+        wmem_map_slot_t *slot = wmem_map_ofind(map, key, NULL);
+        return slot ? slot->value : NULL;
+    }
+
     /* Make sure we have map and a table */
     if (map == NULL || map->table == NULL) {
         return NULL;
@@ -279,6 +750,20 @@ wmem_map_lookup_extended(wmem_map_t *map, const void *key, const void **orig_key
 {
     wmem_map_item_t *item;
 
+    if (map != NULL && map->open) {
+        wmem_map_slot_t *slot = wmem_map_ofind(map, key, NULL);
+        if (slot == NULL) {
+            return false;
+        }
+        if (orig_key) {
+            *orig_key = slot->key;
+        }
+        if (value) {
+            *value = slot->value;
+        }
+        return true;
+    }
+
     /* Make sure we have map and a table */
     if (map == NULL || map->table == NULL) {
         return false;
@@ -310,6 +795,10 @@ wmem_map_remove(wmem_map_t *map, const void *key)
     wmem_map_item_t **item, *tmp;
     void *value;
 
+    if (map != NULL && map->open) {
+        return wmem_map_oremove(map, key, &value) ? value : NULL;
+    }
+
     /* Make sure we have map and a table */
     if (map == NULL || map->table == NULL) {
         return NULL;
@@ -341,6 +830,11 @@ wmem_map_steal(wmem_map_t *map, const void *key)
 {
     wmem_map_item_t **item, *tmp;
 
+    /* Nothing is allocated per item, so this is the same as removing it */
+    if (map != NULL && map->open) {
+        return wmem_map_oremove(map, key, NULL);
+    }
+
     /* Make sure we have map and a table */
     if (map == NULL || map->table == NULL) {
         return false;
@@ -372,7 +866,18 @@ wmem_map_get_keys(wmem_allocator_t *list_allocator, wmem_map_t *map)
     wmem_map_item_t *cur;
     wmem_list_t* list = wmem_list_new(list_allocator);
 
-    if (map->table != NULL) {
+    if (map->open) {
+        wmem_map_otable_t *tbls[2] = { &map->otable, &map->old_otable };
+
+        for (unsigned t = 0; t < 2; t++) {
+            for (i = 0; tbls[t]->ctrl && i < OCAPACITY(tbls[t]); i++) {
+                if (WMEM_MAP_CTRL_FULL(tbls[t]->ctrl[i])) {
+                    wmem_list_prepend(list, (void*)tbls[t]->slots[i].key);
+                }
+            }
+        }
+    }
+    else if (map->table != NULL) {
         capacity = CAPACITY(map);
 
         /* copy all the elements into the list over from table */
@@ -394,6 +899,20 @@ wmem_map_foreach(wmem_map_t *map, GHFunc foreach_func, void * user_data)
     wmem_map_item_t *cur;
     unsigned i;
 
+    if (map != NULL && map->open) {
+        wmem_map_otable_t *tbls[2] = { &map->otable, &map->old_otable };
+        size_t j;
+
+        for (unsigned t = 0; t < 2; t++) {
+            for (j = 0; tbls[t]->ctrl && j < OCAPACITY(tbls[t]); j++) {
+                if (WMEM_MAP_CTRL_FULL(tbls[t]->ctrl[j])) {
+                    foreach_func((void *)tbls[t]->slots[j].key, tbls[t]->slots[j].value, user_data);
+                }
+            }
+        }
+        return;
+    }
+
     /* Make sure we have a table */
     if (map == NULL || map->table == NULL) {
         return;
@@ -414,6 +933,12 @@ wmem_map_foreach_remove(wmem_map_t *map, GHRFunc foreach_func, void * user_data)
     wmem_map_item_t **item, *tmp;
     unsigned i, deleted = 0;
 
+    if (map != NULL && map->open) {
+        deleted  = wmem_map_otable_foreach_remove(map, &map->otable, foreach_func, user_data);
+        deleted += wmem_map_otable_foreach_remove(map, &map->old_otable, foreach_func, user_data);
+        return deleted;
+    }
+
     /* Make sure we have a table */
     if (map == NULL || map->table == NULL) {
         return 0;
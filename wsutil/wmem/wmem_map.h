@@ -77,6 +77,23 @@ wmem_map_new_autoreset(wmem_allocator_t *metadata_scope, wmem_allocator_t *data_
         GHashFunc hash_func, GEqualFunc eql_func)
 G_GNUC_MALLOC;
 
+/** Makes the map use open addressing instead of chaining. The items are kept
+ * in the table itself rather than in a node allocated for each of them, and
+ * the slots of a group are checked against the key's hash all at once (with
+ * SSE2 or NEON where available). Growing the table moves the items to the new
+ * one a few at a time over the following insertions instead of all at once.
+ * Maps keyed by g_direct_hash and g_direct_equal don't call them at all.
+ *
+ * This suits large, lookup-heavy maps. Setting the WIRESHARK_WMEM_MAP_OVERRIDE
+ * environment variable to "open" (or "chained") makes it the default for (or
+ * turns it off on) every map.
+ *
+ * @param map The map, which must be empty.
+ */
+WS_DLL_PUBLIC
+void
+wmem_map_set_open_addressing(wmem_map_t *map);
+
 /** Inserts a value into the map.
  *
  * @param map The map to insert into. Must not be NULL.
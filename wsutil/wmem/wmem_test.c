@@ -20,6 +20,7 @@
 #include "wmem_allocator_block.h"
 #include "wmem_allocator_block_fast.h"
 #include "wmem_allocator_simple.h"
+#include "wmem_allocator_slab.h"
 #include "wmem_allocator_strict.h"
 
 #include <wsutil/time_util.h>
@@ -57,6 +58,9 @@ wmem_allocator_force_new(const wmem_allocator_type_t type)
         case WMEM_ALLOCATOR_STRICT:
             wmem_strict_allocator_init(allocator);
             break;
+        case WMEM_ALLOCATOR_SLAB:
+            wmem_slab_allocator_init(allocator);
+            break;
         default:
             g_assert_not_reached();
             /* This is necessary to squelch MSVC errors; is there
@@ -337,12 +341,37 @@ wmem_test_allocator(wmem_allocator_type_t type, wmem_verify_func verify,
     wmem_destroy_allocator(allocator);
 }
 
+static void
+wmem_test_allocator_used_bytes(void)
+{
+    wmem_allocator_t *allocator;
+    void *ptr1, *ptr2;
+    size_t used;
+
+    allocator = wmem_allocator_force_new(WMEM_ALLOCATOR_BLOCK);
+    g_assert_true(wmem_allocator_used_bytes(allocator) == 0);
+
+    ptr1 = wmem_alloc(allocator, 100);
+    used = wmem_allocator_used_bytes(allocator);
+    g_assert_true(used >= 100);
+    ptr2 = wmem_alloc(allocator, 1000);
+    g_assert_true(wmem_allocator_used_bytes(allocator) >= used + 1000);
+
+    wmem_free(allocator, ptr2);
+    g_assert_true(wmem_allocator_used_bytes(allocator) == used);
+    wmem_free(allocator, ptr1);
+    g_assert_true(wmem_allocator_used_bytes(allocator) == 0);
+
+    wmem_destroy_allocator(allocator);
+}
+
 static void
 wmem_test_allocator_block(void)
 {
     wmem_test_allocator(WMEM_ALLOCATOR_BLOCK, &wmem_block_verify,
             MAX_SIMULTANEOUS_ALLOCS*64);
     wmem_test_allocator_jumbo(WMEM_ALLOCATOR_BLOCK, &wmem_block_verify);
+    wmem_test_allocator_used_bytes();
 }
 
 static void
@@ -361,6 +390,14 @@ wmem_test_allocator_simple(void)
     wmem_test_allocator_jumbo(WMEM_ALLOCATOR_SIMPLE, NULL);
 }
 
+static void
+wmem_test_allocator_slab(void)
+{
+    wmem_test_allocator(WMEM_ALLOCATOR_SLAB, NULL,
+            MAX_SIMULTANEOUS_ALLOCS*64);
+    wmem_test_allocator_jumbo(WMEM_ALLOCATOR_SLAB, NULL);
+}
+
 static void
 wmem_test_allocator_strict(void)
 {
@@ -628,6 +665,144 @@ wmem_test_stringperf(void)
     g_free(str_ptr);
 }
 
+/* The allocations made in the packet scope while dissecting a packet with a
+ * protocol tree, on a 64-bit platform: a proto_node and a field_info for
+ * each item, a label for some of them, and some strings, string buffers
+ * growing by realloc and the odd reassembled buffer. */
+#define PERF_PACKETS            20000
+#define PERF_PROTO_NODE_SIZE    48
+#define PERF_FIELD_INFO_SIZE    72
+#define PERF_ITEM_LABEL_SIZE    240
+
+typedef enum {
+    PERF_ALLOC,
+    PERF_REALLOC,
+    PERF_FREE_ALL
+} wmem_perf_op_t;
+
+typedef struct {
+    wmem_perf_op_t op;
+    unsigned       size;
+} wmem_perf_step_t;
+
+static GArray *
+wmem_perf_packet_trace(void)
+{
+    GArray           *trace = g_array_new(false, false, sizeof(wmem_perf_step_t));
+    wmem_perf_step_t  step;
+    int               packet, item, items;
+    unsigned          strbuf_size;
+
+    for (packet = 0; packet < PERF_PACKETS; packet++) {
+        items = g_test_rand_int_range(20, 400);
+        strbuf_size = 0;
+        for (item = 0; item < items; item++) {
+            step.op = PERF_ALLOC;
+            step.size = PERF_PROTO_NODE_SIZE;
+            g_array_append_val(trace, step);
+            step.size = PERF_FIELD_INFO_SIZE;
+            g_array_append_val(trace, step);
+            if (g_test_rand_int_range(0, 4) == 0) {
+                step.size = PERF_ITEM_LABEL_SIZE;
+                g_array_append_val(trace, step);
+            }
+            if (g_test_rand_int_range(0, 8) == 0) {
+                step.size = g_test_rand_int_range(8, 64);
+                g_array_append_val(trace, step);
+            }
+            if (g_test_rand_int_range(0, 16) == 0) {
+                /* a new string buffer, or the last one growing */
+                if (strbuf_size == 0 || strbuf_size >= 1024) {
+                    step.op = PERF_ALLOC;
+                    strbuf_size = 64;
+                }
+                else {
+                    step.op = PERF_REALLOC;
+                    strbuf_size *= 2;
+                }
+                step.size = strbuf_size;
+                g_array_append_val(trace, step);
+            }
+        }
+        if (g_test_rand_int_range(0, 50) == 0) {
+            step.op = PERF_ALLOC;
+            step.size = g_test_rand_int_range(4*1024, 64*1024);
+            g_array_append_val(trace, step);
+        }
+        step.op = PERF_FREE_ALL;
+        step.size = 0;
+        g_array_append_val(trace, step);
+    }
+
+    return trace;
+}
+
+static void
+wmem_perf_replay(wmem_allocator_t *allocator, GArray *trace)
+{
+    wmem_perf_step_t *step;
+    char             *ptr = NULL;
+    char             *strbuf = NULL;
+
+    for (unsigned i = 0; i < trace->len; i++) {
+        step = &g_array_index(trace, wmem_perf_step_t, i);
+        switch (step->op) {
+            case PERF_ALLOC:
+                ptr = (char *)wmem_alloc(allocator, step->size);
+                ptr[0] = ptr[step->size - 1] = 0;
+                if (step->size == 64)
+                    strbuf = ptr;
+                break;
+            case PERF_REALLOC:
+                strbuf = (char *)wmem_realloc(allocator, strbuf, step->size);
+                strbuf[step->size - 1] = 0;
+                break;
+            case PERF_FREE_ALL:
+                wmem_free_all(allocator);
+                strbuf = NULL;
+                break;
+        }
+    }
+}
+
+/* NOTE: You have to run "wmem_test -m perf" to run the performance tests. */
+static void
+wmem_test_packetperf(void)
+{
+    static const struct {
+        wmem_allocator_type_t  type;
+        const char            *name;
+    } allocators[] = {
+        { WMEM_ALLOCATOR_BLOCK,      "block" },
+        { WMEM_ALLOCATOR_BLOCK_FAST, "block_fast" },
+        { WMEM_ALLOCATOR_SLAB,       "slab" },
+    };
+    wmem_allocator_t   *allocator;
+    GArray             *trace;
+    double              start_utime, start_stime, end_utime, end_stime, utime_ms, stime_ms;
+
+    trace = wmem_perf_packet_trace();
+
+    for (unsigned i = 0; i < G_N_ELEMENTS(allocators); i++) {
+        allocator = wmem_allocator_force_new(allocators[i].type);
+
+        /* Once to get the blocks every allocator keeps across free_all,
+         * then the timed run. */
+        wmem_perf_replay(allocator, trace);
+
+        RESOURCE_USAGE_START;
+        wmem_perf_replay(allocator, trace);
+        RESOURCE_USAGE_END;
+        g_test_minimized_result(utime_ms + stime_ms,
+            "%s: %d packets: u %.3f ms s %.3f ms", allocators[i].name,
+            PERF_PACKETS, utime_ms, stime_ms);
+
+        wmem_destroy_allocator(allocator);
+    }
+
+    g_array_free(trace, true);
+}
+
 /* DATA STRUCTURE TESTING FUNCTIONS (/wmem/datastruct/) */
 
 static void
@@ -1019,6 +1194,119 @@ wmem_test_map(void)
     wmem_destroy_allocator(allocator);
 }
 
+static void
+wmem_test_map_open(void)
+{
+    wmem_allocator_t   *allocator, *extra_allocator;
+    wmem_map_t         *map;
+    GHashTable         *shadow;
+    char               *str_key;
+    const void         *key_ret;
+    void               *ret;
+    unsigned int        i, key;
+    wmem_list_t        *keys;
+
+    allocator = wmem_allocator_new(WMEM_ALLOCATOR_STRICT);
+    extra_allocator = wmem_allocator_new(WMEM_ALLOCATOR_STRICT);
+
+    /* insertion, lookup and removal of integer keys through several
+     * incremental resizes */
+    map = wmem_map_new(allocator, g_direct_hash, g_direct_equal);
+    wmem_map_set_open_addressing(map);
+    for (i=0; i<CONTAINER_ITERS; i++) {
+        ret = wmem_map_insert(map, GINT_TO_POINTER(i), GINT_TO_POINTER(777777));
+        g_assert_true(ret == NULL);
+        ret = wmem_map_insert(map, GINT_TO_POINTER(i), GINT_TO_POINTER(i));
+        g_assert_true(ret == GINT_TO_POINTER(777777));
+        /* keys inserted earlier, some of them still in the old table */
+        key = g_test_rand_int_range(0, i+1);
+        g_assert_true(wmem_map_lookup(map, GINT_TO_POINTER(key)) == GINT_TO_POINTER(key));
+    }
+    g_assert_true(wmem_map_size(map) == CONTAINER_ITERS);
+    for (i=0; i<CONTAINER_ITERS; i++) {
+        g_assert_true(wmem_map_lookup_extended(map, GINT_TO_POINTER(i), &key_ret, &ret));
+        g_assert_true(key_ret == GINT_TO_POINTER(i));
+        g_assert_true(ret == GINT_TO_POINTER(i));
+        ret = wmem_map_remove(map, GINT_TO_POINTER(i));
+        g_assert_true(ret == GINT_TO_POINTER(i));
+        g_assert_true(wmem_map_contains(map, GINT_TO_POINTER(i)) == false);
+        g_assert_true(wmem_map_remove(map, GINT_TO_POINTER(i)) == NULL);
+    }
+    g_assert_true(wmem_map_size(map) == 0);
+    wmem_free_all(allocator);
+
+    /* random inserts and removals against a GHashTable, so that deleted slots
+     * pile up and get rehashed away */
+    map = wmem_map_new(allocator, g_int_hash, g_int_equal);
+    wmem_map_set_open_addressing(map);
+    shadow = g_hash_table_new(g_direct_hash, g_direct_equal);
+    for (i=0; i<CONTAINER_ITERS*4; i++) {
+        unsigned int *int_key = wmem_new(allocator, unsigned int);
+
+        *int_key = g_test_rand_int_range(0, CONTAINER_ITERS/4);
+        key = *int_key + 1;
+        if (g_test_rand_int_range(0, 3) == 0) {
+            ret = wmem_map_remove(map, int_key);
+            g_assert_true(ret == g_hash_table_lookup(shadow, GUINT_TO_POINTER(key)));
+            g_hash_table_remove(shadow, GUINT_TO_POINTER(key));
+        }
+        else {
+            ret = wmem_map_insert(map, int_key, GUINT_TO_POINTER(key));
+            g_assert_true(ret == NULL || ret == GUINT_TO_POINTER(key));
+            g_hash_table_insert(shadow, GUINT_TO_POINTER(key), GUINT_TO_POINTER(key));
+        }
+        g_assert_true(wmem_map_size(map) == g_hash_table_size(shadow));
+    }
+    keys = wmem_map_get_keys(allocator, map);
+    g_assert_true(wmem_list_count(keys) == g_hash_table_size(shadow));
+    g_hash_table_destroy(shadow);
+    wmem_free_all(allocator);
+
+    /* auto-reset */
+    map = wmem_map_new_autoreset(allocator, extra_allocator, g_direct_hash, g_direct_equal);
+    wmem_map_set_open_addressing(map);
+    for (i=0; i<CONTAINER_ITERS; i++) {
+        wmem_map_insert(map, GINT_TO_POINTER(i), GINT_TO_POINTER(i));
+    }
+    wmem_free_all(extra_allocator);
+    g_assert_true(wmem_map_size(map) == 0);
+    for (i=0; i<CONTAINER_ITERS; i++) {
+        g_assert_true(wmem_map_lookup(map, GINT_TO_POINTER(i)) == NULL);
+    }
+    wmem_map_insert(map, GINT_TO_POINTER(1), GINT_TO_POINTER(1));
+    g_assert_true(wmem_map_lookup(map, GINT_TO_POINTER(1)) == GINT_TO_POINTER(1));
+    wmem_free_all(allocator);
+
+    /* string keys, for-each and for-each-remove */
+    map = wmem_map_new(allocator, wmem_str_hash, g_str_equal);
+    wmem_map_set_open_addressing(map);
+    for (i=0; i<CONTAINER_ITERS; i++) {
+        str_key = wmem_test_rand_string(allocator, 1, 64);
+        wmem_map_insert(map, str_key, GINT_TO_POINTER(2));
+        g_assert_true(wmem_map_lookup(map, str_key) == GINT_TO_POINTER(2));
+    }
+    wmem_map_foreach(map, check_val_map, GINT_TO_POINTER(2));
+    wmem_map_foreach_remove(map, equal_val_map, GINT_TO_POINTER(2));
+    g_assert_true(wmem_map_size(map) == 0);
+
+    map = wmem_map_new(allocator, g_direct_hash, g_direct_equal);
+    wmem_map_set_open_addressing(map);
+    for (i=0; i<CONTAINER_ITERS; i++) {
+        wmem_map_insert(map, GINT_TO_POINTER(i), GINT_TO_POINTER(i));
+    }
+    for (i=0; i<CONTAINER_ITERS; i+=2) {
+        g_assert_true(wmem_map_foreach_remove(map, equal_val_map, GINT_TO_POINTER(i)) == 1);
+    }
+    g_assert_true(wmem_map_size(map) == CONTAINER_ITERS/2);
+    for (i=1; i<CONTAINER_ITERS; i+=2) {
+        g_assert_true(wmem_map_steal(map, GINT_TO_POINTER(i)));
+    }
+    g_assert_true(wmem_map_size(map) == 0);
+
+    wmem_destroy_allocator(extra_allocator);
+    wmem_destroy_allocator(allocator);
+}
+
 static void
 wmem_test_queue(void)
 {
@@ -1455,6 +1743,7 @@ main(int argc, char **argv)
     g_test_add_func("/wmem/allocator/block",     wmem_test_allocator_block);
     g_test_add_func("/wmem/allocator/blk_fast",  wmem_test_allocator_block_fast);
     g_test_add_func("/wmem/allocator/simple",    wmem_test_allocator_simple);
+    g_test_add_func("/wmem/allocator/slab",      wmem_test_allocator_slab);
     g_test_add_func("/wmem/allocator/strict",    wmem_test_allocator_strict);
     g_test_add_func("/wmem/allocator/callbacks", wmem_test_allocator_callbacks);
 
@@ -1463,11 +1752,13 @@ main(int argc, char **argv)
 
     if (g_test_perf()) {
         g_test_add_func("/wmem/utils/stringperf", wmem_test_stringperf);
+        g_test_add_func("/wmem/allocator/packetperf", wmem_test_packetperf);
     }
 
     g_test_add_func("/wmem/datastruct/array",  wmem_test_array);
     g_test_add_func("/wmem/datastruct/list",   wmem_test_list);
     g_test_add_func("/wmem/datastruct/map",    wmem_test_map);
+    g_test_add_func("/wmem/datastruct/map/open", wmem_test_map_open);
     g_test_add_func("/wmem/datastruct/queue",  wmem_test_queue);
     g_test_add_func("/wmem/datastruct/stack",  wmem_test_stack);
     g_test_add_func("/wmem/datastruct/strbuf", wmem_test_strbuf);